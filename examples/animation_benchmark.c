@@ -0,0 +1,188 @@
+#include <owl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static struct owl_plataform *window;
+static struct owl_renderer *renderer;
+static struct owl_model *model;
+
+#define CHECK(fn)                                                             \
+  do {                                                                        \
+    int code = (fn);                                                          \
+    if (code) {                                                               \
+      printf("something went wrong in call: %s, code %i\n", (#fn), code);     \
+      return 0;                                                               \
+    }                                                                         \
+  } while (0)
+
+#define NUM_FRAMES 10000
+#define FRAME_TIME (1.0F / 60.0F)
+
+/* playback seeks to a random time every SEEK_INTERVAL frames and jumps to
+ * right before the end every WRAP_INTERVAL frames, so both the binary search
+ * and the wrap around are timed even on clips longer than NUM_FRAMES
+ * frames */
+#define SEEK_INTERVAL 97
+#define WRAP_INTERVAL 251
+
+struct playback {
+  int32_t frame;
+  float time;
+  uint32_t random;
+  int32_t num_seeks;
+  int32_t num_wraps;
+};
+
+static void playback_init(struct playback *playback) {
+  playback->frame = 0;
+  playback->time = 0.0F;
+  playback->random = 1;
+  playback->num_seeks = 0;
+  playback->num_wraps = 0;
+}
+
+/* the same frames every time, the state of a fixed seed lcg */
+static float playback_advance(struct playback *playback, float end) {
+  int32_t const frame = ++playback->frame;
+
+  if (!(frame % SEEK_INTERVAL)) {
+    playback->random = playback->random * 1103515245U + 12345U;
+    playback->time = end * (float)((playback->random >> 8) & 0xFFFF) /
+                     65536.0F;
+    ++playback->num_seeks;
+    return playback->time;
+  }
+
+  if (!(frame % WRAP_INTERVAL))
+    playback->time = end - 0.5F * FRAME_TIME;
+
+  if (end < (playback->time += FRAME_TIME)) {
+    playback->time -= end;
+    ++playback->num_wraps;
+  }
+
+  return playback->time;
+}
+
+/* what owl_model_update_animation used to do */
+static int32_t find_keyframe_linear(
+    struct owl_model_animation_sampler const *sampler, float time) {
+  int32_t i;
+
+  for (i = 0; i < sampler->num_inputs - 1; ++i)
+    if (time >= sampler->inputs[i] && time <= sampler->inputs[i + 1])
+      return i;
+
+  return -1;
+}
+
+static double seconds(clock_t start) {
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* plays num_samplers samplers for NUM_FRAMES frames, looping at the end and
+ * seeking every now and then */
+static void benchmark(char const *name, int32_t num_samplers,
+                      struct owl_model_animation_sampler const *samplers,
+                      float end) {
+  int32_t i;
+  int32_t j;
+  float time;
+  clock_t start;
+  double linear;
+  double cursor;
+  long checksum = 0;
+  struct playback playback;
+  int32_t *keyframes = malloc(num_samplers * sizeof(*keyframes));
+
+  for (j = 0; j < num_samplers; ++j)
+    keyframes[j] = 0;
+
+  playback_init(&playback);
+
+  start = clock();
+  for (i = 0; i < NUM_FRAMES; ++i) {
+    time = playback_advance(&playback, end);
+
+    for (j = 0; j < num_samplers; ++j)
+      checksum += find_keyframe_linear(&samplers[j], time);
+  }
+  linear = seconds(start);
+
+  playback_init(&playback);
+
+  start = clock();
+  for (i = 0; i < NUM_FRAMES; ++i) {
+    time = playback_advance(&playback, end);
+
+    for (j = 0; j < num_samplers; ++j) {
+      keyframes[j] = owl_model_find_keyframe(&samplers[j], keyframes[j], time);
+      checksum -= keyframes[j];
+    }
+  }
+  cursor = seconds(start);
+
+  printf("%-24s %6i samplers  %4i wraps  %4i seeks  linear %8.3f ms  "
+         "cursor %8.3f ms  (%li)\n",
+         name, num_samplers, playback.num_wraps, playback.num_seeks,
+         linear * 1000.0, cursor * 1000.0, checksum);
+
+  free(keyframes);
+}
+
+static void benchmark_synthetic(int32_t num_keyframes) {
+  int32_t i;
+  char name[64];
+  struct owl_model_animation_sampler sampler;
+
+  sampler.interpolation = OWL_ANIMATION_INTERPOLATION_LINEAR;
+  sampler.num_inputs = num_keyframes;
+  sampler.inputs = malloc(num_keyframes * sizeof(*sampler.inputs));
+  sampler.num_outputs = 0;
+  sampler.outputs = NULL;
+
+  /* 30 keyframes per second */
+  for (i = 0; i < num_keyframes; ++i)
+    sampler.inputs[i] = (float)i / 30.0F;
+
+  sprintf(name, "synthetic %i keys", num_keyframes);
+  benchmark(name, 1, &sampler, sampler.inputs[num_keyframes - 1]);
+
+  free(sampler.inputs);
+}
+
+int main(void) {
+  benchmark_synthetic(64);
+  benchmark_synthetic(1024);
+  benchmark_synthetic(16384);
+  benchmark_synthetic(262144);
+
+  window = malloc(sizeof(*window));
+  CHECK(owl_plataform_init(window, 600, 600, "animation benchmark"));
+
+  renderer = malloc(sizeof(*renderer));
+  CHECK(owl_renderer_init(renderer, window));
+
+  model = malloc(sizeof(*model));
+  CHECK(owl_model_init(model, renderer,
+                       "../../res/CesiumMan/glTF/CesiumMan.gltf"));
+
+  if (model->num_animations) {
+    struct owl_model_animation const *animation = &model->animations[0];
+    benchmark("CesiumMan", animation->num_samplers,
+              &model->samplers[animation->first_sampler], animation->end);
+  }
+
+  owl_model_deinit(model, renderer);
+  free(model);
+
+  owl_renderer_deinit(renderer);
+  free(renderer);
+
+  owl_plataform_deinit(window);
+  free(window);
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include <owl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static struct owl_plataform *window;
+static struct owl_renderer *renderer;
+static struct owl_model *model;
+static struct owl_model_baked_animation *baked;
+static struct owl_model_baked_instance *instances;
+
+#define CHECK(fn)                                                             \
+  do {                                                                        \
+    int code = (fn);                                                          \
+    if (code) {                                                               \
+      printf("something went wrong in call: %s, code %i\n", (#fn), code);     \
+      return 0;                                                               \
+    }                                                                         \
+  } while (0)
+
+#define GRID_SIZE 32
+#define NUM_INSTANCES (GRID_SIZE * GRID_SIZE)
+#define SPACING 1.5F
+#define FRAME_RATE 30.0F
+
+/* NUM_INSTANCES characters playing a clip baked at load, no cpu animation */
+int main(void) {
+  int32_t i;
+  float duration;
+
+  window = malloc(sizeof(*window));
+  CHECK(owl_plataform_init(window, 600, 600, "baked crowd"));
+
+  renderer = malloc(sizeof(*renderer));
+  CHECK(owl_renderer_init(renderer, window));
+
+  CHECK(owl_renderer_load_font(renderer, 64.0F, "../../res/CascadiaMono.ttf"));
+
+  CHECK(owl_renderer_load_skybox(renderer, "../../res/skybox"));
+
+  model = malloc(sizeof(*model));
+  CHECK(owl_model_init(model, renderer,
+                       "../../res/CesiumMan/glTF/CesiumMan.gltf"));
+
+  if (!model->num_animations) {
+    printf("the model has no animations\n");
+    return 0;
+  }
+
+  baked = malloc(sizeof(*baked));
+  CHECK(owl_model_baked_animation_init(baked, renderer, model, 0, FRAME_RATE));
+
+  duration = (float)baked->num_frames / baked->frame_rate;
+
+  instances = malloc(NUM_INSTANCES * sizeof(*instances));
+  for (i = 0; i < NUM_INSTANCES; ++i) {
+    owl_v3 position;
+
+    position[0] = ((float)(i % GRID_SIZE) - GRID_SIZE / 2) * SPACING;
+    position[1] = 0.0F;
+    position[2] = -((float)(i / GRID_SIZE) + 2.0F) * SPACING;
+
+    OWL_M4_IDENTITY(instances[i].matrix);
+    owl_m4_translate(position, instances[i].matrix);
+
+    /* spread the start times over the clip */
+    instances[i].time = duration * (float)i / NUM_INSTANCES;
+  }
+
+  while (!owl_plataform_should_close(window)) {
+    float const time = owl_plataform_get_time(window);
+
+    CHECK(owl_renderer_begin_frame(renderer));
+
+    owl_draw_skybox(renderer);
+
+    /* the only per frame work, the shader wraps the time around */
+    for (i = 0; i < NUM_INSTANCES; ++i)
+      instances[i].time = duration * (float)i / NUM_INSTANCES + time;
+
+    CHECK(owl_draw_model_baked(renderer, baked, NUM_INSTANCES, instances));
+
+    owl_draw_renderer_state(renderer);
+
+    CHECK(owl_renderer_end_frame(renderer));
+
+    owl_plataform_poll_events(window);
+  }
+
+  free(instances);
+
+  owl_model_baked_animation_deinit(baked, renderer);
+  free(baked);
+
+  owl_model_deinit(model, renderer);
+  free(model);
+
+  owl_renderer_deinit(renderer);
+  free(renderer);
+
+  owl_plataform_deinit(window);
+  free(window);
+
+  return 0;
+}
@@ -0,0 +1,24 @@
+#include <owl.h>
+
+#include <stdio.h>
+
+/* cooks a gltf model for owl_model_init_cooked, no window or device needed:
+ *   cook ../../res/CesiumMan/glTF/CesiumMan.gltf CesiumMan.owlm */
+int main(int argc, char **argv) {
+  int ret;
+
+  if (3 != argc) {
+    printf("usage: %s <model.gltf> <model.owlm>\n", argv[0]);
+    return 1;
+  }
+
+  ret = owl_model_cook(argv[1], argv[2]);
+  if (ret) {
+    printf("failed to cook %s, code %i\n", argv[1], ret);
+    return 1;
+  }
+
+  printf("cooked %s into %s\n", argv[1], argv[2]);
+
+  return 0;
+}
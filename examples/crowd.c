@@ -0,0 +1,150 @@
+#include <owl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static struct owl_plataform *window;
+static struct owl_renderer *renderer;
+static struct owl_model *model;
+static struct owl_model_instance *instances;
+static struct owl_model_instance_update *updates;
+static owl_m4 *matrices;
+static struct owl_thread_pool pool;
+
+#define CHECK(fn)                                                             \
+  do {                                                                        \
+    int code = (fn);                                                          \
+    if (code) {                                                               \
+      printf("something went wrong in call: %s, code %i\n", (#fn), code);     \
+      return 0;                                                               \
+    }                                                                         \
+  } while (0)
+
+#define GRID_SIZE 8
+#define NUM_INSTANCES (GRID_SIZE * GRID_SIZE)
+#define SPACING 1.5F
+/* the depth prepass is toggled every MEASURE_FRAMES frames */
+#define MEASURE_FRAMES 256
+
+/* one model, NUM_INSTANCES characters playing the same clip out of phase */
+int main(void) {
+  int32_t i;
+  double time_stamp = 0.0;
+  double prev_time_stamp = 0.0;
+  uint64_t invocations = 0;
+  uint64_t num_samples = 0;
+
+  window = malloc(sizeof(*window));
+  CHECK(owl_plataform_init(window, 600, 600, "crowd"));
+
+  renderer = malloc(sizeof(*renderer));
+  CHECK(owl_renderer_init(renderer, window));
+
+  /* the depth prepass only takes skinned models once they are skinned on the
+   * gpu */
+  renderer->compute_skinning = 1;
+
+  CHECK(owl_renderer_load_font(renderer, 64.0F, "../../res/CascadiaMono.ttf"));
+
+  CHECK(owl_renderer_load_skybox(renderer, "../../res/skybox"));
+
+  model = malloc(sizeof(*model));
+  CHECK(owl_model_init(model, renderer,
+                       "../../res/CesiumMan/glTF/CesiumMan.gltf"));
+
+  CHECK(owl_thread_pool_init(&pool, owl_thread_count_cores()));
+
+  instances = malloc(NUM_INSTANCES * sizeof(*instances));
+  updates = malloc(NUM_INSTANCES * sizeof(*updates));
+  matrices = malloc(NUM_INSTANCES * sizeof(*matrices));
+  for (i = 0; i < NUM_INSTANCES; ++i) {
+    CHECK(owl_model_instance_init(&instances[i], renderer, model));
+
+    /* spread the start times over the clip */
+    if (model->num_animations)
+      CHECK(owl_model_instance_update_animation(
+          renderer, &instances[i],
+          model->animations[0].end * (float)i / NUM_INSTANCES, 0));
+  }
+
+  while (!owl_plataform_should_close(window)) {
+    float const dt = time_stamp - prev_time_stamp;
+
+    prev_time_stamp = time_stamp;
+    time_stamp = owl_plataform_get_time(window);
+
+    /* the fragment invocations lag behind by the frames in flight, those
+     * still counting the other setting are skipped */
+    if (renderer->frame_count % MEASURE_FRAMES > OWL_NUM_IN_FLIGHT_FRAMES) {
+      invocations += renderer->fragment_invocations;
+      ++num_samples;
+    }
+
+    if (!((renderer->frame_count + 1) % MEASURE_FRAMES)) {
+      printf("depth_prepass: %i, fragment_invocations: %lu\n",
+             renderer->depth_prepass,
+             (unsigned long)(invocations / num_samples));
+      invocations = 0;
+      num_samples = 0;
+    }
+
+    renderer->depth_prepass = (renderer->frame_count / MEASURE_FRAMES) % 2;
+
+    CHECK(owl_renderer_begin_frame(renderer));
+
+    /* animates every instance across the pool and builds the joint palettes
+     * the draws below use, the far rows animate at a lower rate */
+    for (i = 0; i < NUM_INSTANCES; ++i) {
+      owl_v3 position;
+
+      position[0] = ((float)(i % GRID_SIZE) - GRID_SIZE / 2) * SPACING;
+      position[1] = 0.0F;
+      position[2] = -((float)(i / GRID_SIZE) + 2.0F) * SPACING;
+
+      OWL_M4_IDENTITY(matrices[i]);
+      owl_m4_translate(position, matrices[i]);
+
+      updates[i].instance = &instances[i];
+      updates[i].animation = model->num_animations ? 0 : -1;
+      updates[i].dt = dt;
+      updates[i].screen_size = owl_model_instance_screen_size(
+          renderer, &instances[i], matrices[i]);
+    }
+
+    CHECK(owl_model_update_instances(renderer, &pool, NUM_INSTANCES, updates));
+
+    owl_draw_skybox(renderer);
+
+    /* the depth of every instance is laid down before any of them shades */
+    for (i = 0; i < NUM_INSTANCES; ++i)
+      owl_draw_model_instance_depth(renderer, &instances[i], matrices[i]);
+
+    for (i = 0; i < NUM_INSTANCES; ++i)
+      owl_draw_model_instance(renderer, &instances[i], matrices[i]);
+
+    owl_draw_renderer_state(renderer);
+
+    CHECK(owl_renderer_end_frame(renderer));
+
+    owl_plataform_poll_events(window);
+  }
+
+  for (i = 0; i < NUM_INSTANCES; ++i)
+    owl_model_instance_deinit(&instances[i], renderer);
+  free(matrices);
+  free(updates);
+  free(instances);
+
+  owl_thread_pool_deinit(&pool);
+
+  owl_model_deinit(model, renderer);
+  free(model);
+
+  owl_renderer_deinit(renderer);
+  free(renderer);
+
+  owl_plataform_deinit(window);
+  free(window);
+
+  return 0;
+}
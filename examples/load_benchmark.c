@@ -0,0 +1,89 @@
+#include <owl.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static struct owl_plataform *window;
+static struct owl_renderer *renderer;
+static struct owl_model *model;
+
+#define CHECK(fn)                                                             \
+  do {                                                                        \
+    int code = (fn);                                                          \
+    if (code) {                                                               \
+      printf("something went wrong in call: %s, code %i\n", (#fn), code);     \
+      return 0;                                                               \
+    }                                                                         \
+  } while (0)
+
+#define NUM_RUNS 5
+
+/* the FlightHelmet in res is missing its leather textures */
+static char const *paths[] = {"../../res/CesiumMan/glTF/CesiumMan.gltf",
+                              "../../res/DamagedHelmet/glTF/DamagedHelmet.gltf",
+                              "../../res/Suzanne/glTF/Suzanne.gltf"};
+
+/* loads path NUM_RUNS times with num_threads image decoding threads and
+ * returns the fastest load in seconds, the wall time the loading thread sees */
+static double benchmark(char const *path, int32_t num_threads) {
+  int32_t i;
+  double best = -1.0;
+
+  renderer->num_load_threads = num_threads;
+
+  for (i = 0; i < NUM_RUNS; ++i) {
+    double time;
+    double start = owl_plataform_get_time(window);
+
+    if (owl_model_init(model, renderer, path)) {
+      printf("could not load %s\n", path);
+      return -1.0;
+    }
+
+    time = owl_plataform_get_time(window) - start;
+
+    owl_model_deinit(model, renderer);
+
+    if (0.0 > best || time < best)
+      best = time;
+  }
+
+  return best;
+}
+
+int main(void) {
+  int32_t i;
+  int32_t num_cores;
+
+  window = malloc(sizeof(*window));
+  CHECK(owl_plataform_init(window, 600, 600, "load benchmark"));
+
+  renderer = malloc(sizeof(*renderer));
+  CHECK(owl_renderer_init(renderer, window));
+
+  model = malloc(sizeof(*model));
+
+  num_cores = owl_thread_count_cores();
+
+  for (i = 0; i < (int32_t)(sizeof(paths) / sizeof(paths[0])); ++i) {
+    double serial = benchmark(paths[i], 1);
+    double parallel = benchmark(paths[i], num_cores);
+
+    if (0.0 > serial || 0.0 > parallel)
+      continue;
+
+    printf("%-48s 1 thread %8.2f ms  %2i threads %8.2f ms  (%.2fx)\n",
+           paths[i], serial * 1000.0, num_cores, parallel * 1000.0,
+           serial / parallel);
+  }
+
+  free(model);
+
+  owl_renderer_deinit(renderer);
+  free(renderer);
+
+  owl_plataform_deinit(window);
+  free(window);
+
+  return 0;
+}
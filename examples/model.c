@@ -31,9 +31,11 @@ int main(void)
 	renderer = malloc(sizeof(*renderer));
 	CHECK(owl_renderer_init(renderer, window));
 
+	/* the model streams in while the loop below already renders */
 	model = malloc(sizeof(*model));
-	CHECK(owl_model_init(model, renderer,
-			     "../../res/DamagedHelmet/glTF/DamagedHelmet.gltf"));
+	CHECK(owl_model_load_async(
+		model, renderer,
+		"../../res/DamagedHelmet/glTF/DamagedHelmet.gltf"));
 
 	CHECK(owl_renderer_load_font(renderer, 64.0F,
 				     "../../res/CascadiaMono.ttf"));
@@ -59,6 +61,8 @@ int main(void)
 		(void)(axis);
 #endif
 
+		CHECK(owl_model_update_load(model, renderer));
+
 		CHECK(owl_renderer_begin_frame(renderer));
 
 		owl_draw_skybox(renderer);
@@ -67,9 +71,20 @@ int main(void)
 		owl_model_update_animation(renderer, model, dt, 0);
 #endif
 
+		owl_draw_model_depth(renderer, model, matrix);
 		owl_draw_model(renderer, model, matrix);
 		owl_draw_renderer_state(renderer);
 
+		if (model->loading) {
+			char text[64];
+			owl_v3 position = { -0.8F, 0.8F, 0.0F };
+			owl_v3 color = { 1.0F, 1.0F, 1.0F };
+
+			sprintf(text, "loading %i%%",
+				(int)(owl_model_load_progress(model) * 100.0F));
+			owl_draw_text(renderer, text, position, color);
+		}
+
 		CHECK(owl_renderer_end_frame(renderer));
 
 		owl_plataform_poll_events(window);
@@ -0,0 +1,25 @@
+# compiles SHADER to OUT and fails if the result differs from the committed
+# ${SHADER}.spv.u32, the // comment glslangValidator writes is not compared
+
+execute_process(
+  COMMAND ${VALIDATOR} ${SHADER} -V -x -o ${OUT}
+  RESULT_VARIABLE RESULT
+  WORKING_DIRECTORY ${SOURCE_DIR})
+
+if (NOT RESULT EQUAL 0)
+  message(FATAL_ERROR "failed to compile ${SHADER}")
+endif ()
+
+if (NOT EXISTS ${SOURCE_DIR}/${SHADER}.spv.u32)
+  message(FATAL_ERROR "${SHADER} has no committed binary")
+endif ()
+
+file(READ ${OUT} BUILT)
+file(READ ${SOURCE_DIR}/${SHADER}.spv.u32 COMMITTED)
+string(REGEX REPLACE "//[^\n]*\n" "" BUILT "${BUILT}")
+string(REGEX REPLACE "//[^\n]*\n" "" COMMITTED "${COMMITTED}")
+
+if (NOT BUILT STREQUAL COMMITTED)
+  message(FATAL_ERROR "${SHADER}.spv.u32 does not match ${SHADER}, rebuild it "
+                      "with glslangValidator -V -x")
+endif ()
@@ -0,0 +1,137 @@
+#version 450
+
+layout(location = 0) in vec3 inPos;
+// octahedral encoded
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inUV0;
+layout(location = 3) in vec2 inUV1;
+layout(location = 4) in uvec4 inJoint0;
+layout(location = 5) in vec4 inWeight0;
+layout(location = 6) in vec4 inColor0;
+
+layout(set = 0, binding = 0) uniform UBO {
+  mat4 projection;
+  mat4 model;
+  mat4 view;
+  vec4 lightDir;
+  vec3 camPos;
+  float exposure;
+  float gamma;
+  float prefilteredCubeMipLevels;
+  float scaleIBLAmbient;
+  float debugViewInputs;
+  float debugViewEquation;
+}
+ubo;
+
+struct Draw {
+  vec4 min;
+  vec4 max;
+  vec4 sphere;
+  vec4 cone;
+  uint first;
+  uint numIndices;
+  int node;
+  uint batch;
+  uint batchFirst;
+  int cull;
+  int morphOffset;
+  int vertexOffset;
+  int minLod;
+  int maxLod;
+  int padding0;
+  int padding1;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Draws { Draw draws[]; };
+
+// struct owl_model_baked_header followed by every frame, a frame holds the
+// world matrix of every node and then the joint palette
+layout(std430, set = 4, binding = 0) readonly buffer Baked {
+  int numFrames;
+  int numNodes;
+  int frameSize;
+  float frameRate;
+  mat4 frames[];
+};
+
+// struct owl_model_baked_instance
+struct Instance {
+  mat4 matrix;
+  float time;
+  float padding0;
+  float padding1;
+  float padding2;
+};
+
+layout(std430, set = 5, binding = 0) readonly buffer Instances {
+  Instance instances[];
+};
+
+// right after the material of owl_pbr.frag,
+// sizeof(struct owl_model_push_constant)
+layout(push_constant) uniform BakedDraw {
+  layout(offset = 104) int draw;
+  int jointsOffset;
+  int numJoints;
+}
+bakedDraw;
+
+layout(location = 0) out vec3 outWorldPos;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec2 outUV0;
+layout(location = 3) out vec2 outUV1;
+layout(location = 4) out vec4 outColor0;
+
+int frame0;
+int frame1;
+float blend;
+
+// blends the matrix between the two frames around the instance time
+mat4 sampleFrames(int index) {
+  return (1.0 - blend) * frames[frame0 * frameSize + index] +
+         blend * frames[frame1 * frameSize + index];
+}
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+void main() {
+  outColor0 = inColor0;
+
+  Draw draw = draws[bakedDraw.draw];
+  Instance instance = instances[gl_InstanceIndex];
+
+  float t = mod(instance.time * frameRate, float(numFrames));
+  frame0 = min(int(t), numFrames - 1);
+  frame1 = (frame0 + 1) % numFrames;
+  blend = fract(t);
+
+  mat4 nodeMat = sampleFrames(draw.node);
+  mat4 modelMat = instance.matrix * nodeMat;
+
+  if (bakedDraw.numJoints > 0) {
+    int offset = numNodes + bakedDraw.jointsOffset;
+    mat4 skinMat = inWeight0.x * sampleFrames(offset + int(inJoint0.x)) +
+                   inWeight0.y * sampleFrames(offset + int(inJoint0.y)) +
+                   inWeight0.z * sampleFrames(offset + int(inJoint0.z)) +
+                   inWeight0.w * sampleFrames(offset + int(inJoint0.w));
+
+    modelMat = modelMat * skinMat;
+  }
+
+  vec4 locPos = modelMat * vec4(inPos, 1.0);
+  outNormal = normalize(transpose(inverse(mat3(modelMat))) *
+                        decodeOctahedral(inNormal));
+
+  locPos.y = -locPos.y;
+  outWorldPos = locPos.xyz / locPos.w;
+  outUV0 = inUV0;
+  outUV1 = inUV1;
+  gl_Position = ubo.projection * ubo.view * vec4(outWorldPos, 1.0);
+}
@@ -0,0 +1,89 @@
+#version 450
+
+// only the position stream is bound
+layout(location = 0) in vec3 inPos;
+
+layout(set = 0, binding = 0) uniform UBO {
+  mat4 projection;
+  mat4 model;
+  mat4 view;
+  vec4 lightDir;
+  vec3 camPos;
+  float exposure;
+  float gamma;
+  float prefilteredCubeMipLevels;
+  float scaleIBLAmbient;
+  float debugViewInputs;
+  float debugViewEquation;
+}
+ubo;
+
+struct Draw {
+  vec4 min;
+  vec4 max;
+  vec4 sphere;
+  vec4 cone;
+  uint first;
+  uint numIndices;
+  int node;
+  uint batch;
+  uint batchFirst;
+  int cull;
+  // biased by the first vertex of the primitive
+  int morphOffset;
+  int vertexOffset;
+  int minLod;
+  int maxLod;
+  int padding0;
+  int padding1;
+};
+
+struct Node {
+  mat4 matrix;
+  int jointsOffset;
+  int numJoints;
+  int weightsOffset;
+  int numWeights;
+  int lod;
+  int padding0;
+  int padding1;
+  int padding2;
+};
+
+struct MorphTarget {
+  vec4 position;
+  vec4 normal;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Draws { Draw draws[]; };
+
+layout(std430, set = 1, binding = 1) readonly buffer Nodes { Node nodes[]; };
+
+layout(std430, set = 1, binding = 6) readonly buffer MorphTargets {
+  MorphTarget targets[];
+};
+
+layout(std430, set = 1, binding = 7) readonly buffer Weights {
+  float weights[];
+};
+
+// the depth prepass and the shading pass must produce the same depth, keep
+// the math in sync with owl_pbr.vert
+invariant gl_Position;
+
+void main() {
+  // the culling pass stores the draw id as the instance
+  Draw draw = draws[gl_InstanceIndex];
+  Node node = nodes[draw.node];
+
+  vec3 pos = inPos;
+  int morph = draw.morphOffset + gl_VertexIndex * node.numWeights;
+  for (int i = 0; i < node.numWeights; ++i)
+    pos += weights[node.weightsOffset + i] * targets[morph + i].position.xyz;
+
+  // skinned nodes never reach the depth prepass without compute skinning
+  vec4 locPos = ubo.model * node.matrix * vec4(pos, 1.0);
+  locPos.y = -locPos.y;
+  vec3 worldPos = locPos.xyz / locPos.w;
+  gl_Position = ubo.projection * ubo.view * vec4(worldPos, 1.0);
+}
@@ -1,10 +1,11 @@
 #version 450
 
 layout(location = 0) in vec3 in_position;
-layout(location = 1) in vec3 in_normal;
+// octahedral encoded
+layout(location = 1) in vec2 in_normal;
 layout(location = 2) in vec2 in_uv0;
 layout(location = 3) in vec2 in_uv1;
-layout(location = 4) in vec4 in_joints0;
+layout(location = 4) in uvec4 in_joints0;
 layout(location = 5) in vec4 in_weights0;
 
 layout(set = 0, binding = 0) uniform UBO {
@@ -39,8 +40,16 @@ layout(location = 3) out vec2 out_uv1;
 layout(location = 4) out vec3 out_view;
 layout(location = 5) out vec3 out_light;
 
+vec3 decode_octahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
 void main() {
-  out_normal = in_normal;
+  out_normal = decode_octahedral(in_normal);
   out_uv0 = in_uv0;
   out_uv1 = in_uv1;
 
@@ -57,12 +66,12 @@ void main() {
         ubo.model * node.matrix * skin_matrix * vec4(in_position, 1.0);
     out_normal = normalize(transpose(inverse(mat3(ubo.view * ubo.model *
                                                   node.matrix * skin_matrix))) *
-                           in_normal);
+                           out_normal);
   } else {
     local_position = ubo.model * node.matrix * vec4(in_position, 1.0);
     out_normal =
         normalize(transpose(inverse(mat3(ubo.view * ubo.model * node.matrix))) *
-                  in_normal);
+                  out_normal);
   }
 
   // flip the y coordinate
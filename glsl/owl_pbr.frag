@@ -129,11 +129,15 @@ vec4 SRGBtoLINEAR(vec4 srgbIn) {
 // map or from the interpolated mesh normal and tangent attributes.
 vec3 getNormal() {
   // Perturb normal, see http://www.thetenthplanet.de/archives/1180
-  vec3 tangentNormal = texture(sampler2D(normalMap, sampler0),
-                               material.normalTextureSet == 0 ? inUV0 : inUV1)
-                               .xyz *
-                           2.0 -
-                       1.0;
+  // Normal maps may only store x and y, z is rebuilt from them
+  vec3 tangentNormal;
+  tangentNormal.xy = texture(sampler2D(normalMap, sampler0),
+                             material.normalTextureSet == 0 ? inUV0 : inUV1)
+                             .xy *
+                         2.0 -
+                     1.0;
+  tangentNormal.z =
+      sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
 
   vec3 q1 = dFdx(inWorldPos);
   vec3 q2 = dFdy(inWorldPos);
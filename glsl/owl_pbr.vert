@@ -1,10 +1,11 @@
 #version 450
 
 layout(location = 0) in vec3 inPos;
-layout(location = 1) in vec3 inNormal;
+// octahedral encoded
+layout(location = 1) in vec2 inNormal;
 layout(location = 2) in vec2 inUV0;
 layout(location = 3) in vec2 inUV1;
-layout(location = 4) in vec4 inJoint0;
+layout(location = 4) in uvec4 inJoint0;
 layout(location = 5) in vec4 inWeight0;
 layout(location = 6) in vec4 inColor0;
 
@@ -23,14 +24,59 @@ layout(set = 0, binding = 0) uniform UBO {
 }
 ubo;
 
-#define MAX_NUM_JOINTS 128
+struct Draw {
+  vec4 min;
+  vec4 max;
+  vec4 sphere;
+  vec4 cone;
+  uint first;
+  uint numIndices;
+  int node;
+  uint batch;
+  uint batchFirst;
+  int cull;
+  // biased by the first vertex of the primitive
+  int morphOffset;
+  int vertexOffset;
+  int minLod;
+  int maxLod;
+  int padding0;
+  int padding1;
+};
 
-layout(std430, set = 1, binding = 0) readonly buffer SSBONode {
+struct Node {
   mat4 matrix;
-  mat4 jointMatrix[MAX_NUM_JOINTS];
-  int jointCount;
-}
-node;
+  int jointsOffset;
+  int numJoints;
+  int weightsOffset;
+  int numWeights;
+  int lod;
+  int padding0;
+  int padding1;
+  int padding2;
+};
+
+struct MorphTarget {
+  vec4 position;
+  vec4 normal;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Draws { Draw draws[]; };
+
+layout(std430, set = 1, binding = 1) readonly buffer Nodes { Node nodes[]; };
+
+layout(std430, set = 1, binding = 6) readonly buffer MorphTargets {
+  MorphTarget targets[];
+};
+
+layout(std430, set = 1, binding = 7) readonly buffer Weights {
+  float weights[];
+};
+
+// the model's joint palette, sub-allocated from the renderer's storage ring
+layout(std430, set = 4, binding = 0) readonly buffer Joints {
+  mat4 joints[];
+};
 
 layout(location = 0) out vec3 outWorldPos;
 layout(location = 1) out vec3 outNormal;
@@ -38,24 +84,51 @@ layout(location = 2) out vec2 outUV0;
 layout(location = 3) out vec2 outUV1;
 layout(location = 4) out vec4 outColor0;
 
+// the depth prepass and the shading pass must produce the same depth
+invariant gl_Position;
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
 void main() {
   outColor0 = inColor0;
 
+  // the culling pass stores the draw id as the instance
+  Draw draw = draws[gl_InstanceIndex];
+  Node node = nodes[draw.node];
+
+  // blend the morph targets before skinning, the deltas of a vertex are
+  // contiguous
+  vec3 pos = inPos;
+  vec3 normal = decodeOctahedral(inNormal);
+  int morph = draw.morphOffset + gl_VertexIndex * node.numWeights;
+  for (int i = 0; i < node.numWeights; ++i) {
+    float weight = weights[node.weightsOffset + i];
+    pos += weight * targets[morph + i].position.xyz;
+    normal += weight * targets[morph + i].normal.xyz;
+  }
+
   vec4 locPos;
-  if (node.jointCount > 0.0) {
+  if (node.numJoints > 0) {
     // Mesh is skinned
-    mat4 skinMat = inWeight0.x * node.jointMatrix[int(inJoint0.x)] +
-                   inWeight0.y * node.jointMatrix[int(inJoint0.y)] +
-                   inWeight0.z * node.jointMatrix[int(inJoint0.z)] +
-                   inWeight0.w * node.jointMatrix[int(inJoint0.w)];
+    int offset = node.jointsOffset;
+    mat4 skinMat = inWeight0.x * joints[offset + int(inJoint0.x)] +
+                   inWeight0.y * joints[offset + int(inJoint0.y)] +
+                   inWeight0.z * joints[offset + int(inJoint0.z)] +
+                   inWeight0.w * joints[offset + int(inJoint0.w)];
 
-    locPos = ubo.model * node.matrix * skinMat * vec4(inPos, 1.0);
+    locPos = ubo.model * node.matrix * skinMat * vec4(pos, 1.0);
     outNormal = normalize(
-        transpose(inverse(mat3(ubo.model * node.matrix * skinMat))) * inNormal);
+        transpose(inverse(mat3(ubo.model * node.matrix * skinMat))) * normal);
   } else {
-    locPos = ubo.model * node.matrix * vec4(inPos, 1.0);
+    locPos = ubo.model * node.matrix * vec4(pos, 1.0);
     outNormal =
-        normalize(transpose(inverse(mat3(ubo.model * node.matrix))) * inNormal);
+        normalize(transpose(inverse(mat3(ubo.model * node.matrix))) * normal);
   }
   locPos.y = -locPos.y;
   outWorldPos = locPos.xyz / locPos.w;
@@ -4,9 +4,11 @@
 #include "owl_cloth_simulation.h"
 #include "owl_draw.h"
 #include "owl_fluid_simulation.h"
+#include "owl_mesh.h"
 #include "owl_model.h"
 #include "owl_plataform.h"
 #include "owl_renderer.h"
+#include "owl_thread.h"
 #include "owl_vector_math.h"
 
 #endif
@@ -23,6 +23,8 @@ OWLAPI int owl_cloth_simulation_init(struct owl_cloth_simulation *sim,
   texture_desc.width = 0;
   texture_desc.height = 0;
   texture_desc.format = OWL_RGBA8_SRGB;
+  texture_desc.swizzle = OWL_TEXTURE_SWIZZLE_IDENTITY;
+  texture_desc.mipmaps = 0;
 
   ret = owl_texture_init(r, &texture_desc, &sim->material);
   if (ret)
@@ -21,7 +21,7 @@ OWLAPI int owl_draw_quad(struct owl_renderer *r, struct owl_quad const *quad) {
   struct owl_renderer_vertex_allocation vertex_allocation;
   struct owl_renderer_index_allocation index_allocation;
   struct owl_renderer_uniform_allocation uniform_allocation;
-  static uint32_t const indices[] = {2, 3, 1, 1, 0, 2};
+  static uint16_t const indices[] = {2, 3, 1, 1, 0, 2};
 
   command_buffer = r->submit_command_buffers[r->frame];
 
@@ -87,7 +87,7 @@ OWLAPI int owl_draw_quad(struct owl_renderer *r, struct owl_quad const *quad) {
                          &vertex_allocation.offset);
 
   vkCmdBindIndexBuffer(command_buffer, index_allocation.buffer,
-                       index_allocation.offset, VK_INDEX_TYPE_UINT32);
+                       index_allocation.offset, VK_INDEX_TYPE_UINT16);
 
   vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           r->common_pipeline_layout, 0,
@@ -155,208 +155,567 @@ OWLAPI int owl_draw_text(struct owl_renderer *r, char const *text,
   return OWL_OK;
 }
 
-static int owl_draw_model_node(struct owl_renderer *r, int32_t id,
-                               struct owl_model const *m, owl_m4 matrix) {
+static void owl_draw_fill_model_push_constant(
+    struct owl_model_material const *material,
+    struct owl_model_push_constant *push_constant) {
+  push_constant->workflow = 0.0F;
+  push_constant->base_color_uv_set = -1;
+  push_constant->physical_desc_uv_set = -1;
+  push_constant->normal_uv_set = -1;
+  push_constant->occlusion_uv_set = -1;
+  push_constant->emissive_uv_set = -1;
+
+  push_constant->emissive_factor[0] = material->emissive_factor[0];
+  push_constant->emissive_factor[1] = material->emissive_factor[1];
+  push_constant->emissive_factor[2] = material->emissive_factor[2];
+  push_constant->emissive_factor[3] = material->emissive_factor[3];
+
+  push_constant->diffuse_factor[0] = material->diffuse_factor[0];
+  push_constant->diffuse_factor[1] = material->diffuse_factor[1];
+  push_constant->diffuse_factor[2] = material->diffuse_factor[2];
+  push_constant->diffuse_factor[3] = material->diffuse_factor[3];
+
+  push_constant->specular_factor[0] = material->specular_factor[0];
+  push_constant->specular_factor[1] = material->specular_factor[1];
+  push_constant->specular_factor[2] = material->specular_factor[2];
+  push_constant->specular_factor[3] = material->specular_factor[3];
+
+  if (-1 == material->base_color_texture)
+    push_constant->base_color_uv_set = -1;
+  else {
+    push_constant->base_color_uv_set = material->base_color_texcoord;
+
+    OWL_ASSERT(0 == push_constant->base_color_uv_set);
+  }
+
+  if (-1 == material->normal_texcoord)
+    push_constant->normal_uv_set = -1;
+  else
+    push_constant->normal_uv_set = material->normal_texcoord;
+
+  if (-1 == material->occlusion_texture)
+    push_constant->occlusion_uv_set = -1;
+  else
+    push_constant->occlusion_uv_set = material->occlusion_texcoord;
+
+  if (-1 == material->emissive_texture)
+    push_constant->emissive_uv_set = -1;
+  else
+    push_constant->emissive_uv_set = material->emissive_texcoord;
+
+  push_constant->physical_desc_uv_set = -1;
+
+  push_constant->alpha_mask = material->alpha_mode == OWL_ALPHA_MODE_MASK;
+  push_constant->alpha_mask_cutoff = material->alpha_cutoff;
+
+  if (material->specular_glossiness_enable) {
+    push_constant->workflow = 1;
+
+    if (-1 == material->specular_glossiness_texture)
+      push_constant->physical_desc_uv_set = -1;
+    else
+      push_constant->physical_desc_uv_set =
+          material->specular_glossiness_texture;
+
+    if (-1 == material->diffuse_texture)
+      push_constant->base_color_uv_set = -1;
+    else
+      push_constant->base_color_uv_set = material->base_color_texcoord;
+  }
+
+  if (material->metallic_roughness_enable) {
+    push_constant->workflow = 0;
+    push_constant->base_color_factor[0] = material->base_color_factor[0];
+    push_constant->base_color_factor[1] = material->base_color_factor[1];
+    push_constant->base_color_factor[2] = material->base_color_factor[2];
+    push_constant->base_color_factor[3] = material->base_color_factor[3];
+
+    push_constant->metallic_factor = material->metallic_factor;
+    push_constant->roughness_factor = material->roughness_factor;
+
+    if (-1 == material->metallic_roughness_texture)
+      push_constant->physical_desc_uv_set = -1;
+    else
+      push_constant->physical_desc_uv_set =
+          material->metallic_roughness_texcoord;
+  }
+}
+
+/* gribb-hartmann, the planes end up in the space of the matrix */
+static void owl_draw_extract_frustum(owl_m4 const matrix, owl_v4 *planes) {
   int32_t i;
-  int ret;
+
+  for (i = 0; i < 4; ++i) {
+    planes[0][i] = matrix[i][3] + matrix[i][0];
+    planes[1][i] = matrix[i][3] - matrix[i][0];
+    planes[2][i] = matrix[i][3] + matrix[i][1];
+    planes[3][i] = matrix[i][3] - matrix[i][1];
+    planes[4][i] = matrix[i][2];
+    planes[5][i] = matrix[i][3] - matrix[i][2];
+  }
+}
+
+/* the coarsest lod whose error stays under r->lod_threshold pixels at the
+ * nearest point of the bounds, matrix takes the bounds to the space of the
+ * camera */
+static int32_t owl_draw_pick_lod(struct owl_renderer const *r,
+                                 owl_m4 const matrix, owl_v3 const center,
+                                 float radius, int32_t num_lods,
+                                 float const *errors) {
+  int32_t lod;
+  owl_v4 position;
+  owl_v4 world;
+  float scale;
+  float distance;
+  float pixels;
+
+  if (1 >= num_lods)
+    return 0;
+
+  OWL_V3_COPY(center, position);
+  position[3] = 1.0F;
+  owl_m4_multiply_v4(matrix, position, world);
+
+  scale = OWL_MAX(owl_v3_magnitude(matrix[0]), owl_v3_magnitude(matrix[1]));
+  scale = OWL_MAX(scale, owl_v3_magnitude(matrix[2]));
+
+  distance = owl_v3_distance(world, r->camera_eye) - scale * radius;
+
+  /* the camera is inside of the bounds */
+  if (distance <= 0.0F)
+    return 0;
+
+  /* pixels covered by a unit of the bounds at that distance */
+  pixels = OWL_MAX(r->projection[1][1], -r->projection[1][1]) * 0.5F *
+           (float)r->height * scale / distance;
+
+  for (lod = num_lods - 1; lod > 0; --lod)
+    if (errors[lod] * pixels <= r->lod_threshold)
+      break;
+
+  return lod;
+}
+
+static void
+owl_draw_model_cull(struct owl_renderer *r,
+                    struct owl_model_instance const *instance, owl_m4 matrix) {
+  owl_m4 flip;
+  owl_m4 clip;
+  owl_m4 inverse;
+  owl_v4 eye;
+  VkMemoryBarrier barrier;
+  VkDescriptorSet descriptor_sets[2];
+  VkPipelineStageFlags src_stage = 0;
+  uint32_t const frame = r->frame;
+  struct owl_model_cull_ssbo *cull = instance->mapped_culls[frame];
+  struct owl_renderer_cull_stats *stats = instance->mapped_stats[frame];
+  struct owl_model const *m = instance->model;
+  VkCommandBuffer command_buffer = r->prepass_command_buffers[frame];
+
+  /* the stats are from the last frame that used this slot */
+  r->cull_stats.num_visible += stats->num_visible;
+  r->cull_stats.num_frustum_culled += stats->num_frustum_culled;
+  r->cull_stats.num_occlusion_culled += stats->num_occlusion_culled;
+  r->cull_stats.num_occluded_triangles += stats->num_occluded_triangles;
+  r->cull_stats.num_occluded_fragments += stats->num_occluded_fragments;
+  r->cull_stats.num_backface_culled += stats->num_backface_culled;
+  OWL_MEMSET(stats, 0, sizeof(*stats));
+
+  /* the vertex shader flips y after applying the model matrix */
+  OWL_M4_IDENTITY(flip);
+  flip[1][1] = -1.0F;
+
+  owl_m4_multiply(r->projection, r->view, clip);
+  owl_m4_multiply(clip, flip, clip);
+  owl_m4_multiply(clip, matrix, clip);
+
+  owl_draw_extract_frustum(clip, cull->planes);
+
+  /* assumes the model matrix didn't change since the pyramid was built */
+  owl_m4_multiply(r->depth_pyramid_projection, r->depth_pyramid_view,
+                  cull->occlusion_matrix);
+  owl_m4_multiply(cull->occlusion_matrix, flip, cull->occlusion_matrix);
+  owl_m4_multiply(cull->occlusion_matrix, matrix, cull->occlusion_matrix);
+
+  cull->pyramid_width = r->depth_pyramid_width;
+  cull->pyramid_height = r->depth_pyramid_height;
+  cull->num_pyramid_levels = r->depth_pyramid_levels;
+  cull->occlusion = r->occlusion_culling;
+  cull->num_draws = m->num_draws;
+  cull->num_batches = m->num_batches;
+  cull->padding[0] = 0;
+  cull->padding[1] = 0;
+
+  /* the meshlet cones are tested against the camera in the space of the
+   * model, owl_cull.comp takes it the rest of the way to each node */
+  owl_m4_multiply(flip, matrix, inverse);
+  owl_m4_inverse(inverse, inverse);
+  OWL_V4_SET(eye, r->camera_eye[0], r->camera_eye[1], r->camera_eye[2], 1.0F);
+  owl_m4_multiply_v4(inverse, eye, cull->camera_position);
+
+  vkCmdFillBuffer(command_buffer, instance->count_buffers[frame], 0,
+                  VK_WHOLE_SIZE, 0);
+  vkCmdFillBuffer(command_buffer, instance->indirect_buffers[frame], 0,
+                  VK_WHOLE_SIZE, 0);
+
+  /* also waits on last frame's depth pyramid */
+  src_stage |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+  src_stage |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.pNext = NULL;
+  barrier.srcAccessMask = 0;
+  barrier.srcAccessMask |= VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.srcAccessMask |= VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
+  barrier.dstAccessMask |= VK_ACCESS_SHADER_WRITE_BIT;
+
+  vkCmdPipelineBarrier(command_buffer, src_stage,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                       NULL, 0, NULL);
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    r->model_cull_pipeline);
+
+  descriptor_sets[0] = instance->draw_descriptor_sets[frame];
+  descriptor_sets[1] = r->depth_pyramid_descriptor_set;
+
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          r->model_cull_pipeline_layout, 0,
+                          OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets, 0,
+                          NULL);
+
+  vkCmdDispatch(command_buffer, (m->num_draws + 63) / 64, 1, 1);
+}
+
+static void
+owl_draw_model_batch(struct owl_renderer *r,
+                     struct owl_model_instance const *instance, int32_t id) {
+  uint32_t const frame = r->frame;
+  uint32_t const stride = sizeof(VkDrawIndexedIndirectCommand);
+  struct owl_model_batch const *batch = &instance->model->batches[id];
+  VkBuffer const indirect_buffer = instance->indirect_buffers[frame];
+  VkCommandBuffer command_buffer = r->submit_command_buffers[frame];
+
+  /* culled commands are left zeroed, drawing them is a no-op */
+  if (r->has_draw_indirect_count) {
+    r->vk_cmd_draw_indexed_indirect_count_khr(
+        command_buffer, indirect_buffer, batch->first * stride,
+        instance->count_buffers[frame], id * sizeof(uint32_t), batch->num_draws,
+        stride);
+  } else if (r->has_multi_draw_indirect) {
+    vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer,
+                             batch->first * stride, batch->num_draws, stride);
+  } else {
+    uint32_t i;
+
+    for (i = 0; i < batch->num_draws; ++i)
+      vkCmdDrawIndexedIndirect(command_buffer, indirect_buffer,
+                               (batch->first + i) * stride, 1, stride);
+  }
+}
+
+static void
+owl_draw_model_skin(struct owl_renderer *r,
+                    struct owl_model_instance const *instance,
+                    struct owl_renderer_storage_allocation const *joints) {
+  int32_t i;
+  struct owl_model const *m = instance->model;
+  VkDescriptorSet descriptor_sets[2];
+  uint32_t const frame = r->frame;
+  VkCommandBuffer command_buffer = r->prepass_command_buffers[frame];
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    r->model_skin_pipeline);
+
+  descriptor_sets[0] = instance->draw_descriptor_sets[frame];
+  descriptor_sets[1] = joints->descriptor_set;
+
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          r->model_skin_pipeline_layout, 0,
+                          OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets, 1,
+                          &joints->offset);
+
+  for (i = 0; i < m->num_skin_jobs; ++i) {
+    struct owl_model_skin_job const *job = &m->skin_jobs[i];
+
+    vkCmdPushConstants(command_buffer, r->model_skin_pipeline_layout,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(*job), job);
+
+    vkCmdDispatch(command_buffer, (job->num_vertices + 63) / 64, 1, 1);
+  }
+}
+
+static void owl_draw_fill_model_uniform(struct owl_renderer const *r,
+                                        owl_m4 matrix,
+                                        struct owl_model_uniform *uniform) {
+  OWL_M4_COPY(r->projection, uniform->projection);
+  OWL_M4_COPY(matrix, uniform->model);
+  OWL_M4_COPY(r->view, uniform->view);
+
+  uniform->light_direction[0] = -1.0F;
+  uniform->light_direction[1] = 0.0F;
+  uniform->light_direction[2] = 0.0F;
+  uniform->light_direction[3] = 0.0F;
+  uniform->camera_position[0] = r->camera_eye[0];
+  uniform->camera_position[1] = r->camera_eye[1];
+  uniform->camera_position[2] = r->camera_eye[2];
+  uniform->exposure = 4.5F;
+  uniform->gamma = 2.2F;
+  uniform->prefiltered_cube_mip_levels = r->prefiltered_map_mipmaps;
+  uniform->scale_ibl_ambient = 1.0F;
+  uniform->debug_view_inputs = 0.0F;
+  uniform->debug_view_equation = 0.0F;
+}
+
+/* sets up the nodes, the skinning, the culling and the uniform of the
+ * instance once per frame. the node and command buffers are per frame, so
+ * every draw of the instance in a frame has to use the same matrix */
+static int owl_draw_model_setup(struct owl_renderer *r,
+                                struct owl_model_instance *instance,
+                                owl_m4 matrix) {
+  int32_t i;
+  int32_t skinned;
+  int32_t reskin;
   uint8_t *data;
-  int32_t p;
-  struct owl_model_node const *node;
-  struct owl_model_mesh const *mesh;
-  struct owl_model_joints_ssbo *ssbo;
+  owl_m4 flip;
+  owl_m4 model;
   struct owl_model_uniform uniform;
-  struct owl_renderer_uniform_allocation uniform_allocation;
-  VkCommandBuffer command_buffer = r->submit_command_buffers[r->frame];
+  uint32_t const frame = r->frame;
+  struct owl_model const *m = instance->model;
 
-  node = &m->nodes[id];
+  if (r->frame_count == instance->draw_frame) {
+    if (OWL_MEMCMP(instance->draw_matrix, matrix, sizeof(owl_m4)))
+      return OWL_ERROR_INVALID_VALUE;
 
-  for (i = 0; i < node->num_children; ++i) {
-    ret = owl_draw_model_node(r, node->children[i], m, matrix);
-    if (ret)
-      return ret;
+    return OWL_OK;
   }
 
-  if (-1 == node->mesh)
-    return OWL_OK;
+  skinned = r->compute_skinning && m->num_skin_jobs;
 
-  mesh = &m->meshes[node->mesh];
-  ssbo = mesh->mapped_ssbos[r->frame];
+  /* the skinned vertices of this frame were built from the same pose */
+  reskin = skinned &&
+           instance->skinned_pose_versions[frame] != instance->pose_version;
 
-  OWL_M4_COPY(node->matrix, ssbo->matrix);
+  /* the vertex shader flips y after applying the model matrix */
+  OWL_M4_IDENTITY(flip);
+  flip[1][1] = -1.0F;
+  owl_m4_multiply(flip, matrix, model);
 
-  for (p = node->parent; - 1 != p; p = m->nodes[p].parent)
-    owl_m4_multiply(m->nodes[p].matrix, ssbo->matrix, ssbo->matrix);
+  for (i = 0; i < m->num_nodes; ++i) {
+    int32_t const skin = m->node_skins[i];
+    struct owl_model_node_ssbo *ssbo = &instance->mapped_nodes[frame][i];
 
-  OWL_M4_COPY(r->projection, uniform.projection);
-  OWL_M4_COPY(matrix, uniform.model);
-  OWL_M4_COPY(r->view, uniform.view);
-
-  uniform.light_direction[0] = -1.0F;
-  uniform.light_direction[1] = 0.0F;
-  uniform.light_direction[2] = 0.0F;
-  uniform.light_direction[3] = 0.0F;
-  uniform.camera_position[0] = r->camera_eye[0];
-  uniform.camera_position[1] = r->camera_eye[1];
-  uniform.camera_position[2] = r->camera_eye[2];
-  uniform.exposure = 4.5F;
-  uniform.gamma = 2.2F;
-  uniform.prefiltered_cube_mip_levels = r->prefiltered_map_mipmaps;
-  uniform.scale_ibl_ambient = 1.0F;
-  uniform.debug_view_inputs = 0.0F;
-  uniform.debug_view_equation = 0.0F;
+    OWL_M4_COPY(instance->world_matrices[i], ssbo->matrix);
 
-  data = owl_renderer_uniform_allocate(r, sizeof(uniform), &uniform_allocation);
+    ssbo->lod = 0;
+    ssbo->padding[0] = 0;
+    ssbo->padding[1] = 0;
+    ssbo->padding[2] = 0;
+
+    /* owl_cull.comp only lets the draws of this lod through */
+    if (-1 != m->node_meshes[i]) {
+      owl_m4 node;
+      struct owl_model_mesh const *mesh = &m->meshes[m->node_meshes[i]];
+
+      owl_m4_multiply(model, instance->world_matrices[i], node);
+      ssbo->lod = owl_draw_pick_lod(r, node, mesh->center, mesh->radius,
+                                    mesh->num_lods, mesh->lod_errors);
+    }
+
+    /* pre-skinned vertices must not be skinned or morphed again */
+    if (skinned || -1 == skin || -1 == m->node_meshes[i])
+      ssbo->num_joints = 0;
+    else
+      ssbo->num_joints = m->skins[skin].num_joints;
+
+    ssbo->num_weights = skinned ? 0 : m->node_num_weights[i];
+  }
+
+  if (m->num_weights)
+    OWL_MEMCPY(instance->mapped_weights[frame], instance->weights,
+               m->num_weights * sizeof(*m->weights));
+
+  /* only skinned models take space from the ring, the rest bind the start of
+   * it and never read from it, so do the ones reusing their skinned
+   * vertices */
+  if (!m->num_joint_matrices || (skinned && !reskin)) {
+    instance->joints_allocation.offset = 0;
+    instance->joints_allocation.buffer = r->storage_buffers[frame];
+    instance->joints_allocation.descriptor_set =
+        r->storage_descriptor_sets[frame];
+  } else if (r->frame_count != instance->joints_frame) {
+    uint64_t const size = m->num_joint_matrices * sizeof(owl_m4);
+
+    data = owl_renderer_storage_allocate(r, size, &instance->joints_allocation);
+    if (!data)
+      return OWL_ERROR_NO_MEMORY;
+    owl_model_instance_build_joints(instance, (owl_m4 *)data);
+  }
+
+  instance->joints_frame = r->frame_count;
+
+  if (reskin) {
+    owl_draw_model_skin(r, instance, &instance->joints_allocation);
+    instance->skinned_pose_versions[frame] = instance->pose_version;
+  }
+
+  owl_draw_model_cull(r, instance, matrix);
+
+  data = owl_renderer_uniform_allocate(r, sizeof(uniform),
+                                       &instance->uniform_allocation);
   if (!data)
     return OWL_ERROR_NO_MEMORY;
+
+  owl_draw_fill_model_uniform(r, matrix, &uniform);
   OWL_MEMCPY(data, &uniform, sizeof(uniform));
 
-  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          r->model_pipeline_layout, 0, 1,
-                          &uniform_allocation.model_descriptor_set, 1,
-                          &uniform_allocation.offset);
+  instance->draw_frame = r->frame_count;
+  OWL_M4_COPY(matrix, instance->draw_matrix);
 
-  for (i = 0; i < mesh->num_primitives; ++i) {
-    VkDescriptorSet descriptors_sets[3];
-    struct owl_model_primitive const *primitive;
-    struct owl_model_material const *material;
-    struct owl_model_push_constant push_constant;
+  return OWL_OK;
+}
 
-    push_constant.workflow = 0.0F;
-    push_constant.base_color_uv_set = -1;
-    push_constant.physical_desc_uv_set = -1;
-    push_constant.normal_uv_set = -1;
-    push_constant.occlusion_uv_set = -1;
-    push_constant.emissive_uv_set = -1;
+static void owl_draw_model_bind(struct owl_renderer *r,
+                                struct owl_model_instance const *instance) {
+  VkDescriptorSet descriptor_sets[2];
+  VkBuffer vertex_buffers[2];
+  VkDeviceSize vertex_offsets[2];
+  uint32_t const frame = r->frame;
+  struct owl_model const *m = instance->model;
+  VkCommandBuffer command_buffer = r->submit_command_buffers[frame];
 
-    primitive = &m->primitives[mesh->primitives[i]];
+  /* the position stream and the attribute stream share a buffer */
+  if (r->compute_skinning && m->num_skin_jobs)
+    vertex_buffers[0] = instance->skinned_vertex_buffers[frame];
+  else
+    vertex_buffers[0] = m->vertex_buffer;
+  vertex_buffers[1] = vertex_buffers[0];
 
-    if (!primitive->num_vertices)
-      continue;
+  vertex_offsets[0] = 0;
+  vertex_offsets[1] = m->vertex_attributes_offset;
 
-    material = &m->materials[primitive->material];
+  vkCmdBindVertexBuffers(command_buffer, 0, OWL_ARRAY_SIZE(vertex_buffers),
+                         vertex_buffers, vertex_offsets);
 
-    descriptors_sets[0] = mesh->ssbo_descriptor_sets[r->frame];
-    descriptors_sets[1] = material->descriptor_set;
-    descriptors_sets[2] = r->environment_descriptor_set;
+  vkCmdBindIndexBuffer(command_buffer, m->index_buffer, 0, m->index_type);
 
-    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            r->model_pipeline_layout, 1,
-                            OWL_ARRAY_SIZE(descriptors_sets), descriptors_sets,
-                            0, NULL);
-
-    push_constant.emissive_factor[0] = material->emissive_factor[0];
-    push_constant.emissive_factor[1] = material->emissive_factor[1];
-    push_constant.emissive_factor[2] = material->emissive_factor[2];
-    push_constant.emissive_factor[3] = material->emissive_factor[3];
-
-    push_constant.diffuse_factor[0] = material->diffuse_factor[0];
-    push_constant.diffuse_factor[1] = material->diffuse_factor[1];
-    push_constant.diffuse_factor[2] = material->diffuse_factor[2];
-    push_constant.diffuse_factor[3] = material->diffuse_factor[3];
-
-    push_constant.specular_factor[0] = material->specular_factor[0];
-    push_constant.specular_factor[1] = material->specular_factor[1];
-    push_constant.specular_factor[2] = material->specular_factor[2];
-    push_constant.specular_factor[3] = material->specular_factor[3];
-
-    if (-1 == material->base_color_texture)
-      push_constant.base_color_uv_set = -1;
-    else {
-      push_constant.base_color_uv_set = material->base_color_texcoord;
-
-      OWL_ASSERT(0 == push_constant.base_color_uv_set);
-    }
+  descriptor_sets[0] = instance->uniform_allocation.model_descriptor_set;
+  descriptor_sets[1] = instance->draw_descriptor_sets[frame];
 
-    if (-1 == material->normal_texcoord)
-      push_constant.normal_uv_set = -1;
-    else
-      push_constant.normal_uv_set = material->normal_texcoord;
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          r->model_pipeline_layout, 0,
+                          OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets, 1,
+                          &instance->uniform_allocation.offset);
 
-    if (-1 == material->occlusion_texture)
-      push_constant.occlusion_uv_set = -1;
-    else
-      push_constant.occlusion_uv_set = material->occlusion_texcoord;
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          r->model_pipeline_layout, 4, 1,
+                          &instance->joints_allocation.descriptor_set, 1,
+                          &instance->joints_allocation.offset);
+}
 
-    if (-1 == material->emissive_texture)
-      push_constant.emissive_uv_set = -1;
-    else
-      push_constant.emissive_uv_set = material->emissive_texcoord;
+OWLAPI int owl_draw_model_depth(struct owl_renderer *r, struct owl_model *m,
+                                owl_m4 matrix) {
+  /* not resident yet */
+  if (m->loading)
+    return OWL_OK;
 
-    push_constant.physical_desc_uv_set = -1;
+  return owl_draw_model_instance_depth(r, &m->instance, matrix);
+}
 
-    push_constant.alpha_mask = material->alpha_mode == OWL_ALPHA_MODE_MASK;
-    push_constant.alpha_mask_cutoff = material->alpha_cutoff;
+OWLAPI int
+owl_draw_model_instance_depth(struct owl_renderer *r,
+                              struct owl_model_instance *instance,
+                              owl_m4 matrix) {
+  int32_t i;
+  int ret = OWL_OK;
+  struct owl_model const *m = instance->model;
+  VkCommandBuffer command_buffer = r->submit_command_buffers[r->frame];
 
-    if (material->specular_glossiness_enable) {
-      push_constant.workflow = 1;
+  if (!r->depth_prepass || !m->num_draws)
+    return OWL_OK;
 
-      if (-1 == material->specular_glossiness_texture)
-        push_constant.physical_desc_uv_set = -1;
-      else
-        push_constant.physical_desc_uv_set =
-            material->specular_glossiness_texture;
+  /* the depth pipeline only reads positions, it can't skin on its own */
+  if (m->num_joint_matrices && !(r->compute_skinning && m->num_skin_jobs))
+    return OWL_OK;
 
-      if (-1 == material->diffuse_texture)
-        push_constant.base_color_uv_set = -1;
-      else
-        push_constant.base_color_uv_set = material->base_color_texcoord;
-    }
+  ret = owl_draw_model_setup(r, instance, matrix);
+  if (ret)
+    return ret;
 
-    if (material->metallic_roughness_enable) {
-      push_constant.workflow = 0;
-      push_constant.base_color_factor[0] = material->base_color_factor[0];
-      push_constant.base_color_factor[1] = material->base_color_factor[1];
-      push_constant.base_color_factor[2] = material->base_color_factor[2];
-      push_constant.base_color_factor[3] = material->base_color_factor[3];
-
-      push_constant.metallic_factor = material->metallic_factor;
-      push_constant.roughness_factor = material->roughness_factor;
-
-      if (-1 == material->metallic_roughness_texture)
-        push_constant.physical_desc_uv_set = -1;
-      else
-        push_constant.physical_desc_uv_set =
-            material->metallic_roughness_texcoord;
-    }
+  owl_draw_model_bind(r, instance);
 
-    vkCmdPushConstants(command_buffer, r->model_pipeline_layout,
-                       VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constant),
-                       &push_constant);
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    r->model_depth_pipeline);
 
-    if (primitive->has_indices)
-      vkCmdDrawIndexed(command_buffer, primitive->num_indices, 1,
-                       primitive->first, 0, 0);
-    else
-      vkCmdDraw(command_buffer, primitive->num_vertices, 1, primitive->first,
-                0);
+  for (i = 0; i < m->num_batches; ++i) {
+    struct owl_model_material const *material;
+
+    material = &m->materials[m->batches[i].material];
+
+    /* the depth pipeline has no fragment shader to discard with */
+    if (OWL_ALPHA_MODE_MASK == material->alpha_mode)
+      continue;
+
+    owl_draw_model_batch(r, instance, i);
   }
 
   return OWL_OK;
 }
 
-OWLAPI int owl_draw_model(struct owl_renderer *r, struct owl_model const *model,
+OWLAPI int owl_draw_model(struct owl_renderer *r, struct owl_model *m,
                           owl_m4 matrix) {
-  int i;
+  /* not resident yet */
+  if (m->loading)
+    return OWL_OK;
 
-  uint64_t offset = 0;
+  return owl_draw_model_instance(r, &m->instance, matrix);
+}
+
+OWLAPI int
+owl_draw_model_instance(struct owl_renderer *r,
+                        struct owl_model_instance *instance, owl_m4 matrix) {
+  int32_t i;
   int ret = OWL_OK;
-  VkCommandBuffer command_buffer;
+  VkDescriptorSet descriptor_sets[2];
+  struct owl_model const *m = instance->model;
+  VkCommandBuffer command_buffer = r->submit_command_buffers[r->frame];
 
-  command_buffer = r->submit_command_buffers[r->frame];
+  if (!m->num_draws)
+    return OWL_OK;
+
+  ret = owl_draw_model_setup(r, instance, matrix);
+  if (ret)
+    return ret;
+
+  owl_draw_model_bind(r, instance);
 
   vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                     r->model_pipeline);
 
-  vkCmdBindVertexBuffers(command_buffer, 0, 1, &model->vertex_buffer, &offset);
+  for (i = 0; i < m->num_batches; ++i) {
+    struct owl_model_batch const *batch = &m->batches[i];
+    struct owl_model_material const *material;
+    struct owl_model_push_constant push_constant;
 
-  vkCmdBindIndexBuffer(command_buffer, model->index_buffer, 0,
-                       VK_INDEX_TYPE_UINT32);
+    material = &m->materials[batch->material];
 
-  for (i = 0; i < model->num_roots; ++i) {
-    int32_t root = model->roots[i];
-    ret = owl_draw_model_node(r, root, model, matrix);
-    if (ret)
-      return ret;
+    descriptor_sets[0] = material->descriptor_set;
+    descriptor_sets[1] = r->environment_descriptor_set;
+
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            r->model_pipeline_layout, 2,
+                            OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets, 0,
+                            NULL);
+
+    owl_draw_fill_model_push_constant(material, &push_constant);
+
+    vkCmdPushConstants(command_buffer, r->model_pipeline_layout,
+                       VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constant),
+                       &push_constant);
+
+    owl_draw_model_batch(r, instance, i);
   }
 
   return OWL_OK;
@@ -388,7 +747,7 @@ OWLAPI int owl_draw_skybox(struct owl_renderer *r) {
       {1.0F, -1.0F, 1.0F},   /* 5 */
       {-1.0F, 1.0F, 1.0F},   /* 6 */
       {1.0F, 1.0F, 1.0F}};   /* 7 */
-  static uint32_t const indices[] = {
+  static uint16_t const indices[] = {
       2, 3, 1, 1, 0, 2,  /* face 0 ...............*/
       3, 7, 5, 5, 1, 3,  /* face 1 */
       6, 2, 0, 0, 4, 6,  /* face 2 */
@@ -428,7 +787,7 @@ OWLAPI int owl_draw_skybox(struct owl_renderer *r) {
                          &vertex_allocation.offset);
 
   vkCmdBindIndexBuffer(command_buffer, index_allocation.buffer,
-                       index_allocation.offset, VK_INDEX_TYPE_UINT32);
+                       index_allocation.offset, VK_INDEX_TYPE_UINT16);
 
   vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           r->common_pipeline_layout, 0,
@@ -519,6 +878,13 @@ OWLAPI int owl_draw_renderer_state(struct owl_renderer *r) {
 
   owl_draw_text(r, buffer, position, color);
 
+  position[1] += 0.05F;
+
+  snprintf(buffer, sizeof(buffer), "fragment_invocations: %llu",
+           r->fragment_invocations);
+
+  owl_draw_text(r, buffer, position, color);
+
   return OWL_OK;
 }
 
@@ -528,7 +894,9 @@ OWLAPI int owl_draw_cloth_simulation(struct owl_renderer *r,
   int32_t j;
 
   uint32_t num_indices;
-  uint32_t *indices;
+  void *indices;
+  uint64_t index_size;
+  VkIndexType index_type;
   struct owl_renderer_index_allocation index_allocation;
 
   uint64_t num_vertices;
@@ -543,23 +911,41 @@ OWLAPI int owl_draw_cloth_simulation(struct owl_renderer *r,
 
   command_buffer = r->submit_command_buffers[r->frame];
 
+  /* 16 bit indices unless the cloth is larger than 65536 particles */
+  if (sim->width * sim->height <= 0x10000) {
+    index_type = VK_INDEX_TYPE_UINT16;
+    index_size = sizeof(uint16_t);
+  } else {
+    index_type = VK_INDEX_TYPE_UINT32;
+    index_size = sizeof(uint32_t);
+  }
+
   num_indices = (sim->width - 1) * (sim->height - 1) * 6;
-  indices = owl_renderer_index_allocate(r, num_indices * sizeof(*indices),
+  indices = owl_renderer_index_allocate(r, num_indices * index_size,
                                         &index_allocation);
   if (!indices)
     return OWL_ERROR_NO_FRAME_MEMORY;
 
   for (i = 0; i < (sim->height - 1); ++i) {
     for (j = 0; j < (sim->width - 1); ++j) {
-      int32_t const k = i * sim->width + j;
+      int32_t l;
+      uint32_t quad[6];
+      uint32_t const k = i * sim->width + j;
       int32_t const fixed_k = (i * (sim->width - 1) + j) * 6;
 
-      indices[fixed_k + 0] = k + sim->width;
-      indices[fixed_k + 1] = k + sim->width + 1;
-      indices[fixed_k + 2] = k + 1;
-      indices[fixed_k + 3] = k + 1;
-      indices[fixed_k + 4] = k;
-      indices[fixed_k + 5] = k + sim->width;
+      quad[0] = k + sim->width;
+      quad[1] = k + sim->width + 1;
+      quad[2] = k + 1;
+      quad[3] = k + 1;
+      quad[4] = k;
+      quad[5] = k + sim->width;
+
+      for (l = 0; l < 6; ++l) {
+        if (VK_INDEX_TYPE_UINT16 == index_type)
+          ((uint16_t *)indices)[fixed_k + l] = (uint16_t)quad[l];
+        else
+          ((uint32_t *)indices)[fixed_k + l] = quad[l];
+      }
     }
   }
 
@@ -602,7 +988,7 @@ OWLAPI int owl_draw_cloth_simulation(struct owl_renderer *r,
                          &vertex_allocation.offset);
 
   vkCmdBindIndexBuffer(command_buffer, index_allocation.buffer,
-                       index_allocation.offset, VK_INDEX_TYPE_UINT32);
+                       index_allocation.offset, index_type);
 
   vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           r->common_pipeline_layout, 0,
@@ -613,3 +999,180 @@ OWLAPI int owl_draw_cloth_simulation(struct owl_renderer *r,
 
   return OWL_OK;
 }
+
+/* the lod of a whole baked instance, -1 if it is off screen */
+static int32_t
+owl_draw_baked_instance_lod(struct owl_renderer const *r,
+                            struct owl_model const *m,
+                            struct owl_model_baked_instance const *instance) {
+  owl_m4 flip;
+  owl_m4 matrix;
+  owl_m4 model;
+
+  OWL_M4_COPY(instance->matrix, matrix);
+
+  if (0.0F >= owl_model_screen_size(r, m, matrix))
+    return -1;
+
+  /* the vertex shader flips y after applying the model matrix */
+  OWL_M4_IDENTITY(flip);
+  flip[1][1] = -1.0F;
+  owl_m4_multiply(flip, matrix, model);
+
+  return owl_draw_pick_lod(r, model, m->bounding_center, m->bounding_radius,
+                           m->num_lods, m->lod_errors);
+}
+
+OWLAPI int
+owl_draw_model_baked(struct owl_renderer *r,
+                     struct owl_model_baked_animation const *baked,
+                     int32_t num_instances,
+                     struct owl_model_baked_instance const *instances) {
+  int32_t i;
+  int32_t lod;
+  int32_t num_visible;
+  int32_t num_lod_instances[OWL_MODEL_MAX_LODS];
+  int32_t first_lod_instances[OWL_MODEL_MAX_LODS];
+  int32_t next_lod_instances[OWL_MODEL_MAX_LODS];
+  owl_m4 identity;
+  VkDescriptorSet descriptor_sets[2];
+  struct owl_model_uniform uniform;
+  struct owl_model_baked_instance *visible;
+  struct owl_renderer_uniform_allocation uniform_allocation;
+  struct owl_renderer_storage_allocation instances_allocation;
+  uint32_t offsets[2];
+  uint8_t *data;
+  VkBuffer vertex_buffers[2];
+  VkDeviceSize vertex_offsets[2];
+  uint32_t const frame = r->frame;
+  struct owl_model const *m = baked->model;
+  VkCommandBuffer command_buffer = r->submit_command_buffers[frame];
+
+  if (!m->num_draws || !num_instances)
+    return OWL_OK;
+
+  /* off screen characters are dropped on the cpu, the rest are grouped by
+   * lod so each lod of a primitive is one instanced draw. counted first so
+   * the groups can be written in place */
+  for (i = 0; i < OWL_MODEL_MAX_LODS; ++i)
+    num_lod_instances[i] = 0;
+
+  for (i = 0; i < num_instances; ++i) {
+    lod = owl_draw_baked_instance_lod(r, m, &instances[i]);
+    if (-1 != lod)
+      ++num_lod_instances[lod];
+  }
+
+  for (i = 0, num_visible = 0; i < OWL_MODEL_MAX_LODS; ++i) {
+    first_lod_instances[i] = num_visible;
+    next_lod_instances[i] = num_visible;
+    num_visible += num_lod_instances[i];
+  }
+
+  if (!num_visible)
+    return OWL_OK;
+
+  visible = owl_renderer_storage_allocate(
+      r, num_visible * sizeof(*instances), &instances_allocation);
+  if (!visible)
+    return OWL_ERROR_NO_MEMORY;
+
+  for (i = 0; i < num_instances; ++i) {
+    lod = owl_draw_baked_instance_lod(r, m, &instances[i]);
+    if (-1 != lod)
+      visible[next_lod_instances[lod]++] = instances[i];
+  }
+
+  /* every instance carries its own model matrix */
+  OWL_M4_IDENTITY(identity);
+
+  data = owl_renderer_uniform_allocate(r, sizeof(uniform), &uniform_allocation);
+  if (!data)
+    return OWL_ERROR_NO_MEMORY;
+
+  owl_draw_fill_model_uniform(r, identity, &uniform);
+  OWL_MEMCPY(data, &uniform, sizeof(uniform));
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    r->model_baked_pipeline);
+
+  vertex_buffers[0] = m->vertex_buffer;
+  vertex_buffers[1] = m->vertex_buffer;
+
+  vertex_offsets[0] = 0;
+  vertex_offsets[1] = m->vertex_attributes_offset;
+
+  vkCmdBindVertexBuffers(command_buffer, 0, OWL_ARRAY_SIZE(vertex_buffers),
+                         vertex_buffers, vertex_offsets);
+
+  vkCmdBindIndexBuffer(command_buffer, m->index_buffer, 0, m->index_type);
+
+  /* only the shared draw buffer is read from the storage set */
+  descriptor_sets[0] = uniform_allocation.model_descriptor_set;
+  descriptor_sets[1] = m->instance.draw_descriptor_sets[frame];
+
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          r->model_baked_pipeline_layout, 0,
+                          OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets, 1,
+                          &uniform_allocation.offset);
+
+  descriptor_sets[0] = baked->descriptor_set;
+  descriptor_sets[1] = instances_allocation.descriptor_set;
+
+  offsets[0] = 0;
+  offsets[1] = instances_allocation.offset;
+
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          r->model_baked_pipeline_layout, 4,
+                          OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets,
+                          OWL_ARRAY_SIZE(offsets), offsets);
+
+  for (i = 0; i < m->num_batches; ++i) {
+    uint32_t j;
+    struct owl_model_batch const *batch = &m->batches[i];
+    struct owl_model_material const *material;
+    struct owl_model_push_constant push_constant;
+
+    material = &m->materials[batch->material];
+
+    descriptor_sets[0] = material->descriptor_set;
+    descriptor_sets[1] = r->environment_descriptor_set;
+
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            r->model_baked_pipeline_layout, 2,
+                            OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets, 0,
+                            NULL);
+
+    owl_draw_fill_model_push_constant(material, &push_constant);
+
+    vkCmdPushConstants(command_buffer, r->model_baked_pipeline_layout,
+                       VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push_constant),
+                       &push_constant);
+
+    for (j = 0; j < batch->num_draws; ++j) {
+      struct owl_model_baked_push_constant baked_draw;
+      struct owl_model_draw const *draw = &m->draws[batch->first + j];
+      int32_t const skin = m->node_skins[draw->node];
+
+      baked_draw.draw = (int32_t)(batch->first + j);
+      baked_draw.joints_offset = OWL_MAX(0, m->node_joints_offsets[draw->node]);
+      baked_draw.num_joints = -1 == skin ? 0 : m->skins[skin].num_joints;
+
+      vkCmdPushConstants(command_buffer, r->model_baked_pipeline_layout,
+                         VK_SHADER_STAGE_VERTEX_BIT, sizeof(push_constant),
+                         sizeof(baked_draw), &baked_draw);
+
+      for (lod = draw->min_lod; lod <= draw->max_lod; ++lod) {
+        if (!num_lod_instances[lod])
+          continue;
+
+        vkCmdDrawIndexed(command_buffer, draw->num_indices,
+                         (uint32_t)num_lod_instances[lod], draw->first,
+                         draw->vertex_offset,
+                         (uint32_t)first_lod_instances[lod]);
+      }
+    }
+  }
+
+  return OWL_OK;
+}
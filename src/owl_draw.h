@@ -7,6 +7,9 @@ OWL_BEGIN_DECLARATIONS
 
 struct owl_renderer;
 struct owl_model;
+struct owl_model_instance;
+struct owl_model_baked_animation;
+struct owl_model_baked_instance;
 struct owl_texture;
 struct owl_cloth_simulation;
 struct owl_fluid_simulation;
@@ -60,17 +63,78 @@ OWLAPI int owl_draw_skybox(struct owl_renderer *r);
 OWLAPI int owl_draw_text(struct owl_renderer *r, char const *text,
                          owl_v3 const position, owl_v3 const color);
 
+/**
+ * @brief lays down the depth of a model when the depth prepass is enabled,
+ * call it for every model drawn this frame before drawing any of them
+ *
+ * @param vk the renderer instance created with owl_renderer_init(...)
+ * @param model the model instance created with owl_model_init(...) or
+ * owl_model_load_async(...), nothing is drawn until it is resident
+ * @param matrix the model matrix, the same one passed to owl_draw_model
+ * @return int
+ */
+OWLAPI int owl_draw_model_depth(struct owl_renderer *r,
+                                struct owl_model *model, owl_m4 matrix);
+
+/**
+ * @brief lays down the depth of an instance of a model when the depth
+ * prepass is enabled, call it for every instance drawn this frame before
+ * drawing any of them
+ *
+ * @param vk the renderer instance created with owl_renderer_init(...)
+ * @param instance the instance created with owl_model_instance_init(...)
+ * @param matrix the model matrix, the same one passed to
+ * owl_draw_model_instance
+ * @return int
+ */
+OWLAPI int
+owl_draw_model_instance_depth(struct owl_renderer *r,
+                              struct owl_model_instance *instance,
+                              owl_m4 matrix);
+
 /**
  * @brief draw a model
  *
  * @param vk the renderer instance created with owl_renderer_init(...)
- * @param model the model instance created with owl_model_init(...)
- * @param matrix the model matrix
+ * @param model the model instance created with owl_model_init(...) or
+ * owl_model_load_async(...), nothing is drawn until it is resident
+ * @param matrix the model matrix, the same one for every draw of the model
+ * in a frame
  * @return int
  */
-OWLAPI int owl_draw_model(struct owl_renderer *r, struct owl_model const *model,
+OWLAPI int owl_draw_model(struct owl_renderer *r, struct owl_model *model,
                           owl_m4 matrix);
 
+/**
+ * @brief draw an instance of a model
+ *
+ * @param vk the renderer instance created with owl_renderer_init(...)
+ * @param instance the instance created with owl_model_instance_init(...)
+ * @param matrix the model matrix, an instance can be drawn more than once
+ * per frame but always with the same matrix, OWL_ERROR_INVALID_VALUE
+ * otherwise
+ * @return int
+ */
+OWLAPI int
+owl_draw_model_instance(struct owl_renderer *r,
+                        struct owl_model_instance *instance, owl_m4 matrix);
+
+/**
+ * @brief draw a crowd playing a baked animation, the animation is sampled on
+ * the gpu from the time of every instance
+ *
+ * @param vk the renderer instance created with owl_renderer_init(...)
+ * @param baked the animation created with owl_model_baked_animation_init(...)
+ * @param num_instances the number of instances
+ * @param instances the model matrix and the time of every instance
+ * @return int
+ */
+OWLAPI int
+owl_draw_model_baked(struct owl_renderer *r,
+                     struct owl_model_baked_animation const *baked,
+                     int32_t num_instances,
+                     struct owl_model_baked_instance const *instances);
+
 /**
  * @brief draws the renderer debug state
  *
@@ -23,6 +23,8 @@ owl_fluid_simulation_buffer_init(struct owl_renderer *r, void const *data,
     desc.width = width;
     desc.height = height;
     desc.format = OWL_RGBA32_SFLOAT;
+    desc.swizzle = OWL_TEXTURE_SWIZZLE_IDENTITY;
+    desc.mipmaps = 0;
 
     ret = owl_texture_init(r, &desc, &buffer->texture);
     if (ret)
@@ -62,6 +62,8 @@ OWLAPI int owl_font_init(struct owl_renderer *r, char const *path, int32_t size,
   texture_desc.width = OWL_FONT_ATLAS_WIDTH;
   texture_desc.height = OWL_FONT_ATLAS_HEIGHT;
   texture_desc.format = OWL_R8_UNORM;
+  texture_desc.swizzle = OWL_TEXTURE_SWIZZLE_IDENTITY;
+  texture_desc.mipmaps = 0;
 
   ret = owl_texture_init(r, &texture_desc, &font->atlas);
   if (!ret)
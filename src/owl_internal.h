@@ -8,6 +8,8 @@
 #include <string.h>
 #define OWL_MEMSET(dst, c, s) memset(dst, c, s)
 #define OWL_MEMCPY(dst, src, s) memcpy(dst, src, s)
+#define OWL_MEMCMP(lhs, rhs, s) memcmp(lhs, rhs, s)
+#define OWL_MEMCHR(ptr, c, s) memchr(ptr, c, s)
 #define OWL_STRNCPY(dst, src, n) strncpy(dst, src, n)
 #define OWL_STRNCMP(lhs, rhs, n) strncmp(lhs, rhs, n)
 #define OWL_STRLEN(str) strlen(str)
@@ -0,0 +1,1027 @@
+#include "owl_mesh.h"
+
+#include "owl_internal.h"
+#include "owl_vector_math.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+/* the lru cache the vertex cache optimisation scores against, larger than
+ * the fifo so the order also holds up on bigger caches */
+#define OWL_MESH_SCORE_CACHE_SIZE 32
+#define OWL_MESH_MAX_VALENCE_SCORES 32
+
+OWLAPI int
+owl_mesh_analyze_vertex_cache(uint32_t const *indices, int32_t num_indices,
+                              int32_t num_vertices, int32_t cache_size,
+                              struct owl_mesh_cache_stats *stats) {
+  int32_t i;
+  int32_t num_misses = 0;
+  int32_t num_referenced = 0;
+  uint32_t time;
+  uint32_t *timestamps;
+
+  stats->acmr = 0.0F;
+  stats->atvr = 0.0F;
+
+  if (!num_indices || !num_vertices)
+    return OWL_OK;
+
+  timestamps = OWL_MALLOC(num_vertices * sizeof(*timestamps));
+  if (!timestamps)
+    return OWL_ERROR_NO_MEMORY;
+
+  OWL_MEMSET(timestamps, 0, num_vertices * sizeof(*timestamps));
+
+  /* a vertex is in the fifo if less than cache_size misses happened since it
+   * was pushed */
+  time = (uint32_t)cache_size + 1;
+
+  for (i = 0; i < num_indices; ++i) {
+    uint32_t const vertex = indices[i];
+
+    OWL_ASSERT((int32_t)vertex < num_vertices);
+
+    if (!timestamps[vertex])
+      ++num_referenced;
+
+    if (time - timestamps[vertex] > (uint32_t)cache_size) {
+      timestamps[vertex] = time++;
+      ++num_misses;
+    }
+  }
+
+  stats->acmr = (float)num_misses / (float)(num_indices / 3);
+  stats->atvr = (float)num_misses / (float)num_referenced;
+
+  OWL_FREE(timestamps);
+
+  return OWL_OK;
+}
+
+OWLAPI int owl_mesh_optimize_vertex_cache(uint32_t *indices,
+                                          int32_t num_indices,
+                                          int32_t num_vertices) {
+  int32_t i;
+  int32_t j;
+  int32_t k;
+  int32_t best;
+  int32_t cursor;
+  int32_t num_cached;
+  int32_t num_triangles;
+  int32_t cache[OWL_MESH_SCORE_CACHE_SIZE + 3];
+  int32_t new_cache[OWL_MESH_SCORE_CACHE_SIZE + 3];
+  float cache_scores[OWL_MESH_SCORE_CACHE_SIZE];
+  float valence_scores[OWL_MESH_MAX_VALENCE_SCORES];
+  uint32_t *offsets;
+  uint32_t *adjacency;
+  uint32_t *num_live;
+  int32_t *positions;
+  float *vertex_scores;
+  float *triangle_scores;
+  uint8_t *emitted;
+  uint32_t *output;
+  int ret = OWL_OK;
+
+  num_triangles = num_indices / 3;
+  if (num_triangles < 2)
+    return OWL_OK;
+
+  offsets = OWL_MALLOC((num_vertices + 1) * sizeof(*offsets));
+  adjacency = OWL_MALLOC(num_indices * sizeof(*adjacency));
+  num_live = OWL_MALLOC(num_vertices * sizeof(*num_live));
+  positions = OWL_MALLOC(num_vertices * sizeof(*positions));
+  vertex_scores = OWL_MALLOC(num_vertices * sizeof(*vertex_scores));
+  triangle_scores = OWL_MALLOC(num_triangles * sizeof(*triangle_scores));
+  emitted = OWL_MALLOC(num_triangles * sizeof(*emitted));
+  output = OWL_MALLOC(num_indices * sizeof(*output));
+
+  if (!offsets || !adjacency || !num_live || !positions || !vertex_scores ||
+      !triangle_scores || !emitted || !output) {
+    ret = OWL_ERROR_NO_MEMORY;
+    goto out;
+  }
+
+  /* the first 3 entries held the last triangle, they score the same so the
+   * next one doesn't favour a particular edge */
+  for (i = 0; i < OWL_MESH_SCORE_CACHE_SIZE; ++i) {
+    if (i < 3) {
+      cache_scores[i] = 0.75F;
+    } else {
+      float const scale = 1.0F / (OWL_MESH_SCORE_CACHE_SIZE - 3);
+      cache_scores[i] = (float)pow(1.0F - (i - 3) * scale, 1.5F);
+    }
+  }
+
+  /* vertices with few triangles left get rid of them first, so no lone
+   * triangles are left behind */
+  valence_scores[0] = 0.0F;
+  for (i = 1; i < OWL_MESH_MAX_VALENCE_SCORES; ++i)
+    valence_scores[i] = 2.0F * (float)pow((float)i, -0.5F);
+
+  OWL_MEMSET(num_live, 0, num_vertices * sizeof(*num_live));
+
+  for (i = 0; i < num_triangles * 3; ++i) {
+    OWL_ASSERT((int32_t)indices[i] < num_vertices);
+    ++num_live[indices[i]];
+  }
+
+  offsets[0] = 0;
+  for (i = 0; i < num_vertices; ++i)
+    offsets[i + 1] = offsets[i] + num_live[i];
+
+  OWL_MEMSET(num_live, 0, num_vertices * sizeof(*num_live));
+
+  for (i = 0; i < num_triangles * 3; ++i) {
+    uint32_t const vertex = indices[i];
+    adjacency[offsets[vertex] + num_live[vertex]++] = i / 3;
+  }
+
+  for (i = 0; i < num_vertices; ++i) {
+    positions[i] = -1;
+    vertex_scores[i] = valence_scores[OWL_MIN(num_live[i],
+                                              OWL_MESH_MAX_VALENCE_SCORES - 1)];
+  }
+
+  best = 0;
+  for (i = 0; i < num_triangles; ++i) {
+    emitted[i] = 0;
+    triangle_scores[i] = vertex_scores[indices[i * 3 + 0]] +
+                         vertex_scores[indices[i * 3 + 1]] +
+                         vertex_scores[indices[i * 3 + 2]];
+
+    if (triangle_scores[best] < triangle_scores[i])
+      best = i;
+  }
+
+  cursor = 0;
+  num_cached = 0;
+
+  for (i = 0; i < num_triangles; ++i) {
+    int32_t num_new = 0;
+    float best_score = -1.0F;
+    uint32_t const *triangle;
+
+    /* nothing in the cache has triangles left, start somewhere else */
+    if (-1 == best) {
+      while (emitted[cursor])
+        ++cursor;
+      best = cursor;
+    }
+
+    triangle = &indices[best * 3];
+
+    output[i * 3 + 0] = triangle[0];
+    output[i * 3 + 1] = triangle[1];
+    output[i * 3 + 2] = triangle[2];
+
+    emitted[best] = 1;
+
+    for (j = 0; j < 3; ++j) {
+      uint32_t const vertex = triangle[j];
+      uint32_t *live = &adjacency[offsets[vertex]];
+
+      for (k = 0; k < (int32_t)num_live[vertex]; ++k) {
+        if ((int32_t)live[k] == best) {
+          live[k] = live[--num_live[vertex]];
+          break;
+        }
+      }
+
+      /* degenerate triangles repeat vertices */
+      for (k = 0; k < num_new; ++k)
+        if (new_cache[k] == (int32_t)vertex)
+          break;
+
+      if (k == num_new)
+        new_cache[num_new++] = (int32_t)vertex;
+    }
+
+    for (j = 0; j < num_cached; ++j) {
+      int32_t const vertex = cache[j];
+
+      if (vertex != (int32_t)triangle[0] && vertex != (int32_t)triangle[1] &&
+          vertex != (int32_t)triangle[2])
+        new_cache[num_new++] = vertex;
+    }
+
+    for (j = 0; j < num_new; ++j) {
+      int32_t const vertex = new_cache[j];
+      int32_t const valence =
+          OWL_MIN(num_live[vertex], OWL_MESH_MAX_VALENCE_SCORES - 1);
+
+      positions[vertex] = j < OWL_MESH_SCORE_CACHE_SIZE ? j : -1;
+
+      if (!num_live[vertex])
+        vertex_scores[vertex] = -1.0F;
+      else if (-1 == positions[vertex])
+        vertex_scores[vertex] = valence_scores[valence];
+      else
+        vertex_scores[vertex] = cache_scores[j] + valence_scores[valence];
+    }
+
+    num_cached = OWL_MIN(num_new, OWL_MESH_SCORE_CACHE_SIZE);
+    OWL_MEMCPY(cache, new_cache, num_cached * sizeof(*cache));
+
+    /* only the triangles around the cache changed their score */
+    best = -1;
+    for (j = 0; j < num_new; ++j) {
+      int32_t const vertex = new_cache[j];
+      uint32_t const *live = &adjacency[offsets[vertex]];
+
+      for (k = 0; k < (int32_t)num_live[vertex]; ++k) {
+        uint32_t const *other = &indices[live[k] * 3];
+        float const score = vertex_scores[other[0]] +
+                            vertex_scores[other[1]] + vertex_scores[other[2]];
+
+        triangle_scores[live[k]] = score;
+
+        if (best_score < score) {
+          best_score = score;
+          best = (int32_t)live[k];
+        }
+      }
+    }
+  }
+
+  OWL_MEMCPY(indices, output, num_triangles * 3 * sizeof(*indices));
+
+out:
+  OWL_FREE(output);
+  OWL_FREE(emitted);
+  OWL_FREE(triangle_scores);
+  OWL_FREE(vertex_scores);
+  OWL_FREE(positions);
+  OWL_FREE(num_live);
+  OWL_FREE(adjacency);
+  OWL_FREE(offsets);
+
+  return ret;
+}
+
+struct owl_mesh_cluster {
+  float sort_key;
+  int32_t first;
+  int32_t num_triangles;
+};
+
+static int owl_mesh_compare_clusters(void const *lhs, void const *rhs) {
+  struct owl_mesh_cluster const *l = lhs;
+  struct owl_mesh_cluster const *r = rhs;
+
+  /* descending, ties keep the cache optimized order */
+  if (l->sort_key != r->sort_key)
+    return l->sort_key < r->sort_key ? 1 : -1;
+
+  return l->first - r->first;
+}
+
+static float const *owl_mesh_position(float const *positions, int32_t stride,
+                                      uint32_t vertex) {
+  return (float const *)((uint8_t const *)positions + vertex * stride);
+}
+
+OWLAPI int owl_mesh_optimize_overdraw(uint32_t *indices, int32_t num_indices,
+                                      float const *positions, int32_t stride,
+                                      int32_t num_vertices) {
+  int32_t i;
+  int32_t j;
+  int32_t num_clusters;
+  int32_t num_triangles;
+  uint32_t time;
+  uint32_t *timestamps;
+  uint32_t *output;
+  owl_v3 mesh_center;
+  float mesh_area;
+  struct owl_mesh_cluster *clusters;
+  int ret = OWL_OK;
+
+  num_triangles = num_indices / 3;
+  if (num_triangles < 2)
+    return OWL_OK;
+
+  timestamps = OWL_MALLOC(num_vertices * sizeof(*timestamps));
+  clusters = OWL_MALLOC(num_triangles * sizeof(*clusters));
+  output = OWL_MALLOC(num_indices * sizeof(*output));
+
+  if (!timestamps || !clusters || !output) {
+    ret = OWL_ERROR_NO_MEMORY;
+    goto out;
+  }
+
+  OWL_MEMSET(timestamps, 0, num_vertices * sizeof(*timestamps));
+
+  /* a triangle that misses all of its vertices starts over in the cache,
+   * moving the clusters around at those points barely changes the acmr */
+  num_clusters = 0;
+  time = OWL_MESH_CACHE_SIZE + 1;
+
+  for (i = 0; i < num_triangles; ++i) {
+    int32_t num_misses = 0;
+
+    for (j = 0; j < 3; ++j) {
+      uint32_t const vertex = indices[i * 3 + j];
+
+      if (time - timestamps[vertex] > OWL_MESH_CACHE_SIZE) {
+        timestamps[vertex] = time++;
+        ++num_misses;
+      }
+    }
+
+    if (!num_clusters || 3 == num_misses) {
+      clusters[num_clusters].first = i;
+      clusters[num_clusters].num_triangles = 0;
+      ++num_clusters;
+    }
+
+    ++clusters[num_clusters - 1].num_triangles;
+  }
+
+  if (1 == num_clusters)
+    goto out;
+
+  /* area weighted center of the mesh */
+  mesh_area = 0.0F;
+  OWL_V3_ZERO(mesh_center);
+
+  for (i = 0; i < num_triangles; ++i) {
+    float area;
+    owl_v3 e0;
+    owl_v3 e1;
+    owl_v3 normal;
+    float const *p0 = owl_mesh_position(positions, stride, indices[i * 3 + 0]);
+    float const *p1 = owl_mesh_position(positions, stride, indices[i * 3 + 1]);
+    float const *p2 = owl_mesh_position(positions, stride, indices[i * 3 + 2]);
+
+    OWL_V3_SUB(p1, p0, e0);
+    OWL_V3_SUB(p2, p0, e1);
+    owl_v3_cross(e0, e1, normal);
+    area = owl_v3_magnitude(normal);
+
+    mesh_center[0] += (p0[0] + p1[0] + p2[0]) * area;
+    mesh_center[1] += (p0[1] + p1[1] + p2[1]) * area;
+    mesh_center[2] += (p0[2] + p1[2] + p2[2]) * area;
+    mesh_area += area * 3.0F;
+  }
+
+  if (0.0F < mesh_area)
+    OWL_V3_INVERSE_SCALE(mesh_center, mesh_area, mesh_center);
+
+  /* clusters facing away from the center are likely in front of the rest */
+  for (i = 0; i < num_clusters; ++i) {
+    float area = 0.0F;
+    owl_v3 center;
+    owl_v3 normal;
+    owl_v3 direction;
+    float magnitude;
+    struct owl_mesh_cluster *cluster = &clusters[i];
+
+    OWL_V3_ZERO(center);
+    OWL_V3_ZERO(normal);
+
+    for (j = cluster->first; j < cluster->first + cluster->num_triangles;
+         ++j) {
+      float triangle_area;
+      owl_v3 e0;
+      owl_v3 e1;
+      owl_v3 triangle_normal;
+      float const *p0 =
+          owl_mesh_position(positions, stride, indices[j * 3 + 0]);
+      float const *p1 =
+          owl_mesh_position(positions, stride, indices[j * 3 + 1]);
+      float const *p2 =
+          owl_mesh_position(positions, stride, indices[j * 3 + 2]);
+
+      OWL_V3_SUB(p1, p0, e0);
+      OWL_V3_SUB(p2, p0, e1);
+      owl_v3_cross(e0, e1, triangle_normal);
+      triangle_area = owl_v3_magnitude(triangle_normal);
+
+      center[0] += (p0[0] + p1[0] + p2[0]) * triangle_area;
+      center[1] += (p0[1] + p1[1] + p2[1]) * triangle_area;
+      center[2] += (p0[2] + p1[2] + p2[2]) * triangle_area;
+      area += triangle_area * 3.0F;
+
+      OWL_V3_ADD(normal, triangle_normal, normal);
+    }
+
+    magnitude = owl_v3_magnitude(normal);
+
+    if (0.0F < area && 0.0F < magnitude) {
+      OWL_V3_INVERSE_SCALE(center, area, center);
+      OWL_V3_INVERSE_SCALE(normal, magnitude, normal);
+      OWL_V3_SUB(center, mesh_center, direction);
+      cluster->sort_key = OWL_V3_DOT(direction, normal);
+    } else {
+      cluster->sort_key = 0.0F;
+    }
+  }
+
+  qsort(clusters, num_clusters, sizeof(*clusters), owl_mesh_compare_clusters);
+
+  for (i = 0, j = 0; i < num_clusters; ++i) {
+    uint64_t const size = clusters[i].num_triangles * 3 * sizeof(*indices);
+
+    OWL_MEMCPY(&output[j], &indices[clusters[i].first * 3], size);
+    j += clusters[i].num_triangles * 3;
+  }
+
+  OWL_MEMCPY(indices, output, num_triangles * 3 * sizeof(*indices));
+
+out:
+  OWL_FREE(output);
+  OWL_FREE(clusters);
+  OWL_FREE(timestamps);
+
+  return ret;
+}
+
+static void owl_mesh_compute_meshlet_bounds(uint32_t const *indices,
+                                            float const *positions,
+                                            int32_t stride,
+                                            struct owl_mesh_meshlet *meshlet) {
+  uint32_t i;
+  owl_v3 axis;
+  float magnitude;
+  float min_dot = 1.0F;
+  uint32_t const *first = &indices[meshlet->first];
+
+  OWL_V3_SET(meshlet->min, FLT_MAX, FLT_MAX, FLT_MAX);
+  OWL_V3_SET(meshlet->max, -FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+  for (i = 0; i < meshlet->num_indices; ++i) {
+    float const *p = owl_mesh_position(positions, stride, first[i]);
+
+    meshlet->min[0] = OWL_MIN(meshlet->min[0], p[0]);
+    meshlet->min[1] = OWL_MIN(meshlet->min[1], p[1]);
+    meshlet->min[2] = OWL_MIN(meshlet->min[2], p[2]);
+    meshlet->max[0] = OWL_MAX(meshlet->max[0], p[0]);
+    meshlet->max[1] = OWL_MAX(meshlet->max[1], p[1]);
+    meshlet->max[2] = OWL_MAX(meshlet->max[2], p[2]);
+  }
+
+  OWL_V3_ADD(meshlet->min, meshlet->max, meshlet->center);
+  OWL_V3_SCALE(meshlet->center, 0.5F, meshlet->center);
+
+  meshlet->radius = 0.0F;
+  for (i = 0; i < meshlet->num_indices; ++i) {
+    float const *p = owl_mesh_position(positions, stride, first[i]);
+    float const distance = owl_v3_distance(meshlet->center, p);
+
+    meshlet->radius = OWL_MAX(meshlet->radius, distance);
+  }
+
+  /* the cone axis averages the unit normals, degenerate triangles can face
+   * anywhere and are left out */
+  OWL_V3_ZERO(axis);
+  for (i = 0; i < meshlet->num_indices; i += 3) {
+    owl_v3 e0;
+    owl_v3 e1;
+    owl_v3 normal;
+    float const *p0 = owl_mesh_position(positions, stride, first[i + 0]);
+    float const *p1 = owl_mesh_position(positions, stride, first[i + 1]);
+    float const *p2 = owl_mesh_position(positions, stride, first[i + 2]);
+
+    OWL_V3_SUB(p1, p0, e0);
+    OWL_V3_SUB(p2, p0, e1);
+    owl_v3_cross(e0, e1, normal);
+
+    magnitude = owl_v3_magnitude(normal);
+    if (0.0F < magnitude) {
+      OWL_V3_INVERSE_SCALE(normal, magnitude, normal);
+      OWL_V3_ADD(axis, normal, axis);
+    }
+  }
+
+  magnitude = owl_v3_magnitude(axis);
+  if (0.0F == magnitude) {
+    OWL_V3_ZERO(meshlet->cone_axis);
+    meshlet->cone_cutoff = 2.0F;
+    return;
+  }
+
+  OWL_V3_INVERSE_SCALE(axis, magnitude, meshlet->cone_axis);
+
+  for (i = 0; i < meshlet->num_indices; i += 3) {
+    owl_v3 e0;
+    owl_v3 e1;
+    owl_v3 normal;
+    float const *p0 = owl_mesh_position(positions, stride, first[i + 0]);
+    float const *p1 = owl_mesh_position(positions, stride, first[i + 1]);
+    float const *p2 = owl_mesh_position(positions, stride, first[i + 2]);
+
+    OWL_V3_SUB(p1, p0, e0);
+    OWL_V3_SUB(p2, p0, e1);
+    owl_v3_cross(e0, e1, normal);
+
+    magnitude = owl_v3_magnitude(normal);
+    if (0.0F < magnitude) {
+      float const d = OWL_V3_DOT(normal, meshlet->cone_axis) / magnitude;
+      min_dot = OWL_MIN(min_dot, d);
+    }
+  }
+
+  /* past ~84 degrees the cone culls next to nothing */
+  if (0.1F >= min_dot)
+    meshlet->cone_cutoff = 2.0F;
+  else
+    meshlet->cone_cutoff = (float)sqrt(1.0F - min_dot * min_dot);
+}
+
+OWLAPI int owl_mesh_build_meshlets(uint32_t const *indices,
+                                   int32_t num_indices,
+                                   float const *positions, int32_t stride,
+                                   int32_t num_vertices, int32_t *num_meshlets,
+                                   struct owl_mesh_meshlet *meshlets) {
+  int32_t i;
+  int32_t j;
+  uint32_t stamp = 1;
+  uint32_t first = 0;
+  int32_t num_meshlet_vertices = 0;
+  int32_t num_meshlet_triangles = 0;
+  uint32_t *stamps;
+
+  *num_meshlets = 0;
+
+  if (num_indices < 3)
+    return OWL_OK;
+
+  /* stamps[vertex] == stamp if the current meshlet references the vertex */
+  stamps = OWL_MALLOC(num_vertices * sizeof(*stamps));
+  if (!stamps)
+    return OWL_ERROR_NO_MEMORY;
+
+  OWL_MEMSET(stamps, 0, num_vertices * sizeof(*stamps));
+
+  for (i = 0; i < num_indices / 3; ++i) {
+    int32_t num_new = 0;
+    uint32_t const *triangle = &indices[i * 3];
+
+    for (j = 0; j < 3; ++j)
+      if (stamp != stamps[triangle[j]] &&
+          (j < 1 || triangle[j] != triangle[0]) &&
+          (j < 2 || triangle[j] != triangle[1]))
+        ++num_new;
+
+    if (num_meshlet_triangles &&
+        (OWL_MESH_MAX_MESHLET_VERTICES < num_meshlet_vertices + num_new ||
+         OWL_MESH_MAX_MESHLET_TRIANGLES == num_meshlet_triangles)) {
+      if (meshlets) {
+        struct owl_mesh_meshlet *meshlet = &meshlets[*num_meshlets];
+
+        meshlet->first = first;
+        meshlet->num_indices = (uint32_t)(i * 3) - first;
+        owl_mesh_compute_meshlet_bounds(indices, positions, stride, meshlet);
+      }
+
+      ++*num_meshlets;
+
+      /* none of the vertices belong to the new meshlet yet */
+      ++stamp;
+      first = (uint32_t)(i * 3);
+      num_meshlet_vertices = 0;
+      num_meshlet_triangles = 0;
+
+      num_new = 1 + (triangle[1] != triangle[0]) +
+                (triangle[2] != triangle[0] && triangle[2] != triangle[1]);
+    }
+
+    for (j = 0; j < 3; ++j)
+      stamps[triangle[j]] = stamp;
+
+    num_meshlet_vertices += num_new;
+    ++num_meshlet_triangles;
+  }
+
+  if (meshlets) {
+    struct owl_mesh_meshlet *meshlet = &meshlets[*num_meshlets];
+
+    meshlet->first = first;
+    meshlet->num_indices = (uint32_t)(num_indices / 3 * 3) - first;
+    owl_mesh_compute_meshlet_bounds(indices, positions, stride, meshlet);
+  }
+
+  ++*num_meshlets;
+
+  OWL_FREE(stamps);
+
+  return OWL_OK;
+}
+
+/* the squared distance of p to the planes summed into the quadric is
+ * p^T a p + 2 b.p + c, only the upper half of a is kept */
+struct owl_mesh_quadric {
+  double a00;
+  double a01;
+  double a02;
+  double a11;
+  double a12;
+  double a22;
+  double b0;
+  double b1;
+  double b2;
+  double c;
+};
+
+struct owl_mesh_collapse {
+  double error;
+  uint32_t from;
+  uint32_t to;
+};
+
+static void owl_mesh_add_plane(struct owl_mesh_quadric *q,
+                               double const *normal, double d) {
+  q->a00 += normal[0] * normal[0];
+  q->a01 += normal[0] * normal[1];
+  q->a02 += normal[0] * normal[2];
+  q->a11 += normal[1] * normal[1];
+  q->a12 += normal[1] * normal[2];
+  q->a22 += normal[2] * normal[2];
+  q->b0 += normal[0] * d;
+  q->b1 += normal[1] * d;
+  q->b2 += normal[2] * d;
+  q->c += d * d;
+}
+
+static void owl_mesh_add_quadric(struct owl_mesh_quadric *q,
+                                 struct owl_mesh_quadric const *other) {
+  q->a00 += other->a00;
+  q->a01 += other->a01;
+  q->a02 += other->a02;
+  q->a11 += other->a11;
+  q->a12 += other->a12;
+  q->a22 += other->a22;
+  q->b0 += other->b0;
+  q->b1 += other->b1;
+  q->b2 += other->b2;
+  q->c += other->c;
+}
+
+static double owl_mesh_evaluate_quadric(struct owl_mesh_quadric const *q,
+                                        float const *p) {
+  double const x = p[0];
+  double const y = p[1];
+  double const z = p[2];
+  double error;
+
+  error = q->a00 * x * x + q->a11 * y * y + q->a22 * z * z;
+  error += 2.0 * (q->a01 * x * y + q->a02 * x * z + q->a12 * y * z);
+  error += 2.0 * (q->b0 * x + q->b1 * y + q->b2 * z) + q->c;
+
+  /* rounding can take it slightly under 0 */
+  return OWL_MAX(error, 0.0);
+}
+
+static int owl_mesh_compare_collapses(void const *lhs, void const *rhs) {
+  struct owl_mesh_collapse const *l = lhs;
+  struct owl_mesh_collapse const *r = rhs;
+
+  /* ascending, ties are broken by vertex so the result doesn't depend on the
+   * qsort implementation */
+  if (l->error != r->error)
+    return l->error < r->error ? -1 : 1;
+
+  if (l->from != r->from)
+    return l->from < r->from ? -1 : 1;
+
+  if (l->to != r->to)
+    return l->to < r->to ? -1 : 1;
+
+  return 0;
+}
+
+static int owl_mesh_compare_edges(void const *lhs, void const *rhs) {
+  uint64_t const l = *(uint64_t const *)lhs;
+  uint64_t const r = *(uint64_t const *)rhs;
+
+  if (l != r)
+    return l < r ? -1 : 1;
+
+  return 0;
+}
+
+/* moving from onto to turns one of the triangles around from over, the ones
+ * that also use to fold away and don't count */
+static int owl_mesh_collapse_flips(uint32_t const *indices,
+                                   uint32_t const *offsets,
+                                   uint32_t const *adjacency,
+                                   float const *positions, int32_t stride,
+                                   uint32_t from, uint32_t to) {
+  uint32_t i;
+  int32_t j;
+
+  for (i = offsets[from]; i < offsets[from + 1]; ++i) {
+    owl_v3 e0;
+    owl_v3 e1;
+    owl_v3 before;
+    owl_v3 after;
+    float const *p[3];
+    float const *q[3];
+    uint32_t const *triangle = &indices[adjacency[i] * 3];
+
+    if (to == triangle[0] || to == triangle[1] || to == triangle[2])
+      continue;
+
+    for (j = 0; j < 3; ++j) {
+      p[j] = owl_mesh_position(positions, stride, triangle[j]);
+      q[j] = from == triangle[j] ? owl_mesh_position(positions, stride, to)
+                                 : p[j];
+    }
+
+    OWL_V3_SUB(p[1], p[0], e0);
+    OWL_V3_SUB(p[2], p[0], e1);
+    owl_v3_cross(e0, e1, before);
+
+    OWL_V3_SUB(q[1], q[0], e0);
+    OWL_V3_SUB(q[2], q[0], e1);
+    owl_v3_cross(e0, e1, after);
+
+    if (OWL_V3_DOT(before, after) <= 0.0F)
+      return 1;
+  }
+
+  return 0;
+}
+
+OWLAPI int owl_mesh_simplify(uint32_t const *indices, int32_t num_indices,
+                             float const *positions, int32_t stride,
+                             int32_t num_vertices, int32_t target_num_indices,
+                             float target_error, uint32_t *destination,
+                             int32_t *num_destination, float *error) {
+  int32_t i;
+  int32_t j;
+  int32_t count;
+  double max_error = 0.0;
+  double const limit = (double)target_error * (double)target_error;
+  uint64_t *edges;
+  uint8_t *locked;
+  uint8_t *touched;
+  uint32_t *remap;
+  uint32_t *offsets;
+  uint32_t *adjacency;
+  struct owl_mesh_quadric *quadrics;
+  struct owl_mesh_collapse *collapses;
+  int ret = OWL_OK;
+
+  count = num_indices / 3 * 3;
+
+  *num_destination = count;
+  *error = 0.0F;
+
+  if (!count)
+    return OWL_OK;
+
+  OWL_MEMCPY(destination, indices, count * sizeof(*destination));
+
+  if (count <= target_num_indices)
+    return OWL_OK;
+
+  edges = OWL_MALLOC(count * sizeof(*edges));
+  locked = OWL_MALLOC(num_vertices * sizeof(*locked));
+  touched = OWL_MALLOC(num_vertices * sizeof(*touched));
+  remap = OWL_MALLOC(num_vertices * sizeof(*remap));
+  offsets = OWL_MALLOC((num_vertices + 1) * sizeof(*offsets));
+  adjacency = OWL_MALLOC(count * sizeof(*adjacency));
+  quadrics = OWL_MALLOC(num_vertices * sizeof(*quadrics));
+  collapses = OWL_MALLOC(count * sizeof(*collapses));
+
+  if (!edges || !locked || !touched || !remap || !offsets || !adjacency ||
+      !quadrics || !collapses) {
+    ret = OWL_ERROR_NO_MEMORY;
+    goto out;
+  }
+
+  OWL_MEMSET(locked, 0, num_vertices * sizeof(*locked));
+
+  for (i = 0; i < num_vertices; ++i) {
+    remap[i] = (uint32_t)i;
+    OWL_MEMSET(&quadrics[i], 0, sizeof(quadrics[i]));
+  }
+
+  /* every vertex starts with the planes of the triangles around it */
+  for (i = 0; i < count; i += 3) {
+    owl_v3 e0;
+    owl_v3 e1;
+    owl_v3 normal;
+    double plane[3];
+    double d;
+    float magnitude;
+    float const *p0 = owl_mesh_position(positions, stride, destination[i + 0]);
+    float const *p1 = owl_mesh_position(positions, stride, destination[i + 1]);
+    float const *p2 = owl_mesh_position(positions, stride, destination[i + 2]);
+
+    OWL_V3_SUB(p1, p0, e0);
+    OWL_V3_SUB(p2, p0, e1);
+    owl_v3_cross(e0, e1, normal);
+
+    magnitude = owl_v3_magnitude(normal);
+    if (0.0F == magnitude)
+      continue;
+
+    plane[0] = normal[0] / magnitude;
+    plane[1] = normal[1] / magnitude;
+    plane[2] = normal[2] / magnitude;
+    d = -(plane[0] * p0[0] + plane[1] * p0[1] + plane[2] * p0[2]);
+
+    for (j = 0; j < 3; ++j)
+      owl_mesh_add_plane(&quadrics[destination[i + j]], plane, d);
+  }
+
+  /* an edge without its twin is open, either a border or a seam where the
+   * attributes split a vertex in two. moving its vertices would tear the
+   * surface */
+  for (i = 0; i < count; ++i) {
+    uint32_t const from = destination[i];
+    uint32_t const to = destination[i - i % 3 + (i + 1) % 3];
+
+    edges[i] = (uint64_t)from << 32 | to;
+  }
+
+  qsort(edges, count, sizeof(*edges), owl_mesh_compare_edges);
+
+  for (i = 0; i < count; ++i) {
+    uint32_t const from = (uint32_t)(edges[i] >> 32);
+    uint32_t const to = (uint32_t)(edges[i] & 0xFFFFFFFF);
+    uint64_t const twin = (uint64_t)to << 32 | from;
+
+    if (!bsearch(&twin, edges, count, sizeof(*edges),
+                 owl_mesh_compare_edges)) {
+      locked[from] = 1;
+      locked[to] = 1;
+    }
+  }
+
+  /* a pass collapses the cheapest edges that don't share triangles, so the
+   * flip tests stay valid, and then rebuilds everything */
+  while (target_num_indices < count) {
+    int32_t num_collapses = 0;
+    int32_t num_removed = 0;
+
+    for (i = 0; i < count; ++i) {
+      float const *p;
+      struct owl_mesh_collapse *collapse;
+      uint32_t const from = destination[i];
+      uint32_t const to = destination[i - i % 3 + (i + 1) % 3];
+
+      if (locked[from] || from == to)
+        continue;
+
+      p = owl_mesh_position(positions, stride, to);
+
+      collapse = &collapses[num_collapses++];
+      collapse->from = from;
+      collapse->to = to;
+      collapse->error = owl_mesh_evaluate_quadric(&quadrics[from], p) +
+                        owl_mesh_evaluate_quadric(&quadrics[to], p);
+    }
+
+    if (!num_collapses)
+      break;
+
+    qsort(collapses, num_collapses, sizeof(*collapses),
+          owl_mesh_compare_collapses);
+
+    /* the triangles around every vertex, for the flip tests */
+    OWL_MEMSET(offsets, 0, (num_vertices + 1) * sizeof(*offsets));
+
+    for (i = 0; i < count; ++i)
+      ++offsets[destination[i] + 1];
+
+    for (i = 0; i < num_vertices; ++i)
+      offsets[i + 1] += offsets[i];
+
+    /* filling a range moves its start to the end, which is where the next
+     * one starts */
+    for (i = 0; i < count; ++i)
+      adjacency[offsets[destination[i]]++] = (uint32_t)(i / 3);
+
+    for (i = num_vertices; i > 0; --i)
+      offsets[i] = offsets[i - 1];
+
+    offsets[0] = 0;
+
+    OWL_MEMSET(touched, 0, num_vertices * sizeof(*touched));
+
+    for (i = 0; i < num_collapses; ++i) {
+      uint32_t k;
+      struct owl_mesh_collapse const *collapse = &collapses[i];
+      uint32_t const from = collapse->from;
+      uint32_t const to = collapse->to;
+
+      if (limit < collapse->error)
+        break;
+
+      if (touched[from] || touched[to])
+        continue;
+
+      if (owl_mesh_collapse_flips(destination, offsets, adjacency, positions,
+                                  stride, from, to))
+        continue;
+
+      /* the triangles around from change shape, none of their vertices can
+       * move again this pass */
+      for (k = offsets[from]; k < offsets[from + 1]; ++k) {
+        uint32_t const *triangle = &destination[adjacency[k] * 3];
+
+        touched[triangle[0]] = 1;
+        touched[triangle[1]] = 1;
+        touched[triangle[2]] = 1;
+
+        if (to == triangle[0] || to == triangle[1] || to == triangle[2])
+          num_removed += 3;
+      }
+
+      remap[from] = to;
+      owl_mesh_add_quadric(&quadrics[to], &quadrics[from]);
+      max_error = OWL_MAX(max_error, collapse->error);
+
+      if (count - num_removed <= target_num_indices)
+        break;
+    }
+
+    if (!num_removed)
+      break;
+
+    /* moves the collapsed vertices and drops the triangles that folded */
+    for (i = 0, j = 0; i < count; i += 3) {
+      uint32_t const a = remap[destination[i + 0]];
+      uint32_t const b = remap[destination[i + 1]];
+      uint32_t const c = remap[destination[i + 2]];
+
+      if (a == b || b == c || c == a)
+        continue;
+
+      destination[j++] = a;
+      destination[j++] = b;
+      destination[j++] = c;
+    }
+
+    count = j;
+  }
+
+  *num_destination = count;
+
+out:
+  OWL_FREE(collapses);
+  OWL_FREE(quadrics);
+  OWL_FREE(adjacency);
+  OWL_FREE(offsets);
+  OWL_FREE(remap);
+  OWL_FREE(touched);
+  OWL_FREE(locked);
+  OWL_FREE(edges);
+
+  *error = (float)sqrt(max_error);
+
+  return ret;
+}
+
+OWLAPI void owl_mesh_optimize_vertex_fetch(uint32_t *indices,
+                                           int32_t num_indices,
+                                           int32_t num_vertices,
+                                           uint32_t *remap) {
+  int32_t i;
+  uint32_t next = 0;
+
+  for (i = 0; i < num_vertices; ++i)
+    remap[i] = (uint32_t)-1;
+
+  for (i = 0; i < num_indices; ++i) {
+    uint32_t const vertex = indices[i];
+
+    if ((uint32_t)-1 == remap[vertex])
+      remap[vertex] = next++;
+
+    indices[i] = remap[vertex];
+  }
+
+  for (i = 0; i < num_vertices; ++i)
+    if ((uint32_t)-1 == remap[i])
+      remap[i] = next++;
+}
+
+OWLAPI int owl_mesh_remap_vertices(void *vertices, int32_t num_vertices,
+                                   uint64_t vertex_size,
+                                   uint32_t const *remap) {
+  int32_t i;
+  uint8_t *copy;
+  uint8_t *data = vertices;
+
+  if (!num_vertices || !vertex_size)
+    return OWL_OK;
+
+  copy = OWL_MALLOC(num_vertices * vertex_size);
+  if (!copy)
+    return OWL_ERROR_NO_MEMORY;
+
+  OWL_MEMCPY(copy, data, num_vertices * vertex_size);
+
+  for (i = 0; i < num_vertices; ++i)
+    OWL_MEMCPY(&data[remap[i] * vertex_size], &copy[i * vertex_size],
+               vertex_size);
+
+  OWL_FREE(copy);
+
+  return OWL_OK;
+}
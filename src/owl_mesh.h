@@ -0,0 +1,97 @@
+#ifndef OWL_MESH_H
+#define OWL_MESH_H
+
+#include "owl_definitions.h"
+
+OWL_BEGIN_DECLARATIONS
+
+/* the fifo size the statistics and the overdraw clusters are computed with,
+ * roughly what current gpus keep around after the vertex shader */
+#define OWL_MESH_CACHE_SIZE 16
+
+#define OWL_MESH_MAX_MESHLET_VERTICES 64
+#define OWL_MESH_MAX_MESHLET_TRIANGLES 124
+
+/* post-transform cache statistics of a triangle list, acmr is the number of
+ * transformed vertices per triangle and atvr the number of transformed
+ * vertices per referenced vertex. 0.5 and 1.0 are the best possible */
+struct owl_mesh_cache_stats {
+  float acmr;
+  float atvr;
+};
+
+/* a contiguous run of triangles referencing at most
+ * OWL_MESH_MAX_MESHLET_VERTICES vertices, with the bounds to cull it. the
+ * triangles face away from any point p where
+ * dot(center - p, cone_axis) >= cone_cutoff * length(center - p) + radius,
+ * a cutoff above 1 means the normals are too spread to ever cull */
+struct owl_mesh_meshlet {
+  uint32_t first;
+  uint32_t num_indices;
+  owl_v3 min;
+  owl_v3 max;
+  owl_v3 center;
+  float radius;
+  owl_v3 cone_axis;
+  float cone_cutoff;
+};
+
+/* all the indices are relative to the first vertex of the mesh and less
+ * than num_vertices */
+
+OWLAPI int
+owl_mesh_analyze_vertex_cache(uint32_t const *indices, int32_t num_indices,
+                              int32_t num_vertices, int32_t cache_size,
+                              struct owl_mesh_cache_stats *stats);
+
+/* reorders the triangles so that the vertices they share stay in the cache,
+ * tom forsyth's linear-speed vertex cache optimisation */
+OWLAPI int owl_mesh_optimize_vertex_cache(uint32_t *indices,
+                                          int32_t num_indices,
+                                          int32_t num_vertices);
+
+/* splits the cache optimized triangles where the cache starts over and draws
+ * the outward facing clusters first, so they occlude the rest. keeps the
+ * acmr within the clusters. positions are read stride bytes apart */
+OWLAPI int owl_mesh_optimize_overdraw(uint32_t *indices, int32_t num_indices,
+                                      float const *positions, int32_t stride,
+                                      int32_t num_vertices);
+
+/* renumbers the vertices in the order the indices first reference them and
+ * rewrites the indices, remap[old] is the new position of every vertex.
+ * unreferenced vertices are moved to the end */
+OWLAPI void owl_mesh_optimize_vertex_fetch(uint32_t *indices,
+                                           int32_t num_indices,
+                                           int32_t num_vertices,
+                                           uint32_t *remap);
+
+/* splits the triangles into meshlets in the order they already are, run it
+ * after the cache and overdraw optimisations. only counts them if meshlets is
+ * NULL */
+OWLAPI int owl_mesh_build_meshlets(uint32_t const *indices,
+                                   int32_t num_indices,
+                                   float const *positions, int32_t stride,
+                                   int32_t num_vertices, int32_t *num_meshlets,
+                                   struct owl_mesh_meshlet *meshlets);
+
+/* collapses edges of the triangles into destination until at most
+ * target_num_indices are left or the next collapse would move the surface
+ * further than target_error, garland and heckbert's quadric error metric.
+ * vertices are merged into a neighbour and never moved, so the result still
+ * indexes the same vertices, the ones on open edges and attribute seams
+ * stay. error is how far the surface moved, in the units of the positions.
+ * destination has room for num_indices */
+OWLAPI int owl_mesh_simplify(uint32_t const *indices, int32_t num_indices,
+                             float const *positions, int32_t stride,
+                             int32_t num_vertices, int32_t target_num_indices,
+                             float target_error, uint32_t *destination,
+                             int32_t *num_destination, float *error);
+
+/* moves vertices of vertex_size bytes to remap[i] */
+OWLAPI int owl_mesh_remap_vertices(void *vertices, int32_t num_vertices,
+                                   uint64_t vertex_size,
+                                   uint32_t const *remap);
+
+OWL_END_DECLARATIONS
+
+#endif
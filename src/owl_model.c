@@ -2,9 +2,12 @@
 
 #include "cgltf.h"
 #include "owl_internal.h"
+#include "owl_mesh.h"
+#include "owl_plataform.h"
 #include "owl_renderer.h"
 #include "owl_texture.h"
 #include "owl_vector_math.h"
+#include "stb_image.h"
 
 #include <float.h>
 #include <stdio.h>
@@ -45,41 +48,460 @@ static int owl_model_get_real_uri(struct owl_model *m, char const *src,
   return ret;
 }
 
+struct owl_model_storage {
+  uint64_t size;
+  uint8_t *data;
+};
+
+/* while data is NULL this only measures, once allocated the same sequence of
+ * pushes hands out the memory */
+static void *owl_model_storage_push(struct owl_model_storage *s,
+                                    uint64_t count, uint64_t stride) {
+  uint64_t const offset = OWL_ALIGN_UP_2(s->size, 16);
+
+  s->size = offset + count * stride;
+
+  if (!s->data)
+    return NULL;
+
+  return &s->data[offset];
+}
+
+static uint64_t owl_model_name_size(char const *name) {
+  return name ? OWL_STRLEN(name) + 1 : sizeof("NO NAME");
+}
+
+static void owl_model_copy_name(char const *src, char *dst) {
+  if (!src)
+    src = "NO NAME";
+
+  OWL_MEMCPY(dst, src, OWL_STRLEN(src) + 1);
+}
+
+/* sizes every array of the model from the gltf counts, hot node data is laid
+ * out first and contiguously, the cold data and the variable length pools
+ * (children, joints, keyframes, names) go after */
+static void owl_model_layout_storage(struct cgltf_data const *gltf,
+                                     struct owl_model_storage *s,
+                                     struct owl_model *m) {
+  uint64_t i;
+  uint64_t j;
+  uint64_t num_meshes = 0;
+  uint64_t num_primitives = 0;
+  uint64_t num_samplers = 0;
+  uint64_t num_channels = 0;
+  uint64_t num_weights = 0;
+  uint64_t const num_nodes = gltf->nodes_count;
+
+  for (i = 0; i < gltf->nodes_count; ++i) {
+    struct cgltf_node const *node = &gltf->nodes[i];
+
+    if (!node->mesh)
+      continue;
+
+    ++num_meshes;
+    num_primitives += node->mesh->primitives_count;
+
+    if (node->mesh->primitives_count)
+      num_weights += node->mesh->primitives[0].targets_count;
+  }
+
+  for (i = 0; i < gltf->animations_count; ++i) {
+    num_samplers += gltf->animations[i].samplers_count;
+    num_channels += gltf->animations[i].channels_count;
+  }
+
+  m->node_order = owl_model_storage_push(s, num_nodes, sizeof(int32_t));
+  m->node_parents = owl_model_storage_push(s, num_nodes, sizeof(int32_t));
+  m->node_meshes = owl_model_storage_push(s, num_nodes, sizeof(int32_t));
+  m->node_skins = owl_model_storage_push(s, num_nodes, sizeof(int32_t));
+  m->node_joints_offsets = owl_model_storage_push(s, num_nodes,
+                                                  sizeof(int32_t));
+  m->node_weights_offsets = owl_model_storage_push(s, num_nodes,
+                                                   sizeof(int32_t));
+  m->node_num_weights = owl_model_storage_push(s, num_nodes, sizeof(int32_t));
+  m->node_translations = owl_model_storage_push(s, num_nodes, sizeof(owl_v3));
+  m->node_rotations = owl_model_storage_push(s, num_nodes, sizeof(owl_v4));
+  m->node_scales = owl_model_storage_push(s, num_nodes, sizeof(owl_v3));
+  m->node_matrices = owl_model_storage_push(s, num_nodes, sizeof(owl_m4));
+  m->weights = owl_model_storage_push(s, num_weights, sizeof(float));
+
+  m->batches = owl_model_storage_push(s, gltf->materials_count,
+                                      sizeof(*m->batches));
+  m->skin_jobs = owl_model_storage_push(s, num_primitives,
+                                        sizeof(*m->skin_jobs));
+  m->primitives = owl_model_storage_push(s, num_primitives,
+                                         sizeof(*m->primitives));
+  m->meshes = owl_model_storage_push(s, num_meshes, sizeof(*m->meshes));
+  m->materials = owl_model_storage_push(s, gltf->materials_count,
+                                        sizeof(*m->materials));
+  m->textures = owl_model_storage_push(s, gltf->textures_count,
+                                       sizeof(*m->textures));
+  m->images = owl_model_storage_push(s, gltf->images_count,
+                                     sizeof(*m->images));
+  m->skins = owl_model_storage_push(s, gltf->skins_count, sizeof(*m->skins));
+  m->channels = owl_model_storage_push(s, num_channels, sizeof(*m->channels));
+  m->samplers = owl_model_storage_push(s, num_samplers, sizeof(*m->samplers));
+  m->animations = owl_model_storage_push(s, gltf->animations_count,
+                                         sizeof(*m->animations));
+  m->roots = owl_model_storage_push(s, gltf->scene->nodes_count,
+                                    sizeof(*m->roots));
+  m->nodes = owl_model_storage_push(s, num_nodes, sizeof(*m->nodes));
+
+  for (i = 0; i < gltf->nodes_count; ++i) {
+    struct cgltf_node const *in_node = &gltf->nodes[i];
+    int32_t *children;
+    char *name;
+
+    children = owl_model_storage_push(s, in_node->children_count,
+                                      sizeof(*children));
+    name = owl_model_storage_push(s, owl_model_name_size(in_node->name), 1);
+
+    if (s->data) {
+      m->nodes[i].children = children;
+      m->nodes[i].name = name;
+    }
+  }
+
+  for (i = 0; i < gltf->skins_count; ++i) {
+    struct cgltf_skin const *in_skin = &gltf->skins[i];
+    owl_m4 *inverse_bind_matrices;
+    int32_t *joints;
+    char *name;
+
+    /* missing inverse bind matrices are identities, one per joint */
+    inverse_bind_matrices = owl_model_storage_push(s, in_skin->joints_count,
+                                                   sizeof(owl_m4));
+    joints = owl_model_storage_push(s, in_skin->joints_count, sizeof(*joints));
+    name = owl_model_storage_push(s, owl_model_name_size(in_skin->name), 1);
+
+    if (s->data) {
+      m->skins[i].inverse_bind_matrices = inverse_bind_matrices;
+      m->skins[i].joints = joints;
+      m->skins[i].name = name;
+    }
+  }
+
+  for (i = 0, num_samplers = 0; i < gltf->animations_count; ++i) {
+    struct cgltf_animation const *in_animation = &gltf->animations[i];
+    char *name;
+
+    for (j = 0; j < in_animation->samplers_count; ++j, ++num_samplers) {
+      struct cgltf_animation_sampler const *in_sampler;
+      float *inputs;
+      owl_v4 *outputs;
+
+      in_sampler = &in_animation->samplers[j];
+      inputs = owl_model_storage_push(s, in_sampler->input->count,
+                                      sizeof(*inputs));
+      outputs = owl_model_storage_push(s, in_sampler->output->count,
+                                       sizeof(*outputs));
+
+      if (s->data) {
+        m->samplers[num_samplers].inputs = inputs;
+        m->samplers[num_samplers].outputs = outputs;
+      }
+    }
+
+    name = owl_model_storage_push(s, owl_model_name_size(in_animation->name),
+                                  1);
+
+    if (s->data)
+      m->animations[i].name = name;
+  }
+}
+
+/* same two pass scheme as owl_model_layout_storage, sized from the model */
+static void
+owl_model_instance_layout_storage(struct owl_model const *m,
+                                  struct owl_model_storage *s,
+                                  struct owl_model_instance *instance) {
+  int32_t const num_nodes = m->num_nodes;
+
+  instance->dirty_nodes = owl_model_storage_push(s, num_nodes,
+                                                 sizeof(int32_t));
+  instance->node_translations = owl_model_storage_push(s, num_nodes,
+                                                       sizeof(owl_v3));
+  instance->node_rotations = owl_model_storage_push(s, num_nodes,
+                                                    sizeof(owl_v4));
+  instance->node_scales = owl_model_storage_push(s, num_nodes,
+                                                 sizeof(owl_v3));
+  instance->local_matrices = owl_model_storage_push(s, num_nodes,
+                                                    sizeof(owl_m4));
+  instance->world_matrices = owl_model_storage_push(s, num_nodes,
+                                                    sizeof(owl_m4));
+  instance->weights = owl_model_storage_push(s, m->num_weights,
+                                             sizeof(float));
+  instance->animation_times = owl_model_storage_push(s, m->num_animations,
+                                                     sizeof(float));
+  instance->keyframes = owl_model_storage_push(s, m->num_channels,
+                                               sizeof(int32_t));
+  instance->lod_source.translations = owl_model_storage_push(s, num_nodes,
+                                                             sizeof(owl_v3));
+  instance->lod_source.rotations = owl_model_storage_push(s, num_nodes,
+                                                          sizeof(owl_v4));
+  instance->lod_source.scales = owl_model_storage_push(s, num_nodes,
+                                                       sizeof(owl_v3));
+  instance->lod_source.weights = owl_model_storage_push(s, m->num_weights,
+                                                        sizeof(float));
+  instance->lod_target.translations = owl_model_storage_push(s, num_nodes,
+                                                             sizeof(owl_v3));
+  instance->lod_target.rotations = owl_model_storage_push(s, num_nodes,
+                                                          sizeof(owl_v4));
+  instance->lod_target.scales = owl_model_storage_push(s, num_nodes,
+                                                       sizeof(owl_v3));
+  instance->lod_target.weights = owl_model_storage_push(s, m->num_weights,
+                                                        sizeof(float));
+}
+
+/* what the materials sample an image as */
+enum owl_model_image_usage {
+  OWL_MODEL_IMAGE_USAGE_COLOR = 1 << 0,
+  OWL_MODEL_IMAGE_USAGE_NORMAL = 1 << 1,
+  OWL_MODEL_IMAGE_USAGE_OCCLUSION = 1 << 2,
+  OWL_MODEL_IMAGE_USAGE_METALLIC_ROUGHNESS = 1 << 3
+};
+
+static int32_t owl_model_view_usage(struct cgltf_texture_view const *view,
+                                    struct cgltf_image const *image,
+                                    int32_t usage) {
+  if (view->texture && image == view->texture->image)
+    return usage;
+
+  return 0;
+}
+
+static int32_t owl_model_image_usage(struct cgltf_data const *gltf,
+                                     int32_t i) {
+  int32_t j;
+  int32_t usage = 0;
+  struct cgltf_image const *image = &gltf->images[i];
+
+  for (j = 0; j < (int32_t)gltf->materials_count; ++j) {
+    struct cgltf_material const *material = &gltf->materials[j];
+    struct cgltf_pbr_metallic_roughness const *metallic =
+        &material->pbr_metallic_roughness;
+    struct cgltf_pbr_specular_glossiness const *specular =
+        &material->pbr_specular_glossiness;
+
+    usage |= owl_model_view_usage(&metallic->base_color_texture, image,
+                                  OWL_MODEL_IMAGE_USAGE_COLOR);
+    usage |= owl_model_view_usage(&metallic->metallic_roughness_texture,
+                                  image,
+                                  OWL_MODEL_IMAGE_USAGE_METALLIC_ROUGHNESS);
+    usage |= owl_model_view_usage(&specular->diffuse_texture, image,
+                                  OWL_MODEL_IMAGE_USAGE_COLOR);
+    usage |= owl_model_view_usage(&specular->specular_glossiness_texture,
+                                  image, OWL_MODEL_IMAGE_USAGE_COLOR);
+    usage |= owl_model_view_usage(&material->normal_texture, image,
+                                  OWL_MODEL_IMAGE_USAGE_NORMAL);
+    usage |= owl_model_view_usage(&material->occlusion_texture, image,
+                                  OWL_MODEL_IMAGE_USAGE_OCCLUSION);
+    usage |= owl_model_view_usage(&material->emissive_texture, image,
+                                  OWL_MODEL_IMAGE_USAGE_COLOR);
+  }
+
+  return usage;
+}
+
+struct owl_model_image_format {
+  enum owl_pixel_format format;
+  enum owl_pixel_format compressed_format;
+  enum owl_texture_swizzle swizzle;
+  /* the channels of the decoded rgba8 pixels the format keeps */
+  int32_t first_channel;
+  int32_t num_channels;
+};
+
+/* only the channels owl_pbr.frag reads of the image, in the color space it
+ * expects them. the normals are reconstructed from x and y, occlusion is
+ * red and metallic roughness green and blue. an image used in more than one
+ * way keeps every channel */
+static void owl_model_choose_image_format(struct cgltf_data const *gltf,
+                                          int32_t i,
+                                          struct owl_model_image_format *f) {
+  f->swizzle = OWL_TEXTURE_SWIZZLE_IDENTITY;
+  f->first_channel = 0;
+
+  switch (owl_model_image_usage(gltf, i)) {
+  case OWL_MODEL_IMAGE_USAGE_NORMAL:
+    f->format = OWL_RG8_UNORM;
+    f->compressed_format = OWL_BC5_UNORM;
+    f->num_channels = 2;
+    break;
+
+  case OWL_MODEL_IMAGE_USAGE_OCCLUSION:
+    f->format = OWL_R8_UNORM;
+    f->compressed_format = OWL_BC4_UNORM;
+    f->num_channels = 1;
+    break;
+
+  case OWL_MODEL_IMAGE_USAGE_METALLIC_ROUGHNESS:
+    f->format = OWL_RG8_UNORM;
+    f->compressed_format = OWL_BC5_UNORM;
+    f->swizzle = OWL_TEXTURE_SWIZZLE_RG_AS_GB;
+    f->first_channel = 1;
+    f->num_channels = 2;
+    break;
+
+  case OWL_MODEL_IMAGE_USAGE_NORMAL | OWL_MODEL_IMAGE_USAGE_OCCLUSION:
+  case OWL_MODEL_IMAGE_USAGE_NORMAL |
+      OWL_MODEL_IMAGE_USAGE_METALLIC_ROUGHNESS:
+  case OWL_MODEL_IMAGE_USAGE_OCCLUSION |
+      OWL_MODEL_IMAGE_USAGE_METALLIC_ROUGHNESS:
+  case OWL_MODEL_IMAGE_USAGE_NORMAL | OWL_MODEL_IMAGE_USAGE_OCCLUSION |
+      OWL_MODEL_IMAGE_USAGE_METALLIC_ROUGHNESS:
+    f->format = OWL_RGBA8_UNORM;
+    f->compressed_format = OWL_BC1_RGBA_UNORM;
+    f->num_channels = 4;
+    break;
+
+  /* color, unused or color and something else */
+  default:
+    f->format = OWL_RGBA8_SRGB;
+    f->compressed_format = OWL_BC1_RGBA_SRGB;
+    f->num_channels = 4;
+    break;
+  }
+}
+
+struct owl_model_decoded_image {
+  struct owl_texture_desc desc;
+  /* the pixels of desc, from stb unless the image was compressed */
+  int32_t compressed;
+  uint8_t *data;
+};
+
+struct owl_model_image_job {
+  struct owl_renderer *r;
+  struct cgltf_data const *gltf;
+  struct owl_model *m;
+  struct owl_model_decoded_image *images;
+  int32_t compress;
+  int ret;
+
+  /* only for owl_model_load_async, the images in the order they were
+   * decoded */
+  struct owl_thread_task *task;
+  int32_t num_decoded;
+  int32_t *order;
+};
+
+/* runs on any thread of the pool */
+static void owl_model_decode_image(void *data, int32_t i) {
+  int width;
+  int height;
+  struct owl_model_uri uri;
+  struct owl_model_image_format format;
+  struct owl_model_image_job *job = data;
+  struct owl_model_decoded_image *image = &job->images[i];
+
+  owl_model_get_real_uri(job->m, job->gltf->images[i].uri, &uri);
+
+  OWL_DEBUG_LOG("  trying %s\n", uri.path);
+
+  owl_model_choose_image_format(job->gltf, i, &format);
+
+  image->compressed = job->compress;
+
+  if (image->compressed) {
+    image->data = NULL;
+    if (!owl_texture_load_compressed(uri.path, format.compressed_format,
+                                     format.swizzle, &image->desc))
+      image->data = (uint8_t *)image->desc.pixels;
+
+    return;
+  }
+
+  image->data = owl_texture_decode_file(uri.path, &width, &height);
+  if (image->data)
+    owl_texture_pack_channels((uint64_t)width * height, format.first_channel,
+                              format.num_channels, image->data);
+
+  image->desc.source = OWL_TEXTURE_SOURCE_DATA;
+  image->desc.type = OWL_TEXTURE_TYPE_2D;
+  image->desc.path = NULL;
+  image->desc.pixels = image->data;
+  image->desc.width = (uint32_t)width;
+  image->desc.height = (uint32_t)height;
+  image->desc.format = format.format;
+  image->desc.swizzle = format.swizzle;
+  image->desc.mipmaps = 0;
+}
+
+static void
+owl_model_free_decoded_image(struct owl_model_decoded_image *image) {
+  if (!image->data)
+    return;
+
+  if (image->compressed)
+    OWL_FREE(image->data);
+  else
+    stbi_image_free(image->data);
+
+  image->data = NULL;
+}
+
+/* runs on the loading thread as soon as the image is decoded */
+static void owl_model_upload_image(void *data, int32_t i) {
+  int ret;
+  struct owl_model_image_job *job = data;
+  struct owl_model_decoded_image *image = &job->images[i];
+
+  if (!image->data) {
+    job->ret = OWL_ERROR_FATAL;
+    return;
+  }
+
+  ret = owl_texture_init(job->r, &image->desc, &job->m->images[i].texture);
+  if (ret)
+    job->ret = ret;
+
+  owl_model_free_decoded_image(image);
+}
+
 /* TODO(samuel): gltf specifies the sampler requiremets for each image, right
  * now there is only one thats shared by all textures, add the posibility to
  * use a custom one on owl_texture */
 static int owl_model_load_images(struct owl_renderer *r,
                                  struct cgltf_data *gltf, struct owl_model *m) {
-  int32_t i;
+  struct owl_thread_pool pool;
+  struct owl_model_image_job job;
   int ret = OWL_OK;
 
-  OWL_ASSERT(gltf->images_count < OWL_ARRAY_SIZE(m->images));
+  OWL_DEBUG_LOG("loading images\n");
 
-  m->num_images = (int32_t)gltf->images_count;
+  if (!m->num_images)
+    return ret;
 
-  OWL_DEBUG_LOG("loading images\n");
+  job.r = r;
+  job.gltf = gltf;
+  job.m = m;
+  job.compress = r->compress_textures && r->has_texture_compression_bc;
+  job.ret = OWL_OK;
+  job.images = OWL_MALLOC(m->num_images * sizeof(*job.images));
+  if (!job.images)
+    return OWL_ERROR_NO_MEMORY;
 
-  for (i = 0; i < m->num_images; ++i) {
-    struct owl_model_uri uri;
-    struct owl_texture_desc desc;
-    struct owl_model_image *out_image = &m->images[i];
-    struct cgltf_image *in_image = &gltf->images[i];
+  /* the images are decoded on the pool and uploaded one by one as they are
+   * done, the upload buffer only holds one of them at a time */
+  ret = owl_thread_pool_init(&pool, OWL_MIN(r->num_load_threads,
+                                            m->num_images));
+  if (ret)
+    goto out_free_images;
 
-    ret = owl_model_get_real_uri(m, in_image->uri, &uri);
-    OWL_ASSERT(!ret);
+  ret = owl_thread_pool_pipeline(&pool, m->num_images, owl_model_decode_image,
+                                 owl_model_upload_image, &job);
 
-    OWL_DEBUG_LOG("  trying %s\n", uri.path);
+  owl_thread_pool_deinit(&pool);
 
-    desc.source = OWL_TEXTURE_SOURCE_FILE;
-    desc.type = OWL_TEXTURE_TYPE_2D;
-    desc.path = uri.path;
-    desc.width = 0;
-    desc.height = 0;
-    desc.format = OWL_RGBA8_SRGB;
+  if (!ret)
+    ret = job.ret;
 
-    ret = owl_texture_init(r, &desc, &out_image->texture);
-    OWL_ASSERT(!ret);
-  }
+  OWL_ASSERT(!ret);
+
+out_free_images:
+  OWL_FREE(job.images);
 
   return ret;
 }
@@ -100,8 +522,6 @@ static int owl_model_load_textures(struct owl_renderer *r,
 
   OWL_UNUSED(r);
 
-  OWL_ASSERT(gltf->textures_count < OWL_ARRAY_SIZE(m->textures));
-
   m->num_textures = (int32_t)gltf->textures_count;
 
   for (i = 0; i < m->num_textures; ++i) {
@@ -126,8 +546,6 @@ static int owl_model_load_materials(struct owl_renderer *r,
 
   OWL_UNUSED(r);
 
-  OWL_ASSERT(gltf->materials_count < OWL_ARRAY_SIZE(m->materials));
-
   /* TODO(samuel): fix custom static assert */
   OWL_ASSERT(OWL_ALPHA_MODE_OPAQUE == cgltf_alpha_mode_opaque &&
              "must match with cgltf enums");
@@ -293,6 +711,19 @@ static int owl_model_load_materials(struct owl_renderer *r,
       out_material->specular_factor[2] = specular->specular_factor[2];
       out_material->specular_factor[3] = 1.0F;
     }
+  }
+
+  return ret;
+}
+
+/* the maps of every material, after the images are uploaded */
+static int owl_model_init_material_sets(struct owl_renderer *r,
+                                        struct owl_model *m) {
+  int32_t i;
+  int ret = OWL_OK;
+
+  for (i = 0; i < m->num_materials; ++i) {
+    struct owl_model_material *out_material = &m->materials[i];
 
     {
       VkDescriptorSetAllocateInfo info;
@@ -450,21 +881,159 @@ owl_find_gltf_attribute(struct cgltf_primitive const *p, char const *name) {
   return NULL;
 }
 
+static struct cgltf_attribute const *
+owl_find_gltf_target_attribute(struct cgltf_morph_target const *t,
+                               char const *name) {
+  uint32_t i;
+
+  for (i = 0; i < t->attributes_count; ++i) {
+    struct cgltf_attribute const *current = &t->attributes[i];
+
+    if (!OWL_STRNCMP(current->name, name, 256))
+      return current;
+  }
+
+  return NULL;
+}
+
+/* rounds to the nearest half, ties to even, the carry of a rounded up
+ * mantissa moves into the exponent */
+static uint16_t owl_model_pack_half(float value) {
+  uint32_t bits;
+  uint32_t sign;
+  int32_t exponent;
+  uint32_t mantissa;
+
+  OWL_MEMCPY(&bits, &value, sizeof(bits));
+
+  sign = (bits >> 16) & 0x8000;
+  exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+  mantissa = bits & 0x7fffff;
+
+  /* nan or infinity */
+  if (0xff == ((bits >> 23) & 0xff))
+    return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+  if (31 <= exponent)
+    return (uint16_t)(sign | 0x7c00);
+
+  if (-10 > exponent)
+    return (uint16_t)sign;
+
+  /* subnormal */
+  if (0 >= exponent) {
+    uint32_t const shift = (uint32_t)(14 - exponent);
+
+    mantissa |= 0x800000;
+    mantissa += (1U << (shift - 1)) - 1 + ((mantissa >> shift) & 1);
+    return (uint16_t)(sign | (mantissa >> shift));
+  }
+
+  mantissa += 0x0fff + ((mantissa >> 13) & 1);
+  return (uint16_t)(sign + ((uint32_t)exponent << 10) + (mantissa >> 13));
+}
+
+static int16_t owl_model_pack_snorm16(float value) {
+  value = OWL_CLAMP(value, -1.0F, 1.0F) * 32767.0F;
+  return (int16_t)(0.0F <= value ? value + 0.5F : value - 0.5F);
+}
+
+static uint8_t owl_model_pack_unorm8(float value) {
+  return (uint8_t)(OWL_CLAMP(value, 0.0F, 1.0F) * 255.0F + 0.5F);
+}
+
+/* folds the lower hemisphere over the upper one, a unit vector becomes two
+ * snorm16 */
+static void owl_model_pack_octahedral(float const *normal, int16_t *out) {
+  float x;
+  float y;
+  float const ax = OWL_MAX(normal[0], -normal[0]);
+  float const ay = OWL_MAX(normal[1], -normal[1]);
+  float const az = OWL_MAX(normal[2], -normal[2]);
+  float const length = ax + ay + az;
+
+  if (0.0F >= length) {
+    out[0] = 0;
+    out[1] = 0;
+    return;
+  }
+
+  x = normal[0] / length;
+  y = normal[1] / length;
+
+  if (0.0F > normal[2]) {
+    float const fx = x;
+    float const fy = y;
+
+    x = (1.0F - OWL_MAX(fy, -fy)) * (0.0F <= fx ? 1.0F : -1.0F);
+    y = (1.0F - OWL_MAX(fx, -fx)) * (0.0F <= fy ? 1.0F : -1.0F);
+  }
+
+  out[0] = owl_model_pack_snorm16(x);
+  out[1] = owl_model_pack_snorm16(y);
+}
+
+/* the rounding error goes to the largest weight, they still add up to one */
+static void owl_model_pack_weights(float const *weights, uint8_t *out) {
+  int32_t i;
+  int32_t sum = 0;
+  int32_t largest = 0;
+
+  for (i = 0; i < 4; ++i) {
+    out[i] = owl_model_pack_unorm8(weights[i]);
+    sum += out[i];
+
+    if (out[largest] < out[i])
+      largest = i;
+  }
+
+  if (sum)
+    out[largest] = (uint8_t)OWL_CLAMP(out[largest] + 255 - sum, 0, 255);
+}
+
 struct owl_model_all_primitives {
   int32_t num_vertices;
-  struct owl_model_vertex *vertices;
+  /* laid out like the vertex buffer, see owl_model_vertex_attributes. when
+   * loading it is the upload buffer of upload and the gltf is converted
+   * straight into it */
+  void *vertices;
+  owl_v3 *positions;
+  struct owl_model_vertex_attributes *attributes;
+  struct owl_renderer *upload;
+  struct owl_renderer_upload_allocation allocation;
 
   int32_t num_indices;
   uint32_t *indices;
+
+  int32_t num_targets;
+  struct owl_model_morph_target *targets;
 };
 
+/* what is done to the geometry on top of converting it, owl_model_init
+ * follows the renderer and owl_model_cook does everything */
+struct owl_model_import_options {
+  int32_t optimize_meshes;
+  int32_t generate_lods;
+  int32_t build_meshlets;
+};
+
+static uint64_t owl_model_vertex_buffer_size(int32_t num_vertices) {
+  return num_vertices * (sizeof(owl_v3) +
+                         sizeof(struct owl_model_vertex_attributes));
+}
+
+/* r is the renderer the vertices are uploaded with, NULL keeps them in
+ * regular memory */
 static int owl_model_init_all_primitives(struct owl_model_all_primitives *p,
-                                         struct cgltf_data const *gltf) {
+                                         struct cgltf_data const *gltf,
+                                         struct owl_renderer *r) {
   uint32_t i;
+  uint64_t size;
   int ret = OWL_OK;
 
   p->num_vertices = 0;
   p->num_indices = 0;
+  p->num_targets = 0;
 
   for (i = 0; i < gltf->nodes_count; ++i) {
     uint32_t j;
@@ -482,12 +1051,22 @@ static int owl_model_init_all_primitives(struct owl_model_all_primitives *p,
 
       p->num_vertices += attr->data->count;
       p->num_indices += primitive->indices->count;
+      p->num_targets += attr->data->count * primitive->targets_count;
     }
   }
 
-  p->vertices = OWL_MALLOC(p->num_vertices * sizeof(*p->vertices));
+  size = OWL_MAX(1, owl_model_vertex_buffer_size(p->num_vertices));
+
+  p->upload = r;
+  if (r)
+    p->vertices = owl_renderer_upload_allocate(r, size, &p->allocation);
+  else
+    p->vertices = OWL_MALLOC(size);
   OWL_ASSERT(p->vertices);
 
+  p->positions = p->vertices;
+  p->attributes = (void *)&p->positions[p->num_vertices];
+
   if (p->num_indices) {
     p->indices = OWL_MALLOC(p->num_indices * sizeof(*p->indices));
     OWL_ASSERT(p->indices);
@@ -495,13 +1074,29 @@ static int owl_model_init_all_primitives(struct owl_model_all_primitives *p,
     p->indices = NULL;
   }
 
+  if (p->num_targets) {
+    p->targets = OWL_MALLOC(p->num_targets * sizeof(*p->targets));
+    OWL_ASSERT(p->targets);
+  } else {
+    p->targets = NULL;
+  }
+
   return ret;
 }
 
 static void
 owl_model_deinit_all_primitives(struct owl_model_all_primitives *p) {
+  OWL_FREE(p->targets);
   OWL_FREE(p->indices);
-  OWL_FREE(p->vertices);
+
+  if (!p->upload)
+    OWL_FREE(p->vertices);
+  else if (p->vertices)
+    owl_renderer_upload_free(p->upload, p->vertices);
+
+  p->targets = NULL;
+  p->indices = NULL;
+  p->vertices = NULL;
 }
 
 static int32_t owl_model_gltf_stride(cgltf_type type) {
@@ -674,14 +1269,12 @@ static int owl_model_load_nodes(struct owl_renderer *r,
   int32_t i;
   int32_t num_vertices = 0;
   int32_t num_indices = 0;
+  int32_t num_targets = 0;
   int ret = OWL_OK;
-  VkDevice const device = r->device;
 
   OWL_UNUSED(r);
 
-  OWL_ASSERT(gltf->nodes_count < OWL_ARRAY_SIZE(m->nodes));
-  OWL_ASSERT(gltf->meshes_count < OWL_ARRAY_SIZE(m->meshes));
-
+  m->num_weights = 0;
   m->num_primitives = 0;
   m->num_meshes = 0;
   m->num_nodes = (int32_t)gltf->nodes_count;
@@ -692,68 +1285,71 @@ static int owl_model_load_nodes(struct owl_renderer *r,
     struct owl_model_node *out_node;
 
     in_node = &gltf->nodes[i];
-    out_node = &m->nodes[(int32_t)(in_node - gltf->nodes)];
+    out_node = &m->nodes[i];
 
     if (in_node->parent)
-      out_node->parent = (int32_t)(in_node->parent - gltf->nodes);
+      m->node_parents[i] = (int32_t)(in_node->parent - gltf->nodes);
     else
-      out_node->parent = -1;
-
-    OWL_ASSERT(in_node->children_count < OWL_ARRAY_SIZE(out_node->children));
+      m->node_parents[i] = -1;
 
     out_node->num_children = (int32_t)in_node->children_count;
     for (j = 0; j < out_node->num_children; ++j)
       out_node->children[j] = (int32_t)(in_node->children[j] - gltf->nodes);
 
-    if (in_node->name) {
-      uint32_t max_length = OWL_ARRAY_SIZE(out_node->name);
-      OWL_STRNCPY(out_node->name, in_node->name, max_length);
-    } else {
-      uint32_t max_length = OWL_ARRAY_SIZE(out_node->name);
-      OWL_STRNCPY(out_node->name, "NO NAME", max_length);
-    }
+    owl_model_copy_name(in_node->name, out_node->name);
+
+    OWL_V3_ZERO(out_node->bvh.min);
+    OWL_V3_ZERO(out_node->bvh.max);
+    out_node->bvh.valid = 0;
+    OWL_V3_ZERO(out_node->aabb.min);
+    OWL_V3_ZERO(out_node->aabb.max);
+    out_node->aabb.valid = 0;
 
     if (in_node->has_translation) {
-      out_node->translation[0] = in_node->translation[0];
-      out_node->translation[1] = in_node->translation[1];
-      out_node->translation[2] = in_node->translation[2];
+      m->node_translations[i][0] = in_node->translation[0];
+      m->node_translations[i][1] = in_node->translation[1];
+      m->node_translations[i][2] = in_node->translation[2];
     } else {
-      out_node->translation[0] = 0.0F;
-      out_node->translation[1] = 0.0F;
-      out_node->translation[2] = 0.0F;
+      m->node_translations[i][0] = 0.0F;
+      m->node_translations[i][1] = 0.0F;
+      m->node_translations[i][2] = 0.0F;
     }
 
     if (in_node->has_rotation) {
-      out_node->rotation[0] = in_node->rotation[0];
-      out_node->rotation[1] = in_node->rotation[1];
-      out_node->rotation[2] = in_node->rotation[2];
-      out_node->rotation[3] = in_node->rotation[3];
+      m->node_rotations[i][0] = in_node->rotation[0];
+      m->node_rotations[i][1] = in_node->rotation[1];
+      m->node_rotations[i][2] = in_node->rotation[2];
+      m->node_rotations[i][3] = in_node->rotation[3];
     } else {
-      out_node->rotation[0] = 0.0F;
-      out_node->rotation[1] = 0.0F;
-      out_node->rotation[2] = 0.0F;
-      out_node->rotation[3] = 0.0F;
+      m->node_rotations[i][0] = 0.0F;
+      m->node_rotations[i][1] = 0.0F;
+      m->node_rotations[i][2] = 0.0F;
+      m->node_rotations[i][3] = 0.0F;
     }
 
     if (in_node->has_scale) {
-      out_node->scale[0] = in_node->scale[0];
-      out_node->scale[1] = in_node->scale[1];
-      out_node->scale[2] = in_node->scale[2];
+      m->node_scales[i][0] = in_node->scale[0];
+      m->node_scales[i][1] = in_node->scale[1];
+      m->node_scales[i][2] = in_node->scale[2];
     } else {
-      out_node->scale[0] = 1.0F;
-      out_node->scale[1] = 1.0F;
-      out_node->scale[2] = 1.0F;
+      m->node_scales[i][0] = 1.0F;
+      m->node_scales[i][1] = 1.0F;
+      m->node_scales[i][2] = 1.0F;
     }
 
     if (in_node->has_matrix)
-      OWL_M4_COPY_V16(in_node->matrix, out_node->matrix);
+      OWL_M4_COPY_V16(in_node->matrix, m->node_matrices[i]);
     else
-      OWL_M4_IDENTITY(out_node->matrix);
+      OWL_M4_IDENTITY(m->node_matrices[i]);
 
     if (in_node->skin)
-      out_node->skin = (int32_t)(in_node->skin - gltf->skins);
+      m->node_skins[i] = (int32_t)(in_node->skin - gltf->skins);
     else
-      out_node->skin = -1;
+      m->node_skins[i] = -1;
+
+    m->node_joints_offsets[i] = -1;
+    m->node_weights_offsets[i] = m->num_weights;
+    m->node_num_weights[i] = 0;
 
     /* FIXME(samuel): not sure if each node has it's own mesh, however as I
      * allocate resources per mesh, it's easier to give each one it's own
@@ -765,16 +1361,32 @@ static int owl_model_load_nodes(struct owl_renderer *r,
       in_mesh = in_node->mesh;
 
 #if 0
-			out_node->mesh = (int32_t)(in_mesh - gltf->meshes);
+			m->node_meshes[i] = (int32_t)(in_mesh - gltf->meshes);
 #else
-      out_node->mesh = m->num_meshes++;
+      m->node_meshes[i] = m->num_meshes++;
 #endif
-      out_mesh = &m->meshes[out_node->mesh];
-
-      OWL_ASSERT(in_mesh->primitives_count <
-                 OWL_ARRAY_SIZE(out_mesh->primitives));
+      out_mesh = &m->meshes[m->node_meshes[i]];
 
+      out_mesh->first_primitive = m->num_primitives;
       out_mesh->num_primitives = (int32_t)in_mesh->primitives_count;
+
+      /* every primitive of a mesh has the same number of targets */
+      if (in_mesh->primitives_count) {
+        float *weights = &m->weights[m->num_weights];
+        int32_t const count = (int32_t)in_mesh->primitives[0].targets_count;
+
+        m->node_num_weights[i] = count;
+        m->num_weights += count;
+
+        for (j = 0; j < count; ++j) {
+          if ((int32_t)in_node->weights_count == count)
+            weights[j] = in_node->weights[j];
+          else if ((int32_t)in_mesh->weights_count == count)
+            weights[j] = in_mesh->weights[j];
+          else
+            weights[j] = 0.0F;
+        }
+      }
       for (j = 0; j < out_mesh->num_primitives; ++j) {
         int32_t k;
         int32_t has_skin;
@@ -784,6 +1396,7 @@ static int owl_model_load_nodes(struct owl_renderer *r,
         int32_t position_stride = 0;
         float const *position = NULL;
 
+        int32_t has_bbox = 0;
         owl_v3 min_pos;
         owl_v3 max_pos;
 
@@ -811,7 +1424,6 @@ static int owl_model_load_nodes(struct owl_renderer *r,
         struct cgltf_primitive const *in_primitive = NULL;
 
         in_primitive = &in_mesh->primitives[j];
-        out_mesh->primitives[j] = m->num_primitives;
         out_primitive = &m->primitives[m->num_primitives++];
 
         attr = owl_find_gltf_attribute(in_primitive, "POSITION");
@@ -830,6 +1442,8 @@ static int owl_model_load_nodes(struct owl_renderer *r,
             max_pos[1] = attr->data->max[1];
             max_pos[2] = attr->data->max[2];
           }
+
+          has_bbox = attr->data->has_min && attr->data->has_max;
         }
 
         attr = owl_find_gltf_attribute(in_primitive, "NORMAL");
@@ -860,7 +1474,7 @@ static int owl_model_load_nodes(struct owl_renderer *r,
             joints0_component_is_u8 = 0;
         }
 
-        attr = owl_find_gltf_attribute(in_primitive, "weights_0");
+        attr = owl_find_gltf_attribute(in_primitive, "WEIGHTS_0");
         if (attr) {
           weights0 = owl_resolve_gltf_accessor(attr->data);
           weights0_stride = owl_model_gltf_stride(attr->data->type);
@@ -875,94 +1489,94 @@ static int owl_model_load_nodes(struct owl_renderer *r,
         has_skin = joints0 && weights0;
 
         for (k = 0; k < num_local_vertices; ++k) {
-          struct owl_model_vertex *vertex = &p->vertices[num_vertices + k];
+          owl_v4 value;
+          float *out_position = p->positions[num_vertices + k];
+          struct owl_model_vertex_attributes *vertex;
+
+          vertex = &p->attributes[num_vertices + k];
 
           OWL_ASSERT(position);
           OWL_ASSERT(3 <= position_stride);
-          vertex->position[0] = (&position[k * position_stride])[0];
-          vertex->position[1] = (&position[k * position_stride])[1];
-          vertex->position[2] = (&position[k * position_stride])[2];
+          out_position[0] = (&position[k * position_stride])[0];
+          out_position[1] = (&position[k * position_stride])[1];
+          out_position[2] = (&position[k * position_stride])[2];
 
           if (normal) {
             OWL_ASSERT(3 <= normal_stride);
-            vertex->normal[0] = (&normal[k * normal_stride])[0];
-            vertex->normal[1] = (&normal[k * normal_stride])[1];
-            vertex->normal[2] = (&normal[k * normal_stride])[2];
+            owl_model_pack_octahedral(&normal[k * normal_stride],
+                                      vertex->normal);
           } else {
-            vertex->normal[0] = 0.0F;
-            vertex->normal[1] = 0.0F;
-            vertex->normal[2] = 0.0F;
+            vertex->normal[0] = 0;
+            vertex->normal[1] = 0;
           }
 
           if (uv0) {
             OWL_ASSERT(2 <= uv0_stride);
-            vertex->uv0[0] = (&uv0[k * uv0_stride])[0];
-            vertex->uv0[1] = (&uv0[k * uv0_stride])[1];
-#if 0
-            OWL_DEBUG_LOG("  uv0: " OWL_V2_FORMAT "\n", OWL_V2_FORMAT_ARGS(vertex->uv0));
-            OWL_ASSERT(vertex->uv0[0] < 1.0F && vertex->uv0[0] > 0.0F);
-            OWL_ASSERT(vertex->uv0[1] < 1.0F && vertex->uv0[1] > 0.0F);
-#endif
+            vertex->uv0[0] = owl_model_pack_half((&uv0[k * uv0_stride])[0]);
+            vertex->uv0[1] = owl_model_pack_half((&uv0[k * uv0_stride])[1]);
           } else {
-            vertex->uv0[0] = 0.0F;
-            vertex->uv0[1] = 0.0F;
+            vertex->uv0[0] = 0;
+            vertex->uv0[1] = 0;
           }
 
           if (uv1) {
             OWL_ASSERT(2 <= uv1_stride);
-            vertex->uv1[0] = (&uv1[k * uv1_stride])[0];
-            vertex->uv1[1] = (&uv1[k * uv1_stride])[1];
+            vertex->uv1[0] = owl_model_pack_half((&uv1[k * uv1_stride])[0]);
+            vertex->uv1[1] = owl_model_pack_half((&uv1[k * uv1_stride])[1]);
           } else {
-            vertex->uv1[0] = 0.0F;
-            vertex->uv1[1] = 0.0F;
+            vertex->uv1[0] = 0;
+            vertex->uv1[1] = 0;
           }
 
           if (has_skin) {
+            int32_t l;
+
             OWL_ASSERT(4 == joints0_stride);
-            if (joints0_component_is_u8) {
-              vertex->joints0[0] = (&joints0[k * joints0_stride])[0];
-              vertex->joints0[1] = (&joints0[k * joints0_stride])[1];
-              vertex->joints0[2] = (&joints0[k * joints0_stride])[2];
-              vertex->joints0[3] = (&joints0[k * joints0_stride])[3];
-            } else {
-              uint16_t *joints0_u16 = (uint16_t *)joints0;
-              vertex->joints0[0] = (&joints0_u16[k * joints0_stride])[0];
-              vertex->joints0[1] = (&joints0_u16[k * joints0_stride])[1];
-              vertex->joints0[2] = (&joints0_u16[k * joints0_stride])[2];
-              vertex->joints0[3] = (&joints0_u16[k * joints0_stride])[3];
+            for (l = 0; l < 4; ++l) {
+              uint32_t joint;
+
+              if (joints0_component_is_u8)
+                joint = (&joints0[k * joints0_stride])[l];
+              else
+                joint = (&((uint16_t const *)joints0)[k * joints0_stride])[l];
+
+              /* joints0 is 8 bit, a vertex can only use the first 256
+               * joints of its skin */
+              if (256 <= joint) {
+                OWL_DEBUG_LOG("%s uses more than 256 joints in a skin\n",
+                              m->path);
+                return OWL_ERROR_INVALID_VALUE;
+              }
+
+              vertex->joints0[l] = (uint8_t)joint;
             }
-          } else {
-            vertex->joints0[0] = 0.0F;
-            vertex->joints0[1] = 0.0F;
-            vertex->joints0[2] = 0.0F;
-            vertex->joints0[3] = 0.0F;
-          }
 
-          if (has_skin) {
             OWL_ASSERT(4 == weights0_stride);
-            vertex->weights0[0] = (&weights0[k * weights0_stride])[0];
-            vertex->weights0[1] = (&weights0[k * weights0_stride])[1];
-            vertex->weights0[2] = (&weights0[k * weights0_stride])[2];
-            vertex->weights0[3] = (&weights0[k * weights0_stride])[3];
+            owl_model_pack_weights(&weights0[k * weights0_stride],
+                                   vertex->weights0);
           } else {
-            vertex->weights0[0] = 1.0F;
-            vertex->weights0[1] = 0.0F;
-            vertex->weights0[2] = 0.0F;
-            vertex->weights0[3] = 0.0F;
+            vertex->joints0[0] = 0;
+            vertex->joints0[1] = 0;
+            vertex->joints0[2] = 0;
+            vertex->joints0[3] = 0;
+
+            vertex->weights0[0] = 255;
+            vertex->weights0[1] = 0;
+            vertex->weights0[2] = 0;
+            vertex->weights0[3] = 0;
           }
 
           if (color0) {
             OWL_ASSERT(4 == color0_stride);
-            vertex->color0[0] = (&color0[k * color0_stride])[0];
-            vertex->color0[1] = (&color0[k * color0_stride])[1];
-            vertex->color0[2] = (&color0[k * color0_stride])[2];
-            vertex->color0[3] = (&color0[k * color0_stride])[3];
+            OWL_V4_COPY(&color0[k * color0_stride], value);
           } else {
-            vertex->color0[0] = 1.0F;
-            vertex->color0[1] = 1.0F;
-            vertex->color0[2] = 1.0F;
-            vertex->color0[3] = 1.0F;
+            OWL_V4_SET(value, 1.0F, 1.0F, 1.0F, 1.0F);
           }
+
+          vertex->color0[0] = owl_model_pack_unorm8(value[0]);
+          vertex->color0[1] = owl_model_pack_unorm8(value[1]);
+          vertex->color0[2] = owl_model_pack_unorm8(value[2]);
+          vertex->color0[3] = owl_model_pack_unorm8(value[3]);
         }
 
         if (in_primitive->indices) {
@@ -973,23 +1587,25 @@ static int owl_model_load_nodes(struct owl_renderer *r,
           OWL_ASSERT(num_indices + num_local_indices <= p->num_indices);
 
           switch (accessor->component_type) {
+          /* relative to the first vertex of the primitive, the draws add it
+           * back through the vertex offset */
           case cgltf_component_type_r_32u: {
             int32_t l;
             uint32_t const *data = owl_resolve_gltf_accessor(accessor);
             for (l = 0; l < num_local_indices; ++l)
-              p->indices[num_indices + l] = data[l] + num_vertices;
+              p->indices[num_indices + l] = data[l];
           } break;
           case cgltf_component_type_r_16u: {
             int32_t l;
             uint16_t const *data = owl_resolve_gltf_accessor(accessor);
             for (l = 0; l < num_local_indices; ++l)
-              p->indices[num_indices + l] = data[l] + num_vertices;
+              p->indices[num_indices + l] = data[l];
           } break;
           case cgltf_component_type_r_8u: {
             int32_t l;
             uint8_t const *data = owl_resolve_gltf_accessor(accessor);
             for (l = 0; l < num_local_indices; ++l)
-              p->indices[num_indices + l] = data[l] + num_vertices;
+              p->indices[num_indices + l] = data[l];
           } break;
           case cgltf_component_type_invalid:
           case cgltf_component_type_r_8:
@@ -999,215 +1615,498 @@ static int owl_model_load_nodes(struct owl_renderer *r,
           }
         }
 
-        {
-          int32_t material;
-
-          out_primitive->first = num_indices;
-          out_primitive->num_indices = num_local_indices;
-          out_primitive->num_vertices = num_local_vertices;
-          out_primitive->has_indices = !!num_local_indices;
-          out_primitive->bbox.valid = 0;
+        out_primitive->num_targets = (int32_t)in_primitive->targets_count;
+        out_primitive->morph_offset =
+            num_targets - num_vertices * out_primitive->num_targets;
 
-          out_primitive->bbox.min[0] = min_pos[0];
-          out_primitive->bbox.min[1] = min_pos[1];
-          out_primitive->bbox.min[2] = min_pos[2];
+        for (k = 0; k < out_primitive->num_targets; ++k) {
+          int32_t l;
+          struct cgltf_attribute const *position_deltas;
+          struct cgltf_attribute const *normal_deltas;
+          struct cgltf_morph_target const *target = &in_primitive->targets[k];
 
-          out_primitive->bbox.max[0] = max_pos[0];
-          out_primitive->bbox.max[1] = max_pos[1];
-          out_primitive->bbox.max[2] = max_pos[2];
+          position_deltas = owl_find_gltf_target_attribute(target, "POSITION");
+          normal_deltas = owl_find_gltf_target_attribute(target, "NORMAL");
 
-          material = (int32_t)(in_primitive->material - gltf->materials);
-          out_primitive->material = material;
+          for (l = 0; l < num_local_vertices; ++l) {
+            struct owl_model_morph_target *delta;
+            int32_t const id = l * out_primitive->num_targets + k;
 
-          num_indices += num_local_indices;
-          num_vertices += num_local_vertices;
-        }
-      }
+            delta = &p->targets[num_targets + id];
 
-      for (j = 0; j < (int32_t)OWL_ARRAY_SIZE(out_mesh->ssbos); ++j) {
-        VkBufferCreateInfo info;
-        VkResult vk_result;
-        OWL_UNUSED(vk_result);
-
-        info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        info.pNext = NULL;
-        info.flags = 0;
-        info.size = sizeof(struct owl_model_joints_ssbo);
-        info.usage = 0;
-        info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        info.queueFamilyIndexCount = 0;
-        info.pQueueFamilyIndices = NULL;
-
-        vk_result = vkCreateBuffer(device, &info, NULL, &out_mesh->ssbos[j]);
-        OWL_ASSERT(!vk_result);
-      }
+            OWL_V4_ZERO(delta->position);
+            OWL_V4_ZERO(delta->normal);
 
-      {
-        uint64_t aligned_size;
-        VkMemoryPropertyFlagBits properties;
-        VkMemoryRequirements requirements;
-        VkMemoryAllocateInfo info;
-        VkResult vk_result;
-        OWL_UNUSED(vk_result);
-
-        properties = 0;
-        properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-        properties |= VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-
-        vkGetBufferMemoryRequirements(device, out_mesh->ssbos[0],
-                                      &requirements);
-
-        aligned_size =
-            OWL_ALIGN_UP_2(requirements.size, requirements.alignment);
-
-        info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        info.pNext = NULL;
-        info.allocationSize = aligned_size * OWL_ARRAY_SIZE(out_mesh->ssbos);
-        info.memoryTypeIndex = owl_renderer_find_memory_type(
-            r, requirements.memoryTypeBits, properties);
-
-        vk_result =
-            vkAllocateMemory(device, &info, NULL, &out_mesh->ssbo_memory);
-        OWL_ASSERT(!vk_result);
-
-        for (j = 0; j < (int32_t)OWL_ARRAY_SIZE(out_mesh->ssbos); ++j) {
-          vk_result =
-              vkBindBufferMemory(device, out_mesh->ssbos[j],
-                                 out_mesh->ssbo_memory, j * aligned_size);
-          OWL_ASSERT(!vk_result);
-        }
+            if (position_deltas)
+              cgltf_accessor_read_float(position_deltas->data, l,
+                                        delta->position, 3);
 
-        {
-          void *data;
-          vk_result = vkMapMemory(device, out_mesh->ssbo_memory, 0,
-                                  VK_WHOLE_SIZE, 0, &data);
-          OWL_ASSERT(!vk_result);
-          for (j = 0; j < (int32_t)OWL_ARRAY_SIZE(out_mesh->ssbos); ++j) {
-            uint64_t const offset = j * aligned_size;
-            out_mesh->mapped_ssbos[j] = (void *)&((uint8_t *)(data))[offset];
+            if (normal_deltas)
+              cgltf_accessor_read_float(normal_deltas->data, l, delta->normal,
+                                        3);
           }
         }
 
-        for (j = 0; j < (int32_t)OWL_ARRAY_SIZE(out_mesh->ssbos); ++j) {
-          int32_t l;
-          struct owl_model_joints_ssbo *ssbo = out_mesh->mapped_ssbos[j];
-
-          if (-1 != out_node->skin)
-            ssbo->num_joints = m->skins[out_node->skin].num_joints;
-          else
-            ssbo->num_joints = 0;
-
-          OWL_M4_IDENTITY(ssbo->matrix);
+        num_targets += num_local_vertices * out_primitive->num_targets;
 
-          for (l = 0; l < (int32_t)OWL_ARRAY_SIZE(ssbo->joints); ++l)
-            OWL_M4_IDENTITY(ssbo->joints[l]);
-        }
-      }
-
-      {
-        VkDescriptorSetLayout layouts[OWL_ARRAY_SIZE(out_mesh->ssbos)];
-        VkDescriptorSetAllocateInfo info;
-        VkResult vk_result;
-        OWL_UNUSED(vk_result);
+        {
+          int32_t material;
 
-        OWL_ASSERT(OWL_ARRAY_SIZE(out_mesh->ssbo_descriptor_sets) ==
-                   OWL_ARRAY_SIZE(out_mesh->ssbos));
+          out_primitive->first = num_indices;
+          out_primitive->num_indices = num_local_indices;
+          out_primitive->first_vertex = num_vertices;
+          out_primitive->num_vertices = num_local_vertices;
+          out_primitive->has_indices = !!num_local_indices;
+          out_primitive->bbox.valid = has_bbox;
 
-        for (j = 0; j < (int32_t)OWL_ARRAY_SIZE(layouts); ++j)
-          layouts[j] = r->model_storage_descriptor_set_layout;
+          if (has_bbox) {
+            OWL_V3_COPY(min_pos, out_primitive->bbox.min);
+            OWL_V3_COPY(max_pos, out_primitive->bbox.max);
+          } else {
+            OWL_V3_ZERO(out_primitive->bbox.min);
+            OWL_V3_ZERO(out_primitive->bbox.max);
+          }
 
-        info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        info.pNext = NULL;
-        info.descriptorPool = r->descriptor_pool;
-        info.descriptorSetCount = OWL_ARRAY_SIZE(layouts);
-        info.pSetLayouts = layouts;
+          material = (int32_t)(in_primitive->material - gltf->materials);
+          out_primitive->material = material;
 
-        vk_result = vkAllocateDescriptorSets(device, &info,
-                                             out_mesh->ssbo_descriptor_sets);
-        OWL_ASSERT(!vk_result);
-      }
-      {
-        VkDescriptorBufferInfo descriptors[OWL_ARRAY_SIZE(out_mesh->ssbos)];
-        VkWriteDescriptorSet writes[OWL_ARRAY_SIZE(out_mesh->ssbos)];
-
-        for (j = 0; j < (int32_t)OWL_ARRAY_SIZE(descriptors); ++j) {
-          descriptors[j].buffer = out_mesh->ssbos[j];
-          descriptors[j].offset = 0;
-          descriptors[j].range = sizeof(struct owl_model_joints_ssbo);
-
-          writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-          writes[j].pNext = NULL;
-          writes[j].dstSet = out_mesh->ssbo_descriptor_sets[j];
-          writes[j].dstBinding = 0;
-          writes[j].dstArrayElement = 0;
-          writes[j].descriptorCount = 1;
-          writes[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-          writes[j].pImageInfo = NULL;
-          writes[j].pBufferInfo = &descriptors[j];
-          writes[j].pTexelBufferView = NULL;
+          num_indices += num_local_indices;
+          num_vertices += num_local_vertices;
         }
-
-        vkUpdateDescriptorSets(device, OWL_ARRAY_SIZE(writes), writes, 0, NULL);
       }
     } else {
-      out_node->mesh = -1;
+      m->node_meshes[i] = -1;
     }
   }
 
   OWL_ASSERT(num_indices == p->num_indices);
   OWL_ASSERT(num_vertices == p->num_vertices);
+  OWL_ASSERT(num_targets == p->num_targets);
 
   return ret;
 }
 
-static void owl_model_unload_nodes(struct owl_renderer *r,
-                                   struct owl_model *m) {
+/* reorders the triangles of every primitive for the post-transform cache and
+ * then for overdraw, and the vertices in the order the triangles use them */
+static int owl_model_optimize_primitives(struct owl_model_all_primitives *p,
+                                         struct owl_model *m) {
   int32_t i;
-  VkDevice const device = r->device;
-  /* could just iterate each mesh instead of going trough each node,
-  however it's easier to cleanup future resource allocations this way */
-  for (i = 0; i < m->num_nodes; ++i) {
-    int32_t j;
-    struct owl_model_node *node;
-    struct owl_model_mesh *mesh;
+  uint32_t *remap;
+  float num_triangles = 0.0F;
+  float num_referenced = 0.0F;
+  float acmr_before = 0.0F;
+  float acmr_after = 0.0F;
+  float atvr_before = 0.0F;
+  float atvr_after = 0.0F;
+  int ret = OWL_OK;
+
+  remap = OWL_MALLOC(OWL_MAX(p->num_vertices, 1) * sizeof(*remap));
+  if (!remap)
+    return OWL_ERROR_NO_MEMORY;
 
-    node = &m->nodes[i];
+  for (i = 0; i < m->num_primitives; ++i) {
+    struct owl_mesh_cache_stats stats;
+    struct owl_model_primitive const *primitive = &m->primitives[i];
+    int32_t const num_indices = (int32_t)primitive->num_indices;
+    int32_t const num_vertices = (int32_t)primitive->num_vertices;
+    uint32_t *indices = &p->indices[primitive->first];
+    owl_v3 *positions = &p->positions[primitive->first_vertex];
+    struct owl_model_vertex_attributes *attributes;
 
-    /* if no mesh, continue */
-    if (-1 == node->mesh)
+    attributes = &p->attributes[primitive->first_vertex];
+
+    if (!primitive->has_indices || !num_vertices)
       continue;
 
-    mesh = &m->meshes[node->mesh];
+    ret = owl_mesh_analyze_vertex_cache(indices, num_indices, num_vertices,
+                                        OWL_MESH_CACHE_SIZE, &stats);
+    if (ret)
+      goto out;
+
+    acmr_before += stats.acmr * (num_indices / 3);
+    atvr_before += stats.atvr * num_vertices;
+
+    ret = owl_mesh_optimize_vertex_cache(indices, num_indices, num_vertices);
+    if (ret)
+      goto out;
+
+    ret = owl_mesh_optimize_overdraw(indices, num_indices, positions[0],
+                                     sizeof(*positions), num_vertices);
+    if (ret)
+      goto out;
+
+    owl_mesh_optimize_vertex_fetch(indices, num_indices, num_vertices, remap);
+
+    ret = owl_mesh_remap_vertices(positions, num_vertices, sizeof(*positions),
+                                  remap);
+    if (ret)
+      goto out;
+
+    ret = owl_mesh_remap_vertices(attributes, num_vertices,
+                                  sizeof(*attributes), remap);
+    if (ret)
+      goto out;
+
+    /* the deltas follow their vertex */
+    if (primitive->num_targets) {
+      int32_t const first = primitive->morph_offset +
+                            primitive->first_vertex * primitive->num_targets;
+
+      ret = owl_mesh_remap_vertices(
+          &p->targets[first], num_vertices,
+          primitive->num_targets * sizeof(*p->targets), remap);
+      if (ret)
+        goto out;
+    }
 
-    vkFreeDescriptorSets(device, r->descriptor_pool,
-                         OWL_ARRAY_SIZE(mesh->ssbos),
-                         mesh->ssbo_descriptor_sets);
+    ret = owl_mesh_analyze_vertex_cache(indices, num_indices, num_vertices,
+                                        OWL_MESH_CACHE_SIZE, &stats);
+    if (ret)
+      goto out;
 
-    vkFreeMemory(device, mesh->ssbo_memory, NULL);
+    acmr_after += stats.acmr * (num_indices / 3);
+    atvr_after += stats.atvr * num_vertices;
+    num_triangles += num_indices / 3;
+    num_referenced += num_vertices;
+  }
 
-    for (j = 0; j < (int32_t)OWL_ARRAY_SIZE(mesh->ssbos); ++j)
-      vkDestroyBuffer(device, mesh->ssbos[j], NULL);
+  if (0.0F < num_triangles) {
+    OWL_DEBUG_LOG("%s: acmr %.3f -> %.3f, atvr %.3f -> %.3f\n", m->path,
+                  acmr_before / num_triangles, acmr_after / num_triangles,
+                  atvr_before / num_referenced, atvr_after / num_referenced);
   }
+
+out:
+  OWL_FREE(remap);
+
+  return ret;
 }
 
-static int owl_model_init_buffers(struct owl_renderer *r,
-                                  struct owl_model_all_primitives *p,
-                                  struct owl_model *m) {
+/* how far a lod may stray as a fraction of the size of its primitive, and
+ * the fraction of the indices of the previous lod it has to get under to be
+ * worth keeping */
+#define OWL_MODEL_LOD_MAX_ERROR 0.05F
+#define OWL_MODEL_LOD_MIN_REDUCTION 0.8F
+
+/* simplifies every indexed primitive into lods with half the triangles of
+ * the one before, their indices are appended after the loaded ones. every
+ * lod is simplified from the primitive itself so the errors don't add up */
+static int
+owl_model_init_lods(struct owl_model_import_options const *options,
+                    struct owl_model_all_primitives *p,
+                    struct owl_model *m) {
+  int32_t i;
+  int32_t j;
+  int32_t k;
+  int32_t capacity;
+  int32_t max_indices = 0;
+  uint32_t *scratch = NULL;
   int ret = OWL_OK;
-  VkDevice const device = r->device;
 
-  {
-    VkBufferCreateInfo info;
-    VkResult vk_result;
-    OWL_UNUSED(vk_result);
+  for (i = 0; i < m->num_primitives; ++i) {
+    struct owl_model_primitive *primitive = &m->primitives[i];
+
+    primitive->num_lods = 1;
+    primitive->lods[0].first = primitive->first;
+    primitive->lods[0].num_indices = primitive->num_indices;
+    primitive->lods[0].error = 0.0F;
+    primitive->lods[0].first_meshlet = 0;
+    primitive->lods[0].num_meshlets = 0;
+
+    if (primitive->has_indices)
+      max_indices = OWL_MAX(max_indices, (int32_t)primitive->num_indices);
+  }
+
+  if (!options->generate_lods || !max_indices)
+    goto out;
+
+  scratch = OWL_MALLOC(max_indices * sizeof(*scratch));
+  if (!scratch)
+    return OWL_ERROR_NO_MEMORY;
+
+  capacity = p->num_indices;
+
+  for (i = 0; i < m->num_primitives; ++i) {
+    float max_error;
+    struct owl_model_primitive *primitive = &m->primitives[i];
+    int32_t const num_vertices = (int32_t)primitive->num_vertices;
+
+    if (!primitive->has_indices || !num_vertices || !primitive->bbox.valid)
+      continue;
+
+    max_error = OWL_MODEL_LOD_MAX_ERROR *
+                owl_v3_distance(primitive->bbox.min, primitive->bbox.max);
+
+    for (j = 1; j < OWL_MODEL_MAX_LODS; ++j) {
+      float error;
+      int32_t count;
+      struct owl_model_lod *lod = &primitive->lods[j];
+      struct owl_model_lod const *previous = &primitive->lods[j - 1];
+
+      ret = owl_mesh_simplify(
+          &p->indices[primitive->first], (int32_t)primitive->num_indices,
+          p->positions[primitive->first_vertex], sizeof(*p->positions),
+          num_vertices, (int32_t)(primitive->num_indices >> j), max_error,
+          scratch, &count, &error);
+      if (ret)
+        goto out;
+
+      /* stuck on the error limit or on locked vertices, the next ones would
+       * be no smaller */
+      if (!count ||
+          OWL_MODEL_LOD_MIN_REDUCTION * previous->num_indices < count)
+        break;
+
+      if (options->optimize_meshes) {
+        ret = owl_mesh_optimize_vertex_cache(scratch, count, num_vertices);
+        if (ret)
+          goto out;
+      }
+
+      if (capacity < p->num_indices + count) {
+        uint32_t *indices;
+
+        capacity = OWL_MAX(capacity * 2, p->num_indices + count);
+
+        indices = OWL_REALLOC(p->indices, capacity * sizeof(*p->indices));
+        if (!indices) {
+          ret = OWL_ERROR_NO_MEMORY;
+          goto out;
+        }
+
+        p->indices = indices;
+      }
+
+      OWL_MEMCPY(&p->indices[p->num_indices], scratch,
+                 count * sizeof(*scratch));
+
+      lod->first = (uint32_t)p->num_indices;
+      lod->num_indices = (uint32_t)count;
+      lod->error = OWL_MAX(error, previous->error);
+      lod->first_meshlet = 0;
+      lod->num_meshlets = 0;
+
+      p->num_indices += count;
+      primitive->num_lods = j + 1;
+    }
+  }
+
+out:
+  OWL_FREE(scratch);
+
+  for (i = 0; i < m->num_meshes; ++i) {
+    owl_v3 min;
+    owl_v3 max;
+    int32_t empty = 1;
+    struct owl_model_mesh *mesh = &m->meshes[i];
+
+    mesh->num_lods = 1;
+    for (j = 0; j < OWL_MODEL_MAX_LODS; ++j)
+      mesh->lod_errors[j] = 0.0F;
+
+    for (j = 0; j < mesh->num_primitives; ++j) {
+      struct owl_model_primitive const *primitive;
+
+      primitive = &m->primitives[mesh->first_primitive + j];
+
+      mesh->num_lods = OWL_MAX(mesh->num_lods, primitive->num_lods);
+
+      for (k = 0; k < OWL_MODEL_MAX_LODS; ++k) {
+        int32_t const lod = OWL_MIN(k, primitive->num_lods - 1);
+        float const error = primitive->lods[lod].error;
+
+        mesh->lod_errors[k] = OWL_MAX(mesh->lod_errors[k], error);
+      }
+
+      if (!primitive->bbox.valid)
+        continue;
+
+      if (empty) {
+        OWL_V3_COPY(primitive->bbox.min, min);
+        OWL_V3_COPY(primitive->bbox.max, max);
+        empty = 0;
+      }
+
+      for (k = 0; k < 3; ++k) {
+        min[k] = OWL_MIN(min[k], primitive->bbox.min[k]);
+        max[k] = OWL_MAX(max[k], primitive->bbox.max[k]);
+      }
+    }
+
+    if (empty) {
+      OWL_V3_ZERO(mesh->center);
+      mesh->radius = 0.0F;
+    } else {
+      OWL_V3_ADD(min, max, mesh->center);
+      OWL_V3_SCALE(mesh->center, 0.5F, mesh->center);
+      mesh->radius = owl_v3_distance(min, max) * 0.5F;
+    }
+  }
+
+  return ret;
+}
+
+/* splits every lod of the primitives of static nodes into meshlets so they
+ * can be culled in smaller pieces, skinned and morphed vertices move away
+ * from their bounds and are kept whole */
+static int
+owl_model_init_meshlets(struct owl_model_import_options const *options,
+                        struct owl_model_all_primitives *p,
+                        struct owl_model *m) {
+  int32_t i;
+  int32_t pass;
+  int ret = OWL_OK;
+
+  m->num_meshlets = 0;
+  m->meshlets = NULL;
+
+  /* a draw per meshlet is only cheap with multi draw indirect */
+  if (!options->build_meshlets)
+    return OWL_OK;
+
+  /* the first pass counts them */
+  for (pass = 0; pass < 2; ++pass) {
+    int32_t num_meshlets = 0;
+
+    for (i = 0; i < m->num_nodes; ++i) {
+      int32_t j;
+      struct owl_model_mesh const *mesh;
+
+      if (-1 == m->node_meshes[i] || -1 != m->node_skins[i])
+        continue;
+
+      mesh = &m->meshes[m->node_meshes[i]];
+
+      for (j = 0; j < mesh->num_primitives; ++j) {
+        int32_t k;
+        struct owl_model_primitive *primitive;
+
+        primitive = &m->primitives[mesh->first_primitive + j];
+
+        if (!primitive->num_vertices || !primitive->has_indices ||
+            !primitive->bbox.valid || primitive->num_targets)
+          continue;
+
+        for (k = 0; k < primitive->num_lods; ++k) {
+          int32_t l;
+          int32_t count;
+          struct owl_mesh_meshlet *meshlets = NULL;
+          struct owl_model_lod *lod = &primitive->lods[k];
+
+          if (pass)
+            meshlets = &m->meshlets[num_meshlets];
+
+          ret = owl_mesh_build_meshlets(
+              &p->indices[lod->first], (int32_t)lod->num_indices,
+              p->positions[primitive->first_vertex], sizeof(*p->positions),
+              (int32_t)primitive->num_vertices, &count,
+              meshlets);
+          if (ret)
+            goto error_free_meshlets;
+
+          for (l = 0; pass && l < count; ++l)
+            meshlets[l].first += lod->first;
+
+          lod->first_meshlet = num_meshlets;
+          lod->num_meshlets = count;
+          num_meshlets += count;
+        }
+      }
+    }
+
+    if (!num_meshlets)
+      return OWL_OK;
+
+    if (!pass) {
+      m->meshlets = OWL_MALLOC(num_meshlets * sizeof(*m->meshlets));
+      if (!m->meshlets)
+        return OWL_ERROR_NO_MEMORY;
+    }
+
+    m->num_meshlets = num_meshlets;
+  }
+
+  return OWL_OK;
+
+error_free_meshlets:
+  OWL_FREE(m->meshlets);
+  m->meshlets = NULL;
+  m->num_meshlets = 0;
+
+  return ret;
+}
+
+static void owl_model_deinit_meshlets(struct owl_renderer *r,
+                                      struct owl_model *m) {
+  OWL_UNUSED(r);
+  OWL_FREE(m->meshlets);
+}
+
+static void owl_model_unload_nodes(struct owl_renderer *r,
+                                   struct owl_model *m) {
+  OWL_UNUSED(r);
+  OWL_UNUSED(m);
+}
+
+/* the indices are relative to their primitive, so unless a single primitive
+ * has more than 65536 vertices 16 bits are enough */
+static VkIndexType
+owl_model_pick_index_type(struct owl_model_all_primitives const *p) {
+  int32_t i;
+  uint32_t max_index = 0;
+
+  for (i = 0; i < p->num_indices; ++i)
+    max_index = OWL_MAX(max_index, p->indices[i]);
+
+  if (max_index <= 0xFFFF)
+    return VK_INDEX_TYPE_UINT16;
+
+  return VK_INDEX_TYPE_UINT32;
+}
+
+static uint64_t owl_model_index_size(VkIndexType type) {
+  if (VK_INDEX_TYPE_UINT16 == type)
+    return sizeof(uint16_t);
+
+  return sizeof(uint32_t);
+}
+
+static void owl_model_pack_indices(struct owl_model_all_primitives const *p,
+                                   VkIndexType type, void *data) {
+  int32_t i;
+
+  if (VK_INDEX_TYPE_UINT16 == type) {
+    uint16_t *indices = data;
+    for (i = 0; i < p->num_indices; ++i)
+      indices[i] = (uint16_t)p->indices[i];
+  } else {
+    OWL_MEMCPY(data, p->indices, p->num_indices * sizeof(*p->indices));
+  }
+}
+
+/* creates the vertex buffer for m->num_vertices vertices and, if there are
+ * any indices, the index buffer for num_indices of m->index_type. nothing is
+ * uploaded */
+static int owl_model_create_geometry(struct owl_renderer *r,
+                                     int32_t num_indices,
+                                     struct owl_model *m) {
+  VkDevice const device = r->device;
+
+  m->vertex_attributes_offset = m->num_vertices * sizeof(owl_v3);
+
+  {
+    VkBufferCreateInfo info;
+    VkResult vk_result;
+    OWL_UNUSED(vk_result);
 
     info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     info.pNext = NULL;
     info.flags = 0;
-    info.size = p->num_vertices * sizeof(*p->vertices);
+    info.size = owl_model_vertex_buffer_size(m->num_vertices);
     info.usage = 0;
     info.usage |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    info.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
     info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
     info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     info.queueFamilyIndexCount = 0;
@@ -1242,149 +2141,167 @@ static int owl_model_init_buffers(struct owl_renderer *r,
     OWL_ASSERT(!vk_result);
   }
 
+  if (!num_indices) {
+    m->index_buffer = VK_NULL_HANDLE;
+    m->index_memory = VK_NULL_HANDLE;
+    m->has_indices = 0;
+    return OWL_OK;
+  }
+
   {
-    VkBufferCopy copy;
-    uint64_t size;
-    void *data;
-    struct owl_renderer_upload_allocation allocation;
+    VkBufferCreateInfo info;
+    VkResult vk_result;
+    OWL_UNUSED(vk_result);
 
-    ret = owl_renderer_begin_im_command_buffer(r);
-    OWL_ASSERT(!ret);
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.size = num_indices * owl_model_index_size(m->index_type);
+    info.usage = 0;
+    info.usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.queueFamilyIndexCount = 0;
+    info.pQueueFamilyIndices = 0;
 
-    size = p->num_vertices * sizeof(*p->vertices);
-    data = owl_renderer_upload_allocate(r, size, &allocation);
-    OWL_ASSERT(data);
+    vk_result = vkCreateBuffer(device, &info, NULL, &m->index_buffer);
+    OWL_ASSERT(!vk_result);
+  }
 
-    OWL_MEMCPY(data, p->vertices, size);
+  {
+    VkMemoryPropertyFlagBits properties;
+    VkMemoryRequirements requirements;
+    VkMemoryAllocateInfo info;
+    VkResult vk_result;
+    OWL_UNUSED(vk_result);
 
-#if 0
-    {
-      int32_t i;
-      OWL_DEBUG_LOG("splating vertices...\n");
-      for (i = 0; i < p->num_vertices; ++i) {
-        struct owl_model_vertex *vertex = &p->vertices[i];
-        OWL_DEBUG_LOG("  p->vertices[%i]:\n", i);
-        OWL_DEBUG_LOG("    position: " OWL_V3_FORMAT "\n",
-                      OWL_V3_FORMAT_ARGS(vertex->position));
-        OWL_DEBUG_LOG("    normal: " OWL_V3_FORMAT "\n",
-                      OWL_V3_FORMAT_ARGS(vertex->normal));
-        OWL_DEBUG_LOG("    uv0: " OWL_V2_FORMAT "\n",
-                      OWL_V2_FORMAT_ARGS(vertex->uv0));
-        OWL_DEBUG_LOG("    uv1: " OWL_V2_FORMAT "\n",
-                      OWL_V2_FORMAT_ARGS(vertex->uv1));
-        OWL_DEBUG_LOG("    joints0: " OWL_V4_FORMAT "\n",
-                      OWL_V4_FORMAT_ARGS(vertex->joints0));
-        OWL_DEBUG_LOG("    weights0: " OWL_V4_FORMAT "\n",
-                      OWL_V4_FORMAT_ARGS(vertex->weights0));
-        OWL_DEBUG_LOG("    color0: " OWL_V4_FORMAT "\n",
-                      OWL_V4_FORMAT_ARGS(vertex->color0));
-      }
-    }
-#endif
+    properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
-    copy.srcOffset = 0;
-    copy.dstOffset = 0;
-    copy.size = size;
+    vkGetBufferMemoryRequirements(device, m->index_buffer, &requirements);
 
-    vkCmdCopyBuffer(r->im_command_buffer, allocation.buffer, m->vertex_buffer,
-                    1, &copy);
+    info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    info.pNext = NULL;
+    info.allocationSize = requirements.size;
+    info.memoryTypeIndex = owl_renderer_find_memory_type(
+        r, requirements.memoryTypeBits, properties);
 
-    ret = owl_renderer_end_im_command_buffer(r);
-    OWL_ASSERT(!ret);
+    vk_result = vkAllocateMemory(device, &info, NULL, &m->index_memory);
+    OWL_ASSERT(!vk_result);
 
-    owl_renderer_upload_free(r, data);
+    vk_result = vkBindBufferMemory(device, m->index_buffer, m->index_memory, 0);
+    OWL_ASSERT(!vk_result);
   }
 
-  if (p->num_indices) {
-    {
-      VkBufferCreateInfo info;
-      VkResult vk_result;
-      OWL_UNUSED(vk_result);
+  m->has_indices = 1;
 
-      info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-      info.pNext = NULL;
-      info.flags = 0;
-      info.size = p->num_indices * sizeof(*p->indices);
-      info.usage = 0;
-      info.usage |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-      info.usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-      info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-      info.queueFamilyIndexCount = 0;
-      info.pQueueFamilyIndices = 0;
-
-      vk_result = vkCreateBuffer(device, &info, NULL, &m->index_buffer);
-      OWL_ASSERT(!vk_result);
-    }
+  return OWL_OK;
+}
 
-    {
-      VkMemoryPropertyFlagBits properties;
-      VkMemoryRequirements requirements;
-      VkMemoryAllocateInfo info;
-      VkResult vk_result;
-      OWL_UNUSED(vk_result);
+/* copies size bytes of data into buffer through the upload buffer and waits
+ * for it */
+static int owl_model_upload(struct owl_renderer *r, VkBuffer buffer,
+                            void const *data, uint64_t size) {
+  VkBufferCopy copy;
+  void *upload;
+  struct owl_renderer_upload_allocation allocation;
+  int ret = OWL_OK;
 
-      properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  ret = owl_renderer_begin_im_command_buffer(r);
+  if (ret)
+    return ret;
 
-      vkGetBufferMemoryRequirements(device, m->index_buffer, &requirements);
+  upload = owl_renderer_upload_allocate(r, size, &allocation);
+  if (!upload) {
+    owl_renderer_end_im_command_buffer(r);
+    return OWL_ERROR_NO_MEMORY;
+  }
 
-      info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-      info.pNext = NULL;
-      info.allocationSize = requirements.size;
-      info.memoryTypeIndex = owl_renderer_find_memory_type(
-          r, requirements.memoryTypeBits, properties);
+  OWL_MEMCPY(upload, data, size);
 
-      vk_result = vkAllocateMemory(device, &info, NULL, &m->index_memory);
-      OWL_ASSERT(!vk_result);
+  copy.srcOffset = 0;
+  copy.dstOffset = 0;
+  copy.size = size;
 
-      vk_result =
-          vkBindBufferMemory(device, m->index_buffer, m->index_memory, 0);
-      OWL_ASSERT(!vk_result);
-    }
+  vkCmdCopyBuffer(r->im_command_buffer, allocation.buffer, buffer, 1, &copy);
 
-    {
-      VkBufferCopy copy;
-      uint64_t size;
-      void *data;
-      struct owl_renderer_upload_allocation allocation;
+  ret = owl_renderer_end_im_command_buffer(r);
 
-      ret = owl_renderer_begin_im_command_buffer(r);
-      OWL_ASSERT(!ret);
+  owl_renderer_upload_free(r, upload);
 
-      size = p->num_indices * sizeof(*p->indices);
-      data = owl_renderer_upload_allocate(r, size, &allocation);
-      OWL_ASSERT(data);
+  return ret;
+}
 
-      OWL_MEMCPY(data, p->indices, size);
+static int owl_model_init_buffers(struct owl_renderer *r,
+                                  struct owl_model_all_primitives *p,
+                                  struct owl_model *m) {
+  int ret = OWL_OK;
 
-#if 0
-      {
-        int32_t i;
-        OWL_DEBUG_LOG("splating indices...\n");
-        for (i = 0; i < p->num_indices; ++i) {
-          OWL_DEBUG_LOG("  p->indices[%i]: = %u\n", i, p->indices[i]);
-          OWL_ASSERT(p->indices[i] <= (uint32_t)p->num_vertices);
-        }
-      }
-#endif
+  m->num_vertices = p->num_vertices;
+  m->index_type = owl_model_pick_index_type(p);
 
-      copy.srcOffset = 0;
-      copy.dstOffset = 0;
-      copy.size = size;
+  ret = owl_model_create_geometry(r, p->num_indices, m);
+  if (ret)
+    return ret;
 
-      vkCmdCopyBuffer(r->im_command_buffer, allocation.buffer, m->index_buffer,
-                      1, &copy);
+  /* the vertices were converted in the upload buffer, copy them and give it
+   * back for the rest of the uploads */
+  if (!p->upload) {
+    ret = owl_model_upload(r, m->vertex_buffer, p->vertices,
+                           owl_model_vertex_buffer_size(p->num_vertices));
+    if (ret)
+      return ret;
+  } else {
+    VkBufferCopy copy;
 
-      ret = owl_renderer_end_im_command_buffer(r);
-      OWL_ASSERT(!ret);
+    OWL_ASSERT(r == p->upload);
+
+    ret = owl_renderer_begin_im_command_buffer(r);
+    OWL_ASSERT(!ret);
+
+    copy.srcOffset = 0;
+    copy.dstOffset = 0;
+    copy.size = owl_model_vertex_buffer_size(p->num_vertices);
+
+    vkCmdCopyBuffer(r->im_command_buffer, p->allocation.buffer,
+                    m->vertex_buffer, 1, &copy);
+
+    ret = owl_renderer_end_im_command_buffer(r);
+    OWL_ASSERT(!ret);
+
+    owl_renderer_upload_free(r, p->vertices);
+    p->vertices = NULL;
+    p->positions = NULL;
+    p->attributes = NULL;
+  }
 
-      owl_renderer_upload_free(r, data);
+  if (m->has_indices) {
+    VkBufferCopy copy;
+    void *data;
+    uint64_t const size = p->num_indices * owl_model_index_size(m->index_type);
+    struct owl_renderer_upload_allocation allocation;
+
+    ret = owl_renderer_begin_im_command_buffer(r);
+    if (ret)
+      return ret;
+
+    data = owl_renderer_upload_allocate(r, size, &allocation);
+    if (!data) {
+      owl_renderer_end_im_command_buffer(r);
+      return OWL_ERROR_NO_MEMORY;
     }
 
-    m->has_indices = 1;
-  } else {
-    m->index_buffer = VK_NULL_HANDLE;
-    m->index_memory = VK_NULL_HANDLE;
-    m->has_indices = 0;
+    owl_model_pack_indices(p, m->index_type, data);
+
+    copy.srcOffset = 0;
+    copy.dstOffset = 0;
+    copy.size = size;
+
+    vkCmdCopyBuffer(r->im_command_buffer, allocation.buffer, m->index_buffer,
+                    1, &copy);
+
+    ret = owl_renderer_end_im_command_buffer(r);
+
+    owl_renderer_upload_free(r, data);
   }
 
   return ret;
@@ -1403,474 +2320,3239 @@ static void owl_model_deinit_buffers(struct owl_renderer *r,
   vkDestroyBuffer(device, m->vertex_buffer, NULL);
 }
 
-/* TODO(samuel): do a simplify pass */
-static int owl_model_load_skins(struct owl_renderer *r,
-                                struct cgltf_data const *gltf,
-                                struct owl_model *m) {
-  int32_t i;
-  int ret = OWL_OK;
+#define OWL_MODEL_NODE_LOCAL_DIRTY 1
+#define OWL_MODEL_NODE_WORLD_DIRTY 2
 
-  OWL_UNUSED(r);
+/* breadth first from every parentless node, parents always end up before
+ * their children */
+static void owl_model_init_node_order(struct owl_model *m) {
+  int32_t i;
+  int32_t head = 0;
+  int32_t tail = 0;
 
-  OWL_ASSERT(gltf->skins_count < OWL_ARRAY_SIZE(m->skins));
+  for (i = 0; i < m->num_nodes; ++i)
+    if (-1 == m->node_parents[i])
+      m->node_order[tail++] = i;
 
-  m->num_skins = (int32_t)gltf->skins_count;
-  for (i = 0; i < m->num_skins; ++i) {
-    int32_t j;
-    struct owl_model_skin *out_skin = &m->skins[i];
-    struct cgltf_skin const *in_skin = &gltf->skins[i];
+  while (head < tail) {
+    struct owl_model_node const *node = &m->nodes[m->node_order[head++]];
 
-    if (in_skin->name) {
-      uint32_t max_length = OWL_ARRAY_SIZE(out_skin->name);
-      OWL_STRNCPY(out_skin->name, in_skin->name, max_length);
-    } else {
-      uint32_t max_length = OWL_ARRAY_SIZE(out_skin->name);
-      OWL_STRNCPY(out_skin->name, "NO NAME", max_length);
-    }
+    for (i = 0; i < node->num_children; ++i)
+      m->node_order[tail++] = node->children[i];
+  }
 
-    if (in_skin->skeleton)
-      out_skin->root = (int32_t)(in_skin->skeleton - gltf->nodes);
-    else
-      out_skin->root = -1;
+  OWL_ASSERT(tail == m->num_nodes);
+}
 
-    OWL_ASSERT(in_skin->joints_count < OWL_ARRAY_SIZE(out_skin->joints));
+static void owl_model_resolve_local_node_matrix(
+    struct owl_model_instance const *instance, int32_t id, owl_m4 matrix) {
+  owl_m4 tmp;
 
-    out_skin->num_joints = (int32_t)in_skin->joints_count;
-    for (j = 0; j < out_skin->num_joints; ++j)
-      out_skin->joints[j] = (int32_t)(in_skin->joints[j] - gltf->nodes);
+  OWL_M4_IDENTITY(matrix);
+  owl_m4_translate(instance->node_translations[id], matrix);
 
-    if (in_skin->inverse_bind_matrices) {
-      struct cgltf_accessor *accessor;
-      owl_m4 const *matrices;
+  OWL_M4_IDENTITY(tmp);
+  owl_q4_as_m4(instance->node_rotations[id], tmp);
+  owl_m4_multiply(matrix, tmp, matrix);
 
-      accessor = in_skin->inverse_bind_matrices;
-      matrices = owl_resolve_gltf_accessor(accessor);
+  OWL_M4_IDENTITY(tmp);
+  owl_m4_scale_v3(tmp, instance->node_scales[id], tmp);
+  owl_m4_multiply(matrix, tmp, matrix);
 
-      OWL_ASSERT(accessor->count < OWL_ARRAY_SIZE(out_skin->joints));
+  owl_m4_multiply(matrix, instance->model->node_matrices[id], matrix);
+}
 
-      out_skin->num_inverse_bind_matrices = accessor->count;
-      for (j = 0; j < out_skin->num_inverse_bind_matrices; ++j)
-        OWL_M4_COPY(matrices[j], out_skin->inverse_bind_matrices[j]);
+/* only dirty nodes and their descendants are recomputed */
+static void
+owl_model_update_transforms(struct owl_model_instance *instance) {
+  int32_t i;
+  struct owl_model const *m = instance->model;
+  int32_t *dirty_nodes = instance->dirty_nodes;
+  owl_m4 *local_matrices = instance->local_matrices;
+  owl_m4 *world_matrices = instance->world_matrices;
+
+  for (i = 0; i < m->num_nodes; ++i) {
+    int32_t const id = m->node_order[i];
+    int32_t const parent = m->node_parents[id];
+
+    if (-1 != parent && dirty_nodes[parent])
+      dirty_nodes[id] |= OWL_MODEL_NODE_WORLD_DIRTY;
+
+    if (!dirty_nodes[id])
+      continue;
+
+    if (OWL_MODEL_NODE_LOCAL_DIRTY & dirty_nodes[id])
+      owl_model_resolve_local_node_matrix(instance, id, local_matrices[id]);
+
+    if (-1 == parent)
+      OWL_M4_COPY(local_matrices[id], world_matrices[id]);
+    else
+      owl_m4_multiply(world_matrices[parent], local_matrices[id],
+                      world_matrices[id]);
+  }
+
+  OWL_MEMSET(dirty_nodes, 0, m->num_nodes * sizeof(*dirty_nodes));
+}
+
+OWLAPI void
+owl_model_instance_build_joints(struct owl_model_instance const *instance,
+                                owl_m4 *palette) {
+  int32_t i;
+  struct owl_model const *m = instance->model;
+  owl_m4 *world_matrices = instance->world_matrices;
+
+  for (i = 0; i < m->num_nodes; ++i) {
+    int32_t j;
+    owl_m4 tmp;
+    owl_m4 inverse;
+    owl_m4 *joints;
+    struct owl_model_skin const *skin;
+
+    if (-1 == m->node_meshes[i] || -1 == m->node_skins[i])
+      continue;
+
+    skin = &m->skins[m->node_skins[i]];
+    joints = &palette[m->node_joints_offsets[i]];
+
+    owl_m4_inverse(world_matrices[i], inverse);
+
+    for (j = 0; j < skin->num_joints; ++j) {
+      owl_m4_multiply(world_matrices[skin->joints[j]],
+                      skin->inverse_bind_matrices[j], tmp);
+      owl_m4_multiply(inverse, tmp, joints[j]);
     }
+  }
+}
 
-    /* allocate and write the descriptor sets */
+static int owl_model_create_buffer(struct owl_renderer *r, uint64_t size,
+                                   VkBufferUsageFlags usage,
+                                   VkBuffer *buffer) {
+  VkBufferCreateInfo info;
+  VkResult vk_result;
+
+  info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  info.pNext = NULL;
+  info.flags = 0;
+  info.size = size;
+  info.usage = usage;
+  info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  info.queueFamilyIndexCount = 0;
+  info.pQueueFamilyIndices = NULL;
+
+  vk_result = vkCreateBuffer(r->device, &info, NULL, buffer);
+  if (vk_result)
+    return OWL_ERROR_FATAL;
+
+  return OWL_OK;
+}
+
+/* binds all the buffers to a single allocation, offsets receives where each
+ * buffer starts inside of the memory */
+static int owl_model_bind_buffers(struct owl_renderer *r, int32_t num_buffers,
+                                  VkBuffer const *buffers,
+                                  VkMemoryPropertyFlags properties,
+                                  VkDeviceMemory *memory, uint64_t *offsets) {
+  int32_t i;
+  uint64_t size = 0;
+  uint32_t filter = (uint32_t)-1;
+  VkMemoryAllocateInfo info;
+  VkResult vk_result;
+  VkDevice const device = r->device;
+
+  for (i = 0; i < num_buffers; ++i) {
+    VkMemoryRequirements requirements;
+
+    vkGetBufferMemoryRequirements(device, buffers[i], &requirements);
+
+    offsets[i] = OWL_ALIGN_UP_2(size, requirements.alignment);
+    size = offsets[i] + requirements.size;
+    filter &= requirements.memoryTypeBits;
+  }
+
+  info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  info.pNext = NULL;
+  info.allocationSize = size;
+  info.memoryTypeIndex = owl_renderer_find_memory_type(r, filter, properties);
+
+  vk_result = vkAllocateMemory(device, &info, NULL, memory);
+  if (vk_result)
+    return OWL_ERROR_FATAL;
+
+  for (i = 0; i < num_buffers; ++i) {
+    vk_result = vkBindBufferMemory(device, buffers[i], *memory, offsets[i]);
+    if (vk_result)
+      return OWL_ERROR_FATAL;
+  }
+
+  return OWL_OK;
+}
+
+/* uploads the morph target deltas, read by the vertex shader */
+static int
+owl_model_init_targets(struct owl_renderer *r,
+                       struct owl_model_morph_target const *targets,
+                       int32_t num_targets, struct owl_model *m) {
+  uint64_t offset;
+  uint64_t const size = OWL_MAX(1, num_targets) * sizeof(*targets);
+  VkBufferUsageFlags usage = 0;
+  int ret = OWL_OK;
+
+  usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  ret = owl_model_create_buffer(r, size, usage, &m->target_buffer);
+  if (ret)
+    return ret;
+
+  ret = owl_model_bind_buffers(r, 1, &m->target_buffer,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               &m->target_memory, &offset);
+  if (ret)
+    return ret;
+
+  if (num_targets) {
+    ret = owl_model_upload(r, m->target_buffer, targets, size);
+    if (ret)
+      return ret;
   }
 
   return ret;
 }
 
-static void owl_model_unload_skins(struct owl_renderer *r,
+static void owl_model_deinit_targets(struct owl_renderer *r,
+                                     struct owl_model *m) {
+  vkDestroyBuffer(r->device, m->target_buffer, NULL);
+  vkFreeMemory(r->device, m->target_memory, NULL);
+}
+
+/* flattens every (node, primitive) pair into a draw, grouped by material so
+ * that owl_draw_model can issue one indirect call per material */
+static int owl_model_init_draws(struct owl_renderer *r, struct owl_model *m) {
+  int32_t i;
+  int32_t j;
+  uint32_t first;
+  int32_t *material_batches;
+  uint64_t offset;
+  int ret = OWL_OK;
+
+  material_batches = OWL_MALLOC(OWL_MAX(1, m->num_materials) *
+                                sizeof(*material_batches));
+  if (!material_batches)
+    return OWL_ERROR_NO_MEMORY;
+
+  for (i = 0; i < m->num_materials; ++i)
+    material_batches[i] = -1;
+
+  m->num_draws = 0;
+  m->num_batches = 0;
+  m->num_skin_jobs = 0;
+  m->num_joint_matrices = 0;
+
+  for (i = 0; i < m->num_nodes; ++i) {
+    struct owl_model_mesh const *mesh;
+
+    if (-1 == m->node_meshes[i])
+      continue;
+
+    if (-1 != m->node_skins[i]) {
+      m->node_joints_offsets[i] = m->num_joint_matrices;
+      m->num_joint_matrices += m->skins[m->node_skins[i]].num_joints;
+    }
+
+    mesh = &m->meshes[m->node_meshes[i]];
+
+    for (j = 0; j < mesh->num_primitives; ++j) {
+      int32_t k;
+      int32_t material;
+      struct owl_model_primitive const *primitive;
+
+      primitive = &m->primitives[mesh->first_primitive + j];
+
+      if (!primitive->num_vertices || !primitive->has_indices)
+        continue;
+
+      material = primitive->material;
+
+      if (-1 == material_batches[material]) {
+        struct owl_model_batch *batch;
+
+        OWL_ASSERT(m->num_batches < m->num_materials);
+
+        material_batches[material] = m->num_batches;
+        batch = &m->batches[m->num_batches++];
+        batch->material = material;
+        batch->first = 0;
+        batch->num_draws = 0;
+      }
+
+      for (k = 0; k < primitive->num_lods; ++k)
+        m->batches[material_batches[material]].num_draws +=
+            OWL_MAX(1, primitive->lods[k].num_meshlets);
+    }
+  }
+
+  for (i = 0, first = 0; i < m->num_batches; ++i) {
+    struct owl_model_batch *batch = &m->batches[i];
+
+    batch->first = first;
+    first += batch->num_draws;
+    batch->num_draws = 0;
+  }
+
+  m->num_draws = (int32_t)first;
+
+  m->draws = OWL_MALLOC(OWL_MAX(1, m->num_draws) * sizeof(*m->draws));
+  if (!m->draws) {
+    OWL_FREE(material_batches);
+    return OWL_ERROR_NO_MEMORY;
+  }
+
+  for (i = 0; i < m->num_nodes; ++i) {
+    struct owl_model_mesh const *mesh;
+
+    if (-1 == m->node_meshes[i])
+      continue;
+
+    mesh = &m->meshes[m->node_meshes[i]];
+
+    for (j = 0; j < mesh->num_primitives; ++j) {
+      int32_t k;
+      uint32_t id;
+      struct owl_model_batch *batch;
+      struct owl_model_primitive const *primitive;
+
+      primitive = &m->primitives[mesh->first_primitive + j];
+
+      if (!primitive->num_vertices || !primitive->has_indices)
+        continue;
+
+      id = (uint32_t)material_batches[primitive->material];
+      batch = &m->batches[id];
+
+      for (k = 0; k < primitive->num_lods; ++k) {
+        int32_t l;
+        struct owl_model_lod const *lod = &primitive->lods[k];
+
+        for (l = 0; l < OWL_MAX(1, lod->num_meshlets); ++l) {
+          struct owl_model_draw *draw;
+
+          draw = &m->draws[batch->first + batch->num_draws++];
+
+          if (lod->num_meshlets) {
+            struct owl_mesh_meshlet const *meshlet;
+
+            meshlet = &m->meshlets[lod->first_meshlet + l];
+
+            OWL_V3_COPY(meshlet->min, draw->min);
+            OWL_V3_COPY(meshlet->max, draw->max);
+            OWL_V3_COPY(meshlet->center, draw->sphere);
+            draw->sphere[3] = meshlet->radius;
+            OWL_V3_COPY(meshlet->cone_axis, draw->cone);
+            draw->cone[3] = meshlet->cone_cutoff;
+            draw->first = meshlet->first;
+            draw->num_indices = meshlet->num_indices;
+          } else {
+            /* the lods only drop vertices, the box still holds */
+            OWL_V3_COPY(primitive->bbox.min, draw->min);
+            OWL_V3_COPY(primitive->bbox.max, draw->max);
+            /* a cutoff above 1 never culls */
+            OWL_V4_ZERO(draw->sphere);
+            OWL_V4_SET(draw->cone, 0.0F, 0.0F, 0.0F, 2.0F);
+            draw->first = lod->first;
+            draw->num_indices = lod->num_indices;
+          }
+
+          draw->min[3] = 1.0F;
+          draw->max[3] = 1.0F;
+          draw->vertex_offset = primitive->first_vertex;
+          draw->node = i;
+          draw->batch = id;
+          draw->batch_first = batch->first;
+          /* skinned and morphed bounds are only valid in bind pose, never
+           * cull them */
+          draw->cull = primitive->bbox.valid && -1 == m->node_skins[i] &&
+                       !primitive->num_targets;
+          draw->morph_offset = primitive->morph_offset;
+          /* the last lod also stands in for the ones the primitive lacks */
+          draw->min_lod = k;
+          if (k == primitive->num_lods - 1)
+            draw->max_lod = OWL_MODEL_MAX_LODS - 1;
+          else
+            draw->max_lod = k;
+          draw->padding[0] = 0;
+          draw->padding[1] = 0;
+        }
+      }
+
+      if (-1 != m->node_skins[i] || primitive->num_targets) {
+        struct owl_model_skin_job *job = &m->skin_jobs[m->num_skin_jobs++];
+
+        job->first_vertex = primitive->first_vertex;
+        job->num_vertices = primitive->num_vertices;
+        job->joints_offset = OWL_MAX(0, m->node_joints_offsets[i]);
+        if (-1 != m->node_skins[i])
+          job->num_joints = m->skins[m->node_skins[i]].num_joints;
+        else
+          job->num_joints = 0;
+        job->weights_offset = m->node_weights_offsets[i];
+        job->num_weights = primitive->num_targets;
+        job->morph_offset = primitive->morph_offset;
+        job->attributes_offset = m->vertex_attributes_offset / 4;
+      }
+    }
+  }
+
+  OWL_FREE(material_batches);
+
+  if (!m->num_draws)
+    return OWL_OK;
+
+  {
+    VkBufferUsageFlags usage = 0;
+
+    usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    ret = owl_model_create_buffer(r, m->num_draws * sizeof(*m->draws), usage,
+                                  &m->draw_buffer);
+    OWL_ASSERT(!ret);
+
+    ret = owl_model_bind_buffers(r, 1, &m->draw_buffer,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                 &m->draw_memory, &offset);
+    OWL_ASSERT(!ret);
+  }
+
+  {
+    VkBufferCopy copy;
+    uint64_t size;
+    void *data;
+    struct owl_renderer_upload_allocation allocation;
+
+    ret = owl_renderer_begin_im_command_buffer(r);
+    OWL_ASSERT(!ret);
+
+    size = m->num_draws * sizeof(*m->draws);
+    data = owl_renderer_upload_allocate(r, size, &allocation);
+    OWL_ASSERT(data);
+
+    OWL_MEMCPY(data, m->draws, size);
+
+    copy.srcOffset = 0;
+    copy.dstOffset = 0;
+    copy.size = size;
+
+    vkCmdCopyBuffer(r->im_command_buffer, allocation.buffer, m->draw_buffer, 1,
+                    &copy);
+
+    ret = owl_renderer_end_im_command_buffer(r);
+    OWL_ASSERT(!ret);
+
+    owl_renderer_upload_free(r, data);
+  }
+
+  return ret;
+}
+
+static void owl_model_deinit_draws(struct owl_renderer *r,
                                    struct owl_model *m) {
-  OWL_UNUSED(r);
-  OWL_UNUSED(m);
+  VkDevice const device = r->device;
+
+  OWL_FREE(m->draws);
+
+  if (!m->num_draws)
+    return;
+
+  vkDestroyBuffer(device, m->draw_buffer, NULL);
+  vkFreeMemory(device, m->draw_memory, NULL);
+}
+
+/* the per frame buffers of an instance, the node, culling and weight inputs
+ * are host visible, the commands and the skinned vertices are written on the
+ * gpu */
+static int owl_model_instance_init_frames(struct owl_renderer *r,
+                                          struct owl_model_instance *instance) {
+  int32_t i;
+  int32_t j;
+  VkBuffer buffers[4 * OWL_NUM_IN_FLIGHT_FRAMES];
+  uint64_t offsets[4 * OWL_NUM_IN_FLIGHT_FRAMES];
+  int ret = OWL_OK;
+  struct owl_model const *m = instance->model;
+  VkDevice const device = r->device;
+
+  {
+    uint8_t *data;
+    VkResult vk_result;
+    VkMemoryPropertyFlags properties = 0;
+    uint64_t const num_weights = OWL_MAX(1, m->num_weights);
+    OWL_UNUSED(vk_result);
+
+    properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    properties |= VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i) {
+      ret = owl_model_create_buffer(
+          r, m->num_nodes * sizeof(struct owl_model_node_ssbo),
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, &instance->node_buffers[i]);
+      OWL_ASSERT(!ret);
+
+      ret = owl_model_create_buffer(r, sizeof(struct owl_model_cull_ssbo),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    &instance->cull_buffers[i]);
+      OWL_ASSERT(!ret);
+
+      ret = owl_model_create_buffer(r, sizeof(struct owl_renderer_cull_stats),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    &instance->stats_buffers[i]);
+      OWL_ASSERT(!ret);
+
+      ret = owl_model_create_buffer(r, num_weights * sizeof(float),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    &instance->weight_buffers[i]);
+      OWL_ASSERT(!ret);
+
+      buffers[i * 4 + 0] = instance->node_buffers[i];
+      buffers[i * 4 + 1] = instance->cull_buffers[i];
+      buffers[i * 4 + 2] = instance->stats_buffers[i];
+      buffers[i * 4 + 3] = instance->weight_buffers[i];
+    }
+
+    ret = owl_model_bind_buffers(r, OWL_ARRAY_SIZE(buffers), buffers,
+                                 properties, &instance->frame_memory, offsets);
+    OWL_ASSERT(!ret);
+
+    vk_result = vkMapMemory(device, instance->frame_memory, 0, VK_WHOLE_SIZE, 0,
+                            (void **)&data);
+    OWL_ASSERT(!vk_result);
+
+    for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i) {
+      instance->mapped_nodes[i] = (void *)&data[offsets[i * 4 + 0]];
+      instance->mapped_culls[i] = (void *)&data[offsets[i * 4 + 1]];
+      instance->mapped_stats[i] = (void *)&data[offsets[i * 4 + 2]];
+      instance->mapped_weights[i] = (void *)&data[offsets[i * 4 + 3]];
+
+      OWL_MEMSET(instance->mapped_stats[i], 0,
+                 sizeof(*instance->mapped_stats[i]));
+      OWL_MEMSET(instance->mapped_weights[i], 0, num_weights * sizeof(float));
+      OWL_MEMCPY(instance->mapped_weights[i], instance->weights,
+                 m->num_weights * sizeof(float));
+
+      for (j = 0; j < m->num_nodes; ++j) {
+        int32_t const skin = m->node_skins[j];
+        struct owl_model_node_ssbo *ssbo = &instance->mapped_nodes[i][j];
+
+        OWL_M4_COPY(instance->world_matrices[j], ssbo->matrix);
+        ssbo->joints_offset = OWL_MAX(0, m->node_joints_offsets[j]);
+        if (-1 != skin && -1 != m->node_meshes[j])
+          ssbo->num_joints = m->skins[skin].num_joints;
+        else
+          ssbo->num_joints = 0;
+        ssbo->weights_offset = m->node_weights_offsets[j];
+        ssbo->num_weights = m->node_num_weights[j];
+        ssbo->lod = 0;
+        ssbo->padding[0] = 0;
+        ssbo->padding[1] = 0;
+        ssbo->padding[2] = 0;
+      }
+    }
+  }
+
+  {
+    VkBufferUsageFlags usage = 0;
+
+    usage |= VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i) {
+      ret = owl_model_create_buffer(
+          r, m->num_draws * sizeof(VkDrawIndexedIndirectCommand), usage,
+          &instance->indirect_buffers[i]);
+      OWL_ASSERT(!ret);
+
+      /* one counter per batch */
+      ret = owl_model_create_buffer(r, m->num_batches * sizeof(uint32_t),
+                                    usage, &instance->count_buffers[i]);
+      OWL_ASSERT(!ret);
+
+      buffers[i * 2 + 0] = instance->indirect_buffers[i];
+      buffers[i * 2 + 1] = instance->count_buffers[i];
+    }
+
+    ret = owl_model_bind_buffers(r, 2 * OWL_NUM_IN_FLIGHT_FRAMES, buffers,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                 &instance->indirect_memory, offsets);
+    OWL_ASSERT(!ret);
+  }
+
+  if (m->num_skin_jobs) {
+    VkBufferCopy copy;
+    VkBufferUsageFlags usage = 0;
+    uint64_t size = m->vertex_attributes_offset;
+
+    size += m->num_vertices * sizeof(struct owl_model_vertex_attributes);
+
+    usage |= VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i) {
+      ret = owl_model_create_buffer(r, size, usage,
+                                    &instance->skinned_vertex_buffers[i]);
+      OWL_ASSERT(!ret);
+
+      buffers[i] = instance->skinned_vertex_buffers[i];
+    }
+
+    ret = owl_model_bind_buffers(r, OWL_NUM_IN_FLIGHT_FRAMES, buffers,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                 &instance->skinned_vertex_memory, offsets);
+    OWL_ASSERT(!ret);
+
+    /* owl_skin.comp only rewrites positions and normals of skinned ranges */
+    ret = owl_renderer_begin_im_command_buffer(r);
+    OWL_ASSERT(!ret);
+
+    copy.srcOffset = 0;
+    copy.dstOffset = 0;
+    copy.size = size;
+
+    for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i)
+      vkCmdCopyBuffer(r->im_command_buffer, m->vertex_buffer,
+                      instance->skinned_vertex_buffers[i], 1, &copy);
+
+    ret = owl_renderer_end_im_command_buffer(r);
+    OWL_ASSERT(!ret);
+  }
+
+  {
+    VkDescriptorSetLayout layouts[OWL_NUM_IN_FLIGHT_FRAMES];
+    VkDescriptorSetAllocateInfo info;
+    VkResult vk_result;
+    OWL_UNUSED(vk_result);
+
+    for (i = 0; i < (int32_t)OWL_ARRAY_SIZE(layouts); ++i)
+      layouts[i] = r->model_storage_descriptor_set_layout;
+
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    info.pNext = NULL;
+    info.descriptorPool = r->descriptor_pool;
+    info.descriptorSetCount = OWL_ARRAY_SIZE(layouts);
+    info.pSetLayouts = layouts;
+
+    vk_result =
+        vkAllocateDescriptorSets(device, &info, instance->draw_descriptor_sets);
+    OWL_ASSERT(!vk_result);
+  }
+
+  for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i) {
+    VkDescriptorBufferInfo descriptors[10];
+    VkWriteDescriptorSet writes[10];
+
+    descriptors[0].buffer = m->draw_buffer;
+    descriptors[0].offset = 0;
+    descriptors[0].range = VK_WHOLE_SIZE;
+
+    descriptors[1].buffer = instance->node_buffers[i];
+    descriptors[1].offset = 0;
+    descriptors[1].range = VK_WHOLE_SIZE;
+
+    descriptors[2].buffer = instance->indirect_buffers[i];
+    descriptors[2].offset = 0;
+    descriptors[2].range = VK_WHOLE_SIZE;
+
+    descriptors[3].buffer = instance->count_buffers[i];
+    descriptors[3].offset = 0;
+    descriptors[3].range = VK_WHOLE_SIZE;
+
+    descriptors[4].buffer = instance->cull_buffers[i];
+    descriptors[4].offset = 0;
+    descriptors[4].range = VK_WHOLE_SIZE;
+
+    descriptors[5].buffer = instance->stats_buffers[i];
+    descriptors[5].offset = 0;
+    descriptors[5].range = VK_WHOLE_SIZE;
+
+    descriptors[6].buffer = m->target_buffer;
+    descriptors[6].offset = 0;
+    descriptors[6].range = VK_WHOLE_SIZE;
+
+    descriptors[7].buffer = instance->weight_buffers[i];
+    descriptors[7].offset = 0;
+    descriptors[7].range = VK_WHOLE_SIZE;
+
+    descriptors[8].buffer = m->vertex_buffer;
+    descriptors[8].offset = 0;
+    descriptors[8].range = VK_WHOLE_SIZE;
+
+    /* never written without skin jobs */
+    if (m->num_skin_jobs)
+      descriptors[9].buffer = instance->skinned_vertex_buffers[i];
+    else
+      descriptors[9].buffer = m->vertex_buffer;
+    descriptors[9].offset = 0;
+    descriptors[9].range = VK_WHOLE_SIZE;
+
+    for (j = 0; j < (int32_t)OWL_ARRAY_SIZE(writes); ++j) {
+      writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[j].pNext = NULL;
+      writes[j].dstSet = instance->draw_descriptor_sets[i];
+      writes[j].dstBinding = j;
+      writes[j].dstArrayElement = 0;
+      writes[j].descriptorCount = 1;
+      writes[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writes[j].pImageInfo = NULL;
+      writes[j].pBufferInfo = &descriptors[j];
+      writes[j].pTexelBufferView = NULL;
+    }
+
+    vkUpdateDescriptorSets(device, OWL_ARRAY_SIZE(writes), writes, 0, NULL);
+  }
+
+  return ret;
+}
+
+static void
+owl_model_instance_deinit_frames(struct owl_renderer *r,
+                                 struct owl_model_instance *instance) {
+  int32_t i;
+  struct owl_model const *m = instance->model;
+  VkDevice const device = r->device;
+
+  vkFreeDescriptorSets(device, r->descriptor_pool,
+                       OWL_ARRAY_SIZE(instance->draw_descriptor_sets),
+                       instance->draw_descriptor_sets);
+
+  if (m->num_skin_jobs) {
+    for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i)
+      vkDestroyBuffer(device, instance->skinned_vertex_buffers[i], NULL);
+
+    vkFreeMemory(device, instance->skinned_vertex_memory, NULL);
+  }
+
+  for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i) {
+    vkDestroyBuffer(device, instance->count_buffers[i], NULL);
+    vkDestroyBuffer(device, instance->indirect_buffers[i], NULL);
+    vkDestroyBuffer(device, instance->weight_buffers[i], NULL);
+    vkDestroyBuffer(device, instance->stats_buffers[i], NULL);
+    vkDestroyBuffer(device, instance->cull_buffers[i], NULL);
+    vkDestroyBuffer(device, instance->node_buffers[i], NULL);
+  }
+
+  vkFreeMemory(device, instance->indirect_memory, NULL);
+  vkFreeMemory(device, instance->frame_memory, NULL);
+}
+
+/* TODO(samuel): do a simplify pass */
+static int owl_model_load_skins(struct owl_renderer *r,
+                                struct cgltf_data const *gltf,
+                                struct owl_model *m) {
+  int32_t i;
+  int ret = OWL_OK;
+
+  OWL_UNUSED(r);
+
+  m->num_skins = (int32_t)gltf->skins_count;
+  for (i = 0; i < m->num_skins; ++i) {
+    int32_t j;
+    struct owl_model_skin *out_skin = &m->skins[i];
+    struct cgltf_skin const *in_skin = &gltf->skins[i];
+
+    owl_model_copy_name(in_skin->name, out_skin->name);
+
+    if (in_skin->skeleton)
+      out_skin->root = (int32_t)(in_skin->skeleton - gltf->nodes);
+    else
+      out_skin->root = -1;
+
+    out_skin->num_joints = (int32_t)in_skin->joints_count;
+    for (j = 0; j < out_skin->num_joints; ++j)
+      out_skin->joints[j] = (int32_t)(in_skin->joints[j] - gltf->nodes);
+
+    out_skin->num_inverse_bind_matrices = out_skin->num_joints;
+
+    if (in_skin->inverse_bind_matrices) {
+      struct cgltf_accessor *accessor;
+      owl_m4 const *matrices;
+
+      accessor = in_skin->inverse_bind_matrices;
+      matrices = owl_resolve_gltf_accessor(accessor);
+
+      OWL_ASSERT((int32_t)accessor->count >= out_skin->num_joints);
+
+      for (j = 0; j < out_skin->num_inverse_bind_matrices; ++j)
+        OWL_M4_COPY(matrices[j], out_skin->inverse_bind_matrices[j]);
+    } else {
+      for (j = 0; j < out_skin->num_inverse_bind_matrices; ++j)
+        OWL_M4_IDENTITY(out_skin->inverse_bind_matrices[j]);
+    }
+
+    /* allocate and write the descriptor sets */
+  }
+
+  return ret;
+}
+
+static void owl_model_unload_skins(struct owl_renderer *r,
+                                   struct owl_model *m) {
+  OWL_UNUSED(r);
+  OWL_UNUSED(m);
+}
+
+static int owl_model_load_animations(struct owl_renderer *r,
+                                     struct cgltf_data const *gltf,
+                                     struct owl_model *m) {
+  int32_t i;
+  int ret = OWL_OK;
+
+  OWL_UNUSED(r);
+
+  OWL_ASSERT(OWL_ANIMATION_INTERPOLATION_LINEAR ==
+             cgltf_interpolation_type_linear);
+  OWL_ASSERT(OWL_ANIMATION_INTERPOLATION_STEP == cgltf_interpolation_type_step);
+  OWL_ASSERT(OWL_ANIMATION_INTERPOLATION_CUBICSPLINE ==
+             cgltf_interpolation_type_cubic_spline);
+
+  OWL_ASSERT(OWL_ANIMATION_PATH_TRANSLATION ==
+             cgltf_animation_path_type_translation);
+  OWL_ASSERT(OWL_ANIMATION_PATH_ROTATION == cgltf_animation_path_type_rotation);
+  OWL_ASSERT(OWL_ANIMATION_PATH_SCALE == /*   */
+             cgltf_animation_path_type_scale);
+  OWL_ASSERT(OWL_ANIMATION_PATH_WEIGHTS == /*  */
+             cgltf_animation_path_type_weights);
+
+  m->num_samplers = 0;
+  m->num_channels = 0;
+
+  m->num_animations = (int32_t)gltf->animations_count;
+  for (i = 0; i < m->num_animations; ++i) {
+    int32_t j;
+    struct owl_model_animation *out_animation = &m->animations[i];
+    struct cgltf_animation const *in_animation = &gltf->animations[i];
+
+    out_animation->start = FLT_MAX;
+    out_animation->end = FLT_MIN;
+
+    owl_model_copy_name(in_animation->name, out_animation->name);
+
+    out_animation->first_sampler = m->num_samplers;
+    out_animation->num_samplers = (int32_t)in_animation->samplers_count;
+    for (j = 0; j < out_animation->num_samplers; ++j) {
+      int32_t k;
+      float const *inputs;
+      struct owl_model_animation_sampler *out_sampler;
+      struct cgltf_animation_sampler *in_sampler;
+
+      in_sampler = &in_animation->samplers[j];
+      out_sampler = &m->samplers[out_animation->first_sampler + j];
+
+      out_sampler->interpolation = in_sampler->interpolation;
+
+      /* FIXME(samuel): validate this component type */
+      OWL_ASSERT(in_sampler->input);
+      inputs = owl_resolve_gltf_accessor(in_sampler->input);
+
+      out_sampler->num_inputs = (int32_t)in_sampler->input->count;
+      for (k = 0; k < out_sampler->num_inputs; ++k) {
+        float const input = inputs[k];
+
+        if (input < out_animation->start)
+          out_animation->start = input;
+
+        if (input > out_animation->end)
+          out_animation->end = input;
+
+        out_sampler->inputs[k] = input;
+      }
+
+      out_sampler->num_outputs = (int32_t)in_sampler->output->count;
+      switch (in_sampler->output->type) {
+      case cgltf_type_vec3: {
+        owl_v3 const *outputs;
+        outputs = owl_resolve_gltf_accessor(in_sampler->output);
+
+        for (k = 0; k < out_sampler->num_outputs; ++k) {
+          OWL_V4_ZERO(out_sampler->outputs[k]);
+          OWL_V3_COPY(outputs[k], out_sampler->outputs[k]);
+        }
+      } break;
+
+      case cgltf_type_vec4: {
+        owl_v4 const *outputs;
+        outputs = owl_resolve_gltf_accessor(in_sampler->output);
+        for (k = 0; k < out_sampler->num_outputs; ++k) {
+          OWL_V4_COPY(outputs[k], out_sampler->outputs[k]);
+        }
+      } break;
+
+      /* morph target weights, one per output */
+      case cgltf_type_scalar: {
+        float const *outputs;
+        outputs = owl_resolve_gltf_accessor(in_sampler->output);
+        for (k = 0; k < out_sampler->num_outputs; ++k) {
+          OWL_V4_ZERO(out_sampler->outputs[k]);
+          out_sampler->outputs[k][0] = outputs[k];
+        }
+      } break;
+
+      case cgltf_type_invalid:
+      case cgltf_type_vec2:
+      case cgltf_type_mat2:
+      case cgltf_type_mat3:
+      case cgltf_type_mat4:
+        OWL_ASSERT(0);
+      }
+    }
+
+    m->num_samplers += out_animation->num_samplers;
+
+    out_animation->first_channel = m->num_channels;
+    out_animation->num_channels = in_animation->channels_count;
+    for (j = 0; j < out_animation->num_channels; ++j) {
+      int32_t id;
+      struct owl_model_animation_channel *out_channel;
+      struct cgltf_animation_channel *in_channel;
+
+      in_channel = &in_animation->channels[j];
+      out_channel = &m->channels[out_animation->first_channel + j];
+
+      out_channel->path = in_channel->target_path;
+      out_channel->node = (int32_t)(in_channel->target_node - gltf->nodes);
+
+      id = (int32_t)(in_channel->sampler - in_animation->samplers);
+      out_channel->sampler = out_animation->first_sampler + id;
+    }
+
+    m->num_channels += out_animation->num_channels;
+  }
+
+  return ret;
+}
+
+static void owl_model_unload_animations(struct owl_renderer *r,
+                                        struct owl_model *m) {
+  OWL_UNUSED(r);
+  OWL_UNUSED(m);
+}
+
+static int owl_model_load_roots(struct owl_renderer *r,
+                                struct cgltf_data const *gltf,
+                                struct owl_model *m) {
+  int32_t i;
+  int ret = OWL_OK;
+  struct cgltf_scene const *in_scene = gltf->scene;
+
+  OWL_UNUSED(r);
+
+  m->num_roots = in_scene->nodes_count;
+  for (i = 0; i < m->num_roots; ++i)
+    m->roots[i] = (int32_t)(in_scene->nodes[i] - gltf->nodes);
+
+  return ret;
+}
+
+static void owl_model_unload_roots(struct owl_renderer *r,
+                                   struct owl_model *m) {
+  OWL_UNUSED(r);
+  OWL_UNUSED(m);
+}
+
+/* bounding sphere around the rest pose bounds of every primitive, the world
+ * matrices of the embedded instance are the rest pose right after init */
+static void owl_model_init_bounds(struct owl_model *m) {
+  int32_t i;
+  int32_t j;
+  int32_t k;
+  owl_v3 min;
+  owl_v3 max;
+  int32_t empty = 1;
+
+  m->num_lods = 1;
+  for (i = 0; i < OWL_MODEL_MAX_LODS; ++i)
+    m->lod_errors[i] = 0.0F;
+
+  for (i = 0; i < m->num_nodes; ++i) {
+    float scale;
+    struct owl_model_mesh const *mesh;
+    owl_v4 *matrix = m->instance.world_matrices[i];
+
+    if (-1 == m->node_meshes[i])
+      continue;
+
+    mesh = &m->meshes[m->node_meshes[i]];
+
+    /* the errors are in the space of the node */
+    scale = OWL_MAX(owl_v3_magnitude(matrix[0]), owl_v3_magnitude(matrix[1]));
+    scale = OWL_MAX(scale, owl_v3_magnitude(matrix[2]));
+
+    m->num_lods = OWL_MAX(m->num_lods, mesh->num_lods);
+    for (j = 0; j < OWL_MODEL_MAX_LODS; ++j)
+      m->lod_errors[j] = OWL_MAX(m->lod_errors[j], scale * mesh->lod_errors[j]);
+
+    for (j = 0; j < mesh->num_primitives; ++j) {
+      struct owl_model_primitive const *primitive;
+
+      primitive = &m->primitives[mesh->first_primitive + j];
+
+      if (!primitive->bbox.valid)
+        continue;
+
+      for (k = 0; k < 8; ++k) {
+        int32_t l;
+        owl_v4 corner;
+        owl_v4 position;
+
+        corner[0] = (1 & k) ? primitive->bbox.max[0] : primitive->bbox.min[0];
+        corner[1] = (2 & k) ? primitive->bbox.max[1] : primitive->bbox.min[1];
+        corner[2] = (4 & k) ? primitive->bbox.max[2] : primitive->bbox.min[2];
+        corner[3] = 1.0F;
+
+        owl_m4_multiply_v4(m->instance.world_matrices[i], corner, position);
+
+        if (empty) {
+          OWL_V3_COPY(position, min);
+          OWL_V3_COPY(position, max);
+          empty = 0;
+        }
+
+        for (l = 0; l < 3; ++l) {
+          min[l] = OWL_MIN(min[l], position[l]);
+          max[l] = OWL_MAX(max[l], position[l]);
+        }
+      }
+    }
+  }
+
+  if (empty) {
+    OWL_V3_ZERO(m->bounding_center);
+    m->bounding_radius = 0.0F;
+    return;
+  }
+
+  m->bounding_center[0] = (min[0] + max[0]) * 0.5F;
+  m->bounding_center[1] = (min[1] + max[1]) * 0.5F;
+  m->bounding_center[2] = (min[2] + max[2]) * 0.5F;
+  m->bounding_radius = owl_v3_distance(min, max) * 0.5F;
+}
+
+#define OWL_PATH_SEPARATOR '/'
+
+static void owl_model_set_path(struct owl_model *model, char const *path) {
+  uint32_t end = 0;
+  uint64_t const max_length = sizeof(model->directory);
+
+  OWL_STRNCPY(model->path, path, sizeof(model->path));
+  OWL_STRNCPY(model->directory, path, sizeof(model->path));
+
+  while ('\0' != model->directory[end] && end < max_length)
+    ++end;
+
+  while (OWL_PATH_SEPARATOR != model->directory[end] && end)
+    --end;
+
+  model->directory[end] = '\0';
+}
+
+static int owl_model_init_empty_texture(struct owl_renderer *r,
+                                        struct owl_model *model) {
+  struct owl_texture_desc empty_desc;
+
+  OWL_MEMSET(&empty_desc, 0, sizeof(empty_desc));
+
+  empty_desc.source = OWL_TEXTURE_SOURCE_FILE;
+  empty_desc.path = "../../res/none.png";
+
+  return owl_texture_init(r, &empty_desc, &model->empty_texture);
+}
+
+/* the files cgltf reads are mapped instead of copied, the buffers point
+ * straight into the mappings. its release callback only gets the data back,
+ * the mappings are kept here to find their size */
+struct owl_model_gltf_files {
+  int32_t num_files;
+  int32_t max_files;
+  struct owl_plataform_file *files;
+};
+
+static cgltf_result
+owl_model_gltf_read(struct cgltf_memory_options const *memory_options,
+                    struct cgltf_file_options const *file_options,
+                    char const *path, cgltf_size *size, void **data) {
+  struct owl_plataform_file file;
+  struct owl_model_gltf_files *files = file_options->user_data;
+
+  OWL_UNUSED(memory_options);
+
+  if (files->num_files == files->max_files) {
+    int32_t const max_files = OWL_MAX(4, files->max_files * 2);
+    struct owl_plataform_file *grown;
+
+    grown = OWL_REALLOC(files->files, max_files * sizeof(*grown));
+    if (!grown)
+      return cgltf_result_out_of_memory;
+
+    files->files = grown;
+    files->max_files = max_files;
+  }
+
+  if (owl_plataform_load_file(path, &file))
+    return cgltf_result_file_not_found;
+
+  /* cgltf owns the path */
+  file.path = NULL;
+  files->files[files->num_files++] = file;
+
+  *size = file.size;
+  *data = file.data;
+
+  return cgltf_result_success;
+}
+
+static void
+owl_model_gltf_release(struct cgltf_memory_options const *memory_options,
+                       struct cgltf_file_options const *file_options,
+                       void *data) {
+  int32_t i;
+  struct owl_model_gltf_files *files = file_options->user_data;
+
+  OWL_UNUSED(memory_options);
+
+  for (i = 0; i < files->num_files; ++i) {
+    if (data == files->files[i].data) {
+      owl_plataform_unload_file(&files->files[i]);
+      files->files[i] = files->files[--files->num_files];
+      return;
+    }
+  }
+}
+
+/* cgltf_free and the mappings of the gltf */
+static void owl_model_free_gltf(struct cgltf_data *gltf) {
+  struct owl_model_gltf_files *files = gltf->file.user_data;
+
+  cgltf_free(gltf);
+
+  OWL_ASSERT(!files->num_files);
+  OWL_FREE(files->files);
+  OWL_FREE(files);
+}
+
+/* the part of the load owl_model_init and owl_model_cook share, parses the
+ * gltf into the model and the geometry into all_primitives. the only gpu
+ * state is the upload buffer of r the vertices are written to, if there is
+ * one. the gltf is kept around for its images */
+static int owl_model_import(struct owl_renderer *r,
+                            struct owl_model_import_options const *options,
+                            char const *path, struct owl_model *model,
+                            struct cgltf_data **gltf,
+                            struct owl_model_all_primitives *all_primitives) {
+  struct cgltf_options parse_options;
+  struct owl_model_gltf_files *files;
+  struct cgltf_data *data = NULL;
+
+  int ret = OWL_OK;
+
+  files = OWL_MALLOC(sizeof(*files));
+  if (!files)
+    return OWL_ERROR_NO_MEMORY;
+
+  files->num_files = 0;
+  files->max_files = 0;
+  files->files = NULL;
+
+  OWL_MEMSET(&parse_options, 0, sizeof(parse_options));
+  parse_options.file.read = owl_model_gltf_read;
+  parse_options.file.release = owl_model_gltf_release;
+  parse_options.file.user_data = files;
+
+  owl_model_set_path(model, path);
+
+  if (cgltf_result_success != cgltf_parse_file(&parse_options, path, &data)) {
+    OWL_DEBUG_LOG("Filed to parse gltf file!");
+    OWL_FREE(files->files);
+    OWL_FREE(files);
+    return OWL_ERROR_FATAL;
+  }
+
+  if (cgltf_result_success != cgltf_load_buffers(&parse_options, data, path)) {
+    OWL_DEBUG_LOG("Filed to parse load gltf buffers!");
+    owl_model_free_gltf(data);
+    return OWL_ERROR_FATAL;
+  }
+
+  {
+    struct owl_model_storage storage;
+
+    storage.size = 0;
+    storage.data = NULL;
+    owl_model_layout_storage(data, &storage, model);
+
+    storage.data = OWL_MALLOC(OWL_MAX(1, storage.size));
+    if (!storage.data) {
+      owl_model_free_gltf(data);
+      return OWL_ERROR_NO_MEMORY;
+    }
+
+    /* cooked as is, keep the padding and the gpu handles deterministic */
+    OWL_MEMSET(storage.data, 0, OWL_MAX(1, storage.size));
+
+    model->storage_size = storage.size;
+
+    storage.size = 0;
+    owl_model_layout_storage(data, &storage, model);
+
+    model->storage = storage.data;
+  }
+
+  model->num_images = (int32_t)data->images_count;
+
+  /* none of the loads below touch the renderer */
+  ret = owl_model_load_textures(NULL, data, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_load_materials(NULL, data, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_init_all_primitives(all_primitives, data, r);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_load_skins(NULL, data, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_load_nodes(NULL, data, all_primitives, model);
+  if (ret) {
+    owl_model_deinit_all_primitives(all_primitives);
+    OWL_FREE(model->storage);
+    model->storage = NULL;
+    owl_model_free_gltf(data);
+    return ret;
+  }
+
+  if (options->optimize_meshes) {
+    ret = owl_model_optimize_primitives(all_primitives, model);
+    OWL_ASSERT(!ret);
+  }
+
+  ret = owl_model_init_lods(options, all_primitives, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_init_meshlets(options, all_primitives, model);
+  OWL_ASSERT(!ret);
+
+  owl_model_init_node_order(model);
+
+  ret = owl_model_load_animations(NULL, data, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_load_roots(NULL, data, model);
+  OWL_ASSERT(!ret);
+
+  *gltf = data;
+
+  return ret;
+}
+
+static void
+owl_model_init_import_options(struct owl_renderer const *r,
+                              struct owl_model_import_options *options) {
+  options->optimize_meshes = r->optimize_meshes;
+  options->generate_lods = r->generate_lods;
+  /* a draw per meshlet is only cheap with multi draw indirect */
+  options->build_meshlets = r->has_multi_draw_indirect;
+}
+
+/* TODO(samuel): cleanup on error */
+OWLAPI int owl_model_init(struct owl_model *model, struct owl_renderer *r,
+                          char const *path) {
+  struct owl_model_import_options options;
+  struct cgltf_data *data = NULL;
+  struct owl_model_all_primitives all_primitives;
+
+  int ret = OWL_OK;
+
+  OWL_MEMSET(model, 0, sizeof(*model));
+
+  ret = owl_model_init_empty_texture(r, model);
+  OWL_ASSERT(!ret);
+
+  owl_model_init_import_options(r, &options);
+
+  ret = owl_model_import(r, &options, path, model, &data, &all_primitives);
+  if (ret)
+    goto out;
+
+  /* first, the vertices hold the upload buffer */
+  ret = owl_model_init_buffers(r, &all_primitives, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_init_targets(r, all_primitives.targets,
+                               all_primitives.num_targets, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_load_images(r, data, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_init_material_sets(r, model);
+  OWL_ASSERT(!ret);
+
+  ret = owl_model_init_draws(r, model);
+  OWL_ASSERT(!ret);
+
+  owl_model_deinit_all_primitives(&all_primitives);
+
+  owl_model_free_gltf(data);
+
+  ret = owl_model_instance_init(&model->instance, r, model);
+  OWL_ASSERT(!ret);
+
+  owl_model_init_bounds(model);
+
+out:
+  return ret;
+}
+
+/* everything but the instance, tolerates a model only partly set up */
+static void owl_model_unload(struct owl_renderer *r, struct owl_model *model) {
+  vkDeviceWaitIdle(r->device);
+  owl_model_unload_roots(r, model);
+  owl_model_unload_animations(r, model);
+  owl_model_unload_skins(r, model);
+  owl_model_deinit_draws(r, model);
+  owl_model_deinit_meshlets(r, model);
+  owl_model_deinit_targets(r, model);
+  owl_model_deinit_buffers(r, model);
+  owl_model_unload_nodes(r, model);
+  owl_model_unload_materials(r, model);
+  owl_model_unload_textures(r, model);
+  owl_model_unload_images(r, model);
+  owl_texture_deinit(r, &model->empty_texture);
+  OWL_FREE(model->storage);
+  model->storage = NULL;
+}
+
+/* allocates the pose of an instance and sets it to the rest pose, no gpu
+ * state */
+static int owl_model_instance_init_pose(struct owl_model_instance *instance,
+                                        struct owl_model *model) {
+  int32_t i;
+  struct owl_model_storage storage;
+
+  OWL_MEMSET(instance, 0, sizeof(*instance));
+
+  instance->model = model;
+
+  storage.size = 0;
+  storage.data = NULL;
+  owl_model_instance_layout_storage(model, &storage, instance);
+
+  storage.data = OWL_MALLOC(OWL_MAX(1, storage.size));
+  if (!storage.data)
+    return OWL_ERROR_NO_MEMORY;
+
+  storage.size = 0;
+  owl_model_instance_layout_storage(model, &storage, instance);
+
+  instance->storage = storage.data;
+
+  /* starts at the rest pose */
+  OWL_MEMCPY(instance->node_translations, model->node_translations,
+             model->num_nodes * sizeof(owl_v3));
+  OWL_MEMCPY(instance->node_rotations, model->node_rotations,
+             model->num_nodes * sizeof(owl_v4));
+  OWL_MEMCPY(instance->node_scales, model->node_scales,
+             model->num_nodes * sizeof(owl_v3));
+  OWL_MEMCPY(instance->weights, model->weights,
+             model->num_weights * sizeof(float));
+
+  for (i = 0; i < model->num_nodes; ++i)
+    instance->dirty_nodes[i] = OWL_MODEL_NODE_LOCAL_DIRTY;
+
+  for (i = 0; i < model->num_animations; ++i)
+    instance->animation_times[i] = 0.0F;
+
+  for (i = 0; i < model->num_channels; ++i)
+    instance->keyframes[i] = 0;
+
+  owl_model_update_transforms(instance);
+
+  instance->animation_lod = OWL_MODEL_ANIMATION_LOD_FULL;
+  instance->lod_elapsed = 0.0F;
+  instance->lod_interval = 0.0F;
+
+  /* nothing has been skinned yet */
+  instance->pose_version = 1;
+  for (i = 0; i < OWL_NUM_IN_FLIGHT_FRAMES; ++i)
+    instance->skinned_pose_versions[i] = 0;
+
+  return OWL_OK;
+}
+
+/* owl_model_instance_init without the check, the last step of
+ * owl_model_load_async sets up the instance of the model still loading */
+static int owl_model_init_instance(struct owl_model_instance *instance,
+                                   struct owl_renderer *r,
+                                   struct owl_model *model) {
+  int ret = OWL_OK;
+
+  ret = owl_model_instance_init_pose(instance, model);
+  if (ret)
+    return ret;
+
+  instance->joints_frame = (uint64_t)-1;
+  instance->draw_frame = (uint64_t)-1;
+
+  if (model->num_draws) {
+    ret = owl_model_instance_init_frames(r, instance);
+    if (ret) {
+      OWL_FREE(instance->storage);
+      return ret;
+    }
+  }
+
+  return OWL_OK;
+}
+
+/* owl_model::loading while a owl_model_load_async is in flight. the task
+ * imports the gltf without a renderer and decodes the images, reporting 1
+ * once imported and one more per decoded image. owl_model_update_load does
+ * the gpu side one step at a time as the task gets there: the buffers, an
+ * image per step and then the rest */
+struct owl_model_loader {
+  char path[256];
+  struct owl_model_import_options options;
+  int32_t num_threads;
+
+  struct owl_thread_task task;
+  /* the task hasn't been joined yet */
+  int32_t running;
+  int ret;
+
+  struct cgltf_data *gltf;
+  struct owl_model_all_primitives all_primitives;
+  struct owl_model_image_job images;
+
+  int32_t num_steps;
+  /* the uploads of the last step, the next step waits for them */
+  struct owl_renderer_im_batch batch;
+
+  /* a step failed, everything the load got to was torn down and ret is
+   * returned from then on */
+  int32_t failed;
+};
+
+/* runs on the thread that finished decoding the image */
+static void owl_model_publish_image(void *data, int32_t i) {
+  struct owl_model_image_job *job = data;
+
+  job->order[job->num_decoded++] = i;
+
+  owl_thread_task_report(job->task, 1 + job->num_decoded);
+}
+
+static void owl_model_run_load(void *data) {
+  struct owl_thread_pool pool;
+  struct owl_model_loader *loader = data;
+  int32_t num_images;
+  struct owl_model_image_job *job = &loader->images;
+
+  loader->ret = owl_model_import(NULL, &loader->options, loader->path, job->m,
+                                 &loader->gltf, &loader->all_primitives);
+  if (loader->ret)
+    return;
+
+  num_images = OWL_MAX(1, job->m->num_images);
+
+  job->gltf = loader->gltf;
+  job->images = OWL_MALLOC(num_images * sizeof(*job->images));
+  OWL_ASSERT(job->images);
+  job->order = OWL_MALLOC(num_images * sizeof(*job->order));
+  OWL_ASSERT(job->order);
+
+  owl_thread_task_report(&loader->task, 1);
+
+  loader->ret = owl_thread_pool_init(&pool, OWL_MIN(loader->num_threads,
+                                                    num_images));
+  OWL_ASSERT(!loader->ret);
+
+  loader->ret = owl_thread_pool_pipeline(&pool, job->m->num_images,
+                                         owl_model_decode_image,
+                                         owl_model_publish_image, job);
+  OWL_ASSERT(!loader->ret);
+
+  owl_thread_pool_deinit(&pool);
+}
+
+OWLAPI int owl_model_load_async(struct owl_model *model,
+                                struct owl_renderer *r, char const *path) {
+  struct owl_model_loader *loader;
+  int ret = OWL_OK;
+
+  OWL_MEMSET(model, 0, sizeof(*model));
+
+  loader = OWL_MALLOC(sizeof(*loader));
+  if (!loader)
+    return OWL_ERROR_NO_MEMORY;
+
+  OWL_MEMSET(loader, 0, sizeof(*loader));
+
+  OWL_STRNCPY(loader->path, path, sizeof(loader->path));
+  loader->path[sizeof(loader->path) - 1] = '\0';
+
+  owl_model_init_import_options(r, &loader->options);
+  loader->num_threads = r->num_load_threads;
+
+  loader->images.r = r;
+  loader->images.m = model;
+  loader->images.compress = r->compress_textures &&
+                            r->has_texture_compression_bc;
+  loader->images.task = &loader->task;
+
+  model->loading = loader;
+
+  ret = owl_thread_task_init(&loader->task, owl_model_run_load, loader);
+  if (ret) {
+    model->loading = NULL;
+    OWL_FREE(loader);
+    return ret;
+  }
+
+  loader->running = 1;
+
+  return ret;
+}
+
+/* tears down everything the load got to, the gpu side included, and leaves
+ * the loader failed with ret */
+static int owl_model_fail_load(struct owl_model *model, struct owl_renderer *r,
+                               int ret) {
+  int32_t i;
+  struct owl_model_loader *loader = model->loading;
+  struct owl_model_image_job *job = &loader->images;
+
+  owl_renderer_wait_im_batch(r, &loader->batch);
+
+  /* the images may still be decoding */
+  if (loader->running) {
+    owl_thread_task_deinit(&loader->task);
+    loader->running = 0;
+  }
+
+  if (job->order)
+    for (i = 0; i < job->num_decoded; ++i)
+      owl_model_free_decoded_image(&job->images[job->order[i]]);
+
+  OWL_FREE(job->order);
+  OWL_FREE(job->images);
+  job->order = NULL;
+  job->images = NULL;
+
+  owl_model_deinit_all_primitives(&loader->all_primitives);
+
+  if (loader->gltf)
+    owl_model_free_gltf(loader->gltf);
+  loader->gltf = NULL;
+
+  owl_model_unload(r, model);
+
+  loader->failed = 1;
+  loader->ret = ret;
+
+  return ret;
+}
+
+/* the last step, everything but the images */
+static int owl_model_load_rest(struct owl_model *model,
+                               struct owl_renderer *r) {
+  struct owl_model_loader *loader = model->loading;
+  int ret = OWL_OK;
+
+  owl_thread_task_deinit(&loader->task);
+  loader->running = 0;
+
+  ret = owl_model_init_material_sets(r, model);
+  if (ret)
+    return ret;
+
+  ret = owl_model_init_draws(r, model);
+  if (ret)
+    return ret;
+
+  owl_model_deinit_all_primitives(&loader->all_primitives);
+
+  owl_model_free_gltf(loader->gltf);
+  loader->gltf = NULL;
+
+  OWL_FREE(loader->images.order);
+  OWL_FREE(loader->images.images);
+  loader->images.order = NULL;
+  loader->images.images = NULL;
+
+  ret = owl_model_init_instance(&model->instance, r, model);
+  if (ret)
+    return ret;
+
+  owl_model_init_bounds(model);
+
+  return ret;
+}
+
+OWLAPI int owl_model_update_load(struct owl_model *model,
+                                 struct owl_renderer *r) {
+  int done;
+  int32_t progress;
+  int32_t last_step;
+  struct owl_model_loader *loader = model->loading;
+  int ret = OWL_OK;
+
+  if (!loader)
+    return OWL_OK;
+
+  if (loader->failed)
+    return loader->ret;
+
+  /* the uploads of the last step are still in flight */
+  if (!owl_renderer_im_batch_done(r, &loader->batch))
+    return OWL_OK;
+
+  last_step = model->num_images + 1;
+
+  /* the gpu is done with the last step, the model is resident */
+  if (loader->num_steps > last_step) {
+    OWL_FREE(loader);
+    model->loading = NULL;
+
+    return OWL_OK;
+  }
+
+  done = owl_thread_task_done(&loader->task);
+  progress = owl_thread_task_progress(&loader->task);
+
+  /* the import failed, nothing is on the gpu yet */
+  if (!progress) {
+    if (!done)
+      return OWL_OK;
+
+    return owl_model_fail_load(model, r, loader->ret);
+  }
+
+  /* the image isn't decoded yet or the pool may still be shutting down */
+  if (loader->num_steps && loader->num_steps < last_step) {
+    if (progress < 1 + loader->num_steps)
+      return OWL_OK;
+  } else if (loader->num_steps && !done) {
+    return OWL_OK;
+  }
+
+  /* the uploads of the step are submitted once at the end of it and the
+   * next step polls for them */
+  ret = owl_renderer_begin_im_batch(r, &loader->batch);
+  if (ret)
+    return owl_model_fail_load(model, r, ret);
+
+  if (!loader->num_steps) {
+    ret = owl_model_init_empty_texture(r, model);
+
+    if (!ret)
+      ret = owl_model_init_buffers(r, &loader->all_primitives, model);
+
+    if (!ret)
+      ret = owl_model_init_targets(r, loader->all_primitives.targets,
+                                   loader->all_primitives.num_targets, model);
+  } else if (loader->num_steps < last_step) {
+    int32_t const i = loader->num_steps - 1;
+
+    owl_model_upload_image(&loader->images, loader->images.order[i]);
+
+    ret = loader->images.ret;
+  } else {
+    ret = owl_model_load_rest(model, r);
+  }
+
+  if (ret) {
+    owl_renderer_end_im_batch(r);
+    return owl_model_fail_load(model, r, ret);
+  }
+
+  ret = owl_renderer_end_im_batch(r);
+  if (ret) {
+    /* the instance is the last thing the last step sets up */
+    if (last_step == loader->num_steps)
+      owl_model_instance_deinit(&model->instance, r);
+
+    return owl_model_fail_load(model, r, ret);
+  }
+
+  ++loader->num_steps;
+
+  return OWL_OK;
+}
+
+OWLAPI float owl_model_load_progress(struct owl_model *model) {
+  int32_t progress;
+  struct owl_model_loader *loader = model->loading;
+
+  if (!loader)
+    return 1.0F;
+
+  if (loader->failed)
+    return 0.0F;
+
+  /* the task is joined by the last step */
+  if (loader->running)
+    progress = owl_thread_task_progress(&loader->task);
+  else
+    progress = 1 + model->num_images;
+
+  if (!progress)
+    return 0.0F;
+
+  /* the import, a decode and an upload per image, the buffers and the
+   * rest */
+  return (float)(progress + loader->num_steps) /
+         (float)(2 * model->num_images + 3);
+}
+
+OWLAPI int owl_model_finish_load(struct owl_model *model,
+                                 struct owl_renderer *r) {
+  struct owl_model_loader *loader = model->loading;
+  int ret = OWL_OK;
+
+  if (!loader)
+    return OWL_OK;
+
+  if (loader->failed)
+    return loader->ret;
+
+  if (loader->running)
+    owl_thread_task_wait(&loader->task);
+
+  /* every step is ready now, only the uploads are waited on */
+  while (!ret && model->loading) {
+    owl_renderer_wait_im_batch(r, &loader->batch);
+    ret = owl_model_update_load(model, r);
+  }
+
+  return ret;
+}
+
+/* "OWLM" read as a little endian uint32_t */
+#define OWL_MODEL_COOKED_MAGIC 0x4D4C574FU
+#define OWL_MODEL_COOKED_VERSION 2
+#define OWL_MODEL_COOKED_ALIGNMENT 16
+
+struct owl_model_cooked_section {
+  uint64_t offset;
+  uint64_t size;
+};
+
+/* every mipmap level one after the other, in the uncompressed format and
+ * swizzle owl_model_choose_image_format picks */
+struct owl_model_cooked_image {
+  uint32_t width;
+  uint32_t height;
+  uint32_t mipmaps;
+  uint32_t format;
+  uint32_t swizzle;
+  uint32_t padding[3];
+  struct owl_model_cooked_section pixels;
+};
+
+/* the start of a cooked model, the sections are aligned to
+ * OWL_MODEL_COOKED_ALIGNMENT from the start of the file. the storage is
+ * written as it is in memory with the offsets of its pointers next to it, a
+ * cooked model only loads in builds where the sizes match. the vertices and
+ * the indices are the contents of the vertex and index buffers */
+struct owl_model_cooked_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t sizes[8];
+
+  int32_t num_roots;
+  int32_t num_nodes;
+  int32_t num_weights;
+  int32_t num_images;
+  int32_t num_textures;
+  int32_t num_materials;
+  int32_t num_meshes;
+  int32_t num_primitives;
+  int32_t num_meshlets;
+  int32_t num_skins;
+  int32_t num_samplers;
+  int32_t num_channels;
+  int32_t num_animations;
+  int32_t num_vertices;
+  int32_t num_indices;
+  int32_t num_targets;
+  int32_t index_type;
+  int32_t num_offsets;
+
+  struct owl_model_cooked_section storage;
+  struct owl_model_cooked_section offsets;
+  struct owl_model_cooked_section meshlets;
+  struct owl_model_cooked_section vertices;
+  struct owl_model_cooked_section indices;
+  struct owl_model_cooked_section targets;
+  struct owl_model_cooked_section images;
+};
+
+static void owl_model_cooked_sizes(uint32_t *sizes) {
+  sizes[0] = sizeof(void *);
+  sizes[1] = sizeof(struct owl_model_node);
+  sizes[2] = sizeof(struct owl_model_mesh);
+  sizes[3] = sizeof(struct owl_model_primitive);
+  sizes[4] = sizeof(struct owl_model_material);
+  sizes[5] = sizeof(struct owl_model_skin);
+  sizes[6] = sizeof(struct owl_model_animation_sampler);
+  sizes[7] = sizeof(struct owl_model_image);
+}
+
+/* whether count elements of size bytes at offset lie inside the storage, the
+ * arrays that are empty may start right at its end */
+static int owl_model_storage_fits(struct owl_model const *m, uint64_t offset,
+                                  int32_t count, uint64_t size) {
+  return 0 <= count && offset <= m->storage_size &&
+         (uint64_t)count * size <= m->storage_size - offset;
+}
+
+/* whether a name at offset ends inside the storage */
+static int owl_model_storage_name_fits(struct owl_model const *m,
+                                       uint64_t offset) {
+  uint8_t const *storage = m->storage;
+
+  if (offset >= m->storage_size)
+    return 0;
+
+  return NULL != OWL_MEMCHR(&storage[offset], '\0',
+                            m->storage_size - offset);
+}
+
+/* loading returns -1 from owl_model_walk_storage as soon as a pointer, or
+ * the count elements it points to, falls outside the storage */
+#define OWL_MODEL_STORAGE_POINTER(pointer, count)                              \
+  do {                                                                         \
+    if (offsets && load) {                                                     \
+      if (!owl_model_storage_fits(m, offsets[num_offsets], (count),            \
+                                  sizeof(*(pointer))))                         \
+        return -1;                                                             \
+      (pointer) = (void *)&storage[offsets[num_offsets]];                      \
+    } else if (offsets) {                                                      \
+      offsets[num_offsets] = (uint64_t)((uint8_t *)(pointer) - storage);       \
+    }                                                                          \
+    ++num_offsets;                                                             \
+  } while (0)
+
+#define OWL_MODEL_STORAGE_NAME(pointer)                                        \
+  do {                                                                         \
+    if (offsets && load &&                                                     \
+        !owl_model_storage_name_fits(m, offsets[num_offsets]))                 \
+      return -1;                                                               \
+    OWL_MODEL_STORAGE_POINTER(pointer, 1);                                     \
+  } while (0)
+
+/* visits every pointer into the storage in the same order, cooking stores
+ * where they point to in offsets and loading points them back. only counts
+ * them if offsets is NULL */
+static int32_t owl_model_walk_storage(struct owl_model *m, uint64_t *offsets,
+                                      int32_t load) {
+  int32_t i;
+  int32_t num_offsets = 0;
+  uint8_t *storage = m->storage;
+
+  OWL_MODEL_STORAGE_POINTER(m->node_order, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_parents, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_meshes, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_skins, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_joints_offsets, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_weights_offsets, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_num_weights, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_translations, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_rotations, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_scales, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->node_matrices, m->num_nodes);
+  OWL_MODEL_STORAGE_POINTER(m->weights, m->num_weights);
+  OWL_MODEL_STORAGE_POINTER(m->batches, m->num_materials);
+  OWL_MODEL_STORAGE_POINTER(m->skin_jobs, m->num_primitives);
+  OWL_MODEL_STORAGE_POINTER(m->primitives, m->num_primitives);
+  OWL_MODEL_STORAGE_POINTER(m->meshes, m->num_meshes);
+  OWL_MODEL_STORAGE_POINTER(m->materials, m->num_materials);
+  OWL_MODEL_STORAGE_POINTER(m->textures, m->num_textures);
+  OWL_MODEL_STORAGE_POINTER(m->images, m->num_images);
+  OWL_MODEL_STORAGE_POINTER(m->skins, m->num_skins);
+  OWL_MODEL_STORAGE_POINTER(m->channels, m->num_channels);
+  OWL_MODEL_STORAGE_POINTER(m->samplers, m->num_samplers);
+  OWL_MODEL_STORAGE_POINTER(m->animations, m->num_animations);
+  OWL_MODEL_STORAGE_POINTER(m->roots, m->num_roots);
+  OWL_MODEL_STORAGE_POINTER(m->nodes, m->num_nodes);
+
+  if (!offsets) {
+    return num_offsets + 2 * m->num_nodes + 3 * m->num_skins +
+           2 * m->num_samplers + m->num_animations;
+  }
+
+  /* the counts below were loaded with the arrays above */
+  for (i = 0; i < m->num_nodes; ++i) {
+    OWL_MODEL_STORAGE_POINTER(m->nodes[i].children, m->nodes[i].num_children);
+    OWL_MODEL_STORAGE_NAME(m->nodes[i].name);
+  }
+
+  for (i = 0; i < m->num_skins; ++i) {
+    OWL_MODEL_STORAGE_POINTER(m->skins[i].inverse_bind_matrices,
+                              m->skins[i].num_inverse_bind_matrices);
+    OWL_MODEL_STORAGE_POINTER(m->skins[i].joints, m->skins[i].num_joints);
+    OWL_MODEL_STORAGE_NAME(m->skins[i].name);
+  }
+
+  for (i = 0; i < m->num_samplers; ++i) {
+    OWL_MODEL_STORAGE_POINTER(m->samplers[i].inputs,
+                              m->samplers[i].num_inputs);
+    OWL_MODEL_STORAGE_POINTER(m->samplers[i].outputs,
+                              m->samplers[i].num_outputs);
+  }
+
+  for (i = 0; i < m->num_animations; ++i)
+    OWL_MODEL_STORAGE_NAME(m->animations[i].name);
+
+  return num_offsets;
+}
+
+#undef OWL_MODEL_STORAGE_NAME
+#undef OWL_MODEL_STORAGE_POINTER
+
+/* writes size bytes at the next aligned offset of the file */
+static int owl_model_cook_write(FILE *file, void const *data, uint64_t size,
+                                uint64_t *offset,
+                                struct owl_model_cooked_section *section) {
+  static uint8_t const zeros[OWL_MODEL_COOKED_ALIGNMENT] = {0};
+  uint64_t const aligned = OWL_ALIGN_UP_2(*offset,
+                                          OWL_MODEL_COOKED_ALIGNMENT);
+
+  if (aligned != *offset && 1 != fwrite(zeros, aligned - *offset, 1, file))
+    return OWL_ERROR_FATAL;
+
+  if (size && 1 != fwrite(data, size, 1, file))
+    return OWL_ERROR_FATAL;
+
+  section->offset = aligned;
+  section->size = size;
+  *offset = aligned + size;
+
+  return OWL_OK;
+}
+
+/* decodes the images and writes them with every mipmap level */
+static int owl_model_cook_images(struct cgltf_data const *gltf,
+                                 struct owl_model *m, FILE *file,
+                                 uint64_t *offset,
+                                 struct owl_model_cooked_image *images) {
+  int32_t i;
+  int ret = OWL_OK;
+
+  for (i = 0; i < m->num_images; ++i) {
+    int width;
+    int height;
+    uint8_t *data;
+    uint8_t *levels;
+    uint64_t size;
+    struct owl_model_uri uri;
+    struct owl_model_image_format format;
+    struct owl_model_cooked_image *image = &images[i];
+
+    ret = owl_model_get_real_uri(m, gltf->images[i].uri, &uri);
+    if (ret)
+      return ret;
+
+    OWL_DEBUG_LOG("  cooking %s\n", uri.path);
+
+    data = owl_texture_decode_file(uri.path, &width, &height);
+    if (!data)
+      return OWL_ERROR_NOT_FOUND;
+
+    owl_model_choose_image_format(gltf, i, &format);
+
+    image->width = width;
+    image->height = height;
+    image->mipmaps = owl_texture_calculate_mipmaps(width, height);
+    image->format = format.format;
+    image->swizzle = format.swizzle;
+    OWL_MEMSET(image->padding, 0, sizeof(image->padding));
+
+    /* the levels are built with every channel and packed after */
+    size = owl_texture_levels_size(OWL_RGBA8_SRGB, width, height,
+                                   image->mipmaps);
+
+    levels = OWL_MALLOC(size);
+    if (!levels) {
+      stbi_image_free(data);
+      return OWL_ERROR_NO_MEMORY;
+    }
+
+    OWL_MEMCPY(levels, data, (uint64_t)width * height * 4);
+    stbi_image_free(data);
+
+    owl_texture_build_mipmaps(width, height, image->mipmaps,
+                              OWL_RGBA8_SRGB == format.format, levels);
+    owl_texture_pack_channels(size / 4, format.first_channel,
+                              format.num_channels, levels);
+
+    size = owl_texture_levels_size(format.format, width, height,
+                                   image->mipmaps);
+
+    ret = owl_model_cook_write(file, levels, size, offset, &image->pixels);
+
+    OWL_FREE(levels);
+
+    if (ret)
+      return ret;
+  }
+
+  return ret;
+}
+
+OWLAPI int owl_model_cook(char const *path, char const *cooked_path) {
+  FILE *file;
+  uint64_t offset = 0;
+  uint64_t vertices_size;
+  uint64_t indices_size;
+  uint64_t *offsets = NULL;
+  void *blob = NULL;
+  struct owl_model model;
+  struct owl_model_import_options options;
+  struct owl_model_cooked_header header;
+  struct owl_model_cooked_section section;
+  struct owl_model_cooked_image *images = NULL;
+  struct owl_model_all_primitives all_primitives;
+  struct cgltf_data *data = NULL;
+
+  int ret = OWL_OK;
+
+  OWL_MEMSET(&model, 0, sizeof(model));
+  OWL_MEMSET(&header, 0, sizeof(header));
+
+  options.optimize_meshes = 1;
+  options.generate_lods = 1;
+  options.build_meshlets = 1;
+
+  ret = owl_model_import(NULL, &options, path, &model, &data,
+                         &all_primitives);
+  if (ret)
+    return ret;
+
+  header.magic = OWL_MODEL_COOKED_MAGIC;
+  header.version = OWL_MODEL_COOKED_VERSION;
+  owl_model_cooked_sizes(header.sizes);
+  header.num_roots = model.num_roots;
+  header.num_nodes = model.num_nodes;
+  header.num_weights = model.num_weights;
+  header.num_images = model.num_images;
+  header.num_textures = model.num_textures;
+  header.num_materials = model.num_materials;
+  header.num_meshes = model.num_meshes;
+  header.num_primitives = model.num_primitives;
+  header.num_meshlets = model.num_meshlets;
+  header.num_skins = model.num_skins;
+  header.num_samplers = model.num_samplers;
+  header.num_channels = model.num_channels;
+  header.num_animations = model.num_animations;
+  header.num_vertices = all_primitives.num_vertices;
+  header.num_indices = all_primitives.num_indices;
+  header.num_targets = all_primitives.num_targets;
+  header.index_type = owl_model_pick_index_type(&all_primitives);
+  header.num_offsets = owl_model_walk_storage(&model, NULL, 0);
+
+  vertices_size = owl_model_vertex_buffer_size(header.num_vertices);
+  indices_size = header.num_indices *
+                 owl_model_index_size((VkIndexType)header.index_type);
+
+  offsets = OWL_MALLOC(header.num_offsets * sizeof(*offsets));
+  images = OWL_MALLOC(OWL_MAX(1, model.num_images) * sizeof(*images));
+  blob = OWL_MALLOC(OWL_MAX(1, indices_size));
+  if (!offsets || !images || !blob) {
+    ret = OWL_ERROR_NO_MEMORY;
+    goto out_free;
+  }
+
+  owl_model_walk_storage(&model, offsets, 0);
+
+  file = fopen(cooked_path, "wb");
+  if (!file) {
+    ret = OWL_ERROR_NOT_FOUND;
+    goto out_free;
+  }
+
+  /* the header is written again once the sections are known */
+  ret = owl_model_cook_write(file, &header, sizeof(header), &offset, &section);
+  if (ret)
+    goto out_close;
+
+  ret = owl_model_cook_write(file, model.storage, model.storage_size, &offset,
+                             &header.storage);
+  if (ret)
+    goto out_close;
+
+  ret = owl_model_cook_write(file, offsets,
+                             header.num_offsets * sizeof(*offsets), &offset,
+                             &header.offsets);
+  if (ret)
+    goto out_close;
+
+  ret = owl_model_cook_write(file, model.meshlets,
+                             model.num_meshlets * sizeof(*model.meshlets),
+                             &offset, &header.meshlets);
+  if (ret)
+    goto out_close;
+
+  ret = owl_model_cook_write(file, all_primitives.vertices, vertices_size,
+                             &offset, &header.vertices);
+  if (ret)
+    goto out_close;
+
+  owl_model_pack_indices(&all_primitives, (VkIndexType)header.index_type,
+                         blob);
+  ret = owl_model_cook_write(file, blob, indices_size, &offset,
+                             &header.indices);
+  if (ret)
+    goto out_close;
+
+  ret = owl_model_cook_write(file, all_primitives.targets,
+                             all_primitives.num_targets *
+                                 sizeof(*all_primitives.targets),
+                             &offset, &header.targets);
+  if (ret)
+    goto out_close;
+
+  ret = owl_model_cook_images(data, &model, file, &offset, images);
+  if (ret)
+    goto out_close;
+
+  ret = owl_model_cook_write(file, images,
+                             model.num_images * sizeof(*images), &offset,
+                             &header.images);
+  if (ret)
+    goto out_close;
+
+  if (fseek(file, 0, SEEK_SET) || 1 != fwrite(&header, sizeof(header), 1, file))
+    ret = OWL_ERROR_FATAL;
+
+out_close:
+  if (fclose(file))
+    ret = OWL_ERROR_FATAL;
+
+  /* don't leave a truncated model behind */
+  if (ret)
+    remove(cooked_path);
+
+out_free:
+  OWL_FREE(blob);
+  OWL_FREE(images);
+  OWL_FREE(offsets);
+  owl_model_deinit_all_primitives(&all_primitives);
+  owl_model_free_gltf(data);
+  OWL_FREE(model.meshlets);
+  OWL_FREE(model.storage);
+
+  return ret;
+}
+
+static int
+owl_model_cooked_section_valid(struct owl_plataform_file const *file,
+                               struct owl_model_cooked_section const *section,
+                               uint64_t size) {
+  return section->size == size && section->offset <= file->size &&
+         section->size <= file->size - section->offset;
+}
+
+/* the counts the header gives the model, owl_model_walk_storage sizes the
+ * arrays of the storage from them */
+static void
+owl_model_set_cooked_counts(struct owl_model *model,
+                            struct owl_model_cooked_header const *header) {
+  model->num_roots = header->num_roots;
+  model->num_nodes = header->num_nodes;
+  model->num_weights = header->num_weights;
+  model->num_images = header->num_images;
+  model->num_textures = header->num_textures;
+  model->num_materials = header->num_materials;
+  model->num_meshes = header->num_meshes;
+  model->num_primitives = header->num_primitives;
+  model->num_skins = header->num_skins;
+  model->num_samplers = header->num_samplers;
+  model->num_channels = header->num_channels;
+  model->num_animations = header->num_animations;
+  model->num_vertices = header->num_vertices;
+  model->index_type = (VkIndexType)header->index_type;
+}
+
+static int
+owl_model_check_cooked(struct owl_plataform_file const *file,
+                       struct owl_model_cooked_header const *header) {
+  int32_t i;
+  uint32_t sizes[OWL_ARRAY_SIZE(header->sizes)];
+  struct owl_model counts;
+  struct owl_model_cooked_image const *images;
+
+  if (file->size < sizeof(*header) ||
+      OWL_MODEL_COOKED_MAGIC != header->magic) {
+    OWL_DEBUG_LOG("%s is not a cooked model\n", file->path);
+    return OWL_ERROR_INVALID_VALUE;
+  }
+
+  owl_model_cooked_sizes(sizes);
+
+  if (OWL_MODEL_COOKED_VERSION != header->version ||
+      OWL_MEMCMP(sizes, header->sizes, sizeof(sizes))) {
+    OWL_DEBUG_LOG("%s was cooked by another version, cook it again\n",
+                  file->path);
+    return OWL_ERROR_INVALID_VALUE;
+  }
+
+  if (0 > header->num_roots || 0 > header->num_nodes ||
+      0 > header->num_weights || 0 > header->num_images ||
+      0 > header->num_textures || 0 > header->num_materials ||
+      0 > header->num_meshes || 0 > header->num_primitives ||
+      0 > header->num_meshlets || 0 > header->num_skins ||
+      0 > header->num_samplers || 0 > header->num_channels ||
+      0 > header->num_animations || 0 > header->num_vertices ||
+      0 > header->num_indices || 0 > header->num_targets ||
+      0 > header->num_offsets ||
+      (VK_INDEX_TYPE_UINT16 != header->index_type &&
+       VK_INDEX_TYPE_UINT32 != header->index_type))
+    goto error;
+
+  if (!owl_model_cooked_section_valid(file, &header->storage,
+                                      header->storage.size) ||
+      !owl_model_cooked_section_valid(
+          file, &header->offsets, header->num_offsets * sizeof(uint64_t)) ||
+      !owl_model_cooked_section_valid(
+          file, &header->meshlets,
+          header->num_meshlets * sizeof(struct owl_mesh_meshlet)) ||
+      !owl_model_cooked_section_valid(
+          file, &header->vertices,
+          owl_model_vertex_buffer_size(header->num_vertices)) ||
+      !owl_model_cooked_section_valid(
+          file, &header->indices,
+          header->num_indices *
+              owl_model_index_size((VkIndexType)header->index_type)) ||
+      !owl_model_cooked_section_valid(
+          file, &header->targets,
+          header->num_targets * sizeof(struct owl_model_morph_target)) ||
+      !owl_model_cooked_section_valid(
+          file, &header->images,
+          header->num_images * sizeof(struct owl_model_cooked_image)))
+    goto error;
+
+  /* the counts owl_model_walk_storage counts the pointers from are arrays of
+   * the storage */
+  if (header->num_nodes * sizeof(struct owl_model_node) >
+          header->storage.size ||
+      header->num_skins * sizeof(struct owl_model_skin) >
+          header->storage.size ||
+      header->num_samplers * sizeof(struct owl_model_animation_sampler) >
+          header->storage.size ||
+      header->num_animations * sizeof(struct owl_model_animation) >
+          header->storage.size)
+    goto error;
+
+  /* every pointer of the storage needs its offset */
+  OWL_MEMSET(&counts, 0, sizeof(counts));
+  owl_model_set_cooked_counts(&counts, header);
+
+  if (owl_model_walk_storage(&counts, NULL, 0) != header->num_offsets)
+    goto error;
+
+  images = (void const *)&file->data[header->images.offset];
+
+  for (i = 0; i < header->num_images; ++i) {
+    uint64_t size;
+
+    /* the formats owl_model_choose_image_format picks */
+    if ((OWL_RGBA8_SRGB != images[i].format &&
+         OWL_RGBA8_UNORM != images[i].format &&
+         OWL_RG8_UNORM != images[i].format &&
+         OWL_R8_UNORM != images[i].format) ||
+        OWL_TEXTURE_SWIZZLE_RG_AS_GB < images[i].swizzle)
+      goto error;
+
+    if (!images[i].width || !images[i].height || !images[i].mipmaps ||
+        owl_texture_calculate_mipmaps(images[i].width, images[i].height) <
+            images[i].mipmaps)
+      goto error;
+
+    size = owl_texture_levels_size((enum owl_pixel_format)images[i].format,
+                                   images[i].width, images[i].height,
+                                   images[i].mipmaps);
+
+    if (!owl_model_cooked_section_valid(file, &images[i].pixels, size))
+      goto error;
+  }
+
+  return OWL_OK;
+
+error:
+  OWL_DEBUG_LOG("%s is truncated or corrupt\n", file->path);
+  return OWL_ERROR_INVALID_VALUE;
+}
+
+OWLAPI int owl_model_init_cooked(struct owl_model *model,
+                                 struct owl_renderer *r, char const *path) {
+  int32_t i;
+  struct owl_plataform_file file;
+  struct owl_model_cooked_header const *header;
+  struct owl_model_cooked_image const *images;
+
+  int ret = OWL_OK;
+
+  OWL_MEMSET(model, 0, sizeof(*model));
+
+  ret = owl_plataform_map_file(path, &file);
+  if (ret)
+    return ret;
+
+  header = (void const *)file.data;
+
+  ret = owl_model_check_cooked(&file, header);
+  if (ret)
+    goto out_unmap;
+
+  ret = owl_model_init_empty_texture(r, model);
+  if (ret)
+    goto out_unmap;
+
+  owl_model_set_path(model, path);
+
+  model->storage_size = header->storage.size;
+  model->storage = OWL_MALLOC(OWL_MAX(1, model->storage_size));
+  if (!model->storage) {
+    ret = OWL_ERROR_NO_MEMORY;
+    goto out_deinit_empty_texture;
+  }
+
+  OWL_MEMCPY(model->storage, &file.data[header->storage.offset],
+             model->storage_size);
+
+  owl_model_set_cooked_counts(model, header);
+
+  if (0 > owl_model_walk_storage(
+              model, (void *)&file.data[header->offsets.offset], 1)) {
+    OWL_DEBUG_LOG("%s points outside its storage\n", path);
+    ret = OWL_ERROR_INVALID_VALUE;
+    goto out_free_storage;
+  }
+
+  /* the gpu handles are made below, never taken from the file, so that
+   * owl_model_unload only sees the ones that were */
+  for (i = 0; i < model->num_images; ++i)
+    OWL_MEMSET(&model->images[i].texture, 0, sizeof(struct owl_texture));
+
+  for (i = 0; i < model->num_materials; ++i)
+    model->materials[i].descriptor_set = VK_NULL_HANDLE;
+
+  /* same choices owl_model_init makes from the renderer */
+  if (r->has_multi_draw_indirect && header->num_meshlets) {
+    model->num_meshlets = header->num_meshlets;
+    model->meshlets = OWL_MALLOC(header->meshlets.size);
+    if (!model->meshlets) {
+      ret = OWL_ERROR_NO_MEMORY;
+      goto out_unload;
+    }
+
+    OWL_MEMCPY(model->meshlets, &file.data[header->meshlets.offset],
+               header->meshlets.size);
+  }
+
+  for (i = 0; i < model->num_primitives; ++i) {
+    int32_t j;
+    struct owl_model_primitive *primitive = &model->primitives[i];
+
+    if (!r->generate_lods)
+      primitive->num_lods = 1;
+
+    for (j = 0; !model->meshlets && j < OWL_MODEL_MAX_LODS; ++j) {
+      primitive->lods[j].first_meshlet = 0;
+      primitive->lods[j].num_meshlets = 0;
+    }
+  }
+
+  for (i = 0; !r->generate_lods && i < model->num_meshes; ++i)
+    model->meshes[i].num_lods = 1;
+
+  images = (void const *)&file.data[header->images.offset];
+
+  for (i = 0; i < model->num_images; ++i) {
+    struct owl_texture_desc desc;
+
+    desc.source = OWL_TEXTURE_SOURCE_DATA;
+    desc.type = OWL_TEXTURE_TYPE_2D;
+    desc.path = NULL;
+    desc.pixels = &file.data[images[i].pixels.offset];
+    desc.width = images[i].width;
+    desc.height = images[i].height;
+    desc.format = (enum owl_pixel_format)images[i].format;
+    desc.swizzle = (enum owl_texture_swizzle)images[i].swizzle;
+    desc.mipmaps = images[i].mipmaps;
+
+    ret = owl_texture_init(r, &desc, &model->images[i].texture);
+    if (ret)
+      goto out_unload;
+  }
+
+  ret = owl_model_init_material_sets(r, model);
+  if (ret)
+    goto out_unload;
+
+  /* the vertices and the indices go from the mapping straight into the
+   * upload buffer */
+  ret = owl_model_create_geometry(r, header->num_indices, model);
+  if (ret)
+    goto out_unload;
+
+  ret = owl_model_upload(r, model->vertex_buffer,
+                         &file.data[header->vertices.offset],
+                         header->vertices.size);
+  if (ret)
+    goto out_unload;
+
+  if (model->has_indices) {
+    ret = owl_model_upload(r, model->index_buffer,
+                           &file.data[header->indices.offset],
+                           header->indices.size);
+    if (ret)
+      goto out_unload;
+  }
+
+  ret = owl_model_init_targets(
+      r, (void const *)&file.data[header->targets.offset],
+      header->num_targets, model);
+  if (ret)
+    goto out_unload;
+
+  ret = owl_model_init_draws(r, model);
+  if (ret)
+    goto out_unload;
+
+  ret = owl_model_instance_init(&model->instance, r, model);
+  if (ret)
+    goto out_unload;
+
+  owl_model_init_bounds(model);
+
+  owl_plataform_unmap_file(&file);
+
+  return OWL_OK;
+
+  /* owl_model_unload also frees the storage and the empty texture */
+out_unload:
+  owl_model_unload(r, model);
+  owl_plataform_unmap_file(&file);
+
+  return ret;
+
+out_free_storage:
+  OWL_FREE(model->storage);
+  model->storage = NULL;
+
+out_deinit_empty_texture:
+  owl_texture_deinit(r, &model->empty_texture);
+
+out_unmap:
+  owl_plataform_unmap_file(&file);
+
+  return ret;
+}
+
+OWLAPI void owl_model_deinit(struct owl_model *model, struct owl_renderer *r) {
+  /* a load in flight is finished first, a failed one was already torn
+   * down */
+  if (model->loading && owl_model_finish_load(model, r)) {
+    OWL_FREE(model->loading);
+    model->loading = NULL;
+    return;
+  }
+
+  owl_model_instance_deinit(&model->instance, r);
+  owl_model_unload(r, model);
+}
+
+OWLAPI int owl_model_instance_init(struct owl_model_instance *instance,
+                                   struct owl_renderer *r,
+                                   struct owl_model *model) {
+  OWL_ASSERT(!model->loading);
+
+  return owl_model_init_instance(instance, r, model);
+}
+
+OWLAPI void owl_model_instance_deinit(struct owl_model_instance *instance,
+                                      struct owl_renderer *r) {
+  vkDeviceWaitIdle(r->device);
+
+  if (instance->model->num_draws)
+    owl_model_instance_deinit_frames(r, instance);
+
+  OWL_FREE(instance->storage);
+}
+
+OWLAPI int32_t
+owl_model_find_keyframe(struct owl_model_animation_sampler const *sampler,
+                        int32_t hint, float time) {
+  int32_t low;
+  int32_t high;
+  float const *inputs = sampler->inputs;
+  int32_t const last = sampler->num_inputs - 1;
+
+  if (1 > last || time < inputs[0] || time > inputs[last])
+    return -1;
+
+  /* playing forward the keyframe rarely moves more than one step */
+  if (0 <= hint && hint < last && inputs[hint] <= time) {
+    if (time <= inputs[hint + 1])
+      return hint;
+
+    if (hint + 1 < last && time <= inputs[hint + 2])
+      return hint + 1;
+  }
+
+  /* inputs[low] <= time <= inputs[high] */
+  low = 0;
+  high = last;
+  while (1 < high - low) {
+    int32_t const middle = low + (high - low) / 2;
+
+    if (inputs[middle] <= time)
+      low = middle;
+    else
+      high = middle;
+  }
+
+  return low;
+}
+
+/* evaluates one element of every keyframe between keyframe and keyframe + 1,
+ * keyframes hold num_elements values each (1 for translation, rotation and
+ * scale, the number of morph targets for weights) */
+static void
+owl_model_sample_animation(struct owl_model_animation_sampler const *sampler,
+                           int32_t path, int32_t keyframe, int32_t num_elements,
+                           int32_t element, float time, owl_v4 out) {
+  int32_t i;
+  float const t0 = sampler->inputs[keyframe];
+  float const t1 = sampler->inputs[keyframe + 1];
+  float const dt = t1 - t0;
+  float const a = 0.0F < dt ? (time - t0) / dt : 0.0F;
+  owl_v4 const *outputs = sampler->outputs;
+
+  switch (sampler->interpolation) {
+  case OWL_ANIMATION_INTERPOLATION_STEP: {
+    OWL_V4_COPY(outputs[keyframe * num_elements + element], out);
+  } break;
+
+  case OWL_ANIMATION_INTERPOLATION_LINEAR: {
+    float const *v0 = outputs[keyframe * num_elements + element];
+    float const *v1 = outputs[(keyframe + 1) * num_elements + element];
+
+    if (OWL_ANIMATION_PATH_ROTATION == path)
+      owl_v4_quat_slerp(v0, v1, a, out);
+    else
+      owl_v4_mix(v0, v1, a, out);
+  } break;
+
+  /* every keyframe holds an in tangent, a value and an out tangent */
+  case OWL_ANIMATION_INTERPOLATION_CUBICSPLINE: {
+    float const a2 = a * a;
+    float const a3 = a2 * a;
+    float const h00 = 2.0F * a3 - 3.0F * a2 + 1.0F;
+    float const h10 = (a3 - 2.0F * a2 + a) * dt;
+    float const h01 = -2.0F * a3 + 3.0F * a2;
+    float const h11 = (a3 - a2) * dt;
+    float const *v0 = outputs[(keyframe * 3 + 1) * num_elements + element];
+    float const *b0 = outputs[(keyframe * 3 + 2) * num_elements + element];
+    float const *a1 = outputs[(keyframe * 3 + 3) * num_elements + element];
+    float const *v1 = outputs[(keyframe * 3 + 4) * num_elements + element];
+
+    for (i = 0; i < 4; ++i)
+      out[i] = h00 * v0[i] + h10 * b0[i] + h01 * v1[i] + h11 * a1[i];
+  } break;
+
+  default:
+    OWL_ASSERT(0 && "unexpected interpolation");
+    OWL_V4_ZERO(out);
+    return;
+  }
+
+  if (OWL_ANIMATION_PATH_ROTATION == path)
+    owl_v4_normalize(out, out);
+}
+
+/* wraps around once the time goes past the end of the animation */
+static float
+owl_model_wrap_time(struct owl_model_animation const *animation, float time) {
+  if (animation->end < time)
+    time -= animation->end;
+
+  return time;
+}
+
+/* samples every channel of animation id at time into pose, the nodes it
+ * touches are marked dirty */
+static int owl_model_sample_pose(struct owl_model_instance *instance,
+                                 int32_t id, float time,
+                                 struct owl_model_pose const *pose) {
+  int32_t i;
+  struct owl_model const *m = instance->model;
+  struct owl_model_animation const *animation = &m->animations[id];
+
+  for (i = 0; i < animation->num_channels; ++i) {
+    int32_t j;
+    int32_t k;
+    int32_t node;
+    owl_v4 value;
+    int32_t const channel_id = animation->first_channel + i;
+    struct owl_model_animation_channel const *channel;
+    struct owl_model_animation_sampler const *sampler;
+
+    channel = &m->channels[channel_id];
+    sampler = &m->samplers[channel->sampler];
+    node = channel->node;
+
+    j = owl_model_find_keyframe(sampler, instance->keyframes[channel_id],
+                                time);
+    if (-1 == j)
+      continue;
+
+    instance->keyframes[channel_id] = j;
+
+    switch (channel->path) {
+    case OWL_ANIMATION_PATH_TRANSLATION: {
+      owl_model_sample_animation(sampler, channel->path, j, 1, 0, time, value);
+      OWL_V3_COPY(value, pose->translations[node]);
+      instance->dirty_nodes[node] |= OWL_MODEL_NODE_LOCAL_DIRTY;
+    } break;
+
+    case OWL_ANIMATION_PATH_ROTATION: {
+      owl_model_sample_animation(sampler, channel->path, j, 1, 0, time, value);
+      OWL_V4_COPY(value, pose->rotations[node]);
+      instance->dirty_nodes[node] |= OWL_MODEL_NODE_LOCAL_DIRTY;
+    } break;
+
+    case OWL_ANIMATION_PATH_SCALE: {
+      owl_model_sample_animation(sampler, channel->path, j, 1, 0, time, value);
+      OWL_V3_COPY(value, pose->scales[node]);
+      instance->dirty_nodes[node] |= OWL_MODEL_NODE_LOCAL_DIRTY;
+    } break;
+
+    case OWL_ANIMATION_PATH_WEIGHTS: {
+      int32_t const count = m->node_num_weights[node];
+      float *weights = &pose->weights[m->node_weights_offsets[node]];
+
+      for (k = 0; k < count; ++k) {
+        owl_model_sample_animation(sampler, channel->path, j, count, k, time,
+                                   value);
+        weights[k] = value[0];
+      }
+    } break;
+
+    default:
+      OWL_ASSERT(0 && "unexpected path");
+      return OWL_ERROR_FATAL;
+    }
+  }
+
+  return OWL_OK;
+}
+
+static void owl_model_live_pose(struct owl_model_instance *instance,
+                                struct owl_model_pose *pose) {
+  pose->translations = instance->node_translations;
+  pose->rotations = instance->node_rotations;
+  pose->scales = instance->node_scales;
+  pose->weights = instance->weights;
+}
+
+/* copies the values animation id touches from the live pose into both lod
+ * poses, channels that can't be sampled ahead keep their current value */
+static void owl_model_save_lod_pose(struct owl_model_instance *instance,
+                                    int32_t id) {
+  int32_t i;
+  struct owl_model const *m = instance->model;
+  struct owl_model_animation const *animation = &m->animations[id];
+  struct owl_model_pose const *source = &instance->lod_source;
+  struct owl_model_pose const *target = &instance->lod_target;
+
+  for (i = 0; i < animation->num_channels; ++i) {
+    int32_t offset;
+    struct owl_model_animation_channel const *channel;
+
+    channel = &m->channels[animation->first_channel + i];
+
+    switch (channel->path) {
+    case OWL_ANIMATION_PATH_TRANSLATION: {
+      float const *v = instance->node_translations[channel->node];
+      OWL_V3_COPY(v, source->translations[channel->node]);
+      OWL_V3_COPY(v, target->translations[channel->node]);
+    } break;
+
+    case OWL_ANIMATION_PATH_ROTATION: {
+      float const *v = instance->node_rotations[channel->node];
+      OWL_V4_COPY(v, source->rotations[channel->node]);
+      OWL_V4_COPY(v, target->rotations[channel->node]);
+    } break;
+
+    case OWL_ANIMATION_PATH_SCALE: {
+      float const *v = instance->node_scales[channel->node];
+      OWL_V3_COPY(v, source->scales[channel->node]);
+      OWL_V3_COPY(v, target->scales[channel->node]);
+    } break;
+
+    case OWL_ANIMATION_PATH_WEIGHTS: {
+      uint64_t const size = m->node_num_weights[channel->node] * sizeof(float);
+
+      offset = m->node_weights_offsets[channel->node];
+      OWL_MEMCPY(&source->weights[offset], &instance->weights[offset], size);
+      OWL_MEMCPY(&target->weights[offset], &instance->weights[offset], size);
+    } break;
+    }
+  }
+}
+
+/* blends the values animation id touches from lod_source to lod_target into
+ * the live pose, rotations are nlerped, close enough between two samples a
+ * few updates apart */
+static void owl_model_blend_lod_pose(struct owl_model_instance *instance,
+                                     int32_t id, float a) {
+  int32_t i;
+  struct owl_model const *m = instance->model;
+  struct owl_model_animation const *animation = &m->animations[id];
+  struct owl_model_pose const *source = &instance->lod_source;
+  struct owl_model_pose const *target = &instance->lod_target;
+
+  for (i = 0; i < animation->num_channels; ++i) {
+    int32_t k;
+    int32_t node;
+    struct owl_model_animation_channel const *channel;
+
+    channel = &m->channels[animation->first_channel + i];
+    node = channel->node;
+
+    switch (channel->path) {
+    case OWL_ANIMATION_PATH_TRANSLATION: {
+      owl_v3_mix(source->translations[node], target->translations[node], a,
+                 instance->node_translations[node]);
+      instance->dirty_nodes[node] |= OWL_MODEL_NODE_LOCAL_DIRTY;
+    } break;
+
+    case OWL_ANIMATION_PATH_ROTATION: {
+      float const *q0 = source->rotations[node];
+      float const *q1 = target->rotations[node];
+      float *q = instance->node_rotations[node];
+      float const dot = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] +
+                        q0[3] * q1[3];
+      /* takes the short way around */
+      float const sign = 0.0F > dot ? -1.0F : 1.0F;
+
+      for (k = 0; k < 4; ++k)
+        q[k] = q0[k] + (sign * q1[k] - q0[k]) * a;
+
+      owl_v4_normalize(q, q);
+      instance->dirty_nodes[node] |= OWL_MODEL_NODE_LOCAL_DIRTY;
+    } break;
+
+    case OWL_ANIMATION_PATH_SCALE: {
+      owl_v3_mix(source->scales[node], target->scales[node], a,
+                 instance->node_scales[node]);
+      instance->dirty_nodes[node] |= OWL_MODEL_NODE_LOCAL_DIRTY;
+    } break;
+
+    case OWL_ANIMATION_PATH_WEIGHTS: {
+      int32_t const offset = m->node_weights_offsets[node];
+      float const *w0 = &source->weights[offset];
+      float const *w1 = &target->weights[offset];
+      float *w = &instance->weights[offset];
+
+      for (k = 0; k < m->node_num_weights[node]; ++k)
+        w[k] = w0[k] + (w1[k] - w0[k]) * a;
+    } break;
+    }
+  }
 }
 
-static int owl_model_load_animations(struct owl_renderer *r,
-                                     struct cgltf_data const *gltf,
-                                     struct owl_model *m) {
-  int32_t i;
-  int ret = OWL_OK;
+OWLAPI int
+owl_model_instance_update_animation(struct owl_renderer *r,
+                                    struct owl_model_instance *instance,
+                                    float dt, int32_t id) {
+  int ret;
+  float time;
+  struct owl_model_pose pose;
+  struct owl_model const *m = instance->model;
 
   OWL_UNUSED(r);
 
-  OWL_ASSERT(OWL_ANIMATION_INTERPOLATION_LINEAR ==
-             cgltf_interpolation_type_linear);
-  OWL_ASSERT(OWL_ANIMATION_INTERPOLATION_STEP == cgltf_interpolation_type_step);
-  OWL_ASSERT(OWL_ANIMATION_INTERPOLATION_CUBICSPLINE ==
-             cgltf_interpolation_type_cubic_spline);
+  if (-1 >= id || id >= m->num_animations)
+    return OWL_ERROR_FATAL; /* TODO(samuel0) invalid value */
 
-  OWL_ASSERT(OWL_ANIMATION_PATH_TRANSLATION ==
-             cgltf_animation_path_type_translation);
-  OWL_ASSERT(OWL_ANIMATION_PATH_ROTATION == cgltf_animation_path_type_rotation);
-  OWL_ASSERT(OWL_ANIMATION_PATH_SCALE == /*   */
-             cgltf_animation_path_type_scale);
-  OWL_ASSERT(OWL_ANIMATION_PATH_WEIGHTS == /*  */
-             cgltf_animation_path_type_weights);
+  time = owl_model_wrap_time(&m->animations[id],
+                             instance->animation_times[id] + dt);
+  instance->animation_times[id] = time;
 
-  OWL_ASSERT(gltf->animations_count < OWL_ARRAY_SIZE(m->animations));
+  owl_model_live_pose(instance, &pose);
 
-  m->num_samplers = 0;
-  m->num_channels = 0;
+  ret = owl_model_sample_pose(instance, id, time, &pose);
+  if (ret)
+    return ret;
 
-  m->num_animations = (int32_t)gltf->animations_count;
-  for (i = 0; i < m->num_animations; ++i) {
-    int32_t j;
-    struct owl_model_animation *out_animation = &m->animations[i];
-    struct cgltf_animation const *in_animation = &gltf->animations[i];
+  ++instance->pose_version;
 
-    out_animation->time = 0.0F;
-    out_animation->start = FLT_MAX;
-    out_animation->end = FLT_MIN;
+  owl_model_update_transforms(instance);
 
-    if (in_animation->name) {
-      int32_t max_length = OWL_ARRAY_SIZE(out_animation->name);
-      OWL_STRNCPY(out_animation->name, in_animation->name, max_length);
-    } else {
-      int32_t max_length = OWL_ARRAY_SIZE(out_animation->name);
-      OWL_STRNCPY(out_animation->name, "NO NAME", max_length);
-    }
+  return OWL_OK;
+}
 
-    OWL_ASSERT(in_animation->samplers_count <
-               OWL_ARRAY_SIZE(out_animation->samplers));
+OWLAPI int owl_model_update_animation(struct owl_renderer *r,
+                                      struct owl_model *m, float dt,
+                                      int32_t id) {
+  if (m->loading)
+    return OWL_OK;
 
-    out_animation->num_samplers = (int32_t)in_animation->samplers_count;
-    for (j = 0; j < out_animation->num_samplers; ++j) {
-      int32_t k;
-      float const *inputs;
-      struct owl_model_animation_sampler *out_sampler;
-      struct cgltf_animation_sampler *in_sampler;
+  return owl_model_instance_update_animation(r, &m->instance, dt, id);
+}
 
-      out_animation->samplers[j] = m->num_samplers + j;
+/* screen sizes under which an instance drops to the blended and held lods */
+#define OWL_MODEL_ANIMATION_LOD_BLENDED_SIZE 0.25F
+#define OWL_MODEL_ANIMATION_LOD_HELD_SIZE 0.08F
 
-      in_sampler = &in_animation->samplers[j];
-      out_sampler = &m->samplers[out_animation->samplers[j]];
+/* updates between two samples of the blended and held lods */
+#define OWL_MODEL_ANIMATION_LOD_BLENDED_STEPS 3
+#define OWL_MODEL_ANIMATION_LOD_HELD_STEPS 6
 
-      out_sampler->interpolation = in_sampler->interpolation;
+static int32_t owl_model_pick_animation_lod(float screen_size) {
+  if (OWL_MODEL_ANIMATION_LOD_BLENDED_SIZE <= screen_size)
+    return OWL_MODEL_ANIMATION_LOD_FULL;
 
-      /* FIXME(samuel): validate this component type */
-      OWL_ASSERT(in_sampler->input);
-      inputs = owl_resolve_gltf_accessor(in_sampler->input);
+  if (OWL_MODEL_ANIMATION_LOD_HELD_SIZE <= screen_size)
+    return OWL_MODEL_ANIMATION_LOD_BLENDED;
 
-      OWL_ASSERT(in_sampler->input->count <
-                 OWL_ARRAY_SIZE(out_sampler->inputs));
+  if (0.0F < screen_size)
+    return OWL_MODEL_ANIMATION_LOD_HELD;
 
-      out_sampler->num_inputs = (int32_t)in_sampler->input->count;
-      for (k = 0; k < out_sampler->num_inputs; ++k) {
-        float const input = inputs[k];
+  return OWL_MODEL_ANIMATION_LOD_FROZEN;
+}
 
-        if (input < out_animation->start)
-          out_animation->start = input;
+static int
+owl_model_instance_update_lod(struct owl_renderer *r,
+                              struct owl_model_instance *instance, float dt,
+                              int32_t id, float screen_size) {
+  int ret;
+  float time;
+  int32_t lod;
+  struct owl_model_pose pose;
+  struct owl_model const *m = instance->model;
+  struct owl_model_animation const *animation;
+
+  if (-1 >= id || id >= m->num_animations)
+    return OWL_ERROR_INVALID_VALUE;
+
+  lod = owl_model_pick_animation_lod(screen_size);
+
+  /* a new lod starts from a fresh sample */
+  if (lod != instance->animation_lod) {
+    instance->animation_lod = lod;
+    instance->lod_elapsed = 0.0F;
+    instance->lod_interval = 0.0F;
+  }
 
-        if (input > out_animation->end)
-          out_animation->end = input;
+  if (OWL_MODEL_ANIMATION_LOD_FULL == lod)
+    return owl_model_instance_update_animation(r, instance, dt, id);
 
-        out_sampler->inputs[k] = input;
-      }
+  animation = &m->animations[id];
 
-      OWL_ASSERT(in_sampler->output->count <
-                 OWL_ARRAY_SIZE(out_sampler->outputs));
+  time = owl_model_wrap_time(animation, instance->animation_times[id] + dt);
+  instance->animation_times[id] = time;
 
-      out_sampler->num_outputs = (int32_t)in_sampler->output->count;
-      switch (in_sampler->output->type) {
-      case cgltf_type_vec3: {
-        owl_v3 const *outputs;
-        outputs = owl_resolve_gltf_accessor(in_sampler->output);
+  if (OWL_MODEL_ANIMATION_LOD_FROZEN == lod)
+    return OWL_OK;
 
-        for (k = 0; k < out_sampler->num_outputs; ++k) {
-          OWL_V4_ZERO(out_sampler->outputs[k]);
-          OWL_V3_COPY(outputs[k], out_sampler->outputs[k]);
-        }
-      } break;
+  if (instance->lod_interval <= instance->lod_elapsed) {
+    instance->lod_elapsed = 0.0F;
 
-      case cgltf_type_vec4: {
-        owl_v4 const *outputs;
-        outputs = owl_resolve_gltf_accessor(in_sampler->output);
-        for (k = 0; k < out_sampler->num_outputs; ++k) {
-          OWL_V4_COPY(outputs[k], out_sampler->outputs[k]);
-        }
-      } break;
+    if (OWL_MODEL_ANIMATION_LOD_HELD == lod) {
+      instance->lod_interval = OWL_MODEL_ANIMATION_LOD_HELD_STEPS * dt;
 
-      case cgltf_type_invalid:
-      case cgltf_type_scalar:
-      case cgltf_type_vec2:
-      case cgltf_type_mat2:
-      case cgltf_type_mat3:
-      case cgltf_type_mat4:
-        OWL_ASSERT(0);
-      }
-    }
+      owl_model_live_pose(instance, &pose);
 
-    m->num_samplers += out_animation->num_samplers;
+      ret = owl_model_sample_pose(instance, id, time, &pose);
+      if (ret)
+        return ret;
 
-    OWL_ASSERT(in_animation->channels_count <
-               OWL_ARRAY_SIZE(out_animation->channels));
+      ++instance->pose_version;
+      owl_model_update_transforms(instance);
+    } else {
+      float ahead;
 
-    out_animation->num_channels = in_animation->channels_count;
-    for (j = 0; j < out_animation->num_channels; ++j) {
-      int32_t id;
-      struct owl_model_animation_channel *out_channel;
-      struct cgltf_animation_channel *in_channel;
+      /* the live pose is the one of the last update, the target is where
+       * the animation is going to be when the next sample is due */
+      instance->lod_interval = OWL_MODEL_ANIMATION_LOD_BLENDED_STEPS * dt;
+      ahead = owl_model_wrap_time(animation,
+                                  time - dt + instance->lod_interval);
 
-      out_animation->channels[j] = m->num_channels + j;
+      owl_model_save_lod_pose(instance, id);
 
-      in_channel = &in_animation->channels[j];
-      out_channel = &m->channels[out_animation->channels[j]];
+      ret = owl_model_sample_pose(instance, id, ahead, &instance->lod_target);
+      if (ret)
+        return ret;
+    }
+  }
 
-      out_channel->path = in_channel->target_path;
-      out_channel->node = (int32_t)(in_channel->target_node - gltf->nodes);
+  instance->lod_elapsed += dt;
 
-      id = (int32_t)(in_channel->sampler - in_animation->samplers);
-      out_channel->sampler = out_animation->samplers[id];
-    }
+  if (OWL_MODEL_ANIMATION_LOD_BLENDED == lod) {
+    float a = 1.0F;
 
-    m->num_channels += out_animation->num_channels;
+    if (0.0F < instance->lod_interval)
+      a = OWL_MIN(1.0F, instance->lod_elapsed / instance->lod_interval);
+
+    owl_model_blend_lod_pose(instance, id, a);
+
+    ++instance->pose_version;
+    owl_model_update_transforms(instance);
   }
 
-  return ret;
+  return OWL_OK;
 }
 
-static void owl_model_unload_animations(struct owl_renderer *r,
-                                        struct owl_model *m) {
-  OWL_UNUSED(r);
-  OWL_UNUSED(m);
-}
+OWLAPI float owl_model_screen_size(struct owl_renderer const *r,
+                                   struct owl_model const *m, owl_m4 matrix) {
+  owl_m4 clip;
+  owl_v4 center;
+  owl_v4 position;
+  float scale;
+  float radius;
+  float extent_x;
+  float extent_y;
 
-static int owl_model_load_roots(struct owl_renderer *r,
-                                struct cgltf_data const *gltf,
-                                struct owl_model *m) {
-  int32_t i;
-  int ret = OWL_OK;
-  struct cgltf_scene const *in_scene = gltf->scene;
+  /* the vertex shader flips y after the model matrix, the size doesn't care
+   * about the sign */
+  owl_m4_multiply(r->projection, r->view, clip);
+  owl_m4_multiply(clip, matrix, clip);
 
-  OWL_UNUSED(r);
+  OWL_V3_COPY(m->bounding_center, center);
+  center[3] = 1.0F;
+  owl_m4_multiply_v4(clip, center, position);
 
-  OWL_ASSERT(in_scene->nodes_count < OWL_ARRAY_SIZE(m->roots));
+  scale = OWL_MAX(owl_v3_magnitude(matrix[0]), owl_v3_magnitude(matrix[1]));
+  scale = OWL_MAX(scale, owl_v3_magnitude(matrix[2]));
+  radius = scale * m->bounding_radius;
 
-  m->num_roots = in_scene->nodes_count;
-  for (i = 0; i < m->num_roots; ++i)
-    m->roots[i] = (int32_t)(in_scene->nodes[i] - gltf->nodes);
+  /* behind the camera */
+  if (position[3] < -radius)
+    return 0.0F;
 
-  return ret;
-}
+  /* the camera is inside of the sphere */
+  if (position[3] <= radius)
+    return 1.0F;
 
-static void owl_model_unload_roots(struct owl_renderer *r,
-                                   struct owl_model *m) {
-  OWL_UNUSED(r);
-  OWL_UNUSED(m);
-}
+  extent_x = radius * OWL_MAX(r->projection[0][0], -r->projection[0][0]);
+  extent_y = radius * OWL_MAX(r->projection[1][1], -r->projection[1][1]);
 
-#define OWL_PATH_SEPARATOR '/'
+  if (position[3] + extent_x < OWL_MAX(position[0], -position[0]))
+    return 0.0F;
 
-/* TODO(samuel): cleanup on error */
-OWLAPI int owl_model_init(struct owl_model *model, struct owl_renderer *r,
-                          char const *path) {
-  struct owl_texture_desc empty_desc;
-  struct cgltf_options options;
-  struct cgltf_data *data = NULL;
-  struct owl_model_all_primitives all_primitives;
+  if (position[3] + extent_y < OWL_MAX(position[1], -position[1]))
+    return 0.0F;
 
-  int ret = OWL_OK;
+  return extent_y / position[3];
+}
 
-  OWL_MEMSET(&options, 0, sizeof(options));
-  OWL_MEMSET(model, 0, sizeof(*model));
-  OWL_MEMSET(&empty_desc, 0, sizeof(empty_desc));
+OWLAPI float
+owl_model_instance_screen_size(struct owl_renderer const *r,
+                               struct owl_model_instance const *instance,
+                               owl_m4 matrix) {
+  return owl_model_screen_size(r, instance->model, matrix);
+}
 
-  empty_desc.source = OWL_TEXTURE_SOURCE_FILE;
-  empty_desc.path = "../../res/none.png";
-  ret = owl_texture_init(r, &empty_desc, &model->empty_texture);
-  OWL_ASSERT(!ret);
+struct owl_model_update_job {
+  struct owl_renderer *renderer;
+  struct owl_model_instance_update const *updates;
+  int *rets;
+  owl_m4 **palettes;
+};
 
-  OWL_STRNCPY(model->path, path, sizeof(model->path));
+static void owl_model_run_update_job(void *data, int32_t i) {
+  struct owl_model_update_job const *job = data;
+  struct owl_model_instance_update const *update = &job->updates[i];
 
-  {
-    uint32_t end = 0;
-    uint64_t const max_length = sizeof(model->directory);
+  job->rets[i] = OWL_OK;
 
-    OWL_STRNCPY(model->directory, path, sizeof(model->path));
+  if (-1 != update->animation)
+    job->rets[i] = owl_model_instance_update_lod(
+        job->renderer, update->instance, update->dt, update->animation,
+        update->screen_size);
+}
 
-    while ('\0' != model->directory[end] && end < max_length)
-      ++end;
+static void owl_model_run_palette_job(void *data, int32_t i) {
+  struct owl_model_update_job const *job = data;
 
-    while (OWL_PATH_SEPARATOR != model->directory[end] && end)
-      --end;
+  if (job->palettes[i])
+    owl_model_instance_build_joints(job->updates[i].instance,
+                                    job->palettes[i]);
+}
 
-    model->directory[end] = '\0';
-  }
+/* whether the draw of this frame reads the palette, the ones reusing their
+ * skinned vertices never do */
+static int
+owl_model_instance_needs_palette(struct owl_renderer const *r,
+                                 struct owl_model_instance const *instance) {
+  struct owl_model const *m = instance->model;
 
-  if (cgltf_result_success != cgltf_parse_file(&options, path, &data)) {
-    OWL_DEBUG_LOG("Filed to parse gltf file!");
-    ret = OWL_ERROR_FATAL;
-  }
+  if (!m->num_joint_matrices)
+    return 0;
 
-  if (cgltf_result_success != cgltf_load_buffers(&options, data, path)) {
-    OWL_DEBUG_LOG("Filed to parse load gltf buffers!");
-    ret = OWL_ERROR_FATAL;
-    goto out;
-  }
+  return !r->compute_skinning || !m->num_skin_jobs ||
+         instance->skinned_pose_versions[r->frame] != instance->pose_version;
+}
 
-  ret = owl_model_load_images(r, data, model);
-  OWL_ASSERT(!ret);
+OWLAPI int
+owl_model_update_instances(struct owl_renderer *r, struct owl_thread_pool *pool,
+                           int32_t num_updates,
+                           struct owl_model_instance_update const *updates) {
+  int32_t i;
+  struct owl_model_update_job job;
+  int ret = OWL_OK;
 
-  ret = owl_model_load_textures(r, data, model);
-  OWL_ASSERT(!ret);
+  if (!num_updates)
+    return OWL_OK;
 
-  ret = owl_model_load_materials(r, data, model);
-  OWL_ASSERT(!ret);
+  job.renderer = r;
+  job.updates = updates;
+  job.rets = OWL_MALLOC(num_updates * sizeof(*job.rets));
+  job.palettes = OWL_MALLOC(num_updates * sizeof(*job.palettes));
+  if (!job.rets || !job.palettes) {
+    ret = OWL_ERROR_NO_MEMORY;
+    goto out;
+  }
 
-  ret = owl_model_init_all_primitives(&all_primitives, data);
-  OWL_ASSERT(!ret);
+  if (pool)
+    owl_thread_pool_for(pool, num_updates, owl_model_run_update_job, &job);
+  else
+    for (i = 0; i < num_updates; ++i)
+      owl_model_run_update_job(&job, i);
 
-  ret = owl_model_load_skins(r, data, model);
-  OWL_ASSERT(!ret);
+  for (i = 0; i < num_updates; ++i) {
+    if (job.rets[i]) {
+      ret = job.rets[i];
+      goto out;
+    }
+  }
 
-  ret = owl_model_load_nodes(r, data, &all_primitives, model);
-  OWL_ASSERT(!ret);
+  /* the ring is not thread safe, the palettes are allocated once the poses
+   * are known, only for the instances that get skinned, and the workers
+   * only write into their own */
+  for (i = 0; i < num_updates; ++i) {
+    struct owl_model_instance *instance = updates[i].instance;
+    struct owl_model const *m = instance->model;
 
-  ret = owl_model_init_buffers(r, &all_primitives, model);
-  OWL_ASSERT(!ret);
+    job.palettes[i] = NULL;
 
-  ret = owl_model_load_animations(r, data, model);
-  OWL_ASSERT(!ret);
+    if (!owl_model_instance_needs_palette(r, instance))
+      continue;
 
-  ret = owl_model_load_roots(r, data, model);
-  OWL_ASSERT(!ret);
+    job.palettes[i] = owl_renderer_storage_allocate(
+        r, m->num_joint_matrices * sizeof(owl_m4),
+        &instance->joints_allocation);
+    if (!job.palettes[i]) {
+      ret = OWL_ERROR_NO_MEMORY;
+      goto out;
+    }
+  }
 
-  owl_model_deinit_all_primitives(&all_primitives);
+  if (pool)
+    owl_thread_pool_for(pool, num_updates, owl_model_run_palette_job, &job);
+  else
+    for (i = 0; i < num_updates; ++i)
+      owl_model_run_palette_job(&job, i);
 
-  cgltf_free(data);
+  for (i = 0; i < num_updates; ++i)
+    if (job.palettes[i])
+      updates[i].instance->joints_frame = r->frame_count;
 
 out:
+  OWL_FREE(job.palettes);
+  OWL_FREE(job.rets);
+
   return ret;
 }
 
-OWLAPI void owl_model_deinit(struct owl_model *model, struct owl_renderer *r) {
-  vkDeviceWaitIdle(r->device);
-  owl_model_unload_roots(r, model);
-  owl_model_unload_animations(r, model);
-  owl_model_unload_skins(r, model);
-  owl_model_deinit_buffers(r, model);
-  owl_model_unload_nodes(r, model);
-  owl_model_unload_materials(r, model);
-  owl_model_unload_textures(r, model);
-  owl_model_unload_images(r, model);
-  owl_texture_deinit(r, &model->empty_texture);
-}
+OWLAPI int
+owl_model_baked_animation_init(struct owl_model_baked_animation *baked,
+                               struct owl_renderer *r, struct owl_model *model,
+                               int32_t animation, float frame_rate) {
+  int32_t i;
+  float frames;
+  uint64_t size;
+  uint64_t offset;
+  struct owl_model_instance instance;
+  int ret = OWL_OK;
+  VkDevice const device = r->device;
 
-static void owl_model_resolve_local_node_matrix(struct owl_model const *m,
-                                                int32_t id, owl_m4 matrix) {
-  owl_m4 tmp;
-  struct owl_model_node const *node = &m->nodes[id];
+  if (-1 >= animation || animation >= model->num_animations)
+    return OWL_ERROR_INVALID_VALUE;
 
-  OWL_M4_IDENTITY(matrix);
-  owl_m4_translate(node->translation, matrix);
+  if (0.0F >= frame_rate)
+    return OWL_ERROR_INVALID_VALUE;
 
-  OWL_M4_IDENTITY(tmp);
-  owl_q4_as_m4(node->rotation, tmp);
-  owl_m4_multiply(matrix, tmp, matrix);
+  OWL_MEMSET(baked, 0, sizeof(*baked));
 
-  OWL_M4_IDENTITY(tmp);
-  owl_m4_scale_v3(tmp, node->scale, tmp);
-  owl_m4_multiply(matrix, tmp, matrix);
+  /* enough frames to cover the whole animation */
+  frames = model->animations[animation].end * frame_rate;
 
-  owl_m4_multiply(matrix, node->matrix, matrix);
-}
+  baked->model = model;
+  baked->animation = animation;
+  baked->num_frames = OWL_MAX(1, (int32_t)frames);
+  if ((float)baked->num_frames < frames)
+    ++baked->num_frames;
+  baked->frame_size = model->num_nodes + model->num_joint_matrices;
+  baked->frame_rate = frame_rate;
 
-static void owl_model_resolve_node_matrix(struct owl_model const *m, int32_t id,
-                                          owl_m4 matrix) {
-  int32_t p;
+  size = sizeof(struct owl_model_baked_header) +
+         (uint64_t)baked->num_frames * baked->frame_size * sizeof(owl_m4);
 
-  owl_model_resolve_local_node_matrix(m, id, matrix);
+  {
+    VkBufferUsageFlags usage = 0;
+
+    usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    usage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
-  for (p = m->nodes[id].parent; - 1 != p; p = m->nodes[p].parent) {
-    owl_m4 local;
-    owl_model_resolve_local_node_matrix(m, p, local);
-    owl_m4_multiply(local, matrix, matrix);
+    ret = owl_model_create_buffer(r, size, usage, &baked->buffer);
+    if (ret)
+      goto error;
+
+    ret = owl_model_bind_buffers(r, 1, &baked->buffer,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                 &baked->memory, &offset);
+    if (ret)
+      goto error_destroy_buffer;
   }
-}
 
-static void owl_model_update_node_joints(struct owl_renderer *r,
-                                         struct owl_model *m, int32_t id) {
-  int32_t i;
-  owl_m4 tmp;
-  owl_m4 inverse;
-  struct owl_model_mesh const *mesh;
-  struct owl_model_skin const *skin;
-  struct owl_model_node const *node;
-  uint32_t const frame = r->frame;
+  ret = owl_model_instance_init_pose(&instance, model);
+  if (ret)
+    goto error_free_memory;
 
-  node = &m->nodes[id];
+  {
+    VkBufferCopy copy;
+    uint8_t *data;
+    owl_m4 *matrices;
+    struct owl_model_pose pose;
+    struct owl_model_baked_header *header;
+    struct owl_renderer_upload_allocation allocation;
 
-  for (i = 0; i < node->num_children; ++i)
-    owl_model_update_node_joints(r, m, node->children[i]);
+    ret = owl_renderer_begin_im_command_buffer(r);
+    if (ret)
+      goto error_free_pose;
 
-  if (-1 == node->mesh)
-    return;
+    data = owl_renderer_upload_allocate(r, size, &allocation);
+    if (!data) {
+      owl_renderer_end_im_command_buffer(r);
+      ret = OWL_ERROR_NO_MEMORY;
+      goto error_free_pose;
+    }
 
-  if (-1 == node->skin)
-    return;
+    header = (struct owl_model_baked_header *)data;
+    header->num_frames = baked->num_frames;
+    header->num_nodes = model->num_nodes;
+    header->frame_size = baked->frame_size;
+    header->frame_rate = frame_rate;
 
-  mesh = &m->meshes[node->mesh];
-  skin = &m->skins[node->skin];
+    matrices = (owl_m4 *)(data + sizeof(*header));
 
-  owl_model_resolve_node_matrix(m, id, tmp);
-  owl_m4_inverse(tmp, inverse);
+    owl_model_live_pose(&instance, &pose);
 
-#if 1
-  for (i = 0; i < skin->num_joints; ++i) {
-    struct owl_model_joints_ssbo *ssbo = mesh->mapped_ssbos[frame];
+    for (i = 0; i < baked->num_frames; ++i) {
+      owl_m4 *frame = &matrices[i * baked->frame_size];
+      float const time = OWL_MIN((float)i / frame_rate,
+                                 model->animations[animation].end);
 
-    owl_model_resolve_node_matrix(m, skin->joints[i], tmp);
-    owl_m4_multiply(tmp, skin->inverse_bind_matrices[i], tmp);
-    owl_m4_multiply(inverse, tmp, ssbo->joints[i]);
-  }
-#else
-  OWL_UNUSED(frame);
-  OWL_UNUSED(skin);
-#endif
-}
+      owl_model_sample_pose(&instance, animation, time, &pose);
+      owl_model_update_transforms(&instance);
 
-OWLAPI int owl_model_update_animation(struct owl_renderer *r,
-                                      struct owl_model *m, float dt,
-                                      int32_t id) {
-  int32_t i;
-  struct owl_model_animation *animation;
+      OWL_MEMCPY(frame, instance.world_matrices,
+                 model->num_nodes * sizeof(owl_m4));
+      owl_model_instance_build_joints(&instance, &frame[model->num_nodes]);
+    }
 
-  if (-1 >= id || id >= (int32_t)OWL_ARRAY_SIZE(m->animations))
-    return OWL_ERROR_FATAL; /* TODO(samuel0) invalid value */
+    copy.srcOffset = 0;
+    copy.dstOffset = 0;
+    copy.size = size;
 
-  animation = &m->animations[id];
+    vkCmdCopyBuffer(r->im_command_buffer, allocation.buffer, baked->buffer, 1,
+                    &copy);
 
-  if (animation->end < (animation->time += dt))
-    animation->time -= animation->end;
+    ret = owl_renderer_end_im_command_buffer(r);
+    owl_renderer_upload_free(r, data);
+    if (ret)
+      goto error_free_pose;
+  }
 
-  for (i = 0; i < animation->num_channels; ++i) {
-    int32_t j;
-    struct owl_model_animation_channel *channel;
-    struct owl_model_animation_sampler *sampler;
-    struct owl_model_node *node;
+  OWL_FREE(instance.storage);
 
-    channel = &m->channels[animation->channels[i]];
-    sampler = &m->samplers[channel->sampler];
-    node = &m->nodes[channel->node];
+  {
+    VkDescriptorSetAllocateInfo info;
+    VkResult vk_result;
 
-    if (OWL_ANIMATION_INTERPOLATION_LINEAR != sampler->interpolation)
-      continue;
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    info.pNext = NULL;
+    info.descriptorPool = r->descriptor_pool;
+    info.descriptorSetCount = 1;
+    info.pSetLayouts = &r->model_joints_descriptor_set_layout;
+
+    vk_result = vkAllocateDescriptorSets(device, &info,
+                                         &baked->descriptor_set);
+    if (vk_result) {
+      ret = OWL_ERROR_FATAL;
+      goto error_free_memory;
+    }
+  }
 
-    for (j = 0; j < sampler->num_inputs - 1; ++j) {
-      float const i0 = sampler->inputs[j];
-      float const i1 = sampler->inputs[j + 1];
-      float const time = animation->time;
-      float const a = (time - i0) / (i1 - i0);
+  {
+    VkDescriptorBufferInfo descriptor;
+    VkWriteDescriptorSet write;
+
+    descriptor.buffer = baked->buffer;
+    descriptor.offset = 0;
+    descriptor.range = size;
+
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = NULL;
+    write.dstSet = baked->descriptor_set;
+    write.dstBinding = 0;
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    write.pImageInfo = NULL;
+    write.pBufferInfo = &descriptor;
+    write.pTexelBufferView = NULL;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+  }
 
-      if (!((time >= i0) && (time <= i1)))
-        continue;
+  return OWL_OK;
 
-      switch (channel->path) {
-      case OWL_ANIMATION_PATH_TRANSLATION: {
-        owl_v3_mix(sampler->outputs[j], sampler->outputs[j + 1], a,
-                   node->translation);
-      } break;
+error_free_pose:
+  OWL_FREE(instance.storage);
 
-      case OWL_ANIMATION_PATH_ROTATION: {
-        owl_v4_quat_slerp(sampler->outputs[j], sampler->outputs[j + 1], a,
-                          node->rotation);
-        owl_v4_normalize(node->rotation, node->rotation);
-      } break;
+error_free_memory:
+  vkFreeMemory(device, baked->memory, NULL);
 
-      case OWL_ANIMATION_PATH_SCALE: {
-        owl_v3_mix(sampler->outputs[j], sampler->outputs[j + 1], a,
-                   node->scale);
-      } break;
+error_destroy_buffer:
+  vkDestroyBuffer(device, baked->buffer, NULL);
 
-      default:
-        OWL_ASSERT(0 && "unexpected path");
-        return OWL_ERROR_FATAL;
-      }
-    }
-  }
+error:
+  return ret;
+}
 
-  for (i = 0; i < m->num_roots; ++i)
-    owl_model_update_node_joints(r, m, m->roots[i]);
+OWLAPI void
+owl_model_baked_animation_deinit(struct owl_model_baked_animation *baked,
+                                 struct owl_renderer *r) {
+  VkDevice const device = r->device;
 
-  return OWL_OK;
+  vkDeviceWaitIdle(device);
+
+  vkFreeDescriptorSets(device, r->descriptor_pool, 1, &baked->descriptor_set);
+  vkFreeMemory(device, baked->memory, NULL);
+  vkDestroyBuffer(device, baked->buffer, NULL);
 }
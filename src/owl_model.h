@@ -2,8 +2,10 @@
 #define OWL_MODEL_H
 
 #include "owl_definitions.h"
+#include "owl_mesh.h"
 #include "owl_renderer.h"
 #include "owl_texture.h"
+#include "owl_thread.h"
 
 #include <vulkan/vulkan.h>
 
@@ -15,14 +17,19 @@ OWL_BEGIN_DECLARATIONS
 #define OWL_ALPHA_MODE_MASK 1
 #define OWL_ALPHA_MODE_BLEND 2
 
-struct owl_model_vertex {
-  owl_v3 position;
-  owl_v3 normal;
-  owl_v2 uv0;
-  owl_v2 uv1;
-  owl_v4 joints0;
-  owl_v4 weights0;
-  owl_v4 color0;
+/* the vertex buffer holds every position first and then every
+ * owl_model_vertex_attributes, depth only passes bind just the positions.
+ * quantized, the normal is octahedral encoded, the uvs are half floats and
+ * the weights and the color are unorm. the joints are 8 bit, models with
+ * vertices past the 256th joint of their skin fail to load. keep in sync
+ * with the vertex input of the model pipelines and owl_skin.comp */
+struct owl_model_vertex_attributes {
+  int16_t normal[2];
+  uint16_t uv0[2];
+  uint16_t uv1[2];
+  uint8_t joints0[4];
+  uint8_t weights0[4];
+  uint8_t color0[4];
 };
 
 struct owl_model_uniform {
@@ -73,55 +80,148 @@ struct owl_model_material {
   VkDescriptorSet descriptor_set;
 };
 
+#define OWL_MODEL_MAX_LODS 4
+
+/* a level of detail of a primitive, lod 0 is the primitive as loaded. the
+ * error is how far the simplified surface strays from it, in the space of
+ * the node */
+struct owl_model_lod {
+  uint32_t first;
+  uint32_t num_indices;
+  float error;
+  /* into owl_model::meshlets, static primitives get drawn a meshlet at a
+   * time */
+  int32_t first_meshlet;
+  int32_t num_meshlets;
+};
+
 struct owl_model_primitive {
   uint32_t first;
   uint32_t num_indices;
+  uint32_t first_vertex;
   uint32_t num_vertices;
   int32_t material;
   int32_t has_indices;
+  int32_t num_targets;
+  int32_t morph_offset;
+  int32_t num_lods;
+  struct owl_model_lod lods[OWL_MODEL_MAX_LODS];
   struct owl_model_bbox bbox;
 };
 
-struct owl_model_joints_ssbo {
-  owl_m4 matrix;
-  owl_m4 joints[128];
-  int32_t num_joints;
+/* morph target deltas of one vertex for one target, the targets of a vertex
+ * are contiguous */
+struct owl_model_morph_target {
+  owl_v4 position;
+  owl_v4 normal;
 };
 
+/* the primitives of a mesh are contiguous in owl_model::primitives */
 struct owl_model_mesh {
+  int32_t first_primitive;
   int32_t num_primitives;
-  int32_t primitives[128];
   struct owl_model_bbox bb;
   struct owl_model_bbox aabb;
+  /* the error of a lod is the largest of its primitives, the ones with fewer
+   * lods keep drawing their last */
+  int32_t num_lods;
+  float lod_errors[OWL_MODEL_MAX_LODS];
+  /* bounding sphere of the primitives, the lods are picked with it */
+  owl_v3 center;
+  float radius;
+};
+
+/* one entry per (node, primitive lod) pair or per (node, meshlet) pair, read
+ * by owl_cull.comp and by the vertex shader through gl_InstanceIndex, keep
+ * in sync with the glsl side */
+struct owl_model_draw {
+  owl_v4 min;
+  owl_v4 max;
+  /* the bounding sphere and the normal cone, see struct owl_mesh_meshlet */
+  owl_v4 sphere;
+  owl_v4 cone;
+  uint32_t first;
+  uint32_t num_indices;
+  int32_t node;
+  uint32_t batch;
+  uint32_t batch_first;
+  int32_t cull;
+  /* biased by the first vertex, the deltas of a vertex start at
+   * morph_offset + vertex * num_weights */
+  int32_t morph_offset;
+  /* the indices are relative to the first vertex of the primitive */
+  int32_t vertex_offset;
+  /* drawn while the lod of the node is in [min_lod, max_lod] */
+  int32_t min_lod;
+  int32_t max_lod;
+  int32_t padding[2];
+};
+
+/* draws sharing a material, drawn with a single indirect call */
+struct owl_model_batch {
+  int32_t material;
+  uint32_t first;
+  uint32_t num_draws;
+};
+
+/* one skinned or morphed (node, primitive) pair, the push constant of
+ * owl_skin.comp, keep in sync with the glsl side */
+struct owl_model_skin_job {
+  uint32_t first_vertex;
+  uint32_t num_vertices;
+  int32_t joints_offset;
+  int32_t num_joints;
+  int32_t weights_offset;
+  int32_t num_weights;
+  int32_t morph_offset;
+  /* in 32 bit words */
+  uint32_t attributes_offset;
+};
 
-  VkBuffer ssbos[OWL_NUM_IN_FLIGHT_FRAMES];
-  VkDeviceMemory ssbo_memory;
-  VkDescriptorSet ssbo_descriptor_sets[OWL_NUM_IN_FLIGHT_FRAMES];
-  struct owl_model_joints_ssbo *mapped_ssbos[OWL_NUM_IN_FLIGHT_FRAMES];
+struct owl_model_node_ssbo {
+  owl_m4 matrix;
+  int32_t joints_offset;
+  int32_t num_joints;
+  int32_t weights_offset;
+  int32_t num_weights;
+  /* picked every draw, see owl_model_draw::min_lod */
+  int32_t lod;
+  int32_t padding[3];
+};
+
+/* per frame input of owl_cull.comp, the occlusion matrix is last frame's
+ * clip matrix, the one the depth pyramid was built with */
+struct owl_model_cull_ssbo {
+  owl_v4 planes[6];
+  owl_m4 occlusion_matrix;
+  float pyramid_width;
+  float pyramid_height;
+  int32_t num_pyramid_levels;
+  int32_t occlusion;
+  uint32_t num_draws;
+  uint32_t num_batches;
+  uint32_t padding[2];
+  /* in the space of the model */
+  owl_v4 camera_position;
 };
 
 struct owl_model_skin {
-  char name[256];
+  char *name;
   int32_t root;
 
   int32_t num_inverse_bind_matrices;
-  owl_m4 inverse_bind_matrices[128];
+  owl_m4 *inverse_bind_matrices;
 
   int32_t num_joints;
-  int32_t joints[128];
+  int32_t *joints;
 };
 
+/* rarely touched node data, the rest pose lives in the node_* arrays of
+ * owl_model and the animated one in owl_model_instance */
 struct owl_model_node {
-  char name[256];
-  int32_t parent;
+  char *name;
   int32_t num_children;
-  int32_t children[128];
-  int32_t mesh;
-  int32_t skin;
-  owl_m4 matrix;
-  owl_v3 translation;
-  owl_v3 scale;
-  owl_v4 rotation;
+  int32_t *children;
   struct owl_model_bbox bvh;
   struct owl_model_bbox aabb;
 };
@@ -145,22 +245,22 @@ struct owl_model_animation_sampler {
   int32_t interpolation;
 
   int32_t num_inputs;
-  float inputs[128];
+  float *inputs;
 
   int32_t num_outputs;
-  owl_v4 outputs[128];
+  owl_v4 *outputs;
 };
 
+/* samplers and channels of an animation are contiguous in owl_model */
 struct owl_model_animation {
-  char name[256];
+  char *name;
 
+  int32_t first_sampler;
   int32_t num_samplers;
-  int32_t samplers[128];
 
+  int32_t first_channel;
   int32_t num_channels;
-  int32_t channels[128];
 
-  float time;
   float start;
   float end;
 };
@@ -190,64 +290,357 @@ struct owl_model_texture {
   int32_t image;
 };
 
+struct owl_model;
+
+/* node transforms and morph weights, indexed like the node_* arrays */
+struct owl_model_pose {
+  owl_v3 *translations;
+  owl_v4 *rotations;
+  owl_v3 *scales;
+  float *weights;
+};
+
+/* animation level of detail, picked by owl_model_update_instances from the
+ * projected size of an instance. full samples every update, blended samples
+ * ahead every few updates and blends towards it, held samples every few
+ * updates and frozen only moves the time */
+#define OWL_MODEL_ANIMATION_LOD_FULL 0
+#define OWL_MODEL_ANIMATION_LOD_BLENDED 1
+#define OWL_MODEL_ANIMATION_LOD_HELD 2
+#define OWL_MODEL_ANIMATION_LOD_FROZEN 3
+
+/* the mutable state of a model, a model is loaded once and can be shared by
+ * many instances, each one with its own animation time and pose and with the
+ * per frame buffers a draw writes to. the geometry, the materials and the
+ * animation data stay in the model */
+struct owl_model_instance {
+  struct owl_model *model;
+
+  /* every array below points into storage */
+  void *storage;
+
+  /* time of every animation of the model */
+  float *animation_times;
+
+  /* last keyframe used by every channel, the search starts from here next
+   * update */
+  int32_t *keyframes;
+
+  int32_t *dirty_nodes;
+  owl_v3 *node_translations;
+  owl_v4 *node_rotations;
+  owl_v3 *node_scales;
+  owl_m4 *local_matrices;
+  owl_m4 *world_matrices;
+  float *weights;
+
+  /* the animation lod of the last update, lod_source and lod_target hold the
+   * pose at the last sample and the one lod_interval seconds ahead of it,
+   * only the nodes and weights the animation touches are valid */
+  int32_t animation_lod;
+  float lod_elapsed;
+  float lod_interval;
+  struct owl_model_pose lod_source;
+  struct owl_model_pose lod_target;
+
+  /* bumped every time the pose changes, the compute skinning of a frame is
+   * skipped if its skinned vertices were built from the current pose */
+  uint64_t pose_version;
+  uint64_t skinned_pose_versions[OWL_NUM_IN_FLIGHT_FRAMES];
+
+  /* the joint palette is built straight into the renderer's storage ring,
+   * either by owl_model_update_instances for frame joints_frame or when
+   * drawn */
+  uint64_t joints_frame;
+  struct owl_renderer_storage_allocation joints_allocation;
+
+  /* the frame and the matrix the nodes, skinning, culling and uniform were
+   * last set up for, by whichever of owl_draw_model_instance_depth and
+   * owl_draw_model_instance came first, the other one reuses them */
+  uint64_t draw_frame;
+  owl_m4 draw_matrix;
+  struct owl_renderer_uniform_allocation uniform_allocation;
+
+  /* written by owl_skin.comp when compute skinning is enabled, a copy of the
+   * vertex buffer with the skinned positions and normals */
+  VkBuffer skinned_vertex_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkDeviceMemory skinned_vertex_memory;
+
+  VkBuffer node_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkBuffer cull_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkBuffer stats_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkBuffer weight_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkDeviceMemory frame_memory;
+  struct owl_model_node_ssbo *mapped_nodes[OWL_NUM_IN_FLIGHT_FRAMES];
+  struct owl_model_cull_ssbo *mapped_culls[OWL_NUM_IN_FLIGHT_FRAMES];
+  struct owl_renderer_cull_stats *mapped_stats[OWL_NUM_IN_FLIGHT_FRAMES];
+  float *mapped_weights[OWL_NUM_IN_FLIGHT_FRAMES];
+
+  VkBuffer indirect_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkBuffer count_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkDeviceMemory indirect_memory;
+
+  VkDescriptorSet draw_descriptor_sets[OWL_NUM_IN_FLIGHT_FRAMES];
+};
+
 struct owl_model {
   char path[256];
   char directory[256];
 
+  int32_t num_vertices;
+  uint64_t vertex_attributes_offset;
   VkBuffer vertex_buffer;
   VkDeviceMemory vertex_memory;
 
   int32_t has_indices;
+  VkIndexType index_type;
   VkBuffer index_buffer;
   VkDeviceMemory index_memory;
 
   int32_t active_animation;
 
+  struct owl_texture empty_texture;
+
+  /* every array below points into storage, a single allocation sized from
+   * the gltf counts */
+  uint64_t storage_size;
+  void *storage;
+
   int32_t num_roots;
-  int32_t roots[128];
+  int32_t *roots;
+
+  /* hot node data, one entry per node, node_order has parents before their
+   * children, the transforms are the rest pose */
+  int32_t num_nodes;
+  int32_t *node_order;
+  int32_t *node_parents;
+  int32_t *node_meshes;
+  int32_t *node_skins;
+  int32_t *node_joints_offsets;
+  int32_t *node_weights_offsets;
+  int32_t *node_num_weights;
+  owl_v3 *node_translations;
+  owl_v4 *node_rotations;
+  owl_v3 *node_scales;
+  owl_m4 *node_matrices;
+
+  /* cold node data, names and children */
+  struct owl_model_node *nodes;
+
+  /* rest morph target weights of every node */
+  int32_t num_weights;
+  float *weights;
+
+  int32_t num_images;
+  struct owl_model_image *images;
+
+  int32_t num_textures;
+  struct owl_model_texture *textures;
+
+  int32_t num_materials;
+  struct owl_model_material *materials;
+
+  int32_t num_meshes;
+  struct owl_model_mesh *meshes;
 
-  struct owl_texture empty_texture;
+  int32_t num_primitives;
+  struct owl_model_primitive *primitives;
 
-  int num_nodes;
-  struct owl_model_node nodes[128];
+  int32_t num_meshlets;
+  struct owl_mesh_meshlet *meshlets;
 
-  int num_images;
-  struct owl_model_image images[128];
+  int32_t num_skins;
+  struct owl_model_skin *skins;
 
-  int num_textures;
-  struct owl_model_texture textures[128];
+  int32_t num_samplers;
+  struct owl_model_animation_sampler *samplers;
 
-  int num_materials;
-  struct owl_model_material materials[128];
+  int32_t num_channels;
+  struct owl_model_animation_channel *channels;
+
+  int32_t num_animations;
+  struct owl_model_animation *animations;
+
+  int32_t num_draws;
+  struct owl_model_draw *draws;
+
+  int32_t num_batches;
+  struct owl_model_batch *batches;
 
-  int num_meshes;
-  struct owl_model_mesh meshes[128];
+  int32_t num_skin_jobs;
+  struct owl_model_skin_job *skin_jobs;
 
-  int num_primitives;
-  struct owl_model_primitive primitives[256];
+  /* size of the joint palette of an instance, node_joints_offsets index
+   * into it */
+  int32_t num_joint_matrices;
 
-  int num_skins;
-  struct owl_model_skin skins[128];
+  /* bounding sphere of the rest pose in model space */
+  owl_v3 bounding_center;
+  float bounding_radius;
 
-  int num_samplers;
-  struct owl_model_animation_sampler samplers[128];
+  /* lod errors of the whole model in model space, the largest of its
+   * meshes in the rest pose */
+  int32_t num_lods;
+  float lod_errors[OWL_MODEL_MAX_LODS];
 
-  int num_channels;
-  struct owl_model_animation_channel channels[128];
+  VkBuffer draw_buffer;
+  VkDeviceMemory draw_memory;
 
-  int num_animations;
-  struct owl_model_animation animations[128];
+  VkBuffer target_buffer;
+  VkDeviceMemory target_memory;
+
+  /* used by owl_model_update_animation and owl_draw_model */
+  struct owl_model_instance instance;
+
+  /* set while owl_model_load_async is in flight, none of the above may be
+   * touched until owl_model_update_load clears it */
+  void *loading;
 };
 
 OWLAPI int owl_model_init(struct owl_model *model, struct owl_renderer *r,
                           char const *path);
 
+/* starts loading the model on a thread of its own and returns right away,
+ * the gltf is parsed and the images are decoded there. owl_draw_model and
+ * owl_model_update_animation skip the model until it is resident */
+OWLAPI int owl_model_load_async(struct owl_model *model,
+                                struct owl_renderer *r, char const *path);
+
+/* does the next step of the gpu side of owl_model_load_async if the loading
+ * thread got to it and the uploads of the last step are done, at most an
+ * upload. the uploads are submitted without waiting for them. call it once a
+ * frame outside of owl_renderer_begin_frame and owl_renderer_end_frame. if a
+ * step fails everything the load got to is torn down, the error is returned
+ * from then on and owl_model_deinit only frees the rest */
+OWLAPI int owl_model_update_load(struct owl_model *model,
+                                 struct owl_renderer *r);
+
+/* how much of owl_model_load_async is done, from 0 to 1 */
+OWLAPI float owl_model_load_progress(struct owl_model *model);
+
+/* waits for the loading thread and does every step left */
+OWLAPI int owl_model_finish_load(struct owl_model *model,
+                                 struct owl_renderer *r);
+
+/* loads a model written by owl_model_cook, the file is mapped and the
+ * geometry and the images are copied from it straight into the upload
+ * buffer */
+OWLAPI int owl_model_init_cooked(struct owl_model *model,
+                                 struct owl_renderer *r, char const *path);
+
+/* runs the cpu side of owl_model_init with every mesh optimization on and
+ * writes the result to cooked_path, the geometry in the layout of the gpu
+ * buffers and the images with all their mipmap levels. see examples/cook.c */
+OWLAPI int owl_model_cook(char const *path, char const *cooked_path);
+
 OWLAPI void owl_model_deinit(struct owl_model *model, struct owl_renderer *r);
 
 OWLAPI int owl_model_update_animation(struct owl_renderer *r,
                                       struct owl_model *m, float dt,
                                       int32_t animation);
 
+OWLAPI int owl_model_instance_init(struct owl_model_instance *instance,
+                                   struct owl_renderer *r,
+                                   struct owl_model *model);
+
+OWLAPI void owl_model_instance_deinit(struct owl_model_instance *instance,
+                                      struct owl_renderer *r);
+
+OWLAPI int
+owl_model_instance_update_animation(struct owl_renderer *r,
+                                    struct owl_model_instance *instance,
+                                    float dt, int32_t animation);
+
+/* writes the model's num_joint_matrices joint matrices of the current pose
+ * into palette */
+OWLAPI void
+owl_model_instance_build_joints(struct owl_model_instance const *instance,
+                                owl_m4 *palette);
+
+/* returns the height of the model's bounding sphere drawn with matrix as a
+ * fraction of the viewport height, 0 if it is outside of the view */
+OWLAPI float owl_model_screen_size(struct owl_renderer const *r,
+                                   struct owl_model const *m, owl_m4 matrix);
+
+OWLAPI float
+owl_model_instance_screen_size(struct owl_renderer const *r,
+                               struct owl_model_instance const *instance,
+                               owl_m4 matrix);
+
+struct owl_model_instance_update {
+  struct owl_model_instance *instance;
+  int32_t animation;
+  float dt;
+  /* from owl_model_instance_screen_size, 1 always animates at full rate */
+  float screen_size;
+};
+
+/* updates the animation of every instance and builds the joint palettes the
+ * draws of this frame read into its storage ring, spread across the threads
+ * of pool (NULL runs everything on the calling thread). the smaller an
+ * instance is on screen the less often its animation is sampled. an
+ * instance can only appear once, pass &model->instance to update a model.
+ * returns the first error of the updates, no palette is built then */
+OWLAPI int
+owl_model_update_instances(struct owl_renderer *r, struct owl_thread_pool *pool,
+                           int32_t num_updates,
+                           struct owl_model_instance_update const *updates);
+
+/* header of a baked animation buffer, keep in sync with owl_baked.vert */
+struct owl_model_baked_header {
+  int32_t num_frames;
+  int32_t num_nodes;
+  int32_t frame_size;
+  float frame_rate;
+};
+
+/* vertex push constants of owl_baked.vert, placed right after
+ * owl_model_push_constant */
+struct owl_model_baked_push_constant {
+  int32_t draw;
+  int32_t joints_offset;
+  int32_t num_joints;
+};
+
+/* an animation of a model sampled at a fixed rate, every frame holds the
+ * world matrix of every node followed by the joint palette. played back
+ * entirely on the gpu by owl_draw_model_baked, morph targets are not
+ * baked */
+struct owl_model_baked_animation {
+  struct owl_model *model;
+  int32_t animation;
+  int32_t num_frames;
+  int32_t frame_size;
+  float frame_rate;
+
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  VkDescriptorSet descriptor_set;
+};
+
+/* one character of a baked crowd, keep in sync with owl_baked.vert */
+struct owl_model_baked_instance {
+  owl_m4 matrix;
+  float time;
+  float padding[3];
+};
+
+OWLAPI int
+owl_model_baked_animation_init(struct owl_model_baked_animation *baked,
+                               struct owl_renderer *r, struct owl_model *model,
+                               int32_t animation, float frame_rate);
+
+OWLAPI void
+owl_model_baked_animation_deinit(struct owl_model_baked_animation *baked,
+                                 struct owl_renderer *r);
+
+/* returns the keyframe k such that inputs[k] <= time <= inputs[k + 1] or -1
+ * if time is outside of the sampler, hint is checked first (and the one after
+ * it) before falling back to a binary search */
+OWLAPI int32_t
+owl_model_find_keyframe(struct owl_model_animation_sampler const *sampler,
+                        int32_t hint, float time);
+
 OWL_END_DECLARATIONS
 
 #endif
@@ -1,3 +1,6 @@
+/* posix_madvise */
+#define _POSIX_C_SOURCE 200809L
+
 #include "owl_plataform.h"
 
 #include "owl_internal.h"
@@ -11,7 +14,11 @@
 #include <GLFW/glfw3.h>
 /* clang-format on */
 
+#include <fcntl.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 OWLAPI int owl_plataform_init(struct owl_plataform *plataform, int w, int h,
                               char const *title) {
@@ -139,31 +146,72 @@ owl_plataform_get_title(struct owl_plataform const *plataform) {
 
 OWLAPI int owl_plataform_load_file(char const *path,
                                    struct owl_plataform_file *file) {
-  FILE *fp = NULL;
+  int ret;
+
+  ret = owl_plataform_map_file(path, file);
+  if (ret)
+    return ret;
+
+  /* the whole file is about to be read, start reading it in */
+  posix_madvise(file->data, file->size, POSIX_MADV_WILLNEED);
+
+  return ret;
+}
+
+OWLAPI void owl_plataform_unload_file(struct owl_plataform_file *file) {
+  owl_plataform_unmap_file(file);
+}
+
+OWLAPI int owl_plataform_map_file(char const *path,
+                                  struct owl_plataform_file *file) {
+  int fd;
+  void *data;
+  struct stat st;
   int ret = OWL_OK;
 
-  fp = fopen(path, "rb");
-  if (fp) {
-    fseek(fp, 0, SEEK_END);
-    file->size = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+  file->path = path;
+  file->size = 0;
+  file->data = NULL;
 
-    file->data = OWL_MALLOC(file->size * sizeof(char));
-    if (file->data)
-      fread(file->data, file->size, 1, fp);
-    else
-      ret = OWL_ERROR_NO_MEMORY;
+  fd = open(path, O_RDONLY);
+  if (-1 == fd)
+    return OWL_ERROR_NOT_FOUND;
 
-    fclose(fp);
-  } else {
-    ret = OWL_ERROR_NOT_FOUND;
+  if (fstat(fd, &st) || !st.st_size) {
+    ret = OWL_ERROR_FATAL;
+    goto out_close;
   }
 
-  file->path = path;
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == data) {
+    ret = OWL_ERROR_FATAL;
+    goto out_close;
+  }
+
+  file->size = st.st_size;
+  file->data = data;
+
+out_close:
+  close(fd);
 
   return ret;
 }
 
-OWLAPI void owl_plataform_unload_file(struct owl_plataform_file *file) {
-  OWL_FREE(file->data);
+OWLAPI void owl_plataform_unmap_file(struct owl_plataform_file *file) {
+  if (file->data)
+    munmap(file->data, file->size);
+
+  file->data = NULL;
+  file->size = 0;
+}
+
+OWLAPI int owl_plataform_get_file_time(char const *path, uint64_t *modified) {
+  struct stat info;
+
+  if (stat(path, &info))
+    return OWL_ERROR_NOT_FOUND;
+
+  *modified = (uint64_t)info.st_mtime;
+
+  return OWL_OK;
 }
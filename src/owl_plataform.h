@@ -48,11 +48,24 @@ OWLAPI void owl_plataform_poll_events(struct owl_plataform *plataform);
 
 OWLAPI double owl_plataform_get_time(struct owl_plataform *plataform);
 
+/* a read only view of the whole file for when all of it is needed right
+ * away, a mapping the kernel starts reading in. the data must not be
+ * written */
 OWLAPI int owl_plataform_load_file(char const *path,
                                    struct owl_plataform_file *file);
 
 OWLAPI void owl_plataform_unload_file(struct owl_plataform_file *file);
 
+/* maps the file read only instead of reading it, the pages are read as they
+ * are touched */
+OWLAPI int owl_plataform_map_file(char const *path,
+                                  struct owl_plataform_file *file);
+
+OWLAPI void owl_plataform_unmap_file(struct owl_plataform_file *file);
+
+/* the last modification time of the file in seconds */
+OWLAPI int owl_plataform_get_file_time(char const *path, uint64_t *modified);
+
 OWL_END_DECLARATIONS
 
 #endif
@@ -5,6 +5,7 @@
 #include "owl_model.h"
 #include "owl_plataform.h"
 #include "owl_texture.h"
+#include "owl_thread.h"
 #include "owl_vector_math.h"
 
 #ifndef OWL_POW
@@ -15,6 +16,7 @@
 #include <stdio.h>
 
 #define OWL_DEFAULT_BUFFER_SIZE (1 << 16)
+#define OWL_DEFAULT_STORAGE_RANGE (1 << 16)
 
 #if defined(OWL_ENABLE_VALIDATION)
 
@@ -297,6 +299,41 @@ cleanup:
   return found_required_extensions;
 }
 
+static int owl_renderer_has_device_extension(struct owl_renderer *r,
+                                             char const *name) {
+  int32_t found = 0;
+  uint32_t i;
+  uint32_t num_supported_extensions;
+  VkResult vk_result;
+  VkExtensionProperties *supported_extensions;
+  VkPhysicalDevice const device = r->physical_device;
+
+  vk_result = vkEnumerateDeviceExtensionProperties(
+      device, NULL, &num_supported_extensions, NULL);
+  if (vk_result)
+    return 0;
+
+  supported_extensions =
+      OWL_MALLOC(num_supported_extensions * sizeof(*supported_extensions));
+  if (!supported_extensions)
+    return 0;
+
+  vk_result = vkEnumerateDeviceExtensionProperties(
+      device, NULL, &num_supported_extensions, supported_extensions);
+  if (vk_result)
+    goto cleanup;
+
+  for (i = 0; i < num_supported_extensions && !found; ++i)
+    if (0 == OWL_STRNCMP(supported_extensions[i].extensionName, name,
+                         VK_MAX_EXTENSION_NAME_SIZE))
+      found = 1;
+
+cleanup:
+  OWL_FREE(supported_extensions);
+
+  return found;
+}
+
 static int owl_renderer_request_surface_format(struct owl_renderer *r,
                                                VkFormat format,
                                                VkColorSpaceKHR color_space) {
@@ -491,6 +528,9 @@ cleanup:
 }
 
 static int owl_renderer_init_device(struct owl_renderer *r) {
+  uint32_t i;
+  uint32_t num_extensions;
+  char const *extensions[OWL_ARRAY_SIZE(device_extensions) + 1];
   VkPhysicalDeviceFeatures features;
   VkDeviceCreateInfo info;
   VkDeviceQueueCreateInfo queue_infos[2];
@@ -498,6 +538,17 @@ static int owl_renderer_init_device(struct owl_renderer *r) {
   VkResult vk_result = VK_SUCCESS;
   int ret = OWL_OK;
 
+  for (i = 0; i < OWL_ARRAY_SIZE(device_extensions); ++i)
+    extensions[i] = device_extensions[i];
+
+  num_extensions = OWL_ARRAY_SIZE(device_extensions);
+
+  /* optional, lets the gpu culling pass decide how many draws to issue */
+  r->has_draw_indirect_count = owl_renderer_has_device_extension(
+      r, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+  if (r->has_draw_indirect_count)
+    extensions[num_extensions++] = VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME;
+
   queue_infos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
   queue_infos[0].pNext = NULL;
   queue_infos[0].flags = 0;
@@ -513,6 +564,9 @@ static int owl_renderer_init_device(struct owl_renderer *r) {
   queue_infos[1].pQueuePriorities = &priority;
 
   vkGetPhysicalDeviceFeatures(r->physical_device, &features);
+  r->has_multi_draw_indirect = features.multiDrawIndirect;
+  r->has_pipeline_statistics = features.pipelineStatisticsQuery;
+  r->has_texture_compression_bc = features.textureCompressionBC;
 
   info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
   info.pNext = NULL;
@@ -525,8 +579,8 @@ static int owl_renderer_init_device(struct owl_renderer *r) {
   info.pQueueCreateInfos = queue_infos;
   info.enabledLayerCount = 0;      /* deprecated */
   info.ppEnabledLayerNames = NULL; /* deprecated */
-  info.enabledExtensionCount = OWL_ARRAY_SIZE(device_extensions);
-  info.ppEnabledExtensionNames = device_extensions;
+  info.enabledExtensionCount = num_extensions;
+  info.ppEnabledExtensionNames = extensions;
   info.pEnabledFeatures = &features;
 
   vk_result = vkCreateDevice(r->physical_device, &info, NULL, &r->device);
@@ -536,6 +590,17 @@ static int owl_renderer_init_device(struct owl_renderer *r) {
   vkGetDeviceQueue(r->device, r->graphics_family, 0, &r->graphics_queue);
   vkGetDeviceQueue(r->device, r->present_family, 0, &r->present_queue);
 
+  r->vk_cmd_draw_indexed_indirect_count_khr = NULL;
+  if (r->has_draw_indirect_count) {
+    PFN_vkVoidFunction fn;
+
+    fn = vkGetDeviceProcAddr(r->device, "vkCmdDrawIndexedIndirectCountKHR");
+    r->vk_cmd_draw_indexed_indirect_count_khr =
+        (PFN_vkCmdDrawIndexedIndirectCountKHR)fn;
+    if (!r->vk_cmd_draw_indexed_indirect_count_khr)
+      r->has_draw_indirect_count = 0;
+  }
+
   return ret;
 }
 
@@ -664,7 +729,9 @@ static int owl_renderer_init_attachments(struct owl_renderer *r) {
     info.arrayLayers = 1;
     info.samples = r->msaa;
     info.tiling = VK_IMAGE_TILING_OPTIMAL;
-    info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    info.usage = 0;
+    info.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    info.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
     info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     info.queueFamilyIndexCount = 0;
     info.pQueueFamilyIndices = NULL;
@@ -766,7 +833,7 @@ static int owl_renderer_init_render_passes(struct owl_renderer *r) {
   VkAttachmentReference resolve_reference;
   VkAttachmentDescription attachments[3];
   VkSubpassDescription subpass;
-  VkSubpassDependency dependency;
+  VkSubpassDependency dependencies[2];
   VkRenderPassCreateInfo info;
   VkResult vk_result;
   VkDevice const device = r->device;
@@ -796,11 +863,12 @@ static int owl_renderer_init_render_passes(struct owl_renderer *r) {
   attachments[1].format = r->depth_format;
   attachments[1].samples = r->msaa;
   attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  /* kept around to build the depth pyramid */
+  attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
   /* color resolve */
   attachments[2].flags = 0;
@@ -824,19 +892,31 @@ static int owl_renderer_init_render_passes(struct owl_renderer *r) {
   subpass.preserveAttachmentCount = 0;
   subpass.pPreserveAttachments = NULL;
 
-  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.dstSubpass = 0;
-  dependency.srcStageMask = 0;
-  dependency.srcStageMask |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.srcStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-  dependency.dstStageMask = 0;
-  dependency.dstStageMask |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  dependency.dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-  dependency.srcAccessMask = 0;
-  dependency.dstAccessMask = 0;
-  dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-  dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-  dependency.dependencyFlags = 0;
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = 0;
+  dependencies[0].srcStageMask |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].srcStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  /* last frame's depth pyramid build reads the depth attachment */
+  dependencies[0].srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  dependencies[0].dstStageMask = 0;
+  dependencies[0].dstStageMask |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstAccessMask = 0;
+  dependencies[0].dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dependencyFlags = 0;
+
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = 0;
+  dependencies[1].srcStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[1].srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  dependencies[1].dependencyFlags = 0;
 
   info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
   info.pNext = NULL;
@@ -845,8 +925,8 @@ static int owl_renderer_init_render_passes(struct owl_renderer *r) {
   info.pAttachments = attachments;
   info.subpassCount = 1;
   info.pSubpasses = &subpass;
-  info.dependencyCount = 1;
-  info.pDependencies = &dependency;
+  info.dependencyCount = OWL_ARRAY_SIZE(dependencies);
+  info.pDependencies = dependencies;
 
   vk_result = vkCreateRenderPass(device, &info, NULL, &r->main_render_pass);
   if (vk_result)
@@ -1028,7 +1108,7 @@ static int owl_renderer_init_pools(struct owl_renderer *r) {
   }
 
   {
-    VkDescriptorPoolSize sizes[7];
+    VkDescriptorPoolSize sizes[8];
     VkDescriptorPoolCreateInfo info;
     VkResult vk_result = VK_SUCCESS;
 
@@ -1047,12 +1127,16 @@ static int owl_renderer_init_pools(struct owl_renderer *r) {
     sizes[4].descriptorCount = 256;
     sizes[4].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 
-    sizes[5].descriptorCount = 256;
+    /* every model instance takes a set of 10 per frame */
+    sizes[5].descriptorCount = 4096;
     sizes[5].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 
     sizes[6].descriptorCount = 256;
     sizes[6].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
 
+    sizes[7].descriptorCount = 256;
+    sizes[7].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
     info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     info.pNext = NULL;
     info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
@@ -1230,8 +1314,56 @@ static int owl_renderer_init_shaders(struct owl_renderer *r) {
       goto error_destroy_skybox_vertex_shader;
   }
 
+  {
+    VkShaderModuleCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    static uint32_t const spv[] = {
+#include "owl_baked.vert.spv.u32"
+    };
+
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.codeSize = sizeof(spv);
+    info.pCode = spv;
+
+    vk_result = vkCreateShaderModule(device, &info, NULL,
+                                     &r->model_baked_vertex_shader);
+
+    if (vk_result)
+      goto error_destroy_skybox_fragment_shader;
+  }
+
+  {
+    VkShaderModuleCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    static uint32_t const spv[] = {
+#include "owl_depth.vert.spv.u32"
+    };
+
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.codeSize = sizeof(spv);
+    info.pCode = spv;
+
+    vk_result = vkCreateShaderModule(device, &info, NULL,
+                                     &r->model_depth_vertex_shader);
+
+    if (vk_result)
+      goto error_destroy_model_baked_vertex_shader;
+  }
+
   return OWL_OK;
 
+error_destroy_model_baked_vertex_shader:
+  vkDestroyShaderModule(device, r->model_baked_vertex_shader, NULL);
+
+error_destroy_skybox_fragment_shader:
+  vkDestroyShaderModule(device, r->skybox_fragment_shader, NULL);
+
 error_destroy_skybox_vertex_shader:
   vkDestroyShaderModule(device, r->skybox_vertex_shader, NULL);
 
@@ -1256,6 +1388,8 @@ error:
 
 static void owl_renderer_deinit_shaders(struct owl_renderer *r) {
   VkDevice const device = r->device;
+  vkDestroyShaderModule(device, r->model_depth_vertex_shader, NULL);
+  vkDestroyShaderModule(device, r->model_baked_vertex_shader, NULL);
   vkDestroyShaderModule(device, r->skybox_fragment_shader, NULL);
   vkDestroyShaderModule(device, r->skybox_vertex_shader, NULL);
   vkDestroyShaderModule(device, r->model_fragment_shader, NULL);
@@ -1368,21 +1502,28 @@ static int owl_renderer_init_layouts(struct owl_renderer *r) {
   }
 
   {
-    VkDescriptorSetLayoutBinding binding;
+    uint32_t i;
+    VkDescriptorSetLayoutBinding bindings[10];
     VkDescriptorSetLayoutCreateInfo info;
     VkResult vk_result = VK_SUCCESS;
 
-    binding.binding = 0;
-    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    binding.descriptorCount = 1;
-    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    binding.pImmutableSamplers = NULL;
+    /* draws, nodes, indirect commands, draw counts, culling input, culling
+     * stats, morph targets, morph weights, vertices and skinned vertices */
+    for (i = 0; i < OWL_ARRAY_SIZE(bindings); ++i) {
+      bindings[i].binding = i;
+      bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bindings[i].descriptorCount = 1;
+      bindings[i].stageFlags = 0;
+      bindings[i].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+      bindings[i].stageFlags |= VK_SHADER_STAGE_COMPUTE_BIT;
+      bindings[i].pImmutableSamplers = NULL;
+    }
 
     info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     info.pNext = NULL;
     info.flags = 0;
-    info.bindingCount = 1;
-    info.pBindings = &binding;
+    info.bindingCount = OWL_ARRAY_SIZE(bindings);
+    info.pBindings = bindings;
 
     vk_result = vkCreateDescriptorSetLayout(
         device, &info, NULL, &r->model_storage_descriptor_set_layout);
@@ -1479,7 +1620,33 @@ static int owl_renderer_init_layouts(struct owl_renderer *r) {
   }
 
   {
-    VkDescriptorSetLayout layouts[4];
+    VkDescriptorSetLayoutBinding binding;
+    VkDescriptorSetLayoutCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    /* joint palettes, sub-allocated from the storage ring */
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = 0;
+    binding.stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    binding.stageFlags |= VK_SHADER_STAGE_COMPUTE_BIT;
+    binding.pImmutableSamplers = NULL;
+
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.bindingCount = 1;
+    info.pBindings = &binding;
+
+    vk_result = vkCreateDescriptorSetLayout(
+        device, &info, NULL, &r->model_joints_descriptor_set_layout);
+    if (vk_result)
+      goto error_destroy_model_environment_descriptor_set_layout;
+  }
+
+  {
+    VkDescriptorSetLayout layouts[5];
     VkPushConstantRange push_constant;
     VkPipelineLayoutCreateInfo info;
     VkResult vk_result = VK_SUCCESS;
@@ -1492,6 +1659,7 @@ static int owl_renderer_init_layouts(struct owl_renderer *r) {
     layouts[1] = r->model_storage_descriptor_set_layout;
     layouts[2] = r->model_maps_descriptor_set_layout;
     layouts[3] = r->model_environment_descriptor_set_layout;
+    layouts[4] = r->model_joints_descriptor_set_layout;
 
     info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     info.pNext = NULL;
@@ -1504,11 +1672,193 @@ static int owl_renderer_init_layouts(struct owl_renderer *r) {
     vk_result =
         vkCreatePipelineLayout(device, &info, NULL, &r->model_pipeline_layout);
     if (vk_result)
-      goto error_destroy_model_environment_descriptor_set_layout;
+      goto error_destroy_model_joints_descriptor_set_layout;
+  }
+
+  {
+    VkDescriptorSetLayoutBinding binding;
+    VkDescriptorSetLayoutCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    binding.pImmutableSamplers = NULL;
+
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.bindingCount = 1;
+    info.pBindings = &binding;
+
+    vk_result = vkCreateDescriptorSetLayout(
+        device, &info, NULL, &r->depth_pyramid_descriptor_set_layout);
+    if (vk_result)
+      goto error_destroy_model_pipeline_layout;
+  }
+
+  {
+    VkDescriptorSetLayoutBinding bindings[2];
+    VkDescriptorSetLayoutCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[0].pImmutableSamplers = NULL;
+
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].pImmutableSamplers = NULL;
+
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.bindingCount = OWL_ARRAY_SIZE(bindings);
+    info.pBindings = bindings;
+
+    vk_result = vkCreateDescriptorSetLayout(
+        device, &info, NULL, &r->depth_pyramid_build_descriptor_set_layout);
+    if (vk_result)
+      goto error_destroy_depth_pyramid_descriptor_set_layout;
+  }
+
+  {
+    VkDescriptorSetLayout layouts[2];
+    VkPipelineLayoutCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    layouts[0] = r->model_storage_descriptor_set_layout;
+    layouts[1] = r->depth_pyramid_descriptor_set_layout;
+
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.setLayoutCount = OWL_ARRAY_SIZE(layouts);
+    info.pSetLayouts = layouts;
+    info.pushConstantRangeCount = 0;
+    info.pPushConstantRanges = NULL;
+
+    vk_result = vkCreatePipelineLayout(device, &info, NULL,
+                                       &r->model_cull_pipeline_layout);
+    if (vk_result)
+      goto error_destroy_depth_pyramid_build_descriptor_set_layout;
+  }
+
+  {
+    VkPipelineLayoutCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.setLayoutCount = 1;
+    info.pSetLayouts = &r->depth_pyramid_build_descriptor_set_layout;
+    info.pushConstantRangeCount = 0;
+    info.pPushConstantRanges = NULL;
+
+    vk_result = vkCreatePipelineLayout(device, &info, NULL,
+                                       &r->depth_pyramid_pipeline_layout);
+    if (vk_result)
+      goto error_destroy_model_cull_pipeline_layout;
+  }
+
+  {
+    VkDescriptorSetLayout layouts[2];
+    VkPushConstantRange range;
+    VkPipelineLayoutCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    range.offset = 0;
+    range.size = sizeof(struct owl_model_skin_job);
+
+    layouts[0] = r->model_storage_descriptor_set_layout;
+    layouts[1] = r->model_joints_descriptor_set_layout;
+
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.setLayoutCount = OWL_ARRAY_SIZE(layouts);
+    info.pSetLayouts = layouts;
+    info.pushConstantRangeCount = 1;
+    info.pPushConstantRanges = &range;
+
+    vk_result = vkCreatePipelineLayout(device, &info, NULL,
+                                       &r->model_skin_pipeline_layout);
+    if (vk_result)
+      goto error_destroy_depth_pyramid_pipeline_layout;
+  }
+
+  {
+    VkDescriptorSetLayout layouts[6];
+    VkPushConstantRange ranges[2];
+    VkPipelineLayoutCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    /* the material for owl_pbr.frag and the draw for owl_baked.vert right
+     * after it */
+    ranges[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    ranges[0].offset = 0;
+    ranges[0].size = sizeof(struct owl_model_push_constant);
+
+    ranges[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    ranges[1].offset = sizeof(struct owl_model_push_constant);
+    ranges[1].size = sizeof(struct owl_model_baked_push_constant);
+
+    /* the baked animation and the instances of the crowd take the place of
+     * the joint palette */
+    layouts[0] = r->model_uniform_descriptor_set_layout;
+    layouts[1] = r->model_storage_descriptor_set_layout;
+    layouts[2] = r->model_maps_descriptor_set_layout;
+    layouts[3] = r->model_environment_descriptor_set_layout;
+    layouts[4] = r->model_joints_descriptor_set_layout;
+    layouts[5] = r->model_joints_descriptor_set_layout;
+
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.setLayoutCount = OWL_ARRAY_SIZE(layouts);
+    info.pSetLayouts = layouts;
+    info.pushConstantRangeCount = OWL_ARRAY_SIZE(ranges);
+    info.pPushConstantRanges = ranges;
+
+    vk_result = vkCreatePipelineLayout(device, &info, NULL,
+                                       &r->model_baked_pipeline_layout);
+    if (vk_result)
+      goto error_destroy_model_skin_pipeline_layout;
   }
 
   return OWL_OK;
 
+error_destroy_model_skin_pipeline_layout:
+  vkDestroyPipelineLayout(device, r->model_skin_pipeline_layout, NULL);
+
+error_destroy_depth_pyramid_pipeline_layout:
+  vkDestroyPipelineLayout(device, r->depth_pyramid_pipeline_layout, NULL);
+
+error_destroy_model_cull_pipeline_layout:
+  vkDestroyPipelineLayout(device, r->model_cull_pipeline_layout, NULL);
+
+error_destroy_depth_pyramid_build_descriptor_set_layout:
+  vkDestroyDescriptorSetLayout(
+      device, r->depth_pyramid_build_descriptor_set_layout, NULL);
+
+error_destroy_depth_pyramid_descriptor_set_layout:
+  vkDestroyDescriptorSetLayout(device, r->depth_pyramid_descriptor_set_layout,
+                               NULL);
+
+error_destroy_model_pipeline_layout:
+  vkDestroyPipelineLayout(device, r->model_pipeline_layout, NULL);
+
+error_destroy_model_joints_descriptor_set_layout:
+  vkDestroyDescriptorSetLayout(device, r->model_joints_descriptor_set_layout,
+                               NULL);
+
 error_destroy_model_environment_descriptor_set_layout:
   vkDestroyDescriptorSetLayout(
       device, r->model_environment_descriptor_set_layout, NULL);
@@ -1542,7 +1892,17 @@ error:
 
 static void owl_renderer_deinit_layouts(struct owl_renderer *r) {
   VkDevice const device = r->device;
+  vkDestroyPipelineLayout(device, r->model_baked_pipeline_layout, NULL);
+  vkDestroyPipelineLayout(device, r->model_skin_pipeline_layout, NULL);
+  vkDestroyPipelineLayout(device, r->depth_pyramid_pipeline_layout, NULL);
+  vkDestroyPipelineLayout(device, r->model_cull_pipeline_layout, NULL);
+  vkDestroyDescriptorSetLayout(
+      device, r->depth_pyramid_build_descriptor_set_layout, NULL);
+  vkDestroyDescriptorSetLayout(device, r->depth_pyramid_descriptor_set_layout,
+                               NULL);
   vkDestroyPipelineLayout(device, r->model_pipeline_layout, NULL);
+  vkDestroyDescriptorSetLayout(device, r->model_joints_descriptor_set_layout,
+                               NULL);
   vkDestroyDescriptorSetLayout(
       device, r->model_environment_descriptor_set_layout, NULL);
   vkDestroyDescriptorSetLayout(device, r->model_maps_descriptor_set_layout,
@@ -1559,7 +1919,7 @@ static void owl_renderer_deinit_layouts(struct owl_renderer *r) {
 }
 
 static int owl_renderer_init_graphics_pipelines(struct owl_renderer *r) {
-  VkVertexInputBindingDescription vertex_bindings;
+  VkVertexInputBindingDescription vertex_bindings[2];
   VkVertexInputAttributeDescription vertex_attributes[7];
   VkPipelineVertexInputStateCreateInfo vertex_input;
   VkPipelineInputAssemblyStateCreateInfo input_assembly;
@@ -1581,9 +1941,13 @@ static int owl_renderer_init_graphics_pipelines(struct owl_renderer *r) {
   if (ret)
     return ret;
 
-  vertex_bindings.binding = 0;
-  vertex_bindings.stride = sizeof(struct owl_common_vertex);
-  vertex_bindings.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  vertex_bindings[0].binding = 0;
+  vertex_bindings[0].stride = sizeof(struct owl_common_vertex);
+  vertex_bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+  vertex_bindings[1].binding = 1;
+  vertex_bindings[1].stride = sizeof(struct owl_model_vertex_attributes);
+  vertex_bindings[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
   vertex_attributes[0].binding = 0;
   vertex_attributes[0].location = 0;
@@ -1605,7 +1969,7 @@ static int owl_renderer_init_graphics_pipelines(struct owl_renderer *r) {
   vertex_input.pNext = NULL;
   vertex_input.flags = 0;
   vertex_input.vertexBindingDescriptionCount = 1;
-  vertex_input.pVertexBindingDescriptions = &vertex_bindings;
+  vertex_input.pVertexBindingDescriptions = vertex_bindings;
   vertex_input.vertexAttributeDescriptionCount = 3;
   vertex_input.pVertexAttributeDescriptions = vertex_attributes;
 
@@ -1774,43 +2138,53 @@ static int owl_renderer_init_graphics_pipelines(struct owl_renderer *r) {
   if (vk_result)
     goto error_destroy_wires_pipeline;
 
-  vertex_bindings.stride = sizeof(struct owl_model_vertex);
+  /* the positions and the rest of the attributes live in separate streams,
+   * see owl_model_init_buffers */
+  vertex_bindings[0].stride = sizeof(owl_v3);
 
   vertex_attributes[0].binding = 0;
   vertex_attributes[0].location = 0;
   vertex_attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-  vertex_attributes[0].offset = offsetof(struct owl_model_vertex, position);
+  vertex_attributes[0].offset = 0;
 
-  vertex_attributes[1].binding = 0;
+  /* octahedral, decoded by the vertex shader */
+  vertex_attributes[1].binding = 1;
   vertex_attributes[1].location = 1;
-  vertex_attributes[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-  vertex_attributes[1].offset = offsetof(struct owl_model_vertex, normal);
+  vertex_attributes[1].format = VK_FORMAT_R16G16_SNORM;
+  vertex_attributes[1].offset =
+      offsetof(struct owl_model_vertex_attributes, normal);
 
-  vertex_attributes[2].binding = 0;
+  vertex_attributes[2].binding = 1;
   vertex_attributes[2].location = 2;
-  vertex_attributes[2].format = VK_FORMAT_R32G32_SFLOAT;
-  vertex_attributes[2].offset = offsetof(struct owl_model_vertex, uv0);
+  vertex_attributes[2].format = VK_FORMAT_R16G16_SFLOAT;
+  vertex_attributes[2].offset =
+      offsetof(struct owl_model_vertex_attributes, uv0);
 
-  vertex_attributes[3].binding = 0;
+  vertex_attributes[3].binding = 1;
   vertex_attributes[3].location = 3;
-  vertex_attributes[3].format = VK_FORMAT_R32G32_SFLOAT;
-  vertex_attributes[3].offset = offsetof(struct owl_model_vertex, uv1);
+  vertex_attributes[3].format = VK_FORMAT_R16G16_SFLOAT;
+  vertex_attributes[3].offset =
+      offsetof(struct owl_model_vertex_attributes, uv1);
 
-  vertex_attributes[4].binding = 0;
+  vertex_attributes[4].binding = 1;
   vertex_attributes[4].location = 4;
-  vertex_attributes[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-  vertex_attributes[4].offset = offsetof(struct owl_model_vertex, joints0);
+  vertex_attributes[4].format = VK_FORMAT_R8G8B8A8_UINT;
+  vertex_attributes[4].offset =
+      offsetof(struct owl_model_vertex_attributes, joints0);
 
-  vertex_attributes[5].binding = 0;
+  vertex_attributes[5].binding = 1;
   vertex_attributes[5].location = 5;
-  vertex_attributes[5].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-  vertex_attributes[5].offset = offsetof(struct owl_model_vertex, weights0);
+  vertex_attributes[5].format = VK_FORMAT_R8G8B8A8_UNORM;
+  vertex_attributes[5].offset =
+      offsetof(struct owl_model_vertex_attributes, weights0);
 
-  vertex_attributes[6].binding = 0;
+  vertex_attributes[6].binding = 1;
   vertex_attributes[6].location = 6;
-  vertex_attributes[6].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-  vertex_attributes[6].offset = offsetof(struct owl_model_vertex, color0);
+  vertex_attributes[6].format = VK_FORMAT_R8G8B8A8_UNORM;
+  vertex_attributes[6].offset =
+      offsetof(struct owl_model_vertex_attributes, color0);
 
+  vertex_input.vertexBindingDescriptionCount = 2;
   vertex_input.vertexAttributeDescriptionCount = 7;
 
   color_attachment.blendEnable = VK_FALSE;
@@ -1822,6 +2196,9 @@ static int owl_renderer_init_graphics_pipelines(struct owl_renderer *r) {
   stages[0].module = r->model_vertex_shader;
   stages[1].module = r->model_fragment_shader;
 
+  /* equal depth has to pass when the depth prepass is enabled */
+  depth.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
   info.layout = r->model_pipeline_layout;
 
   vk_result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, NULL,
@@ -1829,32 +2206,75 @@ static int owl_renderer_init_graphics_pipelines(struct owl_renderer *r) {
   if (vk_result)
     goto error_destroy_text_pipeline;
 
-  vertex_bindings.stride = sizeof(struct owl_skybox_vertex);
-
-  vertex_attributes[0].binding = 0;
-  vertex_attributes[0].location = 0;
-  vertex_attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-  vertex_attributes[0].offset = offsetof(struct owl_skybox_vertex, position);
+  /* depth only, no fragment shader and only the position stream */
+  color_attachment.colorWriteMask = 0;
+  depth.depthCompareOp = VK_COMPARE_OP_LESS;
 
+  vertex_input.vertexBindingDescriptionCount = 1;
   vertex_input.vertexAttributeDescriptionCount = 1;
 
-  depth.depthTestEnable = VK_FALSE;
-  depth.depthWriteEnable = VK_FALSE;
-
-  stages[0].module = r->skybox_vertex_shader;
-  stages[1].module = r->skybox_fragment_shader;
+  stages[0].module = r->model_depth_vertex_shader;
 
-  info.layout = r->common_pipeline_layout;
+  info.stageCount = 1;
 
   vk_result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, NULL,
-                                        &r->skybox_pipeline);
-
+                                        &r->model_depth_pipeline);
   if (vk_result)
     goto error_destroy_model_pipeline;
 
-  owl_renderer_deinit_shaders(r);
+  info.stageCount = OWL_ARRAY_SIZE(stages);
 
-  return OWL_OK;
+  vertex_input.vertexBindingDescriptionCount = 2;
+  vertex_input.vertexAttributeDescriptionCount = 7;
+
+  color_attachment.colorWriteMask |= VK_COLOR_COMPONENT_R_BIT;
+  color_attachment.colorWriteMask |= VK_COLOR_COMPONENT_G_BIT;
+  color_attachment.colorWriteMask |= VK_COLOR_COMPONENT_B_BIT;
+  color_attachment.colorWriteMask |= VK_COLOR_COMPONENT_A_BIT;
+
+  /* baked crowds skip the depth prepass */
+  stages[0].module = r->model_baked_vertex_shader;
+
+  info.layout = r->model_baked_pipeline_layout;
+
+  vk_result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, NULL,
+                                        &r->model_baked_pipeline);
+  if (vk_result)
+    goto error_destroy_model_depth_pipeline;
+
+  vertex_bindings[0].stride = sizeof(struct owl_skybox_vertex);
+
+  vertex_attributes[0].binding = 0;
+  vertex_attributes[0].location = 0;
+  vertex_attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+  vertex_attributes[0].offset = offsetof(struct owl_skybox_vertex, position);
+
+  vertex_input.vertexBindingDescriptionCount = 1;
+  vertex_input.vertexAttributeDescriptionCount = 1;
+
+  depth.depthTestEnable = VK_FALSE;
+  depth.depthWriteEnable = VK_FALSE;
+
+  stages[0].module = r->skybox_vertex_shader;
+  stages[1].module = r->skybox_fragment_shader;
+
+  info.layout = r->common_pipeline_layout;
+
+  vk_result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &info, NULL,
+                                        &r->skybox_pipeline);
+
+  if (vk_result)
+    goto error_destroy_model_baked_pipeline;
+
+  owl_renderer_deinit_shaders(r);
+
+  return OWL_OK;
+
+error_destroy_model_baked_pipeline:
+  vkDestroyPipeline(device, r->model_baked_pipeline, NULL);
+
+error_destroy_model_depth_pipeline:
+  vkDestroyPipeline(device, r->model_depth_pipeline, NULL);
 
 error_destroy_model_pipeline:
   vkDestroyPipeline(device, r->model_pipeline, NULL);
@@ -1877,12 +2297,516 @@ error_denit_shaders:
 static void owl_renderer_deinit_graphics_pipelines(struct owl_renderer *r) {
   VkDevice const device = r->device;
   vkDestroyPipeline(device, r->skybox_pipeline, NULL);
+  vkDestroyPipeline(device, r->model_baked_pipeline, NULL);
+  vkDestroyPipeline(device, r->model_depth_pipeline, NULL);
   vkDestroyPipeline(device, r->model_pipeline, NULL);
   vkDestroyPipeline(device, r->text_pipeline, NULL);
   vkDestroyPipeline(device, r->wires_pipeline, NULL);
   vkDestroyPipeline(device, r->basic_pipeline, NULL);
 }
 
+static int owl_renderer_create_compute_pipeline(struct owl_renderer *r,
+                                                uint32_t const *spv,
+                                                uint64_t size,
+                                                VkPipelineLayout layout,
+                                                VkPipeline *pipeline) {
+  VkShaderModule shader;
+  VkResult vk_result;
+  VkDevice const device = r->device;
+
+  {
+    VkShaderModuleCreateInfo info;
+
+    info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.codeSize = size;
+    info.pCode = spv;
+
+    vk_result = vkCreateShaderModule(device, &info, NULL, &shader);
+    if (vk_result)
+      return OWL_ERROR_FATAL;
+  }
+
+  {
+    VkComputePipelineCreateInfo info;
+
+    info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    info.stage.pNext = NULL;
+    info.stage.flags = 0;
+    info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    info.stage.module = shader;
+    info.stage.pName = "main";
+    info.stage.pSpecializationInfo = NULL;
+    info.layout = layout;
+    info.basePipelineHandle = VK_NULL_HANDLE;
+    info.basePipelineIndex = -1;
+
+    vk_result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &info, NULL,
+                                         pipeline);
+  }
+
+  vkDestroyShaderModule(device, shader, NULL);
+
+  if (vk_result)
+    return OWL_ERROR_FATAL;
+
+  return OWL_OK;
+}
+
+static int owl_renderer_init_compute_pipelines(struct owl_renderer *r) {
+  int ret;
+  VkDevice const device = r->device;
+
+  {
+    static uint32_t const spv[] = {
+#include "owl_cull.comp.spv.u32"
+    };
+
+    ret = owl_renderer_create_compute_pipeline(r, spv, sizeof(spv),
+                                               r->model_cull_pipeline_layout,
+                                               &r->model_cull_pipeline);
+    if (ret)
+      goto error;
+  }
+
+  {
+    static uint32_t const spv[] = {
+#include "owl_depth_copy.comp.spv.u32"
+    };
+
+    ret = owl_renderer_create_compute_pipeline(
+        r, spv, sizeof(spv), r->depth_pyramid_pipeline_layout,
+        &r->depth_pyramid_copy_pipeline);
+    if (ret)
+      goto error_destroy_model_cull_pipeline;
+  }
+
+  {
+    static uint32_t const spv[] = {
+#include "owl_depth_reduce.comp.spv.u32"
+    };
+
+    ret = owl_renderer_create_compute_pipeline(
+        r, spv, sizeof(spv), r->depth_pyramid_pipeline_layout,
+        &r->depth_pyramid_reduce_pipeline);
+    if (ret)
+      goto error_destroy_depth_pyramid_copy_pipeline;
+  }
+
+  {
+    static uint32_t const spv[] = {
+#include "owl_skin.comp.spv.u32"
+    };
+
+    ret = owl_renderer_create_compute_pipeline(r, spv, sizeof(spv),
+                                               r->model_skin_pipeline_layout,
+                                               &r->model_skin_pipeline);
+    if (ret)
+      goto error_destroy_depth_pyramid_reduce_pipeline;
+  }
+
+  return OWL_OK;
+
+error_destroy_depth_pyramid_reduce_pipeline:
+  vkDestroyPipeline(device, r->depth_pyramid_reduce_pipeline, NULL);
+
+error_destroy_depth_pyramid_copy_pipeline:
+  vkDestroyPipeline(device, r->depth_pyramid_copy_pipeline, NULL);
+
+error_destroy_model_cull_pipeline:
+  vkDestroyPipeline(device, r->model_cull_pipeline, NULL);
+
+error:
+  return ret;
+}
+
+static void owl_renderer_deinit_compute_pipelines(struct owl_renderer *r) {
+  VkDevice const device = r->device;
+  vkDestroyPipeline(device, r->model_skin_pipeline, NULL);
+  vkDestroyPipeline(device, r->depth_pyramid_reduce_pipeline, NULL);
+  vkDestroyPipeline(device, r->depth_pyramid_copy_pipeline, NULL);
+  vkDestroyPipeline(device, r->model_cull_pipeline, NULL);
+}
+
+static int owl_renderer_init_depth_pyramid(struct owl_renderer *r) {
+  int32_t i;
+  int ret;
+  VkDevice const device = r->device;
+
+  r->depth_pyramid_width = r->width;
+  r->depth_pyramid_height = r->height;
+  r->depth_pyramid_levels = 1;
+
+  while ((r->depth_pyramid_width >> r->depth_pyramid_levels) ||
+         (r->depth_pyramid_height >> r->depth_pyramid_levels))
+    ++r->depth_pyramid_levels;
+
+  r->depth_pyramid_levels =
+      OWL_MIN(r->depth_pyramid_levels, OWL_MAX_DEPTH_PYRAMID_LEVELS);
+
+  {
+    VkImageCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.imageType = VK_IMAGE_TYPE_2D;
+    info.format = VK_FORMAT_R32_SFLOAT;
+    info.extent.width = r->depth_pyramid_width;
+    info.extent.height = r->depth_pyramid_height;
+    info.extent.depth = 1;
+    info.mipLevels = r->depth_pyramid_levels;
+    info.arrayLayers = 1;
+    info.samples = VK_SAMPLE_COUNT_1_BIT;
+    info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    info.usage = 0;
+    info.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+    info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    info.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.queueFamilyIndexCount = 0;
+    info.pQueueFamilyIndices = NULL;
+    info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    vk_result = vkCreateImage(device, &info, NULL, &r->depth_pyramid_image);
+    if (vk_result) {
+      ret = OWL_ERROR_FATAL;
+      goto error;
+    }
+  }
+
+  {
+    VkMemoryRequirements requirements;
+    VkMemoryAllocateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    vkGetImageMemoryRequirements(device, r->depth_pyramid_image, &requirements);
+
+    info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    info.pNext = NULL;
+    info.allocationSize = requirements.size;
+    info.memoryTypeIndex = owl_renderer_find_memory_type(
+        r, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    vk_result = vkAllocateMemory(device, &info, NULL, &r->depth_pyramid_memory);
+    if (vk_result) {
+      ret = OWL_ERROR_FATAL;
+      goto error_destroy_image;
+    }
+
+    vk_result = vkBindImageMemory(device, r->depth_pyramid_image,
+                                  r->depth_pyramid_memory, 0);
+    if (vk_result) {
+      ret = OWL_ERROR_FATAL;
+      goto error_free_memory;
+    }
+  }
+
+  {
+    VkImageViewCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.image = r->depth_pyramid_image;
+    info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    info.format = VK_FORMAT_R32_SFLOAT;
+    info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    info.subresourceRange.baseMipLevel = 0;
+    info.subresourceRange.levelCount = r->depth_pyramid_levels;
+    info.subresourceRange.baseArrayLayer = 0;
+    info.subresourceRange.layerCount = 1;
+
+    vk_result = vkCreateImageView(device, &info, NULL,
+                                  &r->depth_pyramid_image_view);
+    if (vk_result) {
+      ret = OWL_ERROR_FATAL;
+      goto error_free_memory;
+    }
+
+    for (i = 0; i < (int32_t)r->depth_pyramid_levels; ++i) {
+      info.subresourceRange.baseMipLevel = i;
+      info.subresourceRange.levelCount = 1;
+
+      vk_result = vkCreateImageView(device, &info, NULL,
+                                    &r->depth_pyramid_level_views[i]);
+      if (vk_result) {
+        ret = OWL_ERROR_FATAL;
+        goto error_destroy_level_views;
+      }
+    }
+  }
+
+  {
+    VkSamplerCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.magFilter = VK_FILTER_NEAREST;
+    info.minFilter = VK_FILTER_NEAREST;
+    info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    info.mipLodBias = 0.0F;
+    info.anisotropyEnable = VK_FALSE;
+    info.maxAnisotropy = 1.0F;
+    info.compareEnable = VK_FALSE;
+    info.compareOp = VK_COMPARE_OP_ALWAYS;
+    info.minLod = 0.0F;
+    info.maxLod = VK_LOD_CLAMP_NONE;
+    info.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    info.unnormalizedCoordinates = VK_FALSE;
+
+    vk_result =
+        vkCreateSampler(device, &info, NULL, &r->depth_pyramid_sampler);
+    if (vk_result) {
+      ret = OWL_ERROR_FATAL;
+      i = r->depth_pyramid_levels;
+      goto error_destroy_level_views;
+    }
+  }
+
+  {
+    VkDescriptorSetLayout layouts[OWL_MAX_DEPTH_PYRAMID_LEVELS + 1];
+    VkDescriptorSet descriptor_sets[OWL_MAX_DEPTH_PYRAMID_LEVELS + 1];
+    VkDescriptorSetAllocateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    layouts[0] = r->depth_pyramid_descriptor_set_layout;
+    for (i = 0; i < (int32_t)r->depth_pyramid_levels; ++i)
+      layouts[i + 1] = r->depth_pyramid_build_descriptor_set_layout;
+
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    info.pNext = NULL;
+    info.descriptorPool = r->descriptor_pool;
+    info.descriptorSetCount = r->depth_pyramid_levels + 1;
+    info.pSetLayouts = layouts;
+
+    vk_result = vkAllocateDescriptorSets(device, &info, descriptor_sets);
+    if (vk_result) {
+      ret = OWL_ERROR_FATAL;
+      goto error_destroy_sampler;
+    }
+
+    r->depth_pyramid_descriptor_set = descriptor_sets[0];
+    for (i = 0; i < (int32_t)r->depth_pyramid_levels; ++i)
+      r->depth_pyramid_build_sets[i] = descriptor_sets[i + 1];
+  }
+
+  {
+    VkDescriptorImageInfo descriptor;
+    VkWriteDescriptorSet write;
+
+    descriptor.sampler = r->depth_pyramid_sampler;
+    descriptor.imageView = r->depth_pyramid_image_view;
+    descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.pNext = NULL;
+    write.dstSet = r->depth_pyramid_descriptor_set;
+    write.dstBinding = 0;
+    write.dstArrayElement = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &descriptor;
+    write.pBufferInfo = NULL;
+    write.pTexelBufferView = NULL;
+
+    vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
+  }
+
+  /* level 0 is built from the depth attachment, every other level from the
+   * level above it */
+  for (i = 0; i < (int32_t)r->depth_pyramid_levels; ++i) {
+    VkDescriptorImageInfo descriptors[2];
+    VkWriteDescriptorSet writes[2];
+
+    descriptors[0].sampler = r->depth_pyramid_sampler;
+    if (!i) {
+      descriptors[0].imageView = r->depth_image_view;
+      descriptors[0].imageLayout =
+          VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    } else {
+      descriptors[0].imageView = r->depth_pyramid_level_views[i - 1];
+      descriptors[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    descriptors[1].sampler = VK_NULL_HANDLE;
+    descriptors[1].imageView = r->depth_pyramid_level_views[i];
+    descriptors[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].pNext = NULL;
+    writes[0].dstSet = r->depth_pyramid_build_sets[i];
+    writes[0].dstBinding = 0;
+    writes[0].dstArrayElement = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &descriptors[0];
+    writes[0].pBufferInfo = NULL;
+    writes[0].pTexelBufferView = NULL;
+
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].pNext = NULL;
+    writes[1].dstSet = r->depth_pyramid_build_sets[i];
+    writes[1].dstBinding = 1;
+    writes[1].dstArrayElement = 0;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo = &descriptors[1];
+    writes[1].pBufferInfo = NULL;
+    writes[1].pTexelBufferView = NULL;
+
+    vkUpdateDescriptorSets(device, OWL_ARRAY_SIZE(writes), writes, 0, NULL);
+  }
+
+  /* cleared to the far plane so nothing is occluded until the first build */
+  ret = owl_renderer_begin_im_command_buffer(r);
+  if (ret)
+    goto error_free_descriptor_sets;
+
+  {
+    VkImageMemoryBarrier barrier;
+    VkClearColorValue clear;
+    VkImageSubresourceRange range;
+
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel = 0;
+    range.levelCount = r->depth_pyramid_levels;
+    range.baseArrayLayer = 0;
+    range.layerCount = 1;
+
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = NULL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = r->depth_pyramid_image;
+    barrier.subresourceRange = range;
+
+    vkCmdPipelineBarrier(r->im_command_buffer,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1,
+                         &barrier);
+
+    clear.float32[0] = 1.0F;
+    clear.float32[1] = 1.0F;
+    clear.float32[2] = 1.0F;
+    clear.float32[3] = 1.0F;
+
+    vkCmdClearColorImage(r->im_command_buffer, r->depth_pyramid_image,
+                         VK_IMAGE_LAYOUT_GENERAL, &clear, 1, &range);
+  }
+
+  ret = owl_renderer_end_im_command_buffer(r);
+  if (ret)
+    goto error_free_descriptor_sets;
+
+  OWL_M4_COPY(r->projection, r->depth_pyramid_projection);
+  OWL_M4_COPY(r->view, r->depth_pyramid_view);
+
+  return OWL_OK;
+
+error_free_descriptor_sets:
+  vkFreeDescriptorSets(device, r->descriptor_pool, 1,
+                       &r->depth_pyramid_descriptor_set);
+  vkFreeDescriptorSets(device, r->descriptor_pool, r->depth_pyramid_levels,
+                       r->depth_pyramid_build_sets);
+
+error_destroy_sampler:
+  vkDestroySampler(device, r->depth_pyramid_sampler, NULL);
+
+  i = r->depth_pyramid_levels;
+
+error_destroy_level_views:
+  for (i = i - 1; i >= 0; --i)
+    vkDestroyImageView(device, r->depth_pyramid_level_views[i], NULL);
+
+  vkDestroyImageView(device, r->depth_pyramid_image_view, NULL);
+
+error_free_memory:
+  vkFreeMemory(device, r->depth_pyramid_memory, NULL);
+
+error_destroy_image:
+  vkDestroyImage(device, r->depth_pyramid_image, NULL);
+
+error:
+  return ret;
+}
+
+static void owl_renderer_deinit_depth_pyramid(struct owl_renderer *r) {
+  uint32_t i;
+  VkDevice const device = r->device;
+
+  vkFreeDescriptorSets(device, r->descriptor_pool, r->depth_pyramid_levels,
+                       r->depth_pyramid_build_sets);
+  vkFreeDescriptorSets(device, r->descriptor_pool, 1,
+                       &r->depth_pyramid_descriptor_set);
+  vkDestroySampler(device, r->depth_pyramid_sampler, NULL);
+
+  for (i = 0; i < r->depth_pyramid_levels; ++i)
+    vkDestroyImageView(device, r->depth_pyramid_level_views[i], NULL);
+
+  vkDestroyImageView(device, r->depth_pyramid_image_view, NULL);
+  vkFreeMemory(device, r->depth_pyramid_memory, NULL);
+  vkDestroyImage(device, r->depth_pyramid_image, NULL);
+}
+
+static void owl_renderer_build_depth_pyramid(struct owl_renderer *r,
+                                             VkCommandBuffer command_buffer) {
+  uint32_t i;
+
+  for (i = 0; i < r->depth_pyramid_levels; ++i) {
+    VkMemoryBarrier barrier;
+    uint32_t const width = OWL_MAX(1, r->depth_pyramid_width >> i);
+    uint32_t const height = OWL_MAX(1, r->depth_pyramid_height >> i);
+
+    /* waits on the previous level and on anyone still reading the pyramid */
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.pNext = NULL;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask |= VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier,
+                         0, NULL, 0, NULL);
+
+    if (!i)
+      vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                        r->depth_pyramid_copy_pipeline);
+    else if (1 == i)
+      vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                        r->depth_pyramid_reduce_pipeline);
+
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            r->depth_pyramid_pipeline_layout, 0, 1,
+                            &r->depth_pyramid_build_sets[i], 0, NULL);
+
+    vkCmdDispatch(command_buffer, (width + 7) / 8, (height + 7) / 8, 1);
+  }
+
+  OWL_M4_COPY(r->projection, r->depth_pyramid_projection);
+  OWL_M4_COPY(r->view, r->depth_pyramid_view);
+}
+
 static int owl_renderer_init_upload_buffer(struct owl_renderer *r) {
   r->upload_buffer_in_use = 0;
   return OWL_OK;
@@ -2061,6 +2985,54 @@ static int owl_renderer_garbage_push_uniform(struct owl_renderer *r) {
   return OWL_OK;
 }
 
+static int owl_renderer_garbage_push_storage(struct owl_renderer *r) {
+  uint32_t i;
+  uint32_t const capacity = OWL_ARRAY_SIZE(r->garbage_buffers[0]);
+  uint32_t const garbage = r->garbage;
+  uint32_t const num_buffers = r->num_garbage_buffers[garbage];
+  uint32_t const num_memories = r->num_garbage_memories[garbage];
+  uint32_t const num_descriptor_sets = r->num_garbage_descriptor_sets[garbage];
+
+  if (capacity <= num_buffers + r->num_frames)
+    return OWL_ERROR_NO_SPACE;
+
+  if (capacity <= num_memories + 1)
+    return OWL_ERROR_NO_SPACE;
+
+  if (capacity <= num_descriptor_sets + r->num_frames)
+    return OWL_ERROR_NO_SPACE;
+
+  for (i = 0; i < r->num_frames; ++i) {
+    VkBuffer buffer = r->storage_buffers[i];
+    r->garbage_buffers[garbage][num_buffers + i] = buffer;
+  }
+  r->num_garbage_buffers[garbage] += r->num_frames;
+
+  {
+    VkDeviceMemory memory = r->storage_buffer_memory;
+    r->garbage_memories[garbage][num_memories] = memory;
+  }
+  r->num_garbage_memories[garbage] += 1;
+
+  for (i = 0; i < r->num_frames; ++i) {
+    VkDescriptorSet descriptor_set = r->storage_descriptor_sets[i];
+    r->garbage_descriptor_sets[garbage][num_descriptor_sets + i] =
+        descriptor_set;
+  }
+  r->num_garbage_descriptor_sets[garbage] += r->num_frames;
+
+  return OWL_OK;
+}
+
+/* takes back the storage buffer owl_renderer_garbage_push_storage pushed */
+static void owl_renderer_garbage_pop_storage(struct owl_renderer *r) {
+  uint32_t const garbage = r->garbage;
+
+  r->num_garbage_buffers[garbage] -= r->num_frames;
+  r->num_garbage_memories[garbage] -= 1;
+  r->num_garbage_descriptor_sets[garbage] -= r->num_frames;
+}
+
 static int owl_renderer_init_vertex_buffer(struct owl_renderer *r,
                                            uint64_t size) {
   int32_t i;
@@ -2357,74 +3329,235 @@ static int owl_renderer_init_uniform_buffer(struct owl_renderer *r,
       writes[0].pBufferInfo = &descriptors[0];
       writes[0].pTexelBufferView = NULL;
 
-      descriptors[1].buffer = r->uniform_buffers[i];
-      descriptors[1].offset = 0;
-      descriptors[1].range = sizeof(struct owl_model_uniform);
+      descriptors[1].buffer = r->uniform_buffers[i];
+      descriptors[1].offset = 0;
+      descriptors[1].range = sizeof(struct owl_model_uniform);
+
+      writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[1].pNext = NULL;
+      writes[1].dstSet = r->uniform_model_descriptor_sets[i];
+      writes[1].dstBinding = 0;
+      writes[1].dstArrayElement = 0;
+      writes[1].descriptorCount = 1;
+      writes[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+      writes[1].pImageInfo = NULL;
+      writes[1].pBufferInfo = &descriptors[1];
+      writes[1].pTexelBufferView = NULL;
+
+      vkUpdateDescriptorSets(device, OWL_ARRAY_SIZE(writes), writes, 0, NULL);
+    }
+  }
+
+  r->uniform_buffer_last_offset = 0;
+  r->uniform_buffer_offset = 0;
+  r->uniform_buffer_size = size;
+
+  return OWL_OK;
+
+error_free_descriptor_sets:
+  for (i = i - 1; i >= 0; --i) {
+    VkDescriptorSet descriptor_sets[3];
+
+    descriptor_sets[0] = r->uniform_pvm_descriptor_sets[i];
+    descriptor_sets[1] = r->uniform_model_descriptor_sets[i];
+
+    vkFreeDescriptorSets(device, r->descriptor_pool,
+                         OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets);
+  }
+
+  i = r->num_frames;
+
+error_free_memory:
+  vkFreeMemory(device, r->uniform_buffer_memory, NULL);
+
+  i = r->num_frames;
+
+error_destroy_buffers:
+  for (i = i - 1; i >= 0; --i)
+    vkDestroyBuffer(device, r->uniform_buffers[i], NULL);
+
+  return OWL_ERROR_FATAL;
+}
+
+static void owl_renderer_deinit_uniform_buffer(struct owl_renderer *r) {
+  uint32_t i;
+  VkDevice const device = r->device;
+
+  for (i = 0; i < r->num_frames; ++i) {
+    VkDescriptorSet descriptor_sets[2];
+
+    descriptor_sets[0] = r->uniform_pvm_descriptor_sets[i];
+    descriptor_sets[1] = r->uniform_model_descriptor_sets[i];
+
+    vkFreeDescriptorSets(device, r->descriptor_pool,
+                         OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets);
+  }
+
+  vkFreeMemory(device, r->uniform_buffer_memory, NULL);
+
+  for (i = 0; i < r->num_frames; ++i)
+    vkDestroyBuffer(device, r->uniform_buffers[i], NULL);
+}
+
+/* r is only written once everything was created, a failure leaves the
+ * previous storage buffer in place */
+static int owl_renderer_init_storage_buffer(struct owl_renderer *r,
+                                            uint64_t size, uint64_t range) {
+  int32_t i;
+  VkDeviceSize alignment;
+  VkDeviceSize aligned_size;
+  VkDeviceMemory memory;
+  void *data;
+  VkBuffer buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkDescriptorSet descriptor_sets[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkDevice const device = r->device;
+
+  for (i = 0; i < (int32_t)r->num_frames; ++i) {
+    VkBufferCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.size = size;
+    info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    info.queueFamilyIndexCount = 0;
+    info.pQueueFamilyIndices = NULL;
+
+    vk_result = vkCreateBuffer(device, &info, NULL, &buffers[i]);
+    if (vk_result)
+      goto error_destroy_buffers;
+  }
+
+  {
+    uint32_t j;
+    VkMemoryPropertyFlagBits properties;
+    VkMemoryAllocateInfo info;
+    VkMemoryRequirements requirements;
+    VkPhysicalDeviceProperties device_properties;
+    VkResult vk_result = VK_SUCCESS;
+
+    properties = 0;
+    properties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    properties |= VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    vkGetBufferMemoryRequirements(device, buffers[0], &requirements);
+    vkGetPhysicalDeviceProperties(r->physical_device, &device_properties);
+
+    /* the dynamic offsets have their own alignment requirement */
+    alignment =
+        OWL_MAX(requirements.alignment,
+                device_properties.limits.minStorageBufferOffsetAlignment);
+    aligned_size = OWL_ALIGN_UP_2(size, alignment);
+
+    info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    info.pNext = NULL;
+    info.allocationSize = aligned_size * r->num_frames;
+    info.memoryTypeIndex = owl_renderer_find_memory_type(
+        r, requirements.memoryTypeBits, properties);
+
+    vk_result = vkAllocateMemory(device, &info, NULL, &memory);
+    if (vk_result)
+      goto error_destroy_buffers;
+
+    for (j = 0; j < r->num_frames; ++j) {
+      vk_result = vkBindBufferMemory(device, buffers[j], memory,
+                                     aligned_size * j);
+      if (vk_result)
+        goto error_free_memory;
+    }
+
+    vk_result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data);
+    if (vk_result)
+      goto error_free_memory;
+  }
 
-      writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      writes[1].pNext = NULL;
-      writes[1].dstSet = r->uniform_model_descriptor_sets[i];
-      writes[1].dstBinding = 0;
-      writes[1].dstArrayElement = 0;
-      writes[1].descriptorCount = 1;
-      writes[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-      writes[1].pImageInfo = NULL;
-      writes[1].pBufferInfo = &descriptors[1];
-      writes[1].pTexelBufferView = NULL;
+  for (i = 0; i < (int32_t)r->num_frames; ++i) {
+    {
+      VkDescriptorSetAllocateInfo info;
+      VkResult vk_result = VK_SUCCESS;
 
-      vkUpdateDescriptorSets(device, OWL_ARRAY_SIZE(writes), writes, 0, NULL);
+      info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+      info.pNext = NULL;
+      info.descriptorPool = r->descriptor_pool;
+      info.descriptorSetCount = 1;
+      info.pSetLayouts = &r->model_joints_descriptor_set_layout;
+
+      vk_result =
+          vkAllocateDescriptorSets(device, &info, &descriptor_sets[i]);
+      if (vk_result)
+        goto error_free_descriptor_sets;
+    }
+
+    {
+      VkDescriptorBufferInfo descriptor;
+      VkWriteDescriptorSet write;
+
+      descriptor.buffer = buffers[i];
+      descriptor.offset = 0;
+      descriptor.range = range;
+
+      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      write.pNext = NULL;
+      write.dstSet = descriptor_sets[i];
+      write.dstBinding = 0;
+      write.dstArrayElement = 0;
+      write.descriptorCount = 1;
+      write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+      write.pImageInfo = NULL;
+      write.pBufferInfo = &descriptor;
+      write.pTexelBufferView = NULL;
+
+      vkUpdateDescriptorSets(device, 1, &write, 0, NULL);
     }
   }
 
-  r->uniform_buffer_last_offset = 0;
-  r->uniform_buffer_offset = 0;
-  r->uniform_buffer_size = size;
+  for (i = 0; i < (int32_t)r->num_frames; ++i) {
+    r->storage_buffers[i] = buffers[i];
+    r->storage_descriptor_sets[i] = descriptor_sets[i];
+  }
+
+  r->storage_buffer_memory = memory;
+  r->storage_buffer_data = data;
+  r->storage_buffer_alignment = alignment;
+  r->storage_buffer_aligned_size = aligned_size;
+  r->storage_buffer_last_offset = 0;
+  r->storage_buffer_offset = 0;
+  r->storage_buffer_size = size;
+  r->storage_buffer_range = range;
 
   return OWL_OK;
 
 error_free_descriptor_sets:
-  for (i = i - 1; i >= 0; --i) {
-    VkDescriptorSet descriptor_sets[3];
-
-    descriptor_sets[0] = r->uniform_pvm_descriptor_sets[i];
-    descriptor_sets[1] = r->uniform_model_descriptor_sets[i];
-
-    vkFreeDescriptorSets(device, r->descriptor_pool,
-                         OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets);
-  }
+  for (i = i - 1; i >= 0; --i)
+    vkFreeDescriptorSets(device, r->descriptor_pool, 1, &descriptor_sets[i]);
 
   i = r->num_frames;
 
 error_free_memory:
-  vkFreeMemory(device, r->uniform_buffer_memory, NULL);
+  vkFreeMemory(device, memory, NULL);
 
   i = r->num_frames;
 
 error_destroy_buffers:
   for (i = i - 1; i >= 0; --i)
-    vkDestroyBuffer(device, r->uniform_buffers[i], NULL);
+    vkDestroyBuffer(device, buffers[i], NULL);
 
   return OWL_ERROR_FATAL;
 }
 
-static void owl_renderer_deinit_uniform_buffer(struct owl_renderer *r) {
+static void owl_renderer_deinit_storage_buffer(struct owl_renderer *r) {
   uint32_t i;
   VkDevice const device = r->device;
 
-  for (i = 0; i < r->num_frames; ++i) {
-    VkDescriptorSet descriptor_sets[2];
-
-    descriptor_sets[0] = r->uniform_pvm_descriptor_sets[i];
-    descriptor_sets[1] = r->uniform_model_descriptor_sets[i];
-
-    vkFreeDescriptorSets(device, r->descriptor_pool,
-                         OWL_ARRAY_SIZE(descriptor_sets), descriptor_sets);
-  }
+  vkFreeDescriptorSets(device, r->descriptor_pool, r->num_frames,
+                       r->storage_descriptor_sets);
 
-  vkFreeMemory(device, r->uniform_buffer_memory, NULL);
+  vkFreeMemory(device, r->storage_buffer_memory, NULL);
 
   for (i = 0; i < r->num_frames; ++i)
-    vkDestroyBuffer(device, r->uniform_buffers[i], NULL);
+    vkDestroyBuffer(device, r->storage_buffers[i], NULL);
 }
 
 static int owl_renderer_init_frames(struct owl_renderer *r) {
@@ -2432,6 +3565,7 @@ static int owl_renderer_init_frames(struct owl_renderer *r) {
   VkDevice const device = r->device;
 
   r->frame = 0;
+  r->frame_count = 0;
 
   for (i = 0; i < (int32_t)r->num_frames; ++i) {
     VkCommandPoolCreateInfo info;
@@ -2464,6 +3598,22 @@ static int owl_renderer_init_frames(struct owl_renderer *r) {
       goto error_free_submit_command_buffers;
   }
 
+  for (i = 0; i < (int32_t)r->num_frames; ++i) {
+    VkCommandBufferAllocateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    info.pNext = NULL;
+    info.commandPool = r->submit_command_pools[i];
+    info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    info.commandBufferCount = 1;
+
+    vk_result = vkAllocateCommandBuffers(device, &info,
+                                         &r->prepass_command_buffers[i]);
+    if (vk_result)
+      goto error_free_prepass_command_buffers;
+  }
+
   for (i = 0; i < (int32_t)r->num_frames; ++i) {
     VkFenceCreateInfo info;
     VkResult vk_result = VK_SUCCESS;
@@ -2505,6 +3655,26 @@ static int owl_renderer_init_frames(struct owl_renderer *r) {
       goto error_destroy_render_done_semaphores;
   }
 
+  if (r->has_pipeline_statistics) {
+    VkQueryPoolCreateInfo info;
+    VkResult vk_result = VK_SUCCESS;
+
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.pNext = NULL;
+    info.flags = 0;
+    info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    info.queryCount = r->num_frames;
+    info.pipelineStatistics =
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    vk_result =
+        vkCreateQueryPool(device, &info, NULL, &r->statistics_query_pool);
+    if (vk_result) {
+      i = r->num_frames;
+      goto error_destroy_render_done_semaphores;
+    }
+  }
+
   return OWL_OK;
 
 error_destroy_render_done_semaphores:
@@ -2531,6 +3701,15 @@ error_destroy_in_flight_fences:
 
   i = r->num_frames;
 
+error_free_prepass_command_buffers:
+  for (i = i - 1; i > 0; --i) {
+    VkCommandPool command_pool = r->submit_command_pools[i];
+    VkCommandBuffer command_buffer = r->prepass_command_buffers[i];
+    vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+  }
+
+  i = r->num_frames;
+
 error_free_submit_command_buffers:
   for (i = i - 1; i > 0; --i) {
     VkCommandPool command_pool = r->submit_command_pools[i];
@@ -2552,6 +3731,9 @@ static void owl_renderer_deinit_frames(struct owl_renderer *r) {
 
   VkDevice const device = r->device;
 
+  if (r->has_pipeline_statistics)
+    vkDestroyQueryPool(device, r->statistics_query_pool, NULL);
+
   for (i = 0; i < r->num_frames; ++i) {
     VkSemaphore semaphore = r->render_done_semaphores[i];
     vkDestroySemaphore(device, semaphore, NULL);
@@ -2573,6 +3755,12 @@ static void owl_renderer_deinit_frames(struct owl_renderer *r) {
 
   i = r->num_frames;
 
+  for (i = 0; i < r->num_frames; ++i) {
+    VkCommandPool command_pool = r->submit_command_pools[i];
+    VkCommandBuffer command_buffer = r->prepass_command_buffers[i];
+    vkFreeCommandBuffers(device, command_pool, 1, &command_buffer);
+  }
+
   for (i = 0; i < r->num_frames; ++i) {
     VkCommandPool command_pool = r->submit_command_pools[i];
     VkCommandBuffer command_buffer = r->submit_command_buffers[i];
@@ -3444,7 +4632,7 @@ https://github.com/SaschaWillems/Vulkan-glTF-PBR/blob/master/src/main.cpp#L1288
         {
           struct owl_skybox_vertex *mapped_vertices;
           struct owl_renderer_vertex_allocation vertex_allocation;
-          uint32_t *mapped_indices;
+          uint16_t *mapped_indices;
           struct owl_renderer_index_allocation index_allocation;
           /*
            *    4----5
@@ -3464,7 +4652,7 @@ https://github.com/SaschaWillems/Vulkan-glTF-PBR/blob/master/src/main.cpp#L1288
               {1.0F, -1.0F, 1.0F},                             /* 5 */
               {-1.0F, 1.0F, 1.0F},                             /* 6 */
               {1.0F, 1.0F, 1.0F}};                             /* 7 */
-          static uint32_t const indices[] = {2, 3, 1, 1, 0, 2, /* face 0 .....*/
+          static uint16_t const indices[] = {2, 3, 1, 1, 0, 2, /* face 0 .....*/
                                              3, 7, 5, 5, 1, 3, /* face 1 */
                                              6, 2, 0, 0, 4, 6, /* face 2 */
                                              7, 6, 4, 4, 5, 7, /* face 3 */
@@ -3489,7 +4677,7 @@ https://github.com/SaschaWillems/Vulkan-glTF-PBR/blob/master/src/main.cpp#L1288
                                  &vertex_allocation.offset);
 
           vkCmdBindIndexBuffer(command_buffer, index_allocation.buffer,
-                               index_allocation.offset, VK_INDEX_TYPE_UINT32);
+                               index_allocation.offset, VK_INDEX_TYPE_UINT16);
 
           vkCmdDrawIndexed(command_buffer, OWL_ARRAY_SIZE(indices), 1, 0, 0, 0);
         }
@@ -4259,9 +5447,20 @@ OWLAPI int owl_renderer_init(struct owl_renderer *r, struct owl_plataform *p) {
 
   r->plataform = p;
   r->im_command_buffer = VK_NULL_HANDLE;
+  r->im_batch = NULL;
   r->skybox_loaded = 0;
   r->font_loaded = 0;
   r->num_frames = OWL_NUM_IN_FLIGHT_FRAMES;
+  r->depth_prepass = 0;
+  r->occlusion_culling = 1;
+  r->compute_skinning = 0;
+  r->optimize_meshes = 1;
+  r->generate_lods = 1;
+  r->lod_threshold = 1.0F;
+  r->num_load_threads = owl_thread_count_cores();
+  r->compress_textures = 0;
+  r->fragment_invocations = 0;
+  OWL_MEMSET(&r->cull_stats, 0, sizeof(r->cull_stats));
 
   r->clear_values[0].color.float32[0] = 0.0F;
   r->clear_values[0].color.float32[1] = 0.0F;
@@ -4349,10 +5548,22 @@ OWLAPI int owl_renderer_init(struct owl_renderer *r, struct owl_plataform *p) {
     goto error_deinit_layouts;
   }
 
+  ret = owl_renderer_init_compute_pipelines(r);
+  if (ret) {
+    OWL_DEBUG_LOG("Failed to initialize compute pipelines!\n");
+    goto error_deinit_graphics_pipelines;
+  }
+
+  ret = owl_renderer_init_depth_pyramid(r);
+  if (ret) {
+    OWL_DEBUG_LOG("Failed to initialize depth pyramid!\n");
+    goto error_deinit_compute_pipelines;
+  }
+
   ret = owl_renderer_init_upload_buffer(r);
   if (ret) {
     OWL_DEBUG_LOG("Failed to initialize upload heap!\n");
-    goto error_deinit_graphics_pipelines;
+    goto error_deinit_depth_pyramid;
   }
 
   ret = owl_renderer_init_samplers(r);
@@ -4391,8 +5602,18 @@ OWLAPI int owl_renderer_init(struct owl_renderer *r, struct owl_plataform *p) {
     goto error_deinit_index_buffer;
   }
 
+  ret = owl_renderer_init_storage_buffer(r, OWL_DEFAULT_BUFFER_SIZE,
+                                         OWL_DEFAULT_STORAGE_RANGE);
+  if (ret) {
+    OWL_DEBUG_LOG("Filed to initilize storage buffer!\n");
+    goto error_deinit_uniform_buffer;
+  }
+
   return OWL_OK;
 
+error_deinit_uniform_buffer:
+  owl_renderer_deinit_uniform_buffer(r);
+
 error_deinit_index_buffer:
   owl_renderer_deinit_index_buffer(r);
 
@@ -4411,6 +5632,12 @@ error_deinit_samplers:
 error_deinit_upload_buffer:
   owl_renderer_deinit_upload_buffer(r);
 
+error_deinit_depth_pyramid:
+  owl_renderer_deinit_depth_pyramid(r);
+
+error_deinit_compute_pipelines:
+  owl_renderer_deinit_compute_pipelines(r);
+
 error_deinit_graphics_pipelines:
   owl_renderer_deinit_graphics_pipelines(r);
 
@@ -4451,6 +5678,7 @@ OWLAPI void owl_renderer_deinit(struct owl_renderer *r) {
   if (r->skybox_loaded)
     owl_renderer_unload_skybox(r);
 
+  owl_renderer_deinit_storage_buffer(r);
   owl_renderer_deinit_uniform_buffer(r);
   owl_renderer_deinit_index_buffer(r);
   owl_renderer_deinit_vertex_buffer(r);
@@ -4458,6 +5686,8 @@ OWLAPI void owl_renderer_deinit(struct owl_renderer *r) {
   owl_renderer_deinit_frames(r);
   owl_renderer_deinit_samplers(r);
   owl_renderer_deinit_upload_buffer(r);
+  owl_renderer_deinit_depth_pyramid(r);
+  owl_renderer_deinit_compute_pipelines(r);
   owl_renderer_deinit_graphics_pipelines(r);
   owl_renderer_deinit_layouts(r);
   owl_renderer_deinit_pools(r);
@@ -4492,6 +5722,7 @@ OWLAPI int owl_renderer_update_dimensions(struct owl_renderer *r) {
   ratio = (float)width / (float)height;
   owl_m4_perspective(fov, ratio, near, far, r->projection);
 
+  owl_renderer_deinit_depth_pyramid(r);
   owl_renderer_deinit_graphics_pipelines(r);
   owl_renderer_deinit_swapchain(r);
   owl_renderer_deinit_attachments(r);
@@ -4520,8 +5751,17 @@ OWLAPI int owl_renderer_update_dimensions(struct owl_renderer *r) {
     goto error_deinit_swapchain;
   }
 
+  ret = owl_renderer_init_depth_pyramid(r);
+  if (ret) {
+    OWL_DEBUG_LOG("Failed to resize depth pyramid!\n");
+    goto error_deinit_graphics_pipelines;
+  }
+
   return OWL_OK;
 
+error_deinit_graphics_pipelines:
+  owl_renderer_deinit_graphics_pipelines(r);
+
 error_deinit_swapchain:
   owl_renderer_deinit_swapchain(r);
 
@@ -4651,6 +5891,53 @@ OWLAPI void owl_renderer_uniform_clear_offset(struct owl_renderer *r) {
   r->uniform_buffer_offset = 0;
 }
 
+OWLAPI void *
+owl_renderer_storage_allocate(struct owl_renderer *r, uint64_t size,
+                              struct owl_renderer_storage_allocation *alloc) {
+  uint8_t *data = r->storage_buffer_data;
+  uint32_t const frame = r->frame;
+  uint64_t const alignment = r->storage_buffer_alignment;
+  uint64_t range = r->storage_buffer_range;
+  uint64_t aligned_size = r->storage_buffer_aligned_size;
+  uint64_t end = r->storage_buffer_offset + OWL_MAX(size, range);
+
+  /* the shaders see range bytes from the offset, all of them have to be
+   * inside of the buffer */
+  if (range < size || r->storage_buffer_size < end) {
+    int ret;
+
+    ret = owl_renderer_garbage_push_storage(r);
+    if (ret)
+      return NULL;
+
+    range = OWL_MAX(range, OWL_ALIGN_UP_2(size, alignment));
+
+    /* on failure the old buffer is still the current one */
+    ret = owl_renderer_init_storage_buffer(r, end * 2, range);
+    if (ret) {
+      owl_renderer_garbage_pop_storage(r);
+      return NULL;
+    }
+
+    data = r->storage_buffer_data;
+    aligned_size = r->storage_buffer_aligned_size;
+  }
+
+  alloc->offset = r->storage_buffer_offset;
+  alloc->buffer = r->storage_buffers[frame];
+  alloc->descriptor_set = r->storage_descriptor_sets[frame];
+
+  r->storage_buffer_offset =
+      OWL_ALIGN_UP_2(r->storage_buffer_offset + size, alignment);
+
+  return &data[frame * aligned_size + alloc->offset];
+}
+
+OWLAPI void owl_renderer_storage_clear_offset(struct owl_renderer *r) {
+  r->storage_buffer_last_offset = r->storage_buffer_offset;
+  r->storage_buffer_offset = 0;
+}
+
 #define OWL_RENDERER_IS_SWAPCHAIN_OUT_OF_DATE(vk_result)                       \
   (VK_ERROR_OUT_OF_DATE_KHR == (vk_result) ||                                  \
    VK_SUBOPTIMAL_KHR == (vk_result) ||                                         \
@@ -4702,6 +5989,20 @@ OWLAPI int owl_renderer_begin_frame(struct owl_renderer *r) {
 
   owl_renderer_collect_garbage(r);
 
+  /* the slot's fence was waited on, its results are ready if it was ever
+   * submitted */
+  if (r->has_pipeline_statistics) {
+    uint64_t invocations;
+
+    vk_result = vkGetQueryPoolResults(
+        device, r->statistics_query_pool, frame, 1, sizeof(invocations),
+        &invocations, sizeof(invocations), VK_QUERY_RESULT_64_BIT);
+    if (VK_SUCCESS == vk_result)
+      r->fragment_invocations = invocations;
+  }
+
+  OWL_MEMSET(&r->cull_stats, 0, sizeof(r->cull_stats));
+
   {
     VkCommandBufferBeginInfo info;
 
@@ -4710,11 +6011,18 @@ OWLAPI int owl_renderer_begin_frame(struct owl_renderer *r) {
     info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     info.pInheritanceInfo = NULL;
 
+    vk_result = vkBeginCommandBuffer(r->prepass_command_buffers[frame], &info);
+    if (vk_result)
+      return OWL_ERROR_FATAL;
+
     vk_result = vkBeginCommandBuffer(command_buffer, &info);
     if (vk_result)
       return OWL_ERROR_FATAL;
   }
 
+  if (r->has_pipeline_statistics)
+    vkCmdResetQueryPool(command_buffer, r->statistics_query_pool, frame, 1);
+
   {
     VkRenderPassBeginInfo info;
     VkFramebuffer framebuffer;
@@ -4734,19 +6042,55 @@ OWLAPI int owl_renderer_begin_frame(struct owl_renderer *r) {
     vkCmdBeginRenderPass(command_buffer, &info, VK_SUBPASS_CONTENTS_INLINE);
   }
 
+  if (r->has_pipeline_statistics)
+    vkCmdBeginQuery(command_buffer, r->statistics_query_pool, frame, 0);
+
   return OWL_OK;
 }
 
 OWLAPI int owl_renderer_end_frame(struct owl_renderer *r) {
   uint32_t const frame = r->frame;
   VkCommandBuffer command_buffer = r->submit_command_buffers[frame];
+  VkCommandBuffer prepass_command_buffer = r->prepass_command_buffers[frame];
   VkFence in_flight_fence = r->in_flight_fences[frame];
   VkSemaphore acquire_semaphore = r->acquire_semaphores[frame];
   VkSemaphore render_done_semaphore = r->render_done_semaphores[frame];
 
   VkResult vk_result;
 
+  {
+    VkMemoryBarrier barrier;
+    VkPipelineStageFlags dst_stage = 0;
+
+    dst_stage |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+    dst_stage |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    dst_stage |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.pNext = NULL;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.dstAccessMask |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    barrier.dstAccessMask |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    barrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(prepass_command_buffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dst_stage, 0, 1,
+                         &barrier, 0, NULL, 0, NULL);
+  }
+
+  vk_result = vkEndCommandBuffer(prepass_command_buffer);
+  if (vk_result)
+    return OWL_ERROR_FATAL;
+
+  if (r->has_pipeline_statistics)
+    vkCmdEndQuery(command_buffer, r->statistics_query_pool, frame);
+
   vkCmdEndRenderPass(command_buffer);
+
+  if (r->occlusion_culling)
+    owl_renderer_build_depth_pyramid(r, command_buffer);
+
   vk_result = vkEndCommandBuffer(command_buffer);
   if (vk_result)
     return OWL_ERROR_FATAL;
@@ -4754,6 +6098,11 @@ OWLAPI int owl_renderer_end_frame(struct owl_renderer *r) {
   {
     VkSubmitInfo info;
     VkPipelineStageFlagBits stage;
+    VkCommandBuffer command_buffers[2];
+
+    /* the prepass runs the compute work that the render pass consumes */
+    command_buffers[0] = prepass_command_buffer;
+    command_buffers[1] = command_buffer;
 
     stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -4763,8 +6112,8 @@ OWLAPI int owl_renderer_end_frame(struct owl_renderer *r) {
     info.signalSemaphoreCount = 1;
     info.pSignalSemaphores = &render_done_semaphore;
     info.pWaitDstStageMask = &stage;
-    info.commandBufferCount = 1;
-    info.pCommandBuffers = &command_buffer;
+    info.commandBufferCount = OWL_ARRAY_SIZE(command_buffers);
+    info.pCommandBuffers = command_buffers;
 
     vk_result = vkQueueSubmit(r->graphics_queue, 1, &info, in_flight_fence);
     if (vk_result)
@@ -4789,9 +6138,11 @@ OWLAPI int owl_renderer_end_frame(struct owl_renderer *r) {
   }
 
   r->frame = (r->frame + 1) % r->num_frames;
+  ++r->frame_count;
   owl_renderer_vertex_clear_offset(r);
   owl_renderer_index_clear_offset(r);
   owl_renderer_uniform_clear_offset(r);
+  owl_renderer_storage_clear_offset(r);
 
   return OWL_OK;
 }
@@ -4870,6 +6221,31 @@ error:
   return NULL;
 }
 
+static void owl_renderer_grow_im_batch(struct owl_renderer_im_batch *batch) {
+  VkBuffer *buffers;
+  VkDeviceMemory *memories;
+  int32_t const max_uploads = OWL_MAX(4, 2 * batch->max_uploads);
+
+  buffers = OWL_MALLOC(max_uploads * sizeof(*buffers));
+  OWL_ASSERT(buffers);
+  memories = OWL_MALLOC(max_uploads * sizeof(*memories));
+  OWL_ASSERT(memories);
+
+  if (batch->num_uploads) {
+    OWL_MEMCPY(buffers, batch->upload_buffers,
+               batch->num_uploads * sizeof(*buffers));
+    OWL_MEMCPY(memories, batch->upload_memories,
+               batch->num_uploads * sizeof(*memories));
+  }
+
+  OWL_FREE(batch->upload_buffers);
+  OWL_FREE(batch->upload_memories);
+
+  batch->max_uploads = max_uploads;
+  batch->upload_buffers = buffers;
+  batch->upload_memories = memories;
+}
+
 OWLAPI void owl_renderer_upload_free(struct owl_renderer *r, void *data) {
   VkDevice const device = r->device;
 
@@ -4879,6 +6255,21 @@ OWLAPI void owl_renderer_upload_free(struct owl_renderer *r, void *data) {
   r->upload_buffer_size = 0;
   r->upload_buffer_data = NULL;
 
+  /* the batch isn't submitted yet, the buffer is freed once the gpu is done
+   * with it */
+  if (r->im_batch) {
+    struct owl_renderer_im_batch *batch = r->im_batch;
+
+    if (batch->num_uploads == batch->max_uploads)
+      owl_renderer_grow_im_batch(batch);
+
+    batch->upload_buffers[batch->num_uploads] = r->upload_buffer;
+    batch->upload_memories[batch->num_uploads] = r->upload_buffer_memory;
+    ++batch->num_uploads;
+
+    return;
+  }
+
   vkFreeMemory(device, r->upload_buffer_memory, NULL);
   vkDestroyBuffer(device, r->upload_buffer, NULL);
 }
@@ -4910,6 +6301,8 @@ OWLAPI int owl_renderer_load_skybox(struct owl_renderer *r, char const *path) {
   texture_desc.width = 0;
   texture_desc.height = 0;
   texture_desc.format = OWL_RGBA8_SRGB;
+  texture_desc.swizzle = OWL_TEXTURE_SWIZZLE_IDENTITY;
+  texture_desc.mipmaps = 0;
 
   ret = owl_texture_init(r, &texture_desc, &r->skybox);
   if (ret)
@@ -5045,6 +6438,10 @@ OWLAPI int owl_renderer_begin_im_command_buffer(struct owl_renderer *r) {
   int ret = OWL_OK;
   VkDevice const device = r->device;
 
+  /* a batch keeps recording into the command buffer it started */
+  if (r->im_batch && r->im_command_buffer)
+    return OWL_OK;
+
   OWL_ASSERT(!r->im_command_buffer);
 
   {
@@ -5080,10 +6477,14 @@ OWLAPI int owl_renderer_begin_im_command_buffer(struct owl_renderer *r) {
     }
   }
 
+  if (r->im_batch)
+    r->im_batch->command_buffer = r->im_command_buffer;
+
   goto out;
 
 error_im_command_buffer_deinit:
   vkFreeCommandBuffers(device, r->command_pool, 1, &r->im_command_buffer);
+  r->im_command_buffer = VK_NULL_HANDLE;
 
 out:
   return ret;
@@ -5096,6 +6497,25 @@ OWLAPI int owl_renderer_end_im_command_buffer(struct owl_renderer *r) {
 
   OWL_ASSERT(r->im_command_buffer);
 
+  /* the next commands of the batch may read what these wrote */
+  if (r->im_batch) {
+    VkMemoryBarrier barrier;
+
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.pNext = NULL;
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.dstAccessMask |= VK_ACCESS_MEMORY_READ_BIT;
+    barrier.dstAccessMask |= VK_ACCESS_MEMORY_WRITE_BIT;
+
+    vkCmdPipelineBarrier(r->im_command_buffer,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0,
+                         NULL, 0, NULL);
+
+    return OWL_OK;
+  }
+
   vk_result = vkEndCommandBuffer(r->im_command_buffer);
   if (VK_SUCCESS != vk_result) {
     ret = OWL_ERROR_FATAL;
@@ -5131,3 +6551,131 @@ cleanup:
 
   return ret;
 }
+
+OWLAPI int owl_renderer_begin_im_batch(struct owl_renderer *r,
+                                       struct owl_renderer_im_batch *batch) {
+  VkFenceCreateInfo info;
+  VkResult vk_result = VK_SUCCESS;
+
+  OWL_ASSERT(!r->im_batch);
+  OWL_ASSERT(!r->im_command_buffer);
+
+  batch->command_buffer = VK_NULL_HANDLE;
+  batch->num_uploads = 0;
+  batch->max_uploads = 0;
+  batch->upload_buffers = NULL;
+  batch->upload_memories = NULL;
+
+  info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  info.pNext = NULL;
+  info.flags = 0;
+
+  vk_result = vkCreateFence(r->device, &info, NULL, &batch->fence);
+  if (VK_SUCCESS != vk_result) {
+    batch->fence = VK_NULL_HANDLE;
+    return OWL_ERROR_FATAL;
+  }
+
+  r->im_batch = batch;
+
+  return OWL_OK;
+}
+
+OWLAPI int owl_renderer_end_im_batch(struct owl_renderer *r) {
+  VkSubmitInfo info;
+  VkResult vk_result = VK_SUCCESS;
+  struct owl_renderer_im_batch *batch = r->im_batch;
+
+  OWL_ASSERT(batch);
+
+  r->im_batch = NULL;
+
+  /* nothing was recorded, there is nothing to wait for */
+  if (!r->im_command_buffer)
+    return OWL_OK;
+
+  r->im_command_buffer = VK_NULL_HANDLE;
+
+  vk_result = vkEndCommandBuffer(batch->command_buffer);
+  if (VK_SUCCESS != vk_result)
+    goto error;
+
+  info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  info.pNext = NULL;
+  info.waitSemaphoreCount = 0;
+  info.pWaitSemaphores = NULL;
+  info.pWaitDstStageMask = NULL;
+  info.commandBufferCount = 1;
+  info.pCommandBuffers = &batch->command_buffer;
+  info.signalSemaphoreCount = 0;
+  info.pSignalSemaphores = NULL;
+
+  vk_result = vkQueueSubmit(r->graphics_queue, 1, &info, batch->fence);
+  if (VK_SUCCESS != vk_result)
+    goto error;
+
+  return OWL_OK;
+
+  /* never submitted, the fence would never signal */
+error:
+  vkFreeCommandBuffers(r->device, r->command_pool, 1, &batch->command_buffer);
+  batch->command_buffer = VK_NULL_HANDLE;
+
+  return OWL_ERROR_FATAL;
+}
+
+static void owl_renderer_release_im_batch(struct owl_renderer *r,
+                                          struct owl_renderer_im_batch *batch) {
+  int32_t i;
+  VkDevice const device = r->device;
+
+  for (i = 0; i < batch->num_uploads; ++i) {
+    vkFreeMemory(device, batch->upload_memories[i], NULL);
+    vkDestroyBuffer(device, batch->upload_buffers[i], NULL);
+  }
+
+  OWL_FREE(batch->upload_buffers);
+  OWL_FREE(batch->upload_memories);
+
+  if (batch->command_buffer)
+    vkFreeCommandBuffers(device, r->command_pool, 1, &batch->command_buffer);
+
+  vkDestroyFence(device, batch->fence, NULL);
+
+  batch->fence = VK_NULL_HANDLE;
+  batch->command_buffer = VK_NULL_HANDLE;
+  batch->num_uploads = 0;
+  batch->max_uploads = 0;
+  batch->upload_buffers = NULL;
+  batch->upload_memories = NULL;
+}
+
+OWLAPI int owl_renderer_im_batch_done(struct owl_renderer *r,
+                                      struct owl_renderer_im_batch *batch) {
+  OWL_ASSERT(r->im_batch != batch);
+
+  if (!batch->fence)
+    return 1;
+
+  /* a lost device won't signal it either */
+  if (batch->command_buffer &&
+      VK_NOT_READY == vkGetFenceStatus(r->device, batch->fence))
+    return 0;
+
+  owl_renderer_release_im_batch(r, batch);
+
+  return 1;
+}
+
+OWLAPI void owl_renderer_wait_im_batch(struct owl_renderer *r,
+                                       struct owl_renderer_im_batch *batch) {
+  OWL_ASSERT(r->im_batch != batch);
+
+  if (!batch->fence)
+    return;
+
+  if (batch->command_buffer)
+    vkWaitForFences(r->device, 1, &batch->fence, VK_TRUE, (uint64_t)-1);
+
+  owl_renderer_release_im_batch(r, batch);
+}
@@ -11,6 +11,7 @@ OWL_BEGIN_DECLARATIONS
 #define OWL_MAX_SWAPCHAIN_IMAGES 8
 #define OWL_NUM_IN_FLIGHT_FRAMES 2
 #define OWL_NUM_GARBAGE_FRAMES (OWL_NUM_IN_FLIGHT_FRAMES + 1)
+#define OWL_MAX_DEPTH_PYRAMID_LEVELS 16
 
 struct owl_renderer_upload_allocation {
   VkBuffer buffer;
@@ -33,6 +34,36 @@ struct owl_renderer_uniform_allocation {
   VkDescriptorSet model_descriptor_set;
 };
 
+struct owl_renderer_storage_allocation {
+  uint32_t offset;
+  VkBuffer buffer;
+  VkDescriptorSet descriptor_set;
+};
+
+/* written by owl_cull.comp, the fragment count is an estimate from the
+ * screen space bounds of the occluded draws */
+struct owl_renderer_cull_stats {
+  uint32_t num_visible;
+  uint32_t num_frustum_culled;
+  uint32_t num_occlusion_culled;
+  uint32_t num_occluded_triangles;
+  uint32_t num_occluded_fragments;
+  uint32_t num_backface_culled;
+  uint32_t padding[2];
+};
+
+/* the immediate command buffers recorded between owl_renderer_begin_im_batch
+ * and owl_renderer_end_im_batch, submitted once without waiting. the upload
+ * buffers freed in between are kept until the fence signals */
+struct owl_renderer_im_batch {
+  VkFence fence;
+  VkCommandBuffer command_buffer;
+  int32_t num_uploads;
+  int32_t max_uploads;
+  VkBuffer *upload_buffers;
+  VkDeviceMemory *upload_memories;
+};
+
 struct owl_renderer {
   struct owl_plataform *plataform;
 
@@ -64,6 +95,35 @@ struct owl_renderer {
   VkSampleCountFlagBits msaa;
   VkFormat depth_format;
 
+  int32_t has_multi_draw_indirect;
+  int32_t has_draw_indirect_count;
+  int32_t has_pipeline_statistics;
+  int32_t has_texture_compression_bc;
+
+  /* lays down model depth with owl_draw_model_depth before shading, set
+   * before drawing */
+  int32_t depth_prepass;
+  /* tests model draws against last frame's depth pyramid */
+  int32_t occlusion_culling;
+  /* skins and morphs model vertices once per frame in a compute pass, set
+   * before drawing */
+  int32_t compute_skinning;
+  /* reorders model triangles and vertices for the vertex cache and overdraw
+   * at load, set before loading models */
+  int32_t optimize_meshes;
+  /* simplifies model primitives into a chain of lods at load, set before
+   * loading models */
+  int32_t generate_lods;
+  /* the largest error a model lod may show, in pixels */
+  float lod_threshold;
+  /* the threads model images are decoded on at load, set before loading
+   * models */
+  int32_t num_load_threads;
+  /* encodes model images into block compressed formats at load and caches
+   * them next to the images, needs has_texture_compression_bc. set before
+   * loading models */
+  int32_t compress_textures;
+
   VkImage color_image;
   VkDeviceSize color_memory_size;
   VkDeviceMemory color_memory;
@@ -77,6 +137,8 @@ struct owl_renderer {
   VkRenderPass main_render_pass;
 
   VkCommandBuffer im_command_buffer;
+  /* set while the immediate command buffers are being batched */
+  struct owl_renderer_im_batch *im_batch;
 
   VkPresentModeKHR present_mode;
 
@@ -97,6 +159,8 @@ struct owl_renderer {
   VkShaderModule model_fragment_shader;
   VkShaderModule skybox_vertex_shader;
   VkShaderModule skybox_fragment_shader;
+  VkShaderModule model_baked_vertex_shader;
+  VkShaderModule model_depth_vertex_shader;
 
   VkDescriptorSetLayout common_uniform_descriptor_set_layout;
   VkDescriptorSetLayout common_texture_descriptor_set_layout;
@@ -104,15 +168,43 @@ struct owl_renderer {
   VkDescriptorSetLayout model_storage_descriptor_set_layout;
   VkDescriptorSetLayout model_maps_descriptor_set_layout;
   VkDescriptorSetLayout model_environment_descriptor_set_layout;
+  VkDescriptorSetLayout model_joints_descriptor_set_layout;
 
   VkPipelineLayout common_pipeline_layout;
+  VkDescriptorSetLayout depth_pyramid_descriptor_set_layout;
+  VkDescriptorSetLayout depth_pyramid_build_descriptor_set_layout;
+
   VkPipelineLayout model_pipeline_layout;
+  VkPipelineLayout model_cull_pipeline_layout;
+  VkPipelineLayout model_skin_pipeline_layout;
+  VkPipelineLayout model_baked_pipeline_layout;
+  VkPipelineLayout depth_pyramid_pipeline_layout;
 
   VkPipeline basic_pipeline;
   VkPipeline wires_pipeline;
   VkPipeline text_pipeline;
   VkPipeline model_pipeline;
   VkPipeline skybox_pipeline;
+  VkPipeline model_depth_pipeline;
+  VkPipeline model_cull_pipeline;
+  VkPipeline model_skin_pipeline;
+  VkPipeline model_baked_pipeline;
+  VkPipeline depth_pyramid_copy_pipeline;
+  VkPipeline depth_pyramid_reduce_pipeline;
+
+  uint32_t depth_pyramid_width;
+  uint32_t depth_pyramid_height;
+  uint32_t depth_pyramid_levels;
+  VkImage depth_pyramid_image;
+  VkDeviceMemory depth_pyramid_memory;
+  VkImageView depth_pyramid_image_view;
+  VkImageView depth_pyramid_level_views[OWL_MAX_DEPTH_PYRAMID_LEVELS];
+  VkSampler depth_pyramid_sampler;
+  VkDescriptorSet depth_pyramid_descriptor_set;
+  VkDescriptorSet depth_pyramid_build_sets[OWL_MAX_DEPTH_PYRAMID_LEVELS];
+  /* clip matrix of the frame the pyramid was built from */
+  owl_m4 depth_pyramid_projection;
+  owl_m4 depth_pyramid_view;
 
   VkSampler linear_sampler;
 
@@ -145,14 +237,22 @@ struct owl_renderer {
 
   uint32_t frame;
   uint32_t num_frames;
+  /* number of frames ended so far */
+  uint64_t frame_count;
 
   VkCommandPool submit_command_pools[OWL_NUM_IN_FLIGHT_FRAMES];
   VkCommandBuffer submit_command_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkCommandBuffer prepass_command_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
 
   VkFence in_flight_fences[OWL_NUM_IN_FLIGHT_FRAMES];
   VkSemaphore acquire_semaphores[OWL_NUM_IN_FLIGHT_FRAMES];
   VkSemaphore render_done_semaphores[OWL_NUM_IN_FLIGHT_FRAMES];
 
+  VkQueryPool statistics_query_pool;
+  /* results of the last frame that used the current in flight slot */
+  uint64_t fragment_invocations;
+  struct owl_renderer_cull_stats cull_stats;
+
   VkDeviceSize vertex_buffer_last_offset;
   VkDeviceSize vertex_buffer_size;
   VkDeviceSize vertex_buffer_offset;
@@ -182,6 +282,19 @@ struct owl_renderer {
   VkDescriptorSet uniform_pvm_descriptor_sets[OWL_NUM_IN_FLIGHT_FRAMES];
   VkDescriptorSet uniform_model_descriptor_sets[OWL_NUM_IN_FLIGHT_FRAMES];
 
+  /* per frame ring for variable sized storage data (joint palettes), the
+   * descriptors see storage_buffer_range bytes from the dynamic offset */
+  VkDeviceSize storage_buffer_last_offset;
+  VkDeviceSize storage_buffer_size;
+  VkDeviceSize storage_buffer_range;
+  VkDeviceSize storage_buffer_offset;
+  VkDeviceSize storage_buffer_alignment;
+  VkDeviceMemory storage_buffer_memory;
+  VkDeviceSize storage_buffer_aligned_size;
+  void *storage_buffer_data;
+  VkBuffer storage_buffers[OWL_NUM_IN_FLIGHT_FRAMES];
+  VkDescriptorSet storage_descriptor_sets[OWL_NUM_IN_FLIGHT_FRAMES];
+
   uint32_t garbage;
   uint32_t num_garbage_buffers[OWL_NUM_GARBAGE_FRAMES];
   uint32_t num_garbage_memories[OWL_NUM_GARBAGE_FRAMES];
@@ -193,6 +306,7 @@ struct owl_renderer {
 
   PFN_vkCreateDebugUtilsMessengerEXT vk_create_debug_utils_messenger_ext;
   PFN_vkDestroyDebugUtilsMessengerEXT vk_destroy_debug_utils_messenger_ext;
+  PFN_vkCmdDrawIndexedIndirectCountKHR vk_cmd_draw_indexed_indirect_count_khr;
 };
 
 OWLAPI int owl_renderer_init(struct owl_renderer *r, struct owl_plataform *p);
@@ -223,6 +337,12 @@ owl_renderer_uniform_allocate(struct owl_renderer *r, uint64_t size,
 
 OWLAPI void owl_renderer_uniform_clear_offset(struct owl_renderer *r);
 
+OWLAPI void *
+owl_renderer_storage_allocate(struct owl_renderer *r, uint64_t size,
+                              struct owl_renderer_storage_allocation *alloc);
+
+OWLAPI void owl_renderer_storage_clear_offset(struct owl_renderer *r);
+
 OWLAPI void *
 owl_renderer_upload_allocate(struct owl_renderer *r, uint64_t size,
                              struct owl_renderer_upload_allocation *alloc);
@@ -246,6 +366,23 @@ OWLAPI int owl_renderer_begin_im_command_buffer(struct owl_renderer *r);
 
 OWLAPI int owl_renderer_end_im_command_buffer(struct owl_renderer *r);
 
+/* until owl_renderer_end_im_batch the immediate command buffers are recorded
+ * one after the other into the same command buffer instead of being
+ * submitted and waited on */
+OWLAPI int owl_renderer_begin_im_batch(struct owl_renderer *r,
+                                       struct owl_renderer_im_batch *batch);
+
+/* submits the batch with its fence and returns right away */
+OWLAPI int owl_renderer_end_im_batch(struct owl_renderer *r);
+
+/* 1 once the gpu is done with the batch, its resources are released then */
+OWLAPI int owl_renderer_im_batch_done(struct owl_renderer *r,
+                                      struct owl_renderer_im_batch *batch);
+
+/* blocks until the gpu is done with the batch and releases it */
+OWLAPI void owl_renderer_wait_im_batch(struct owl_renderer *r,
+                                       struct owl_renderer_im_batch *batch);
+
 OWL_END_DECLARATIONS
 
 #endif
@@ -1,18 +1,25 @@
 #include "owl_texture.h"
 
 #include "owl_internal.h"
+#include "owl_plataform.h"
 #include "owl_renderer.h"
+#include "owl_texture_compression.h"
 #include "stb_image.h"
 
 #include <math.h>
+#include <stdio.h>
 
 #define OWL_TEXTURE_MAX_PATH_LENGTH 128
+#define OWL_TEXTURE_MAX_CACHE_PATH_LENGTH 512
 
 static VkFormat owl_pixel_format_as_vk_format(enum owl_pixel_format format) {
   switch (format) {
   case OWL_R8_UNORM:
     return VK_FORMAT_R8_UNORM;
 
+  case OWL_RG8_UNORM:
+    return VK_FORMAT_R8G8_UNORM;
+
   case OWL_RGBA8_SRGB:
     return VK_FORMAT_R8G8B8A8_SRGB;
 
@@ -21,14 +28,42 @@ static VkFormat owl_pixel_format_as_vk_format(enum owl_pixel_format format) {
 
   case OWL_RGBA32_SFLOAT:
     return VK_FORMAT_R32G32B32A32_SFLOAT;
+
+  case OWL_BC1_RGBA_SRGB:
+    return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+
+  case OWL_BC1_RGBA_UNORM:
+    return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+
+  case OWL_BC3_SRGB:
+    return VK_FORMAT_BC3_SRGB_BLOCK;
+
+  case OWL_BC3_UNORM:
+    return VK_FORMAT_BC3_UNORM_BLOCK;
+
+  case OWL_BC4_UNORM:
+    return VK_FORMAT_BC4_UNORM_BLOCK;
+
+  case OWL_BC5_UNORM:
+    return VK_FORMAT_BC5_UNORM_BLOCK;
+
+  case OWL_BC7_SRGB:
+    return VK_FORMAT_BC7_SRGB_BLOCK;
+
+  case OWL_BC7_UNORM:
+    return VK_FORMAT_BC7_UNORM_BLOCK;
   }
 }
 
+/* for the compressed formats the size of a 4x4 block */
 static uint64_t owl_pixel_format_size(enum owl_pixel_format format) {
   switch (format) {
   case OWL_R8_UNORM:
     return 1 * sizeof(uint8_t);
 
+  case OWL_RG8_UNORM:
+    return 2 * sizeof(uint8_t);
+
   case OWL_RGBA8_SRGB:
     return 4 * sizeof(uint8_t);
 
@@ -37,6 +72,39 @@ static uint64_t owl_pixel_format_size(enum owl_pixel_format format) {
 
   case OWL_RGBA32_SFLOAT:
     return 4 * sizeof(uint32_t);
+
+  case OWL_BC1_RGBA_SRGB:
+  case OWL_BC1_RGBA_UNORM:
+  case OWL_BC4_UNORM:
+    return 8;
+
+  case OWL_BC3_SRGB:
+  case OWL_BC3_UNORM:
+  case OWL_BC5_UNORM:
+  case OWL_BC7_SRGB:
+  case OWL_BC7_UNORM:
+    return 16;
+  }
+}
+
+int owl_texture_is_compressed(enum owl_pixel_format format) {
+  switch (format) {
+  case OWL_R8_UNORM:
+  case OWL_RG8_UNORM:
+  case OWL_RGBA8_SRGB:
+  case OWL_RGBA8_UNORM:
+  case OWL_RGBA32_SFLOAT:
+    return 0;
+
+  case OWL_BC1_RGBA_SRGB:
+  case OWL_BC1_RGBA_UNORM:
+  case OWL_BC3_SRGB:
+  case OWL_BC3_UNORM:
+  case OWL_BC4_UNORM:
+  case OWL_BC5_UNORM:
+  case OWL_BC7_SRGB:
+  case OWL_BC7_UNORM:
+    return 1;
   }
 }
 
@@ -44,6 +112,607 @@ uint32_t owl_texture_calculate_mipmaps(uint32_t w, uint32_t h) {
   return (uint32_t)(floor(log2(OWL_MAX(w, h))) + 1);
 }
 
+uint64_t owl_texture_levels_size(enum owl_pixel_format format, uint32_t w,
+                                 uint32_t h, uint32_t mipmaps) {
+  uint32_t i;
+  uint64_t size = 0;
+  uint64_t const pixel_size = owl_pixel_format_size(format);
+  int const compressed = owl_texture_is_compressed(format);
+
+  for (i = 0; i < mipmaps; ++i) {
+    uint64_t width = OWL_MAX(1, w >> i);
+    uint64_t height = OWL_MAX(1, h >> i);
+
+    /* partial blocks at the edges still take a whole block */
+    if (compressed) {
+      width = (width + 3) / 4;
+      height = (height + 3) / 4;
+    }
+
+    size += width * height * pixel_size;
+  }
+
+  return size;
+}
+
+static float owl_texture_srgb_to_linear(float value) {
+  if (value <= 0.04045F)
+    return value / 12.92F;
+
+  return (float)pow((value + 0.055F) / 1.055F, 2.4);
+}
+
+static float owl_texture_linear_to_srgb(float value) {
+  if (value <= 0.0031308F)
+    return value * 12.92F;
+
+  return 1.055F * (float)pow(value, 1.0 / 2.4) - 0.055F;
+}
+
+void owl_texture_build_mipmaps(uint32_t width, uint32_t height,
+                               uint32_t mipmaps, int srgb, uint8_t *pixels) {
+  uint32_t i;
+  float to_linear[256];
+  uint8_t *src = pixels;
+
+  for (i = 0; i < OWL_ARRAY_SIZE(to_linear); ++i) {
+    if (srgb)
+      to_linear[i] = owl_texture_srgb_to_linear((float)i / 255.0F);
+    else
+      to_linear[i] = (float)i / 255.0F;
+  }
+
+  for (i = 1; i < mipmaps; ++i) {
+    uint32_t x;
+    uint32_t y;
+    uint32_t const src_width = OWL_MAX(1, width >> (i - 1));
+    uint32_t const src_height = OWL_MAX(1, height >> (i - 1));
+    uint32_t const dst_width = OWL_MAX(1, width >> i);
+    uint32_t const dst_height = OWL_MAX(1, height >> i);
+    uint8_t *dst = &src[src_width * src_height * 4];
+
+    for (y = 0; y < dst_height; ++y) {
+      for (x = 0; x < dst_width; ++x) {
+        uint32_t c;
+        uint8_t const *texels[4];
+        uint32_t const x0 = OWL_MIN(2 * x, src_width - 1);
+        uint32_t const x1 = OWL_MIN(2 * x + 1, src_width - 1);
+        uint32_t const y0 = OWL_MIN(2 * y, src_height - 1);
+        uint32_t const y1 = OWL_MIN(2 * y + 1, src_height - 1);
+
+        texels[0] = &src[(y0 * src_width + x0) * 4];
+        texels[1] = &src[(y0 * src_width + x1) * 4];
+        texels[2] = &src[(y1 * src_width + x0) * 4];
+        texels[3] = &src[(y1 * src_width + x1) * 4];
+
+        for (c = 0; c < 4; ++c) {
+          float value;
+
+          /* alpha is stored linear */
+          if (3 == c) {
+            value = (texels[0][c] + texels[1][c] + texels[2][c] +
+                     texels[3][c]) /
+                    (4.0F * 255.0F);
+          } else {
+            value = (to_linear[texels[0][c]] + to_linear[texels[1][c]] +
+                     to_linear[texels[2][c]] + to_linear[texels[3][c]]) *
+                    0.25F;
+
+            if (srgb)
+              value = owl_texture_linear_to_srgb(value);
+          }
+
+          value = OWL_CLAMP(value, 0.0F, 1.0F);
+          dst[(y * dst_width + x) * 4 + c] = (uint8_t)(value * 255.0F + 0.5F);
+        }
+      }
+    }
+
+    src = dst;
+  }
+}
+
+void owl_texture_pack_channels(uint64_t num_pixels, int32_t first,
+                               int32_t count, uint8_t *pixels) {
+  uint64_t i;
+  int32_t c;
+
+  /* every pixel lands at or before where it was read from */
+  for (i = 0; i < num_pixels; ++i)
+    for (c = 0; c < count; ++c)
+      pixels[i * count + c] = pixels[i * 4 + first + c];
+}
+
+uint8_t *owl_texture_decode_file(char const *path, int *width, int *height) {
+  int channels;
+  uint8_t *pixels;
+  struct owl_plataform_file file;
+
+  if (owl_plataform_load_file(path, &file))
+    return NULL;
+
+  pixels = stbi_load_from_memory(file.data, (int)file.size, width, height,
+                                 &channels, STBI_rgb_alpha);
+
+  owl_plataform_unload_file(&file);
+
+  return pixels;
+}
+
+#define OWL_TEXTURE_KTX2_HEADER_SIZE 80
+#define OWL_TEXTURE_KTX2_LEVEL_SIZE 24
+
+static uint8_t const owl_texture_ktx2_identifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+/* ktx2 is little endian */
+static uint32_t owl_texture_ktx2_get_u32(uint8_t const *data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+         ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint64_t owl_texture_ktx2_get_u64(uint8_t const *data) {
+  return (uint64_t)owl_texture_ktx2_get_u32(data) |
+         ((uint64_t)owl_texture_ktx2_get_u32(&data[4]) << 32);
+}
+
+static void owl_texture_ktx2_put_u32(uint8_t *data, uint32_t value) {
+  data[0] = (uint8_t)(value & 0xFF);
+  data[1] = (uint8_t)((value >> 8) & 0xFF);
+  data[2] = (uint8_t)((value >> 16) & 0xFF);
+  data[3] = (uint8_t)(value >> 24);
+}
+
+static void owl_texture_ktx2_put_u64(uint8_t *data, uint64_t value) {
+  owl_texture_ktx2_put_u32(data, (uint32_t)(value & 0xFFFFFFFF));
+  owl_texture_ktx2_put_u32(&data[4], (uint32_t)(value >> 32));
+}
+
+int owl_texture_load_ktx2(char const *path, struct owl_texture_desc *desc) {
+  int32_t i;
+  uint8_t *pixels;
+  uint8_t const *data;
+  uint32_t width;
+  uint32_t height;
+  uint32_t num_levels;
+  uint64_t offset;
+  int32_t found = 0;
+  enum owl_pixel_format format = OWL_RGBA8_SRGB;
+  struct owl_plataform_file file;
+  int ret = OWL_OK;
+
+  ret = owl_plataform_load_file(path, &file);
+  if (ret)
+    return ret;
+
+  data = file.data;
+
+  if (OWL_TEXTURE_KTX2_HEADER_SIZE > file.size ||
+      OWL_MEMCMP(data, owl_texture_ktx2_identifier,
+                 sizeof(owl_texture_ktx2_identifier))) {
+    ret = OWL_ERROR_INVALID_VALUE;
+    goto out_unload_file;
+  }
+
+  for (i = OWL_RGBA8_SRGB; i <= OWL_BC7_UNORM; ++i) {
+    if ((uint32_t)owl_pixel_format_as_vk_format((enum owl_pixel_format)i) ==
+        owl_texture_ktx2_get_u32(&data[12])) {
+      format = (enum owl_pixel_format)i;
+      found = 1;
+    }
+  }
+
+  width = owl_texture_ktx2_get_u32(&data[20]);
+  height = owl_texture_ktx2_get_u32(&data[24]);
+  /* 0 levels asks for them to be generated */
+  num_levels = OWL_MAX(1, owl_texture_ktx2_get_u32(&data[40]));
+
+  /* only single 2D images, no arrays, cubemaps or supercompression */
+  if (!found || !width || !height || owl_texture_ktx2_get_u32(&data[28]) ||
+      1 < owl_texture_ktx2_get_u32(&data[32]) ||
+      1 != owl_texture_ktx2_get_u32(&data[36]) ||
+      owl_texture_ktx2_get_u32(&data[44]) ||
+      owl_texture_calculate_mipmaps(width, height) < num_levels ||
+      OWL_TEXTURE_KTX2_HEADER_SIZE +
+              (uint64_t)num_levels * OWL_TEXTURE_KTX2_LEVEL_SIZE >
+          file.size) {
+    ret = OWL_ERROR_INVALID_VALUE;
+    goto out_unload_file;
+  }
+
+  for (i = 0; i < (int32_t)num_levels; ++i) {
+    uint8_t const *level = &data[OWL_TEXTURE_KTX2_HEADER_SIZE +
+                                 i * OWL_TEXTURE_KTX2_LEVEL_SIZE];
+    uint64_t const level_offset = owl_texture_ktx2_get_u64(&level[0]);
+    uint64_t const level_size = owl_texture_ktx2_get_u64(&level[8]);
+
+    if (level_size != owl_texture_levels_size(format, OWL_MAX(1, width >> i),
+                                              OWL_MAX(1, height >> i), 1) ||
+        level_offset > file.size || level_size > file.size - level_offset) {
+      ret = OWL_ERROR_INVALID_VALUE;
+      goto out_unload_file;
+    }
+  }
+
+  pixels = OWL_MALLOC(owl_texture_levels_size(format, width, height,
+                                              num_levels));
+  if (!pixels) {
+    ret = OWL_ERROR_NO_MEMORY;
+    goto out_unload_file;
+  }
+
+  /* the file has the smallest level first, the desc the largest */
+  offset = 0;
+  for (i = 0; i < (int32_t)num_levels; ++i) {
+    uint8_t const *level = &data[OWL_TEXTURE_KTX2_HEADER_SIZE +
+                                 i * OWL_TEXTURE_KTX2_LEVEL_SIZE];
+    uint64_t const level_size = owl_texture_ktx2_get_u64(&level[8]);
+
+    OWL_MEMCPY(&pixels[offset], &data[owl_texture_ktx2_get_u64(level)],
+               level_size);
+
+    offset += level_size;
+  }
+
+  desc->type = OWL_TEXTURE_TYPE_2D;
+  desc->source = OWL_TEXTURE_SOURCE_DATA;
+  desc->path = NULL;
+  desc->pixels = pixels;
+  desc->width = width;
+  desc->height = height;
+  desc->format = format;
+  desc->swizzle = OWL_TEXTURE_SWIZZLE_IDENTITY;
+  desc->mipmaps = owl_texture_ktx2_get_u32(&data[40]);
+
+out_unload_file:
+  owl_plataform_unload_file(&file);
+
+  return ret;
+}
+
+int owl_texture_write_ktx2(char const *path,
+                           struct owl_texture_desc const *desc) {
+  int32_t i;
+  FILE *file;
+  uint8_t *header;
+  uint64_t offset;
+  uint64_t header_size;
+  uint64_t pixels_offset;
+  uint32_t dfd_offset;
+  uint32_t dfd_size;
+  uint32_t num_samples;
+  uint32_t color_model;
+  uint32_t const num_levels = OWL_MAX(1, desc->mipmaps);
+  uint32_t const block_size = owl_pixel_format_size(desc->format);
+  int32_t srgb = 0;
+  int ret = OWL_OK;
+  static uint8_t const zeros[16] = {0};
+
+  /* the data format descriptor of every block format, khr_df_model_bc1a,
+   * bc3, bc4, bc5 and bc7. the samples are what the ktx spec lists for them */
+  switch (desc->format) {
+  case OWL_BC1_RGBA_SRGB:
+    srgb = 1;
+    /* fallthrough */
+  case OWL_BC1_RGBA_UNORM:
+    color_model = 128;
+    num_samples = 1;
+    break;
+
+  case OWL_BC3_SRGB:
+    srgb = 1;
+    /* fallthrough */
+  case OWL_BC3_UNORM:
+    color_model = 130;
+    num_samples = 2;
+    break;
+
+  case OWL_BC4_UNORM:
+    color_model = 131;
+    num_samples = 1;
+    break;
+
+  case OWL_BC5_UNORM:
+    color_model = 132;
+    num_samples = 2;
+    break;
+
+  case OWL_BC7_SRGB:
+    srgb = 1;
+    /* fallthrough */
+  case OWL_BC7_UNORM:
+    color_model = 134;
+    num_samples = 1;
+    break;
+
+  default:
+    return OWL_ERROR_INVALID_VALUE;
+  }
+
+  /* the total size, then the descriptor block and its samples */
+  dfd_size = 4 + 24 + 16 * num_samples;
+  dfd_offset = OWL_TEXTURE_KTX2_HEADER_SIZE +
+               num_levels * OWL_TEXTURE_KTX2_LEVEL_SIZE;
+  header_size = dfd_offset + dfd_size;
+
+  header = OWL_MALLOC(header_size);
+  if (!header)
+    return OWL_ERROR_NO_MEMORY;
+
+  OWL_MEMSET(header, 0, header_size);
+  OWL_MEMCPY(header, owl_texture_ktx2_identifier,
+             sizeof(owl_texture_ktx2_identifier));
+
+  owl_texture_ktx2_put_u32(&header[12],
+                           owl_pixel_format_as_vk_format(desc->format));
+  owl_texture_ktx2_put_u32(&header[16], 1);
+  owl_texture_ktx2_put_u32(&header[20], desc->width);
+  owl_texture_ktx2_put_u32(&header[24], desc->height);
+  owl_texture_ktx2_put_u32(&header[36], 1);
+  owl_texture_ktx2_put_u32(&header[40], num_levels);
+  owl_texture_ktx2_put_u32(&header[48], dfd_offset);
+  owl_texture_ktx2_put_u32(&header[52], dfd_size);
+
+  /* the levels go smallest first, each aligned to a block */
+  offset = header_size;
+  pixels_offset = owl_texture_levels_size(desc->format, desc->width,
+                                          desc->height, num_levels);
+  for (i = (int32_t)num_levels - 1; i >= 0; --i) {
+    uint8_t *level = &header[OWL_TEXTURE_KTX2_HEADER_SIZE +
+                             i * OWL_TEXTURE_KTX2_LEVEL_SIZE];
+    uint64_t const level_size = owl_texture_levels_size(
+        desc->format, OWL_MAX(1, desc->width >> i),
+        OWL_MAX(1, desc->height >> i), 1);
+
+    offset = OWL_ALIGN_UP_2(offset, (uint64_t)block_size);
+
+    owl_texture_ktx2_put_u64(&level[0], offset);
+    owl_texture_ktx2_put_u64(&level[8], level_size);
+    owl_texture_ktx2_put_u64(&level[16], level_size);
+
+    offset += level_size;
+  }
+
+  {
+    uint8_t *dfd = &header[dfd_offset];
+
+    owl_texture_ktx2_put_u32(&dfd[0], dfd_size);
+    /* vendor khronos, type basic */
+    owl_texture_ktx2_put_u32(&dfd[4], 0);
+    /* version 1.3 */
+    owl_texture_ktx2_put_u32(&dfd[8], 2 | ((dfd_size - 4) << 16));
+    /* bt709 primaries, srgb or linear transfer */
+    owl_texture_ktx2_put_u32(&dfd[12], color_model | (1 << 8) |
+                                           ((srgb ? 2U : 1U) << 16));
+    /* 4x4x1x1 texels, stored as the size minus 1 */
+    owl_texture_ktx2_put_u32(&dfd[16], 3 | (3 << 8));
+    owl_texture_ktx2_put_u32(&dfd[20], block_size);
+
+    for (i = 0; i < (int32_t)num_samples; ++i) {
+      uint8_t *sample = &dfd[28 + 16 * i];
+      uint32_t channel = i;
+      uint32_t const bits = 8 * block_size / num_samples;
+
+      /* bc1 stores the alpha present channel, bc3 the alpha first which
+       * stays linear with an srgb transfer */
+      if (128 == color_model)
+        channel = 1;
+      else if (130 == color_model && 0 == i)
+        channel = 15 | (srgb ? 0x10 : 0);
+      else if (130 == color_model)
+        channel = 0;
+
+      owl_texture_ktx2_put_u32(&sample[0],
+                               (i * bits) | ((bits - 1) << 16) |
+                                   (channel << 24));
+      owl_texture_ktx2_put_u32(&sample[12], 0xFFFFFFFF);
+    }
+  }
+
+  file = fopen(path, "wb");
+  if (!file) {
+    ret = OWL_ERROR_NOT_FOUND;
+    goto out_free_header;
+  }
+
+  if (1 != fwrite(header, header_size, 1, file)) {
+    ret = OWL_ERROR_FATAL;
+    goto out_close_file;
+  }
+
+  offset = header_size;
+  for (i = (int32_t)num_levels - 1; i >= 0; --i) {
+    uint8_t const *pixels = desc->pixels;
+    uint64_t const level_size = owl_texture_levels_size(
+        desc->format, OWL_MAX(1, desc->width >> i),
+        OWL_MAX(1, desc->height >> i), 1);
+    uint64_t const aligned = OWL_ALIGN_UP_2(offset, (uint64_t)block_size);
+
+    pixels_offset -= level_size;
+
+    if ((aligned != offset &&
+         1 != fwrite(zeros, aligned - offset, 1, file)) ||
+        1 != fwrite(&pixels[pixels_offset], level_size, 1, file)) {
+      ret = OWL_ERROR_FATAL;
+      goto out_close_file;
+    }
+
+    offset = aligned + level_size;
+  }
+
+out_close_file:
+  if (fclose(file) && !ret)
+    ret = OWL_ERROR_FATAL;
+
+out_free_header:
+  OWL_FREE(header);
+
+  return ret;
+}
+
+static char const *owl_texture_cache_name(enum owl_pixel_format format,
+                                          enum owl_texture_swizzle swizzle) {
+  if (OWL_TEXTURE_SWIZZLE_RG_AS_GB == swizzle)
+    return OWL_BC5_UNORM == format ? "bc5_unorm_gb" : NULL;
+
+  switch (format) {
+  case OWL_BC1_RGBA_SRGB:
+    return "bc1_srgb";
+
+  case OWL_BC1_RGBA_UNORM:
+    return "bc1_unorm";
+
+  case OWL_BC4_UNORM:
+    return "bc4_unorm";
+
+  case OWL_BC5_UNORM:
+    return "bc5_unorm";
+
+  default:
+    return NULL;
+  }
+}
+
+/* the red channel, the only one bc4 keeps */
+static void owl_texture_encode_bc4(uint8_t const *texels, uint8_t *block) {
+  owl_texture_compression_encode_bc4(texels, 0, block);
+}
+
+int owl_texture_load_compressed(char const *path, enum owl_pixel_format format,
+                                enum owl_texture_swizzle swizzle,
+                                struct owl_texture_desc *desc) {
+  int width;
+  int height;
+  uint8_t *data;
+  uint8_t *levels;
+  uint8_t *blocks;
+  uint8_t *src;
+  uint8_t *dst;
+  int32_t i;
+  int32_t srgb;
+  int32_t cache;
+  int32_t length;
+  uint32_t mipmaps;
+  uint64_t block_size;
+  uint64_t image_time;
+  uint64_t cache_time;
+  uint64_t num_pixels;
+  char const *name = owl_texture_cache_name(format, swizzle);
+  char cache_path[OWL_TEXTURE_MAX_CACHE_PATH_LENGTH];
+  void (*encode_block)(uint8_t const *texels, uint8_t *block);
+
+  if (!name)
+    return OWL_ERROR_INVALID_VALUE;
+
+  length = OWL_SNPRINTF(cache_path, sizeof(cache_path), "%s.%s.ktx2", path,
+                        name);
+  cache = 0 <= length && OWL_TEXTURE_MAX_CACHE_PATH_LENGTH > length;
+
+  if (cache && !owl_plataform_get_file_time(path, &image_time) &&
+      !owl_plataform_get_file_time(cache_path, &cache_time) &&
+      cache_time >= image_time && !owl_texture_load_ktx2(cache_path, desc)) {
+    desc->swizzle = swizzle;
+    return OWL_OK;
+  }
+
+  data = owl_texture_decode_file(path, &width, &height);
+  if (!data)
+    return OWL_ERROR_NOT_FOUND;
+
+  mipmaps = owl_texture_calculate_mipmaps(width, height);
+  num_pixels = (uint64_t)width * height;
+
+  levels = OWL_MALLOC(owl_texture_levels_size(OWL_RGBA8_UNORM, width, height,
+                                              mipmaps));
+  if (!levels) {
+    stbi_image_free(data);
+    return OWL_ERROR_NO_MEMORY;
+  }
+
+  OWL_MEMCPY(levels, data, num_pixels * 4);
+  stbi_image_free(data);
+
+  srgb = OWL_BC1_RGBA_SRGB == format;
+
+  /* bc1 only has 1 bit alpha, anything translucent goes to bc3 */
+  if (OWL_BC1_RGBA_SRGB == format || OWL_BC1_RGBA_UNORM == format) {
+    for (i = 0; i < (int32_t)num_pixels; ++i) {
+      if (255 != levels[i * 4 + 3]) {
+        format = srgb ? OWL_BC3_SRGB : OWL_BC3_UNORM;
+        break;
+      }
+    }
+  }
+
+  if (OWL_BC4_UNORM == format)
+    encode_block = owl_texture_encode_bc4;
+  else if (OWL_BC5_UNORM == format)
+    encode_block = owl_texture_compression_encode_bc5;
+  else if (OWL_BC3_SRGB == format || OWL_BC3_UNORM == format)
+    encode_block = owl_texture_compression_encode_bc3;
+  else
+    encode_block = owl_texture_compression_encode_bc1;
+
+  owl_texture_build_mipmaps(width, height, mipmaps, srgb, levels);
+
+  /* the encoders take the first channels */
+  if (OWL_TEXTURE_SWIZZLE_RG_AS_GB == swizzle) {
+    uint64_t j;
+    uint64_t const num_level_pixels =
+        owl_texture_levels_size(OWL_RGBA8_UNORM, width, height, mipmaps) / 4;
+
+    for (j = 0; j < num_level_pixels; ++j) {
+      levels[j * 4 + 0] = levels[j * 4 + 1];
+      levels[j * 4 + 1] = levels[j * 4 + 2];
+    }
+  }
+
+  blocks = OWL_MALLOC(owl_texture_levels_size(format, width, height, mipmaps));
+  if (!blocks) {
+    OWL_FREE(levels);
+    return OWL_ERROR_NO_MEMORY;
+  }
+
+  block_size = owl_pixel_format_size(format);
+
+  src = levels;
+  dst = blocks;
+  for (i = 0; i < (int32_t)mipmaps; ++i) {
+    uint32_t const level_width = OWL_MAX(1, (uint32_t)width >> i);
+    uint32_t const level_height = OWL_MAX(1, (uint32_t)height >> i);
+
+    owl_texture_compression_encode_image(src, level_width, level_height,
+                                         block_size, encode_block, dst);
+
+    src += (uint64_t)level_width * level_height * 4;
+    dst += owl_texture_levels_size(format, level_width, level_height, 1);
+  }
+
+  OWL_FREE(levels);
+
+  desc->type = OWL_TEXTURE_TYPE_2D;
+  desc->source = OWL_TEXTURE_SOURCE_DATA;
+  desc->path = NULL;
+  desc->pixels = blocks;
+  desc->width = width;
+  desc->height = height;
+  desc->format = format;
+  desc->swizzle = swizzle;
+  desc->mipmaps = mipmaps;
+
+  /* a partially written cache would only be read back wrong */
+  if (cache && owl_texture_write_ktx2(cache_path, desc))
+    remove(cache_path);
+
+  return OWL_OK;
+}
+
+static int owl_texture_is_ktx2(char const *path) {
+  uint64_t const length = OWL_STRLEN(path);
+
+  return 5 <= length && !OWL_MEMCMP(&path[length - 5], ".ktx2", 5);
+}
+
 OWLAPI void owl_texture_change_layout(struct owl_texture *texture,
                                       VkCommandBuffer command_buffer,
                                       VkImageLayout layout) {
@@ -215,6 +884,8 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
                             struct owl_texture_desc *desc,
                             struct owl_texture *texture) {
   int ret;
+  /* the levels come in desc->pixels instead of being blitted */
+  int uploads_levels = 0;
 
   VkFormat vk_format;
   VkResult vk_result;
@@ -228,10 +899,24 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
   texture->image_view = VK_NULL_HANDLE;
   texture->descriptor_set = VK_NULL_HANDLE;
 
+  if (OWL_TEXTURE_SOURCE_FILE == desc->source &&
+      OWL_TEXTURE_TYPE_2D == desc->type && owl_texture_is_ktx2(desc->path)) {
+    struct owl_texture_desc ktx2_desc;
+
+    ret = owl_texture_load_ktx2(desc->path, &ktx2_desc);
+    if (ret)
+      return ret;
+
+    ret = owl_texture_init(r, &ktx2_desc, texture);
+
+    OWL_FREE((void *)ktx2_desc.pixels);
+
+    return ret;
+  }
+
   /* first upload the image(s) data into the upload buffer */
   if (OWL_TEXTURE_SOURCE_DATA == desc->source) {
     uint64_t bitmap_size;
-    uint64_t pixel_size;
 
     /* loading a cubemap from raw data not supported atm */
     if (OWL_TEXTURE_TYPE_CUBE == desc->type) {
@@ -239,6 +924,15 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
       goto error_free_upload_data;
     }
 
+    if (owl_texture_is_compressed(desc->format) &&
+        !r->has_texture_compression_bc) {
+      ret = OWL_ERROR_INVALID_VALUE;
+      goto error_free_upload_data;
+    }
+
+    /* compressed formats can't be blitted into their levels */
+    uploads_levels = desc->mipmaps || owl_texture_is_compressed(desc->format);
+
     texture->layers = 1;
 
     /* set the texture dimensions */
@@ -249,8 +943,9 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
     vk_format = owl_pixel_format_as_vk_format(desc->format);
 
     /* calculate the size in bytes */
-    pixel_size = owl_pixel_format_size(desc->format);
-    bitmap_size = texture->width * texture->height * pixel_size;
+    bitmap_size = owl_texture_levels_size(desc->format, texture->width,
+                                          texture->height,
+                                          OWL_MAX(1, desc->mipmaps));
 
     /* allocate staging memory */
     upload_data =
@@ -266,12 +961,11 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
     /* when loading from disk, always use r8g8b8a8_srgb */
     vk_format = owl_pixel_format_as_vk_format(OWL_RGBA8_SRGB);
 
-    /* if it's just one 2D texture, simply use stbi_load and load */
+    /* if it's just one 2D texture, simply decode and load */
     if (OWL_TEXTURE_TYPE_2D == desc->type ||
         OWL_TEXTURE_TYPE_COMPUTE == desc->type) {
       int width;
       int height;
-      int channels;
       uint8_t *data;
       uint64_t bitmap_size;
       uint64_t pixel_size;
@@ -279,7 +973,7 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
       texture->layers = 1;
 
       /* load image from disk */
-      data = stbi_load(desc->path, &width, &height, &channels, STBI_rgb_alpha);
+      data = owl_texture_decode_file(desc->path, &width, &height);
       if (!data) {
         ret = OWL_ERROR_FATAL;
         goto error_free_upload_data;
@@ -312,7 +1006,6 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
       int32_t i;
       int width = 0;
       int height = 0;
-      int channels = 0;
       uint64_t offset = 0;
       uint64_t bitmap_size = 0;
       uint64_t pixel_size;
@@ -337,7 +1030,7 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
                      names[i]);
 
         /* load the image */
-        data = stbi_load(path, &width, &height, &channels, STBI_rgb_alpha);
+        data = owl_texture_decode_file(path, &width, &height);
         if (!data) {
           OWL_ASSERT(0);
           ret = OWL_ERROR_FATAL;
@@ -386,6 +1079,8 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
 
   if (OWL_TEXTURE_TYPE_COMPUTE == desc->type)
     texture->mipmaps = 1;
+  else if (uploads_levels)
+    texture->mipmaps = OWL_MAX(1, desc->mipmaps);
   else
     texture->mipmaps =
         owl_texture_calculate_mipmaps(texture->width, texture->height);
@@ -481,10 +1176,17 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
     else
       info.viewType = VK_IMAGE_VIEW_TYPE_2D;
     info.format = vk_format;
-    info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    if (OWL_TEXTURE_SWIZZLE_RG_AS_GB == desc->swizzle) {
+      info.components.r = VK_COMPONENT_SWIZZLE_ONE;
+      info.components.g = VK_COMPONENT_SWIZZLE_R;
+      info.components.b = VK_COMPONENT_SWIZZLE_G;
+      info.components.a = VK_COMPONENT_SWIZZLE_ONE;
+    } else {
+      info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+      info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+      info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+      info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    }
     info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     info.subresourceRange.baseMipLevel = 0;
     info.subresourceRange.levelCount = texture->mipmaps;
@@ -555,30 +1257,50 @@ OWLAPI int owl_texture_init(struct owl_renderer *r,
                            OWL_ARRAY_SIZE(copies), copies);
 
   } else {
-    VkBufferImageCopy copy;
-
-    copy.bufferOffset = 0;
-    copy.bufferRowLength = 0;
-    copy.bufferImageHeight = 0;
-    copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    copy.imageSubresource.mipLevel = 0;
-    copy.imageSubresource.baseArrayLayer = 0;
-    copy.imageSubresource.layerCount = 1;
-    copy.imageOffset.x = 0;
-    copy.imageOffset.y = 0;
-    copy.imageOffset.z = 0;
-    copy.imageExtent.width = texture->width;
-    copy.imageExtent.height = texture->height;
-    copy.imageExtent.depth = 1;
-
-    vkCmdCopyBufferToImage(r->im_command_buffer, upload_allocation.buffer,
-                           texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                           1, &copy);
+    uint32_t i;
+    uint32_t num_levels = 1;
+    uint64_t offset = 0;
+    enum owl_pixel_format format = OWL_RGBA8_SRGB;
+
+    if (OWL_TEXTURE_SOURCE_DATA == desc->source)
+      format = desc->format;
+
+    if (uploads_levels)
+      num_levels = texture->mipmaps;
+
+    for (i = 0; i < num_levels; ++i) {
+      VkBufferImageCopy copy;
+      uint32_t const width = OWL_MAX(1, texture->width >> i);
+      uint32_t const height = OWL_MAX(1, texture->height >> i);
+
+      copy.bufferOffset = offset;
+      copy.bufferRowLength = 0;
+      copy.bufferImageHeight = 0;
+      copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      copy.imageSubresource.mipLevel = i;
+      copy.imageSubresource.baseArrayLayer = 0;
+      copy.imageSubresource.layerCount = 1;
+      copy.imageOffset.x = 0;
+      copy.imageOffset.y = 0;
+      copy.imageOffset.z = 0;
+      copy.imageExtent.width = width;
+      copy.imageExtent.height = height;
+      copy.imageExtent.depth = 1;
+
+      vkCmdCopyBufferToImage(r->im_command_buffer, upload_allocation.buffer,
+                             texture->image,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+      offset += owl_texture_levels_size(format, width, height, 1);
+    }
   }
 
   if (OWL_TEXTURE_TYPE_COMPUTE == desc->type)
     owl_texture_change_layout(texture, r->im_command_buffer,
                               VK_IMAGE_LAYOUT_GENERAL);
+  else if (uploads_levels)
+    owl_texture_change_layout(texture, r->im_command_buffer,
+                              VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
   else
     owl_texture_generate_mipmaps(texture, r);
 
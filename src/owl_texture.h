@@ -21,17 +21,42 @@ enum owl_pixel_format {
   OWL_RGBA8_SRGB,
   OWL_RGBA8_UNORM,
   OWL_R8_UNORM,
-  OWL_RGBA32_SFLOAT
+  OWL_RG8_UNORM,
+  OWL_RGBA32_SFLOAT,
+  /* 4x4 blocks, need owl_renderer::has_texture_compression_bc */
+  OWL_BC1_RGBA_SRGB,
+  OWL_BC1_RGBA_UNORM,
+  OWL_BC3_SRGB,
+  OWL_BC3_UNORM,
+  OWL_BC4_UNORM,
+  OWL_BC5_UNORM,
+  OWL_BC7_SRGB,
+  OWL_BC7_UNORM
+};
+
+/* where the channels of the texture are sampled from, for formats packed
+ * with fewer channels than the image they came from */
+enum owl_texture_swizzle {
+  OWL_TEXTURE_SWIZZLE_IDENTITY,
+  /* red and green are sampled as green and blue, red and alpha read 1 */
+  OWL_TEXTURE_SWIZZLE_RG_AS_GB
 };
 
 struct owl_texture_desc {
   enum owl_texture_type type;
   enum owl_texture_source source;
+  /* paths ending in .ktx2 load the levels and format of the file */
   char const *path;
   void const *pixels;
   uint32_t width;
   uint32_t height;
   enum owl_pixel_format format;
+  enum owl_texture_swizzle swizzle;
+  /* only for OWL_TEXTURE_SOURCE_DATA, the number of levels in pixels, each
+   * one right after the one before and half its size. 0 uploads a single
+   * level and blits the rest on the gpu, compressed formats can't be blitted
+   * and get just the one level */
+  uint32_t mipmaps;
 };
 
 struct owl_texture {
@@ -58,6 +83,47 @@ OWLAPI void owl_texture_change_layout(struct owl_texture *texture,
                                       VkImageLayout layout);
 
 uint32_t owl_texture_calculate_mipmaps(uint32_t w, uint32_t h);
+
+int owl_texture_is_compressed(enum owl_pixel_format format);
+
+/* number of bytes of the first mipmaps levels of a w by h image, the layout
+ * of owl_texture_desc::pixels */
+uint64_t owl_texture_levels_size(enum owl_pixel_format format, uint32_t w,
+                                 uint32_t h, uint32_t mipmaps);
+
+/* fills every level after the first of an rgba8 image with a box filter,
+ * in linear space when srgb is set like the blits of owl_texture_init */
+void owl_texture_build_mipmaps(uint32_t width, uint32_t height,
+                               uint32_t mipmaps, int srgb, uint8_t *pixels);
+
+/* keeps count channels of every rgba8 pixel starting at first, packed one
+ * pixel after the other in place */
+void owl_texture_pack_channels(uint64_t num_pixels, int32_t first,
+                               int32_t count, uint8_t *pixels);
+
+/* decodes the image at path into rgba8 straight from a mapping of the file,
+ * NULL if it can't. free the pixels with stbi_image_free */
+uint8_t *owl_texture_decode_file(char const *path, int *width, int *height);
+
+/* reads a ktx2 file with a single 2D layer and no supercompression into a
+ * data desc, the levels go into desc->pixels and must be freed with
+ * OWL_FREE */
+int owl_texture_load_ktx2(char const *path, struct owl_texture_desc *desc);
+
+/* writes the levels of a data desc in a block compressed format as ktx2 */
+int owl_texture_write_ktx2(char const *path,
+                           struct owl_texture_desc const *desc);
+
+/* decodes the image at path and encodes every level of it in format, bc1,
+ * bc4 or bc5. bc1 becomes bc3 if the image has any alpha. with
+ * OWL_TEXTURE_SWIZZLE_RG_AS_GB green and blue are encoded instead of red and
+ * green. the result is cached next to the image as <path>.<format>.ktx2 and
+ * read back from there while it's newer than the image. free desc->pixels
+ * with OWL_FREE */
+int owl_texture_load_compressed(char const *path, enum owl_pixel_format format,
+                                enum owl_texture_swizzle swizzle,
+                                struct owl_texture_desc *desc);
+
 OWL_END_DECLARATIONS
 
 #endif
@@ -0,0 +1,328 @@
+#include "owl_texture_compression.h"
+
+#include "owl_internal.h"
+
+#define OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS 16
+
+static uint16_t owl_texture_compression_pack_565(float const *color) {
+  float const r = OWL_CLAMP(color[0], 0.0F, 255.0F) * (31.0F / 255.0F);
+  float const g = OWL_CLAMP(color[1], 0.0F, 255.0F) * (63.0F / 255.0F);
+  float const b = OWL_CLAMP(color[2], 0.0F, 255.0F) * (31.0F / 255.0F);
+
+  return (uint16_t)(((uint32_t)(r + 0.5F) << 11) |
+                    ((uint32_t)(g + 0.5F) << 5) | (uint32_t)(b + 0.5F));
+}
+
+/* expanded the way the hardware does, replicating the high bits */
+static void owl_texture_compression_unpack_565(uint16_t packed,
+                                               int32_t *color) {
+  int32_t const r = (packed >> 11) & 31;
+  int32_t const g = (packed >> 5) & 63;
+  int32_t const b = packed & 31;
+
+  color[0] = (r << 3) | (r >> 2);
+  color[1] = (g << 2) | (g >> 4);
+  color[2] = (b << 3) | (b >> 2);
+}
+
+/* picks the closest of the 4 colors between c0 and c1 for every texel,
+ * returns the squared error */
+static int32_t owl_texture_compression_fit_bc1(uint8_t const *texels,
+                                               uint16_t c0, uint16_t c1,
+                                               uint8_t *indices) {
+  int32_t i;
+  int32_t c;
+  int32_t endpoints[2][3];
+  int32_t palette[4][3];
+  int32_t error = 0;
+
+  owl_texture_compression_unpack_565(c0, endpoints[0]);
+  owl_texture_compression_unpack_565(c1, endpoints[1]);
+
+  for (c = 0; c < 3; ++c) {
+    palette[0][c] = endpoints[0][c];
+    palette[1][c] = endpoints[1][c];
+    palette[2][c] = (2 * endpoints[0][c] + endpoints[1][c]) / 3;
+    palette[3][c] = (endpoints[0][c] + 2 * endpoints[1][c]) / 3;
+  }
+
+  for (i = 0; i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i) {
+    int32_t j;
+    int32_t best = 0;
+    int32_t best_error = -1;
+    uint8_t const *texel = &texels[i * 4];
+
+    for (j = 0; j < 4; ++j) {
+      int32_t const dr = texel[0] - palette[j][0];
+      int32_t const dg = texel[1] - palette[j][1];
+      int32_t const db = texel[2] - palette[j][2];
+      int32_t const e = dr * dr + dg * dg + db * db;
+
+      if (-1 == best_error || e < best_error) {
+        best = j;
+        best_error = e;
+      }
+    }
+
+    indices[i] = (uint8_t)best;
+    error += best_error;
+  }
+
+  return error;
+}
+
+/* the endpoints that minimize the squared error of the texels for the
+ * indices they already have, 0 if the indices don't tell them apart */
+static int owl_texture_compression_refine_bc1(uint8_t const *texels,
+                                              uint8_t const *indices,
+                                              float *e0, float *e1) {
+  int32_t i;
+  int32_t c;
+  float det;
+  float aa = 0.0F;
+  float ab = 0.0F;
+  float bb = 0.0F;
+  float ax[3] = {0.0F, 0.0F, 0.0F};
+  float bx[3] = {0.0F, 0.0F, 0.0F};
+  /* how much of c0 every index takes */
+  static float const weights[4] = {1.0F, 0.0F, 2.0F / 3.0F, 1.0F / 3.0F};
+
+  for (i = 0; i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i) {
+    float const a = weights[indices[i]];
+    float const b = 1.0F - a;
+
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+
+    for (c = 0; c < 3; ++c) {
+      ax[c] += a * texels[i * 4 + c];
+      bx[c] += b * texels[i * 4 + c];
+    }
+  }
+
+  det = aa * bb - ab * ab;
+  if (det < 1e-6F)
+    return 0;
+
+  for (c = 0; c < 3; ++c) {
+    e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+    e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+  }
+
+  return 1;
+}
+
+OWLAPI void owl_texture_compression_encode_bc1(uint8_t const *texels,
+                                               uint8_t *block) {
+  int32_t i;
+  int32_t c;
+  int32_t error;
+  uint16_t c0;
+  uint16_t c1;
+  uint32_t bits;
+  float min_t = 0.0F;
+  float max_t = 0.0F;
+  float length = 0.0F;
+  float e0[3];
+  float e1[3];
+  float mean[3] = {0.0F, 0.0F, 0.0F};
+  float axis[3] = {1.0F, 1.0F, 1.0F};
+  float covariance[6] = {0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
+  uint8_t indices[OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS];
+
+  for (i = 0; i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i)
+    for (c = 0; c < 3; ++c)
+      mean[c] += texels[i * 4 + c] / 16.0F;
+
+  for (i = 0; i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i) {
+    float const r = texels[i * 4 + 0] - mean[0];
+    float const g = texels[i * 4 + 1] - mean[1];
+    float const b = texels[i * 4 + 2] - mean[2];
+
+    covariance[0] += r * r;
+    covariance[1] += r * g;
+    covariance[2] += r * b;
+    covariance[3] += g * g;
+    covariance[4] += g * b;
+    covariance[5] += b * b;
+  }
+
+  /* the principal axis of the colors by power iteration */
+  for (i = 0; i < 8; ++i) {
+    float scale;
+    float next[3];
+
+    next[0] = covariance[0] * axis[0] + covariance[1] * axis[1] +
+              covariance[2] * axis[2];
+    next[1] = covariance[1] * axis[0] + covariance[3] * axis[1] +
+              covariance[4] * axis[2];
+    next[2] = covariance[2] * axis[0] + covariance[4] * axis[1] +
+              covariance[5] * axis[2];
+
+    scale = OWL_MAX(OWL_MAX(next[0] < 0.0F ? -next[0] : next[0],
+                            next[1] < 0.0F ? -next[1] : next[1]),
+                    next[2] < 0.0F ? -next[2] : next[2]);
+    if (scale < 1e-6F)
+      break;
+
+    for (c = 0; c < 3; ++c)
+      axis[c] = next[c] / scale;
+  }
+
+  for (c = 0; c < 3; ++c)
+    length += axis[c] * axis[c];
+
+  /* the end points of the colors along the axis, moved in by a 16th of
+   * their distance so the interpolated colors land on the texels */
+  for (i = 0; length > 1e-6F && i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS;
+       ++i) {
+    float t = 0.0F;
+
+    for (c = 0; c < 3; ++c)
+      t += (texels[i * 4 + c] - mean[c]) * axis[c];
+
+    t /= length;
+
+    min_t = 0 == i ? t : OWL_MIN(min_t, t);
+    max_t = 0 == i ? t : OWL_MAX(max_t, t);
+  }
+
+  for (c = 0; c < 3; ++c) {
+    float const inset = (max_t - min_t) * axis[c] / 16.0F;
+
+    e0[c] = mean[c] + max_t * axis[c] - inset;
+    e1[c] = mean[c] + min_t * axis[c] + inset;
+  }
+
+  c0 = owl_texture_compression_pack_565(e0);
+  c1 = owl_texture_compression_pack_565(e1);
+  error = owl_texture_compression_fit_bc1(texels, c0, c1, indices);
+
+  if (error && owl_texture_compression_refine_bc1(texels, indices, e0, e1)) {
+    uint8_t refined_indices[OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS];
+    uint16_t const refined_c0 = owl_texture_compression_pack_565(e0);
+    uint16_t const refined_c1 = owl_texture_compression_pack_565(e1);
+    int32_t const refined_error = owl_texture_compression_fit_bc1(
+        texels, refined_c0, refined_c1, refined_indices);
+
+    if (refined_error < error) {
+      c0 = refined_c0;
+      c1 = refined_c1;
+      OWL_MEMCPY(indices, refined_indices, sizeof(indices));
+    }
+  }
+
+  /* c0 > c1 selects the 4 color mode, with c0 == c1 every texel is c0 */
+  if (c0 < c1) {
+    uint16_t const swap = c0;
+
+    c0 = c1;
+    c1 = swap;
+
+    for (i = 0; i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i)
+      indices[i] ^= 1;
+  } else if (c0 == c1) {
+    OWL_MEMSET(indices, 0, sizeof(indices));
+  }
+
+  bits = 0;
+  for (i = 0; i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i)
+    bits |= (uint32_t)indices[i] << (2 * i);
+
+  block[0] = (uint8_t)(c0 & 0xFF);
+  block[1] = (uint8_t)(c0 >> 8);
+  block[2] = (uint8_t)(c1 & 0xFF);
+  block[3] = (uint8_t)(c1 >> 8);
+  block[4] = (uint8_t)(bits & 0xFF);
+  block[5] = (uint8_t)((bits >> 8) & 0xFF);
+  block[6] = (uint8_t)((bits >> 16) & 0xFF);
+  block[7] = (uint8_t)(bits >> 24);
+}
+
+OWLAPI void owl_texture_compression_encode_bc4(uint8_t const *texels,
+                                               int32_t c, uint8_t *block) {
+  int32_t i;
+  int32_t j;
+  int32_t palette[8];
+  uint32_t bits[2] = {0, 0};
+  int32_t a0 = texels[c];
+  int32_t a1 = texels[c];
+
+  for (i = 1; i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i) {
+    a0 = OWL_MAX(a0, texels[i * 4 + c]);
+    a1 = OWL_MIN(a1, texels[i * 4 + c]);
+  }
+
+  /* a0 > a1 selects the 8 value mode, with a0 == a1 every texel is a0 */
+  palette[0] = a0;
+  palette[1] = a1;
+  for (j = 2; j < 8; ++j)
+    palette[j] = ((8 - j) * a0 + (j - 1) * a1 + 3) / 7;
+
+  for (i = 0; a0 != a1 && i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i) {
+    int32_t best = 0;
+    int32_t best_error = 256;
+    int32_t const value = texels[i * 4 + c];
+
+    for (j = 0; j < 8; ++j) {
+      int32_t const e = value < palette[j] ? palette[j] - value
+                                           : value - palette[j];
+
+      if (e < best_error) {
+        best = j;
+        best_error = e;
+      }
+    }
+
+    /* 8 3 bit indices per 24 bits */
+    bits[i / 8] |= (uint32_t)best << (3 * (i % 8));
+  }
+
+  block[0] = (uint8_t)a0;
+  block[1] = (uint8_t)a1;
+
+  for (j = 0; j < 2; ++j) {
+    block[2 + j * 3 + 0] = (uint8_t)(bits[j] & 0xFF);
+    block[2 + j * 3 + 1] = (uint8_t)((bits[j] >> 8) & 0xFF);
+    block[2 + j * 3 + 2] = (uint8_t)((bits[j] >> 16) & 0xFF);
+  }
+}
+
+OWLAPI void owl_texture_compression_encode_bc3(uint8_t const *texels,
+                                               uint8_t *block) {
+  owl_texture_compression_encode_bc4(texels, 3, &block[0]);
+  owl_texture_compression_encode_bc1(texels, &block[8]);
+}
+
+OWLAPI void owl_texture_compression_encode_bc5(uint8_t const *texels,
+                                               uint8_t *block) {
+  owl_texture_compression_encode_bc4(texels, 0, &block[0]);
+  owl_texture_compression_encode_bc4(texels, 1, &block[8]);
+}
+
+OWLAPI void owl_texture_compression_encode_image(
+    uint8_t const *pixels, uint32_t width, uint32_t height,
+    uint32_t block_size,
+    void (*encode_block)(uint8_t const *texels, uint8_t *block),
+    uint8_t *blocks) {
+  uint32_t x;
+  uint32_t y;
+
+  for (y = 0; y < height; y += 4) {
+    for (x = 0; x < width; x += 4) {
+      uint32_t i;
+      uint8_t texels[OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS * 4];
+
+      for (i = 0; i < OWL_TEXTURE_COMPRESSION_BLOCK_TEXELS; ++i) {
+        uint32_t const tx = OWL_MIN(x + i % 4, width - 1);
+        uint32_t const ty = OWL_MIN(y + i / 4, height - 1);
+
+        OWL_MEMCPY(&texels[i * 4], &pixels[(ty * width + tx) * 4], 4);
+      }
+
+      encode_block(texels, blocks);
+      blocks += block_size;
+    }
+  }
+}
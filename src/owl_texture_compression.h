@@ -0,0 +1,38 @@
+#ifndef OWL_TEXTURE_COMPRESSION_H
+#define OWL_TEXTURE_COMPRESSION_H
+
+#include "owl_definitions.h"
+
+OWL_BEGIN_DECLARATIONS
+
+/* cpu encoders for the 4x4 block formats, the texels are rgba8 and the rows
+ * of a block are 4 texels apart */
+
+/* 8 bytes, 4 color mode, alpha is ignored */
+OWLAPI void owl_texture_compression_encode_bc1(uint8_t const *texels,
+                                               uint8_t *block);
+
+/* 8 bytes, channel c of the texels */
+OWLAPI void owl_texture_compression_encode_bc4(uint8_t const *texels,
+                                               int32_t c, uint8_t *block);
+
+/* 16 bytes, a bc4 block of the alpha and a bc1 block of the color */
+OWLAPI void owl_texture_compression_encode_bc3(uint8_t const *texels,
+                                               uint8_t *block);
+
+/* 16 bytes, a bc4 block of the red and one of the green */
+OWLAPI void owl_texture_compression_encode_bc5(uint8_t const *texels,
+                                               uint8_t *block);
+
+/* encodes a width by height rgba8 image into blocks of block_size bytes
+ * with encode_block, the texels past the edges repeat the last row and
+ * column */
+OWLAPI void owl_texture_compression_encode_image(
+    uint8_t const *pixels, uint32_t width, uint32_t height,
+    uint32_t block_size,
+    void (*encode_block)(uint8_t const *texels, uint8_t *block),
+    uint8_t *blocks);
+
+OWL_END_DECLARATIONS
+
+#endif
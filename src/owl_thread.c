@@ -0,0 +1,397 @@
+#include "owl_thread.h"
+
+#include "owl_internal.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+struct owl_thread_pool_state {
+  pthread_mutex_t mutex;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  pthread_cond_t finish;
+
+  /* bumped for every loop, workers wait for it to change */
+  uint32_t generation;
+  int32_t quit;
+
+  void (*fn)(void *data, int32_t i);
+  void *data;
+  int32_t count;
+  int32_t next;
+  int32_t num_pending;
+
+  /* the indices whose fn returned, in the order they did. only pipelines
+   * keep them */
+  int32_t *finished;
+  int32_t num_finished;
+
+  int32_t num_workers;
+  pthread_t workers[OWL_MAX_THREADS];
+};
+
+/* claims indices one at a time, the loop bodies are coarse (a whole model
+ * instance) so the lock is not contended */
+static void owl_thread_pool_run(struct owl_thread_pool_state *state) {
+  for (;;) {
+    int32_t i;
+
+    pthread_mutex_lock(&state->mutex);
+    i = state->next < state->count ? state->next++ : -1;
+    pthread_mutex_unlock(&state->mutex);
+
+    if (-1 == i)
+      break;
+
+    state->fn(state->data, i);
+
+    if (state->finished) {
+      pthread_mutex_lock(&state->mutex);
+      state->finished[state->num_finished++] = i;
+      pthread_cond_signal(&state->finish);
+      pthread_mutex_unlock(&state->mutex);
+    }
+  }
+}
+
+static void *owl_thread_pool_worker(void *arg) {
+  uint32_t generation = 0;
+  struct owl_thread_pool_state *state = arg;
+
+  for (;;) {
+    pthread_mutex_lock(&state->mutex);
+
+    while (!state->quit && generation == state->generation)
+      pthread_cond_wait(&state->start, &state->mutex);
+
+    if (state->quit) {
+      pthread_mutex_unlock(&state->mutex);
+      break;
+    }
+
+    generation = state->generation;
+    pthread_mutex_unlock(&state->mutex);
+
+    owl_thread_pool_run(state);
+
+    pthread_mutex_lock(&state->mutex);
+    if (!--state->num_pending)
+      pthread_cond_signal(&state->done);
+    pthread_mutex_unlock(&state->mutex);
+  }
+
+  return NULL;
+}
+
+OWLAPI int32_t owl_thread_count_cores(void) {
+  long const count = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (1 > count)
+    return 1;
+
+  return (int32_t)count;
+}
+
+OWLAPI int owl_thread_pool_init(struct owl_thread_pool *pool,
+                                int32_t num_threads) {
+  int32_t i;
+  struct owl_thread_pool_state *state;
+
+  num_threads = OWL_CLAMP(num_threads, 1, OWL_MAX_THREADS);
+
+  state = OWL_MALLOC(sizeof(*state));
+  if (!state)
+    return OWL_ERROR_NO_MEMORY;
+
+  OWL_MEMSET(state, 0, sizeof(*state));
+
+  if (pthread_mutex_init(&state->mutex, NULL))
+    goto error_free_state;
+
+  if (pthread_cond_init(&state->start, NULL))
+    goto error_destroy_mutex;
+
+  if (pthread_cond_init(&state->done, NULL))
+    goto error_destroy_start;
+
+  if (pthread_cond_init(&state->finish, NULL))
+    goto error_destroy_done;
+
+  /* the calling thread is the last one */
+  for (i = 0; i < num_threads - 1; ++i) {
+    if (pthread_create(&state->workers[i], NULL, owl_thread_pool_worker,
+                       state))
+      goto error_join_workers;
+
+    ++state->num_workers;
+  }
+
+  pool->num_threads = num_threads;
+  pool->opaque = state;
+
+  return OWL_OK;
+
+error_join_workers:
+  pthread_mutex_lock(&state->mutex);
+  state->quit = 1;
+  pthread_cond_broadcast(&state->start);
+  pthread_mutex_unlock(&state->mutex);
+
+  for (i = 0; i < state->num_workers; ++i)
+    pthread_join(state->workers[i], NULL);
+
+  pthread_cond_destroy(&state->finish);
+
+error_destroy_done:
+  pthread_cond_destroy(&state->done);
+
+error_destroy_start:
+  pthread_cond_destroy(&state->start);
+
+error_destroy_mutex:
+  pthread_mutex_destroy(&state->mutex);
+
+error_free_state:
+  OWL_FREE(state);
+
+  return OWL_ERROR_FATAL;
+}
+
+OWLAPI void owl_thread_pool_deinit(struct owl_thread_pool *pool) {
+  int32_t i;
+  struct owl_thread_pool_state *state = pool->opaque;
+
+  pthread_mutex_lock(&state->mutex);
+  state->quit = 1;
+  pthread_cond_broadcast(&state->start);
+  pthread_mutex_unlock(&state->mutex);
+
+  for (i = 0; i < state->num_workers; ++i)
+    pthread_join(state->workers[i], NULL);
+
+  pthread_cond_destroy(&state->finish);
+  pthread_cond_destroy(&state->done);
+  pthread_cond_destroy(&state->start);
+  pthread_mutex_destroy(&state->mutex);
+
+  OWL_FREE(state);
+}
+
+OWLAPI void owl_thread_pool_for(struct owl_thread_pool *pool, int32_t count,
+                                void (*fn)(void *data, int32_t i), void *data) {
+  int32_t i;
+  struct owl_thread_pool_state *state = pool->opaque;
+
+  /* not worth waking anyone up */
+  if (!state->num_workers || 1 >= count) {
+    for (i = 0; i < count; ++i)
+      fn(data, i);
+
+    return;
+  }
+
+  pthread_mutex_lock(&state->mutex);
+  state->fn = fn;
+  state->data = data;
+  state->count = count;
+  state->next = 0;
+  state->num_pending = state->num_workers;
+  ++state->generation;
+  pthread_cond_broadcast(&state->start);
+  pthread_mutex_unlock(&state->mutex);
+
+  owl_thread_pool_run(state);
+
+  pthread_mutex_lock(&state->mutex);
+  while (state->num_pending)
+    pthread_cond_wait(&state->done, &state->mutex);
+  pthread_mutex_unlock(&state->mutex);
+}
+
+OWLAPI int owl_thread_pool_pipeline(struct owl_thread_pool *pool,
+                                    int32_t count,
+                                    void (*fn)(void *data, int32_t i),
+                                    void (*done)(void *data, int32_t i),
+                                    void *data) {
+  int32_t i;
+  int32_t num_done;
+  int32_t *finished;
+  struct owl_thread_pool_state *state = pool->opaque;
+
+  if (!state->num_workers || 1 >= count) {
+    for (i = 0; i < count; ++i) {
+      fn(data, i);
+      done(data, i);
+    }
+
+    return OWL_OK;
+  }
+
+  finished = OWL_MALLOC(count * sizeof(*finished));
+  if (!finished)
+    return OWL_ERROR_NO_MEMORY;
+
+  pthread_mutex_lock(&state->mutex);
+  state->fn = fn;
+  state->data = data;
+  state->count = count;
+  state->next = 0;
+  state->finished = finished;
+  state->num_finished = 0;
+  state->num_pending = state->num_workers;
+  ++state->generation;
+  pthread_cond_broadcast(&state->start);
+  pthread_mutex_unlock(&state->mutex);
+
+  for (num_done = 0; num_done < count;) {
+    int32_t ready = -1;
+    int32_t claimed = -1;
+
+    pthread_mutex_lock(&state->mutex);
+
+    while (num_done == state->num_finished && state->next == state->count)
+      pthread_cond_wait(&state->finish, &state->mutex);
+
+    if (num_done < state->num_finished)
+      ready = state->finished[num_done];
+    else
+      claimed = state->next++;
+
+    pthread_mutex_unlock(&state->mutex);
+
+    if (-1 != ready) {
+      done(data, ready);
+      ++num_done;
+    } else {
+      fn(data, claimed);
+
+      pthread_mutex_lock(&state->mutex);
+      state->finished[state->num_finished++] = claimed;
+      pthread_mutex_unlock(&state->mutex);
+    }
+  }
+
+  pthread_mutex_lock(&state->mutex);
+  while (state->num_pending)
+    pthread_cond_wait(&state->done, &state->mutex);
+  state->finished = NULL;
+  pthread_mutex_unlock(&state->mutex);
+
+  OWL_FREE(finished);
+
+  return OWL_OK;
+}
+
+struct owl_thread_task_state {
+  pthread_mutex_t mutex;
+  pthread_cond_t finish;
+  pthread_t thread;
+
+  void (*fn)(void *data);
+  void *data;
+
+  int32_t progress;
+  int32_t done;
+};
+
+static void *owl_thread_task_run(void *arg) {
+  struct owl_thread_task_state *state = arg;
+
+  state->fn(state->data);
+
+  pthread_mutex_lock(&state->mutex);
+  state->done = 1;
+  pthread_cond_broadcast(&state->finish);
+  pthread_mutex_unlock(&state->mutex);
+
+  return NULL;
+}
+
+OWLAPI int owl_thread_task_init(struct owl_thread_task *task,
+                                void (*fn)(void *data), void *data) {
+  struct owl_thread_task_state *state;
+
+  state = OWL_MALLOC(sizeof(*state));
+  if (!state)
+    return OWL_ERROR_NO_MEMORY;
+
+  OWL_MEMSET(state, 0, sizeof(*state));
+
+  state->fn = fn;
+  state->data = data;
+
+  if (pthread_mutex_init(&state->mutex, NULL))
+    goto error_free_state;
+
+  if (pthread_cond_init(&state->finish, NULL))
+    goto error_destroy_mutex;
+
+  /* fn may report before pthread_create returns */
+  task->opaque = state;
+
+  if (pthread_create(&state->thread, NULL, owl_thread_task_run, state))
+    goto error_destroy_finish;
+
+  return OWL_OK;
+
+error_destroy_finish:
+  pthread_cond_destroy(&state->finish);
+
+error_destroy_mutex:
+  pthread_mutex_destroy(&state->mutex);
+
+error_free_state:
+  OWL_FREE(state);
+
+  return OWL_ERROR_FATAL;
+}
+
+OWLAPI void owl_thread_task_deinit(struct owl_thread_task *task) {
+  struct owl_thread_task_state *state = task->opaque;
+
+  pthread_join(state->thread, NULL);
+  pthread_cond_destroy(&state->finish);
+  pthread_mutex_destroy(&state->mutex);
+
+  OWL_FREE(state);
+}
+
+OWLAPI void owl_thread_task_report(struct owl_thread_task *task,
+                                   int32_t progress) {
+  struct owl_thread_task_state *state = task->opaque;
+
+  pthread_mutex_lock(&state->mutex);
+  state->progress = progress;
+  pthread_mutex_unlock(&state->mutex);
+}
+
+OWLAPI int32_t owl_thread_task_progress(struct owl_thread_task *task) {
+  int32_t progress;
+  struct owl_thread_task_state *state = task->opaque;
+
+  pthread_mutex_lock(&state->mutex);
+  progress = state->progress;
+  pthread_mutex_unlock(&state->mutex);
+
+  return progress;
+}
+
+OWLAPI int owl_thread_task_done(struct owl_thread_task *task) {
+  int done;
+  struct owl_thread_task_state *state = task->opaque;
+
+  pthread_mutex_lock(&state->mutex);
+  done = state->done;
+  pthread_mutex_unlock(&state->mutex);
+
+  return done;
+}
+
+OWLAPI void owl_thread_task_wait(struct owl_thread_task *task) {
+  struct owl_thread_task_state *state = task->opaque;
+
+  pthread_mutex_lock(&state->mutex);
+  while (!state->done)
+    pthread_cond_wait(&state->finish, &state->mutex);
+  pthread_mutex_unlock(&state->mutex);
+}
@@ -1 +1,68 @@
-/* TODO */
+#ifndef OWL_THREAD_H
+#define OWL_THREAD_H
+
+#include "owl_definitions.h"
+
+OWL_BEGIN_DECLARATIONS
+
+#define OWL_MAX_THREADS 32
+
+/* a fixed set of worker threads that run parallel for loops, the calling
+ * thread takes part in every loop */
+struct owl_thread_pool {
+  int32_t num_threads;
+  void *opaque;
+};
+
+OWLAPI int owl_thread_pool_init(struct owl_thread_pool *pool,
+                                int32_t num_threads);
+
+OWLAPI void owl_thread_pool_deinit(struct owl_thread_pool *pool);
+
+/* number of online cores, at least 1 */
+OWLAPI int32_t owl_thread_count_cores(void);
+
+/* calls fn(data, i) for every i in [0, count) and returns once all of them
+ * are done, the order and the thread each i runs on are unspecified */
+OWLAPI void owl_thread_pool_for(struct owl_thread_pool *pool, int32_t count,
+                                void (*fn)(void *data, int32_t i), void *data);
+
+/* like owl_thread_pool_for but also calls done(data, i) on the calling thread
+ * as soon as fn(data, i) has returned, in the order they finish. the calling
+ * thread runs the done calls first and fn only when none is ready */
+OWLAPI int owl_thread_pool_pipeline(struct owl_thread_pool *pool,
+                                    int32_t count,
+                                    void (*fn)(void *data, int32_t i),
+                                    void (*done)(void *data, int32_t i),
+                                    void *data);
+
+/* runs fn(data) once on a thread of its own, fn tells how far it got with
+ * owl_thread_task_report */
+struct owl_thread_task {
+  void *opaque;
+};
+
+OWLAPI int owl_thread_task_init(struct owl_thread_task *task,
+                                void (*fn)(void *data), void *data);
+
+/* waits for fn to return */
+OWLAPI void owl_thread_task_deinit(struct owl_thread_task *task);
+
+/* sets the progress of the task, everything fn wrote before is visible to
+ * whoever reads the new progress */
+OWLAPI void owl_thread_task_report(struct owl_thread_task *task,
+                                   int32_t progress);
+
+/* the last reported progress, 0 until the first report. never blocks on
+ * fn */
+OWLAPI int32_t owl_thread_task_progress(struct owl_thread_task *task);
+
+/* 1 once fn has returned, everything it wrote is visible from then on */
+OWLAPI int owl_thread_task_done(struct owl_thread_task *task);
+
+/* blocks until fn has returned */
+OWLAPI void owl_thread_task_wait(struct owl_thread_task *task);
+
+OWL_END_DECLARATIONS
+
+#endif